@@ -0,0 +1,691 @@
+/*
+ * Droidspaces v5 - Daemon protocol load and fault-injection harness
+ *
+ * Starts a private daemon on its own abstract socket (DS_DAEMON_SOCK, so a
+ * real @droidspaces daemon is left alone) and points hundreds of concurrent
+ * clients at it. Each client loops over a mix of well-formed requests
+ * (pipe, pty and stdin-streaming sessions of `version` and `help`) and
+ * faults:
+ *
+ *   partial     sends half a request header, then holds the connection
+ *   slow        pty `help` read a few bytes at a time
+ *   disconnect  full request, then an RST before the reply is read
+ *   garbage     a request with an impossible argc
+ *
+ * Once a second it samples the daemon's open fds, its live handler
+ * processes and zombies among its descendants; at the end it reports
+ * throughput, latency percentiles per request kind, and what was still
+ * open once the clients stopped (fd leaks, stuck handlers, zombies).
+ *
+ * Needs root (the daemon does). Built and run by `make daemonbench`; the
+ * daemon's own log still goes to the usual droidspacesd.log.
+ *
+ * Copyright (C) 2026 ravindu644 <droidcasts@protonmail.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "droidspace.h"
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <stddef.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/* Wire protocol, mirrored from daemon.c */
+#define MSG_OUT ((uint8_t)0x01)
+#define MSG_ERR ((uint8_t)0x02)
+#define MSG_EXIT ((uint8_t)0xFF)
+#define REQ_FLAG_PTY (1u << 0)
+#define REQ_FLAG_STDIN (1u << 1)
+
+#define DL_MAX_CLIENTS 2048
+#define DL_MAX_SAMPLES 3600
+#define DL_REPLY_TIMEOUT_S 30
+#define DL_DRAIN_TIMEOUT_MS 20000
+
+enum dl_kind {
+  K_PIPE,
+  K_PTY,
+  K_HELP,
+  K_STDIN,
+  K_PARTIAL,
+  K_SLOW,
+  K_DISCONNECT,
+  K_GARBAGE,
+  K_COUNT
+};
+
+static const char *const kind_names[K_COUNT] = {
+    "pipe", "pty", "help", "stdin", "partial", "slow", "disconnect", "garbage"};
+
+/* The first DL_LAT_CAP latencies of each kind; plenty for percentiles */
+#define DL_LAT_CAP 200000
+
+struct dl_stats {
+  pthread_mutex_t lock;
+  double *lat[K_COUNT];
+  int nlat[K_COUNT];
+  long ok[K_COUNT], failed[K_COUNT];
+  long partial_closed; /* partial requests the daemon gave up on */
+};
+
+struct dl_sample {
+  double t;
+  long done;
+  int fds, handlers, zombies;
+};
+
+static struct dl_stats g_stats = {.lock = PTHREAD_MUTEX_INITIALIZER};
+static struct dl_sample g_samples[DL_MAX_SAMPLES];
+static int g_nsamples;
+
+static char g_sock[64];
+static pid_t g_daemon = -1;
+static volatile int g_stop;
+static volatile sig_atomic_t g_interrupted;
+
+/* Percentages of each fault among all requests */
+static int g_pct_partial = 5, g_pct_slow = 5, g_pct_disconnect = 10,
+           g_pct_garbage = 2;
+static int g_partial_hold_s = 15;
+
+/* ---------------------------------------------------------------------------
+ * Helpers
+ * ---------------------------------------------------------------------------*/
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static int cmp_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static double percentile(const double *v, int n, double p) {
+  if (n <= 0)
+    return -1;
+  int idx = (int)(p / 100.0 * (n - 1) + 0.5);
+  return v[idx < n ? idx : n - 1];
+}
+
+static int send_all(int fd, const void *buf, size_t len) {
+  const char *p = buf;
+  while (len) {
+    ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return -1;
+    p += n;
+    len -= (size_t)n;
+  }
+  return 0;
+}
+
+static int recv_all(int fd, void *buf, size_t len) {
+  char *p = buf;
+  while (len) {
+    ssize_t n = recv(fd, p, len, 0);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return -1;
+    p += n;
+    len -= (size_t)n;
+  }
+  return 0;
+}
+
+static int dl_connect(void) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  size_t nlen = strlen(g_sock);
+  memcpy(addr.sun_path + 1, g_sock, nlen);
+  socklen_t alen =
+      (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + nlen);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return -1;
+  struct timeval tv = {DL_REPLY_TIMEOUT_S, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  if (connect(fd, (struct sockaddr *)&addr, alen) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/* Serialise a request the way ds_client_run() does */
+static size_t build_req(uint8_t *buf, size_t size, uint32_t flags, int argc,
+                        const char *const *argv) {
+  size_t off = 0;
+  uint32_t v = htonl(flags);
+  memcpy(buf + off, &v, 4);
+  off += 4;
+  v = htonl((uint32_t)argc);
+  memcpy(buf + off, &v, 4);
+  off += 4;
+  for (int i = 0; i < argc; i++) {
+    uint32_t len = (uint32_t)strlen(argv[i]);
+    if (off + 4 + len + 4 > size)
+      return 0;
+    v = htonl(len);
+    memcpy(buf + off, &v, 4);
+    memcpy(buf + off + 4, argv[i], len);
+    off += 4 + len;
+  }
+  if (flags & REQ_FLAG_PTY) {
+    uint16_t ws[2] = {htons(24), htons(80)};
+    memcpy(buf + off, ws, 4);
+    off += 4;
+  }
+  return off;
+}
+
+static int send_frame(int fd, uint8_t type, const void *data, uint32_t len) {
+  uint8_t hdr[5];
+  uint32_t nl = htonl(len);
+  hdr[0] = type;
+  memcpy(hdr + 1, &nl, 4);
+  if (send_all(fd, hdr, 5) < 0)
+    return -1;
+  return len ? send_all(fd, data, len) : 0;
+}
+
+/*
+ * Read frames until MSG_EXIT. chunk > 0 reads payloads that many bytes at a
+ * time with pause_ms in between (a slow reader). Returns the exit code or
+ * -1 when the stream broke first.
+ */
+static int read_until_exit(int fd, size_t chunk, int pause_ms) {
+  char buf[8192];
+  for (;;) {
+    uint8_t hdr[5];
+    if (recv_all(fd, hdr, 5) < 0)
+      return -1;
+    uint32_t len;
+    memcpy(&len, hdr + 1, 4);
+    len = ntohl(len);
+    if (hdr[0] == MSG_EXIT) {
+      uint32_t code = 0;
+      if (len != 4 || recv_all(fd, &code, 4) < 0)
+        return -1;
+      return (int)ntohl(code);
+    }
+    while (len) {
+      size_t want = len < sizeof(buf) ? len : sizeof(buf);
+      if (chunk && want > chunk)
+        want = chunk;
+      if (recv_all(fd, buf, want) < 0)
+        return -1;
+      len -= (uint32_t)want;
+      if (pause_ms)
+        usleep((useconds_t)pause_ms * 1000);
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------------
+ * Client operations
+ * ---------------------------------------------------------------------------*/
+
+static int op_session(enum dl_kind kind) {
+  static const char *const version[] = {"version"};
+  static const char *const help[] = {"help"};
+  uint8_t req[256];
+  uint32_t flags = kind == K_PTY || kind == K_SLOW ? REQ_FLAG_PTY
+                   : kind == K_STDIN               ? REQ_FLAG_STDIN
+                                                   : 0;
+  int use_help = kind == K_HELP || kind == K_SLOW;
+  size_t len = build_req(req, sizeof(req), flags, 1, use_help ? help : version);
+
+  int fd = dl_connect();
+  if (fd < 0)
+    return -1;
+  int rc = send_all(fd, req, len);
+  if (rc == 0 && kind == K_STDIN) {
+    rc = send_frame(fd, MSG_OUT, "ping\n", 5);
+    if (rc == 0)
+      rc = send_frame(fd, MSG_OUT, NULL, 0); /* eof */
+  }
+  if (rc == 0)
+    rc = read_until_exit(fd, kind == K_SLOW ? 64 : 0, kind == K_SLOW ? 20 : 0);
+  close(fd);
+  return rc == 0 ? 0 : -1;
+}
+
+/* Half a request, then silence: the daemon should time the handler out */
+static int op_partial(void) {
+  static const char *const version[] = {"version"};
+  uint8_t req[64];
+  size_t len = build_req(req, sizeof(req), 0, 1, version);
+  int fd = dl_connect();
+  if (fd < 0)
+    return -1;
+  if (send_all(fd, req, len / 2) < 0) {
+    close(fd);
+    return -1;
+  }
+
+  struct timeval tv = {1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  double deadline = now_ms() + g_partial_hold_s * 1000.0;
+  int closed = 0;
+  while (!closed && !g_stop && now_ms() < deadline) {
+    char c;
+    ssize_t n = recv(fd, &c, 1, 0);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+      closed = 1;
+  }
+  close(fd);
+  if (closed) {
+    pthread_mutex_lock(&g_stats.lock);
+    g_stats.partial_closed++;
+    pthread_mutex_unlock(&g_stats.lock);
+  }
+  return 0;
+}
+
+/* Full request, then an RST instead of reading the reply */
+static int op_disconnect(void) {
+  static const char *const help[] = {"help"};
+  uint8_t req[64];
+  size_t len = build_req(req, sizeof(req), REQ_FLAG_PTY, 1, help);
+  int fd = dl_connect();
+  if (fd < 0)
+    return -1;
+  int rc = send_all(fd, req, len);
+  struct linger lg = {1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+  close(fd);
+  return rc;
+}
+
+/* argc 0 must be refused with MSG_ERR + MSG_EXIT 1 */
+static int op_garbage(void) {
+  uint32_t req[2] = {0, 0};
+  int fd = dl_connect();
+  if (fd < 0)
+    return -1;
+  int rc = send_all(fd, req, sizeof(req)) == 0 ? read_until_exit(fd, 0, 0) : -1;
+  close(fd);
+  return rc == 1 ? 0 : -1;
+}
+
+static enum dl_kind pick_kind(unsigned int *seed) {
+  int r = (int)(rand_r(seed) % 100);
+  if ((r -= g_pct_partial) < 0)
+    return K_PARTIAL;
+  if ((r -= g_pct_slow) < 0)
+    return K_SLOW;
+  if ((r -= g_pct_disconnect) < 0)
+    return K_DISCONNECT;
+  if ((r -= g_pct_garbage) < 0)
+    return K_GARBAGE;
+  static const enum dl_kind normal[] = {K_PIPE, K_PIPE, K_PIPE, K_PTY,
+                                        K_PTY,  K_PTY,  K_HELP, K_STDIN};
+  return normal[rand_r(seed) % (sizeof(normal) / sizeof(normal[0]))];
+}
+
+static void *client_main(void *arg) {
+  unsigned int seed = (unsigned int)(uintptr_t)arg * 2654435761u;
+  while (!g_stop) {
+    enum dl_kind kind = pick_kind(&seed);
+    double t0 = now_ms();
+    int rc;
+    switch (kind) {
+    case K_PARTIAL:
+      rc = op_partial();
+      break;
+    case K_DISCONNECT:
+      rc = op_disconnect();
+      break;
+    case K_GARBAGE:
+      rc = op_garbage();
+      break;
+    default:
+      rc = op_session(kind);
+      break;
+    }
+    double ms = now_ms() - t0;
+
+    pthread_mutex_lock(&g_stats.lock);
+    if (rc == 0) {
+      g_stats.ok[kind]++;
+      if (g_stats.nlat[kind] < DL_LAT_CAP)
+        g_stats.lat[kind][g_stats.nlat[kind]++] = ms;
+    } else {
+      g_stats.failed[kind]++;
+    }
+    pthread_mutex_unlock(&g_stats.lock);
+    if (rc < 0 && !g_stop)
+      usleep(10000); /* don't spin on a dead daemon */
+  }
+  return NULL;
+}
+
+/* ---------------------------------------------------------------------------
+ * Daemon observation
+ * ---------------------------------------------------------------------------*/
+
+static int count_fds(pid_t pid) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/fd", pid);
+  DIR *d = opendir(path);
+  if (!d)
+    return -1;
+  int n = 0;
+  struct dirent *de;
+  while ((de = readdir(d)))
+    if (de->d_name[0] != '.')
+      n++;
+  closedir(d);
+  return n;
+}
+
+/* Live descendants of the daemon (handlers and their sessions) and zombies
+ * among them */
+static void count_tree(pid_t root, int *live, int *zombies) {
+  static pid_t pids[65536], ppids[65536];
+  static char states[65536];
+  int n = 0;
+  DIR *d = opendir("/proc");
+  struct dirent *de;
+  while (d && (de = readdir(d)) && n < 65536) {
+    if (de->d_name[0] < '0' || de->d_name[0] > '9')
+      continue;
+    char path[300], buf[512];
+    snprintf(path, sizeof(path), "/proc/%s/stat", de->d_name);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      continue;
+    ssize_t len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len <= 0)
+      continue;
+    buf[len] = '\0';
+    char *rp = strrchr(buf, ')');
+    int ppid;
+    char st;
+    if (!rp || sscanf(rp + 2, "%c %d", &st, &ppid) != 2)
+      continue;
+    pids[n] = atoi(de->d_name);
+    ppids[n] = ppid;
+    states[n] = st;
+    n++;
+  }
+  if (d)
+    closedir(d);
+
+  /* Walk down from the daemon; descendant depth is small */
+  static char in_tree[65536];
+  memset(in_tree, 0, (size_t)n);
+  *live = *zombies = 0;
+  for (int changed = 1; changed;) {
+    changed = 0;
+    for (int i = 0; i < n; i++) {
+      if (in_tree[i])
+        continue;
+      int parent_in = ppids[i] == root;
+      for (int j = 0; !parent_in && j < n; j++)
+        parent_in = in_tree[j] && pids[j] == ppids[i];
+      if (parent_in) {
+        in_tree[i] = 1;
+        changed = 1;
+        if (states[i] == 'Z')
+          (*zombies)++;
+        else
+          (*live)++;
+      }
+    }
+  }
+}
+
+static void sample(double t0) {
+  if (g_nsamples >= DL_MAX_SAMPLES)
+    return;
+  struct dl_sample *s = &g_samples[g_nsamples++];
+  s->t = (now_ms() - t0) / 1000.0;
+  s->fds = count_fds(g_daemon);
+  count_tree(g_daemon, &s->handlers, &s->zombies);
+  pthread_mutex_lock(&g_stats.lock);
+  s->done = 0;
+  for (int k = 0; k < K_COUNT; k++)
+    s->done += g_stats.ok[k] + g_stats.failed[k];
+  pthread_mutex_unlock(&g_stats.lock);
+  fprintf(stderr, "[%6.1fs] requests %-8ld fds %-4d handlers %-5d zombies %d\n",
+          s->t, s->done, s->fds, s->handlers, s->zombies);
+}
+
+static pid_t start_daemon(const char *bin) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    int dn = open("/dev/null", O_RDWR);
+    if (dn >= 0) {
+      dup2(dn, STDIN_FILENO);
+      dup2(dn, STDOUT_FILENO);
+      dup2(dn, STDERR_FILENO);
+    }
+    setenv("DS_DAEMON_SOCK", g_sock, 1);
+    execl(bin, bin, "daemon", "--foreground", (char *)NULL);
+    _exit(127);
+  }
+  if (pid < 0)
+    return -1;
+
+  /* Ready once it accepts */
+  for (int i = 0; i < 100; i++) {
+    int fd = dl_connect();
+    if (fd >= 0) {
+      close(fd);
+      return pid;
+    }
+    if (waitpid(pid, NULL, WNOHANG) == pid)
+      return -1;
+    usleep(50000);
+  }
+  kill(pid, SIGKILL);
+  waitpid(pid, NULL, 0);
+  return -1;
+}
+
+/* ---------------------------------------------------------------------------
+ * Report
+ * ---------------------------------------------------------------------------*/
+
+static void print_json(FILE *out, int clients, double secs, int base_fds,
+                       int end_fds, int end_handlers, int end_zombies) {
+  long total = 0;
+  for (int k = 0; k < K_COUNT; k++)
+    total += g_stats.ok[k] + g_stats.failed[k];
+
+  fprintf(out, "{\n  \"bench\": \"daemon\",\n  \"version\": \"%s\",\n",
+          DS_VERSION);
+  fprintf(out,
+          "  \"clients\": %d,\n  \"seconds\": %.1f,\n"
+          "  \"requests_per_sec\": %.1f,\n",
+          clients, secs, secs > 0 ? total / secs : 0.0);
+  fprintf(out,
+          "  \"faults_pct\": {\"partial\": %d, \"slow\": %d, "
+          "\"disconnect\": %d, \"garbage\": %d},\n",
+          g_pct_partial, g_pct_slow, g_pct_disconnect, g_pct_garbage);
+  fprintf(out, "  \"partial_closed_by_daemon\": %ld,\n",
+          g_stats.partial_closed);
+  fprintf(out,
+          "  \"leaks\": {\"fds_before\": %d, \"fds_after\": %d, "
+          "\"handlers_after\": %d, \"zombies_after\": %d},\n",
+          base_fds, end_fds, end_handlers, end_zombies);
+
+  fprintf(out, "  \"kinds\": [\n");
+  for (int k = 0; k < K_COUNT; k++) {
+    int n = g_stats.nlat[k];
+    qsort(g_stats.lat[k], (size_t)n, sizeof(double), cmp_double);
+    fprintf(out,
+            "    {\"kind\": \"%s\", \"ok\": %ld, \"failed\": %ld, "
+            "\"p50_ms\": %.2f, \"p90_ms\": %.2f, \"p99_ms\": %.2f, "
+            "\"max_ms\": %.2f}%s\n",
+            kind_names[k], g_stats.ok[k], g_stats.failed[k],
+            percentile(g_stats.lat[k], n, 50), percentile(g_stats.lat[k], n, 90),
+            percentile(g_stats.lat[k], n, 99), n ? g_stats.lat[k][n - 1] : -1.0,
+            k + 1 < K_COUNT ? "," : "");
+  }
+  fprintf(out, "  ],\n  \"samples\": [\n");
+  for (int i = 0; i < g_nsamples; i++) {
+    const struct dl_sample *s = &g_samples[i];
+    fprintf(out,
+            "    {\"t\": %.1f, \"requests\": %ld, \"fds\": %d, "
+            "\"handlers\": %d, \"zombies\": %d}%s\n",
+            s->t, s->done, s->fds, s->handlers, s->zombies,
+            i + 1 < g_nsamples ? "," : "");
+  }
+  fprintf(out, "  ]\n}\n");
+}
+
+static void on_interrupt(int sig) {
+  (void)sig;
+  g_interrupted = 1;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "Usage: %s [-b BIN] [-c CLIENTS] [-t SECONDS] [-f P,S,D,G] "
+          "[-H SECONDS] [-o FILE]\n"
+          "  -b BIN        droidspaces binary (default output/droidspaces)\n"
+          "  -c CLIENTS    concurrent clients (default 200)\n"
+          "  -t SECONDS    load duration (default 20)\n"
+          "  -f P,S,D,G    percent partial, slow, disconnect, garbage "
+          "(default 5,5,10,2)\n"
+          "  -H SECONDS    how long a partial client holds on (default 15)\n"
+          "  -o FILE       write the JSON report to FILE instead of stdout\n",
+          argv0);
+}
+
+int main(int argc, char **argv) {
+  const char *bin = "output/droidspaces", *outfile = NULL;
+  int clients = 200, seconds = 20, opt;
+
+  while ((opt = getopt(argc, argv, "b:c:t:f:H:o:h")) != -1) {
+    switch (opt) {
+    case 'b':
+      bin = optarg;
+      break;
+    case 'c':
+      clients = atoi(optarg);
+      break;
+    case 't':
+      seconds = atoi(optarg);
+      break;
+    case 'f':
+      if (sscanf(optarg, "%d,%d,%d,%d", &g_pct_partial, &g_pct_slow,
+                 &g_pct_disconnect, &g_pct_garbage) != 4) {
+        usage(argv[0]);
+        return 2;
+      }
+      break;
+    case 'H':
+      g_partial_hold_s = atoi(optarg);
+      break;
+    case 'o':
+      outfile = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 2;
+    }
+  }
+  if (clients < 1 || clients > DL_MAX_CLIENTS || seconds < 1 ||
+      g_pct_partial + g_pct_slow + g_pct_disconnect + g_pct_garbage > 100) {
+    usage(argv[0]);
+    return 2;
+  }
+  if (getuid() != 0) {
+    fprintf(stderr, "daemonbench: the daemon needs root\n");
+    return 2;
+  }
+
+  /* Each client may hold a connection plus a pty/pipe pair on our side */
+  struct rlimit rl;
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGINT, on_interrupt);
+  signal(SIGTERM, on_interrupt);
+
+  for (int k = 0; k < K_COUNT; k++) {
+    g_stats.lat[k] = malloc(DL_LAT_CAP * sizeof(double));
+    if (!g_stats.lat[k])
+      return 1;
+  }
+
+  snprintf(g_sock, sizeof(g_sock), "droidspaces-bench-%d", getpid());
+  g_daemon = start_daemon(bin);
+  if (g_daemon < 0) {
+    fprintf(stderr, "daemonbench: could not start '%s daemon'\n", bin);
+    return 1;
+  }
+  int base_fds = count_fds(g_daemon);
+  fprintf(stderr, "daemonbench: daemon PID %d on @%s, %d clients for %ds\n",
+          g_daemon, g_sock, clients, seconds);
+
+  pthread_t *threads = calloc((size_t)clients, sizeof(pthread_t));
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, 256 * 1024);
+  int started = 0;
+  for (int i = 0; threads && i < clients; i++) {
+    if (pthread_create(&threads[i], &attr, client_main,
+                       (void *)(uintptr_t)(i + 1)) != 0)
+      break;
+    started++;
+  }
+  pthread_attr_destroy(&attr);
+
+  double t0 = now_ms();
+  while (!g_interrupted && now_ms() - t0 < seconds * 1000.0) {
+    usleep(1000000);
+    sample(t0);
+  }
+  double secs = (now_ms() - t0) / 1000.0;
+  g_stop = 1;
+  for (int i = 0; i < started; i++)
+    pthread_join(threads[i], NULL);
+  free(threads);
+
+  /* Let handlers of finished sessions exit, then look for leftovers */
+  int end_fds, end_handlers = 0, end_zombies = 0;
+  double drain_start = now_ms();
+  do {
+    usleep(200000);
+    count_tree(g_daemon, &end_handlers, &end_zombies);
+  } while ((end_handlers || end_zombies) &&
+           now_ms() - drain_start < DL_DRAIN_TIMEOUT_MS);
+  end_fds = count_fds(g_daemon);
+  sample(t0);
+
+  kill(g_daemon, SIGTERM);
+  waitpid(g_daemon, NULL, 0);
+
+  FILE *out = outfile ? fopen(outfile, "w") : stdout;
+  if (!out) {
+    fprintf(stderr, "daemonbench: %s: %s\n", outfile, strerror(errno));
+    out = stdout;
+  }
+  print_json(out, started, secs, base_fds, end_fds, end_handlers, end_zombies);
+  if (out != stdout)
+    fclose(out);
+
+  int leaked = end_fds > base_fds || end_handlers || end_zombies;
+  if (leaked)
+    fprintf(stderr, "daemonbench: leftovers after the run (fds %d -> %d, "
+                    "%d handlers, %d zombies)\n",
+            base_fds, end_fds, end_handlers, end_zombies);
+  return leaked ? 1 : 0;
+}
@@ -0,0 +1,622 @@
+/*
+ * Droidspaces v5 - Container lifecycle benchmark
+ *
+ * Drives a droidspaces binary through start, restart, stop, enter, run and
+ * status/show with 1, 10 and 50 running containers and prints latency
+ * percentiles as JSON, so releases can be compared on the same host.
+ *
+ * Needs root on a plain Linux host. Each container gets a throwaway rootfs
+ * in a temp directory whose init, sh and true are this very binary (a
+ * static multi-call executable, like busybox), so nothing has to be
+ * downloaded and the numbers measure Droidspaces rather than a distro's
+ * boot. Built and run by `make bench`.
+ *
+ * Copyright (C) 2026 ravindu644 <droidcasts@protonmail.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "droidspace.h"
+#include <ftw.h>
+
+#define BENCH_PREFIX "dsbench-"
+#define BENCH_MAX_CONTAINERS 256
+#define BENCH_ENTER_TIMEOUT_MS 15000
+
+/* ---------------------------------------------------------------------------
+ * Multi-call applets for the generated rootfs
+ * ---------------------------------------------------------------------------*/
+
+static volatile sig_atomic_t g_init_stop = 0;
+
+static void init_on_signal(int sig) {
+  if (sig != SIGCHLD)
+    g_init_stop = 1;
+}
+
+/* PID 1: reap children until any of the stop signals Droidspaces sends */
+static int applet_init(void) {
+  int stop_sigs[] = {SIGTERM, SIGPWR, SIGINT, SIGUSR1, SIGUSR2, SIGRTMIN + 3};
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = init_on_signal;
+  sigset_t block, old;
+  sigemptyset(&block);
+  sigaddset(&block, SIGCHLD);
+  sigaction(SIGCHLD, &sa, NULL);
+  for (size_t i = 0; i < sizeof(stop_sigs) / sizeof(stop_sigs[0]); i++) {
+    sigaddset(&block, stop_sigs[i]);
+    sigaction(stop_sigs[i], &sa, NULL);
+  }
+  sigprocmask(SIG_BLOCK, &block, &old);
+
+  for (;;) {
+    while (waitpid(-1, NULL, WNOHANG) > 0)
+      ;
+    if (g_init_stop)
+      break;
+    sigsuspend(&old);
+  }
+  kill(-1, SIGKILL);
+  return 0;
+}
+
+static int sh_run_line(char *line) {
+  char *argv[32];
+  int argc = 0;
+  for (char *tok = strtok(line, " \t\r\n"); tok && argc < 31;
+       tok = strtok(NULL, " \t\r\n"))
+    argv[argc++] = tok;
+  argv[argc] = NULL;
+  if (argc == 0)
+    return 0;
+  if (strcmp(argv[0], "exit") == 0)
+    exit(argc > 1 ? atoi(argv[1]) : 0);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    execvp(argv[0], argv);
+    _exit(127);
+  }
+  int status = 0;
+  if (pid < 0 || waitpid(pid, &status, 0) < 0)
+    return 1;
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+/* Just enough shell for `sh -c CMD` and an interactive `exit` */
+static int applet_sh(int argc, char **argv) {
+  for (int i = 1; i + 1 < argc; i++)
+    if (strcmp(argv[i], "-c") == 0)
+      return sh_run_line(argv[i + 1]);
+
+  int interactive = isatty(STDIN_FILENO);
+  char line[1024];
+  int ret = 0;
+  for (;;) {
+    if (interactive && write(STDOUT_FILENO, "# ", 2) < 0)
+      return 1;
+    if (!fgets(line, sizeof(line), stdin))
+      return ret;
+    ret = sh_run_line(line);
+  }
+}
+
+/* ---------------------------------------------------------------------------
+ * Samples and percentiles
+ * ---------------------------------------------------------------------------*/
+
+struct series {
+  const char *op;
+  int containers;
+  double *ms;
+  int count, cap;
+  int failures;
+};
+
+static struct series *g_series;
+static int g_series_count;
+
+static struct series *series_get(const char *op, int containers) {
+  for (int i = 0; i < g_series_count; i++)
+    if (g_series[i].containers == containers &&
+        strcmp(g_series[i].op, op) == 0)
+      return &g_series[i];
+  struct series *p =
+      realloc(g_series, (size_t)(g_series_count + 1) * sizeof(*p));
+  if (!p) {
+    perror("realloc");
+    exit(1);
+  }
+  g_series = p;
+  p = &g_series[g_series_count++];
+  memset(p, 0, sizeof(*p));
+  p->op = op;
+  p->containers = containers;
+  return p;
+}
+
+static void series_add(struct series *s, double ms) {
+  if (ms < 0) {
+    s->failures++;
+    return;
+  }
+  if (s->count == s->cap) {
+    int cap = s->cap ? s->cap * 2 : 64;
+    double *p = realloc(s->ms, (size_t)cap * sizeof(*p));
+    if (!p) {
+      perror("realloc");
+      exit(1);
+    }
+    s->ms = p;
+    s->cap = cap;
+  }
+  s->ms[s->count++] = ms;
+}
+
+static int cmp_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted samples */
+static double percentile(const double *v, int n, double p) {
+  int rank = (int)(p / 100.0 * n + 0.999999);
+  if (rank < 1)
+    rank = 1;
+  if (rank > n)
+    rank = n;
+  return v[rank - 1];
+}
+
+/* ---------------------------------------------------------------------------
+ * Running the binary under test
+ * ---------------------------------------------------------------------------*/
+
+static char *g_bin = "output/droidspaces";
+static const char *g_tmpdir;
+static char g_errlog[PATH_MAX];
+static volatile sig_atomic_t g_interrupted = 0;
+
+static int slurp(const char *path, char *buf, size_t size) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+  ssize_t r = read(fd, buf, size - 1);
+  close(fd);
+  buf[r > 0 ? r : 0] = '\0';
+  return r < 0 ? -1 : 0;
+}
+
+static int spit(int fd, const void *buf, size_t len) {
+  const char *p = buf;
+  while (len > 0) {
+    ssize_t w = write(fd, p, len);
+    if (w < 0 && errno == EINTR)
+      continue;
+    if (w <= 0)
+      return -1;
+    p += w;
+    len -= (size_t)w;
+  }
+  return 0;
+}
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static void child_stdio(void) {
+  int devnull = open("/dev/null", O_RDWR);
+  int err = open(g_errlog, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (devnull >= 0) {
+    dup2(devnull, STDIN_FILENO);
+    dup2(devnull, STDOUT_FILENO);
+  }
+  if (err >= 0)
+    dup2(err, STDERR_FILENO);
+}
+
+static void report_failure(char *const argv[], int status) {
+  fprintf(stderr, "[bench] failed (status %d):", status);
+  for (int i = 0; argv[i]; i++)
+    fprintf(stderr, " %s", argv[i]);
+  fprintf(stderr, "\n");
+  char buf[2048];
+  if (slurp(g_errlog, buf, sizeof(buf)) == 0 && buf[0])
+    fprintf(stderr, "%s\n", buf);
+}
+
+/* Wall time of one invocation in ms, or -1 if it did not exit 0 */
+static double run_timed(char *const argv[]) {
+  double t0 = now_ms();
+  pid_t pid = fork();
+  if (pid < 0)
+    return -1;
+  if (pid == 0) {
+    child_stdio();
+    execv(argv[0], argv);
+    _exit(127);
+  }
+  int status;
+  if (waitpid(pid, &status, 0) < 0)
+    return -1;
+  double ms = now_ms() - t0;
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    report_failure(argv, status);
+    return -1;
+  }
+  return ms;
+}
+
+static double ds_op(int idx, char *verb, char *arg) {
+  char name[64], rootfs[PATH_MAX + 32];
+  snprintf(name, sizeof(name), "--name=" BENCH_PREFIX "%d", idx);
+  snprintf(rootfs, sizeof(rootfs), "--rootfs=%s/ct-%d/rootfs", g_tmpdir, idx);
+  char *argv[6];
+  int n = 0;
+  argv[n++] = g_bin;
+  argv[n++] = name;
+  if (strcmp(verb, "start") == 0)
+    argv[n++] = rootfs;
+  argv[n++] = verb;
+  if (arg)
+    argv[n++] = arg;
+  argv[n] = NULL;
+  return run_timed(argv);
+}
+
+/* `enter` on a PTY: wait for the prompt, type exit, time until it returns */
+static double ds_enter(int idx) {
+  char name[64];
+  snprintf(name, sizeof(name), "--name=" BENCH_PREFIX "%d", idx);
+  char *argv[] = {g_bin, name, "enter", NULL};
+
+  double t0 = now_ms();
+  int master;
+  pid_t pid = forkpty(&master, NULL, NULL, NULL);
+  if (pid < 0)
+    return -1;
+  if (pid == 0) {
+    execv(argv[0], argv);
+    _exit(127);
+  }
+
+  char tail[2] = {0, 0};
+  int sent = 0, status = -1;
+  while (now_ms() - t0 < BENCH_ENTER_TIMEOUT_MS) {
+    if (waitpid(pid, &status, WNOHANG) == pid)
+      break;
+    struct pollfd pfd = {.fd = master, .events = POLLIN};
+    if (poll(&pfd, 1, 50) <= 0)
+      continue;
+    char buf[512];
+    ssize_t r = read(master, buf, sizeof(buf));
+    if (r <= 0) {
+      waitpid(pid, &status, 0);
+      break;
+    }
+    for (ssize_t i = 0; i < r && !sent; i++) {
+      tail[0] = tail[1];
+      tail[1] = buf[i];
+      if (tail[0] == '#' && tail[1] == ' ') {
+        sent = write(master, "exit\n", 5) == 5;
+      }
+    }
+  }
+  double ms = now_ms() - t0;
+  close(master);
+  if (status == -1) {
+    kill(pid, SIGKILL);
+    waitpid(pid, &status, 0);
+    fprintf(stderr, "[bench] enter %s timed out\n", name);
+    return -1;
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    report_failure(argv, status);
+    return -1;
+  }
+  return ms;
+}
+
+static double ds_show(void) {
+  char *argv[] = {g_bin, "show", NULL};
+  return run_timed(argv);
+}
+
+/* ---------------------------------------------------------------------------
+ * Generated rootfs
+ * ---------------------------------------------------------------------------*/
+
+static int write_text(const char *dir, const char *rel, const char *text) {
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s/%s", dir, rel);
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return -1;
+  int ret = spit(fd, text, strlen(text));
+  close(fd);
+  return ret;
+}
+
+static int copy_self(const char *dst) {
+  int in = open("/proc/self/exe", O_RDONLY | O_CLOEXEC);
+  int out = open(dst, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0755);
+  int ok = in >= 0 && out >= 0;
+  char buf[65536];
+  ssize_t r;
+  while (ok && (r = read(in, buf, sizeof(buf))) > 0)
+    ok = spit(out, buf, (size_t)r) == 0;
+  if (in >= 0)
+    close(in);
+  if (out >= 0)
+    close(out);
+  return ok ? 0 : -1;
+}
+
+static int make_rootfs(int idx, const char *multicall) {
+  static const char *const dirs[] = {"bin", "sbin", "etc", "dev", "proc", "sys",
+                                     "tmp", "run", "root", "var", "usr", NULL};
+  static const char *const links[][2] = {
+      {"sbin/init", "/bin/dsbench"}, {"bin/sh", "dsbench"},
+      {"bin/true", "dsbench"}, {NULL, NULL}};
+  char root[PATH_MAX], path[PATH_MAX + 64];
+  /* One parent per rootfs: start saves container.config next to it */
+  snprintf(root, sizeof(root), "%s/ct-%d", g_tmpdir, idx);
+  if (mkdir(root, 0755) < 0 && errno != EEXIST)
+    return -1;
+  strncat(root, "/rootfs", sizeof(root) - strlen(root) - 1);
+  if (mkdir(root, 0755) < 0 && errno != EEXIST)
+    return -1;
+  for (int i = 0; dirs[i]; i++) {
+    snprintf(path, sizeof(path), "%s/%s", root, dirs[i]);
+    mkdir(path, 0755);
+  }
+
+  snprintf(path, sizeof(path), "%s/bin/dsbench", root);
+  if (access(path, X_OK) != 0 && link(multicall, path) < 0 &&
+      copy_self(path) < 0)
+    return -1;
+  for (int i = 0; links[i][0]; i++) {
+    snprintf(path, sizeof(path), "%s/%s", root, links[i][0]);
+    if (symlink(links[i][1], path) < 0 && errno != EEXIST)
+      return -1;
+  }
+
+  char hostname[64];
+  snprintf(hostname, sizeof(hostname), BENCH_PREFIX "%d\n", idx);
+  if (write_text(root, "etc/passwd", "root:x:0:0:root:/root:/bin/sh\n") < 0 ||
+      write_text(root, "etc/group", "root:x:0:\n") < 0 ||
+      write_text(root, "etc/hostname", hostname) < 0 ||
+      write_text(root, "etc/os-release",
+                 "NAME=\"dsbench\"\nID=dsbench\nVERSION_ID=1\n") < 0)
+    return -1;
+  return 0;
+}
+
+static int rm_entry(const char *path, const struct stat *st, int flag,
+                    struct FTW *ftw) {
+  (void)st;
+  (void)ftw;
+  if (flag == FTW_DP)
+    rmdir(path);
+  else
+    unlink(path);
+  return 0;
+}
+
+/* FTW_MOUNT: never descend into anything a failed stop left mounted */
+static void rm_tree(const char *path) {
+  nftw(path, rm_entry, 16, FTW_DEPTH | FTW_PHYS | FTW_MOUNT);
+}
+
+/* ---------------------------------------------------------------------------
+ * Scenarios
+ * ---------------------------------------------------------------------------*/
+
+static int g_running[BENCH_MAX_CONTAINERS];
+
+static void stop_all(int upto) {
+  for (int i = 0; i < upto; i++) {
+    if (g_running[i])
+      ds_op(i, "stop", NULL);
+    g_running[i] = 0;
+  }
+}
+
+/* One round with n containers: start all, poke them, restart all, stop all */
+static int bench_round(int n, int iters) {
+  for (int i = 0; i < n && !g_interrupted; i++) {
+    double ms = ds_op(i, "start", NULL);
+    series_add(series_get("start", n), ms);
+    if (ms < 0)
+      return -1;
+    g_running[i] = 1;
+  }
+
+  for (int k = 0; k < iters && !g_interrupted; k++) {
+    int idx = k % n;
+    series_add(series_get("status", n), ds_op(idx, "status", NULL));
+    series_add(series_get("show", n), ds_show());
+    series_add(series_get("run_true", n), ds_op(idx, "run", "true"));
+    series_add(series_get("enter", n), ds_enter(idx));
+  }
+
+  for (int i = 0; i < n && !g_interrupted; i++)
+    series_add(series_get("restart", n), ds_op(i, "restart", NULL));
+
+  for (int i = 0; i < n; i++) {
+    if (!g_running[i])
+      continue;
+    series_add(series_get("stop", n), ds_op(i, "stop", NULL));
+    g_running[i] = 0;
+  }
+  return g_interrupted ? -1 : 0;
+}
+
+static void print_json(FILE *out, int rounds, int iters) {
+  struct utsname uts;
+  uname(&uts);
+  fprintf(out, "{\n  \"benchmark\": \"lifecycle\",\n");
+  fprintf(out, "  \"binary\": \"%s\",\n", g_bin);
+  fprintf(out, "  \"kernel\": \"%s\",\n  \"machine\": \"%s\",\n", uts.release,
+          uts.machine);
+  fprintf(out, "  \"cpus\": %ld,\n", sysconf(_SC_NPROCESSORS_ONLN));
+  fprintf(out, "  \"rounds\": %d,\n  \"iterations\": %d,\n", rounds, iters);
+  fprintf(out, "  \"results\": [");
+  for (int i = 0; i < g_series_count; i++) {
+    struct series *s = &g_series[i];
+    qsort(s->ms, (size_t)s->count, sizeof(double), cmp_double);
+    double sum = 0;
+    for (int j = 0; j < s->count; j++)
+      sum += s->ms[j];
+    fprintf(out, "%s\n    {\"op\": \"%s\", \"containers\": %d, "
+                 "\"samples\": %d, \"failures\": %d",
+            i ? "," : "", s->op, s->containers, s->count, s->failures);
+    if (s->count)
+      fprintf(out,
+              ", \"min_ms\": %.3f, \"p50_ms\": %.3f, \"p90_ms\": %.3f, "
+              "\"p99_ms\": %.3f, \"max_ms\": %.3f, \"mean_ms\": %.3f",
+              s->ms[0], percentile(s->ms, s->count, 50),
+              percentile(s->ms, s->count, 90),
+              percentile(s->ms, s->count, 99), s->ms[s->count - 1],
+              sum / s->count);
+    fprintf(out, "}");
+  }
+  fprintf(out, "\n  ]\n}\n");
+}
+
+static void on_interrupt(int sig) {
+  (void)sig;
+  g_interrupted = 1;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "Usage: %s [-b BINARY] [-n 1,10,50] [-r ROUNDS] [-k ITERS] "
+          "[-o FILE] [-d]\n"
+          "  -b  droidspaces binary under test (default output/droidspaces)\n"
+          "  -n  running-container counts to measure at\n"
+          "  -r  rounds per count (default 3)\n"
+          "  -k  status/show/run/enter iterations per round (default 20)\n"
+          "  -o  write the JSON report to FILE instead of stdout\n"
+          "  -d  go through a running daemon instead of direct mode\n",
+          argv0);
+}
+
+int main(int argc, char **argv) {
+  const char *self = strrchr(argv[0], '/');
+  self = self ? self + 1 : argv[0];
+  if (strcmp(self, "init") == 0)
+    return applet_init();
+  if (strcmp(self, "sh") == 0 || strcmp(self, "-sh") == 0)
+    return applet_sh(argc, argv);
+  if (strcmp(self, "true") == 0)
+    return 0;
+
+  const char *counts = "1,10,50", *outfile = NULL;
+  int rounds = 3, iters = 20, via_daemon = 0, opt;
+  while ((opt = getopt(argc, argv, "b:n:r:k:o:dh")) != -1) {
+    switch (opt) {
+    case 'b':
+      g_bin = optarg;
+      break;
+    case 'n':
+      counts = optarg;
+      break;
+    case 'r':
+      rounds = atoi(optarg);
+      break;
+    case 'k':
+      iters = atoi(optarg);
+      break;
+    case 'o':
+      outfile = optarg;
+      break;
+    case 'd':
+      via_daemon = 1;
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 2;
+    }
+  }
+  if (getuid() != 0) {
+    fprintf(stderr, "[bench] must be run as root\n");
+    return 2;
+  }
+  if (access(g_bin, X_OK) != 0) {
+    fprintf(stderr, "[bench] %s: %s\n", g_bin, strerror(errno));
+    return 2;
+  }
+  if (rounds < 1)
+    rounds = 1;
+  if (iters < 1)
+    iters = 1;
+  if (!via_daemon)
+    setenv("DS_NO_PROXY", "1", 1);
+
+  static char tmpl[] = "/tmp/ds-bench.XXXXXX";
+  g_tmpdir = mkdtemp(tmpl);
+  if (!g_tmpdir) {
+    perror("mkdtemp");
+    return 1;
+  }
+  snprintf(g_errlog, sizeof(g_errlog), "%s/stderr.log", g_tmpdir);
+  char multicall[PATH_MAX];
+  snprintf(multicall, sizeof(multicall), "%s/dsbench", g_tmpdir);
+  if (copy_self(multicall) < 0) {
+    fprintf(stderr, "[bench] cannot copy %s into %s\n", argv[0], g_tmpdir);
+    return 1;
+  }
+
+  signal(SIGINT, on_interrupt);
+  signal(SIGTERM, on_interrupt);
+
+  int max_n = 0, ret = 0;
+  char *list = strdup(counts);
+  for (char *tok = strtok(list, ","); tok && !g_interrupted && ret == 0;
+       tok = strtok(NULL, ",")) {
+    int n = atoi(tok);
+    if (n < 1 || n > BENCH_MAX_CONTAINERS) {
+      fprintf(stderr, "[bench] container count %d out of range\n", n);
+      ret = 2;
+      break;
+    }
+    for (; max_n < n; max_n++) {
+      if (make_rootfs(max_n, multicall) < 0) {
+        fprintf(stderr, "[bench] cannot build rootfs %d\n", max_n);
+        ret = 1;
+        break;
+      }
+    }
+    for (int r = 0; r < rounds && ret == 0; r++) {
+      fprintf(stderr, "[bench] %d container(s), round %d/%d\n", n, r + 1,
+              rounds);
+      if (bench_round(n, iters) < 0)
+        ret = 1;
+    }
+    stop_all(max_n);
+  }
+  free(list);
+
+  FILE *out = outfile ? fopen(outfile, "w") : stdout;
+  if (!out) {
+    perror(outfile);
+    out = stdout;
+  }
+  print_json(out, rounds, iters);
+  if (out != stdout)
+    fclose(out);
+
+  /* The containers' configs live in the workspace; the rootfs trees here */
+  for (int i = 0; i < max_n; i++) {
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s/Containers/" BENCH_PREFIX "%d",
+             DS_WORKSPACE_LINUX, i);
+    rm_tree(dir);
+  }
+  rm_tree(g_tmpdir);
+  return ret;
+}
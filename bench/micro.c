@@ -0,0 +1,701 @@
+/*
+ * Droidspaces v5 - Microbenchmarks for hot helpers
+ *
+ * Links the regular objects (everything but main.o) and times single calls
+ * to helpers that sit on scan, monitor and start paths: collect_pids(),
+ * find_container_by_name(), is_dangerous_node(), the /proc virtualizers,
+ * get_host_cgroups(), ds_config_load() and parse_cidr().  Last, getpid and
+ * read loops run once bare and once under the container seccomp filter
+ * (ds_seccomp_apply()), to show what the filter costs every syscall.
+ *
+ * Inputs come from a synthetic tree generated at startup (thousands of
+ * /proc/<pid> entries, a mountinfo the size of a busy Android device, 64-CPU
+ * stat/cpuinfo, a config with every list key filled). The tree is bind
+ * mounted over /proc inside a private mount namespace, using a user
+ * namespace when not run as root; if neither is possible the /proc helpers
+ * fall back to the live host /proc and the header says so.
+ *
+ * Output is one Go-benchmark style line per helper (ns/op, B/op,
+ * allocs/op), so two runs can be compared with benchstat. Allocations are
+ * counted by interposing malloc/calloc/realloc, which is why this binary is
+ * linked dynamically. Built and run by `make microbench`.
+ *
+ * Copyright (C) 2026 ravindu644 <droidcasts@protonmail.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "virtualize.h"
+#include <dlfcn.h>
+#include <ftw.h>
+
+/* Provided by main.c in the real binary */
+int ds_log_silent = 1;
+char ds_log_container_name[256] = "";
+unsigned int ds_log_debug_mask = 0;
+
+/* micro_cgroup.c */
+int ds_bench_host_cgroups(void);
+
+/* ---------------------------------------------------------------------------
+ * Allocation counting
+ * ---------------------------------------------------------------------------*/
+
+static void *(*real_malloc)(size_t);
+static void *(*real_calloc)(size_t, size_t);
+static void *(*real_realloc)(void *, size_t);
+static void (*real_free)(void *);
+
+static int g_counting;
+static unsigned long long g_allocs, g_alloc_bytes;
+
+/* dlsym() may allocate before the real allocator is known */
+static char g_boot_heap[16384] __attribute__((aligned(16)));
+static size_t g_boot_used;
+
+static int in_boot_heap(const void *p) {
+  return (const char *)p >= g_boot_heap &&
+         (const char *)p < g_boot_heap + sizeof(g_boot_heap);
+}
+
+static void *boot_alloc(size_t size) {
+  size = (size + 15) & ~(size_t)15;
+  if (g_boot_used + size > sizeof(g_boot_heap))
+    return NULL;
+  void *p = g_boot_heap + g_boot_used;
+  g_boot_used += size;
+  return p;
+}
+
+static void resolve(void *slot, const char *name) {
+  void *sym = dlsym(RTLD_NEXT, name);
+  memcpy(slot, &sym, sizeof(sym));
+}
+
+static int hooks_ready(void) {
+  static int resolving;
+  if (real_free)
+    return 1;
+  if (resolving)
+    return 0;
+  resolving = 1;
+  resolve(&real_malloc, "malloc");
+  resolve(&real_calloc, "calloc");
+  resolve(&real_realloc, "realloc");
+  resolve(&real_free, "free");
+  resolving = 0;
+  return real_free != NULL;
+}
+
+static void count_alloc(size_t size) {
+  if (g_counting) {
+    g_allocs++;
+    g_alloc_bytes += size;
+  }
+}
+
+void *malloc(size_t size) {
+  if (!hooks_ready())
+    return boot_alloc(size);
+  count_alloc(size);
+  return real_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+  if (!hooks_ready())
+    return boot_alloc(n * size); /* boot heap is zeroed static storage */
+  count_alloc(n * size);
+  return real_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  if (!hooks_ready() || in_boot_heap(ptr)) {
+    void *p = hooks_ready() ? real_malloc(size) : boot_alloc(size);
+    if (p && ptr) {
+      size_t avail = (size_t)(g_boot_heap + sizeof(g_boot_heap) - (char *)ptr);
+      memcpy(p, ptr, size < avail ? size : avail);
+    }
+    return p;
+  }
+  count_alloc(size);
+  return real_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+  if (!ptr || in_boot_heap(ptr) || !hooks_ready())
+    return;
+  real_free(ptr);
+}
+
+/* ---------------------------------------------------------------------------
+ * Fixture tree
+ * ---------------------------------------------------------------------------*/
+
+static char g_fixture[PATH_MAX];
+static int g_fixture_pids = 4000;
+static int g_fixture_mounts = 3000;
+static int g_fixture_containers = 8;
+static const char *g_fixture_mode = "live";
+
+static FILE *fixture_open(const char *fmt, ...)
+    __attribute__((format(printf, 1, 2)));
+
+static FILE *fixture_open(const char *fmt, ...) {
+  char rel[PATH_MAX], path[PATH_MAX * 2];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(rel, sizeof(rel), fmt, ap);
+  va_end(ap);
+  snprintf(path, sizeof(path), "%s/%s", g_fixture, rel);
+  FILE *f = fopen(path, "we");
+  if (!f) {
+    fprintf(stderr, "[micro] %s: %s\n", path, strerror(errno));
+    exit(1);
+  }
+  return f;
+}
+
+static void fixture_mkdir(const char *fmt, ...)
+    __attribute__((format(printf, 1, 2)));
+
+static void fixture_mkdir(const char *fmt, ...) {
+  char rel[PATH_MAX], path[PATH_MAX * 2];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(rel, sizeof(rel), fmt, ap);
+  va_end(ap);
+  snprintf(path, sizeof(path), "%s/%s", g_fixture, rel);
+  if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+    fprintf(stderr, "[micro] %s: %s\n", path, strerror(errno));
+    exit(1);
+  }
+}
+
+/* Which fixture pids are container inits: spread across the scan order */
+static int fixture_is_container(int pid) {
+  int stride = g_fixture_pids / (g_fixture_containers ? g_fixture_containers : 1);
+  return g_fixture_containers > 0 && stride > 0 && pid % stride == 0;
+}
+
+static void fixture_pid(int pid) {
+  fixture_mkdir("proc/%d", pid);
+  int is_ct = fixture_is_container(pid);
+
+  FILE *f = fixture_open("proc/%d/status", pid);
+  fprintf(f,
+          "Name:\t%s\nUmask:\t0022\nState:\tS (sleeping)\nTgid:\t%d\n"
+          "Ngid:\t0\nPid:\t%d\nPPid:\t1\nTracerPid:\t0\n"
+          "Uid:\t0\t0\t0\t0\nGid:\t0\t0\t0\t0\nFDSize:\t64\n"
+          "Groups:\t\nNStgid:\t%d%s\nNSpid:\t%d%s\nNSpgid:\t%d\nNSsid:\t%d\n"
+          "VmPeak:\t   12345 kB\nVmSize:\t   12345 kB\nVmRSS:\t    4321 kB\n"
+          "Threads:\t1\nSigQ:\t0/31063\nSigPnd:\t0000000000000000\n"
+          "CapEff:\t000001ffffffffff\nSeccomp:\t0\n"
+          "voluntary_ctxt_switches:\t42\nnonvoluntary_ctxt_switches:\t7\n",
+          is_ct ? "init" : "worker", pid, pid, pid, is_ct ? "\t1" : "", pid,
+          is_ct ? "\t1" : "", pid, pid);
+  fclose(f);
+
+  char link_path[PATH_MAX * 2], target[PATH_MAX * 2];
+  snprintf(link_path, sizeof(link_path), "%s/proc/%d/root", g_fixture, pid);
+  if (is_ct) {
+    fixture_mkdir("roots/%d", pid);
+    fixture_mkdir("roots/%d/run", pid);
+    fixture_mkdir("roots/%d/run/droidspaces", pid);
+    f = fixture_open("roots/%d/run/droidspaces/name", pid);
+    fprintf(f, "bench-%d\n", pid);
+    fclose(f);
+    snprintf(target, sizeof(target), "%s/roots/%d", g_fixture, pid);
+  } else {
+    snprintf(target, sizeof(target), "%s/roots/host", g_fixture);
+  }
+  if (symlink(target, link_path) < 0) {
+    fprintf(stderr, "[micro] %s: %s\n", link_path, strerror(errno));
+    exit(1);
+  }
+}
+
+static void fixture_mountinfo(void) {
+  FILE *f = fixture_open("proc/self/mountinfo");
+  int cg_at[3] = {g_fixture_mounts / 3, 2 * g_fixture_mounts / 3,
+                  g_fixture_mounts - 1};
+  for (int i = 0; i < g_fixture_mounts; i++) {
+    int id = 100 + i;
+    if (i == cg_at[0])
+      fprintf(f, "%d 25 0:%d / /dev/cpuctl rw,nosuid,nodev,noexec,relatime "
+                 "shared:%d - cgroup none rw,cpu\n", id, 40 + i, i);
+    else if (i == cg_at[1])
+      fprintf(f, "%d 25 0:%d / /dev/memcg rw,nosuid,nodev,noexec,relatime "
+                 "shared:%d - cgroup none rw,memory\n", id, 40 + i, i);
+    else if (i == cg_at[2])
+      fprintf(f, "%d 25 0:%d / %s/cgroup rw,nosuid,nodev,noexec,relatime "
+                 "shared:%d - cgroup2 none rw,memory_recursiveprot\n",
+              id, 40 + i, g_fixture, i);
+    else if (i % 4 == 0)
+      fprintf(f, "%d 30 0:%d /data/media /mnt/pass_through/0/emulated/%d "
+                 "rw,nosuid,nodev,noexec,noatime shared:%d - f2fs "
+                 "/dev/block/dm-%d rw,lazytime,seclabel,background_gc=on\n",
+              id, 60 + i, i, i, i % 48);
+    else if (i % 4 == 1)
+      fprintf(f, "%d 30 0:%d / /apex/com.android.module%d@3400%d ro,nodev,"
+                 "noatime shared:%d - ext4 /dev/block/loop%d ro,seclabel\n",
+              id, 60 + i, i, i, i, i % 128);
+    else
+      fprintf(f, "%d 30 0:%d / /storage/emulated/%d rw,nosuid,nodev,"
+                 "noexec,noatime shared:%d - fuse /dev/fuse rw,user_id=0,"
+                 "group_id=0,allow_other\n", id, 60 + i, i, i);
+  }
+  fclose(f);
+
+  /* The cgroup2 mount above points back into the fixture */
+  fixture_mkdir("cgroup");
+  fixture_mkdir("cgroup/droidspaces");
+  fixture_mkdir("cgroup/droidspaces/bench");
+  static const char *const cg_files[][2] = {
+      {"cgroup.controllers", "cpuset cpu io memory pids\n"},
+      {"droidspaces/bench/memory.max", "2147483648\n"},
+      {"droidspaces/bench/memory.current", "536870912\n"},
+      {"droidspaces/bench/cpu.max", "400000 100000\n"},
+      {"droidspaces/bench/pids.max", "max\n"},
+      {"droidspaces/bench/memory.stat",
+       "anon 268435456\nfile 201326592\nkernel 33554432\nkernel_stack "
+       "1048576\npagetables 2097152\nsock 0\nshmem 4194304\nslab 25165824\n"},
+      {NULL, NULL}};
+  for (int i = 0; cg_files[i][0]; i++) {
+    f = fixture_open("cgroup/%s", cg_files[i][0]);
+    fputs(cg_files[i][1], f);
+    fclose(f);
+  }
+}
+
+static void fixture_proc_files(void) {
+  static const char *const meminfo_keys[] = {
+      "MemTotal", "MemFree", "MemAvailable", "Buffers", "Cached",
+      "SwapCached", "Active", "Inactive", "Active(anon)", "Inactive(anon)",
+      "Active(file)", "Inactive(file)", "Unevictable", "Mlocked", "SwapTotal",
+      "SwapFree", "Dirty", "Writeback", "AnonPages", "Mapped", "Shmem",
+      "KReclaimable", "Slab", "SReclaimable", "SUnreclaim", "KernelStack",
+      "PageTables", "NFS_Unstable", "Bounce", "WritebackTmp", "CommitLimit",
+      "Committed_AS", "VmallocTotal", "VmallocUsed", "VmallocChunk", "Percpu",
+      "AnonHugePages", "ShmemHugePages", "FileHugePages", "CmaTotal",
+      "CmaFree", NULL};
+  FILE *f = fixture_open("proc/meminfo");
+  for (int i = 0; meminfo_keys[i]; i++)
+    fprintf(f, "%-16s%10lld kB\n", meminfo_keys[i],
+            i == 0 ? 11718476LL : 1000003LL * (i % 7 + 1) % 4000000);
+  fprintf(f, "HugePages_Total:       0\nHugePages_Free:        0\n"
+             "Hugepagesize:       2048 kB\n");
+  fclose(f);
+
+  f = fixture_open("proc/stat");
+  fprintf(f, "cpu  4705 356 584 3699 23 23 0 0 0 0\n");
+  for (int c = 0; c < 64; c++)
+    fprintf(f, "cpu%d %d 11 %d %d 3 2 1 0 0 0\n", c, 1000 + c, 90 + c,
+            50000 + c * 13);
+  fprintf(f, "intr 114930548");
+  for (int i = 0; i < 700; i++)
+    fprintf(f, " %d", i % 9 ? 0 : 1234 + i);
+  fprintf(f, "\nctxt 1990473\nbtime 1062191376\nprocesses 2915\n"
+             "procs_running 1\nprocs_blocked 0\n"
+             "softirq 183433 0 21755 12 39 1137 231 21459 2263 0 136537\n");
+  fclose(f);
+
+  f = fixture_open("proc/cpuinfo");
+  for (int c = 0; c < 64; c++)
+    fprintf(f,
+            "processor\t: %d\nBogoMIPS\t: 38.40\nFeatures\t: fp asimd evtstrm "
+            "aes pmull sha1 sha2 crc32 atomics fphp asimdhp cpuid asimdrdm "
+            "lrcpc dcpop asimddp\nCPU implementer\t: 0x41\n"
+            "CPU architecture: 8\nCPU variant\t: 0x%d\nCPU part\t: 0x%s\n"
+            "CPU revision\t: 0\n\n",
+            c, c < 48 ? 1 : 3, c < 48 ? "d05" : "d41");
+  fprintf(f, "Hardware\t: Synthetic 64-core fixture\n");
+  fclose(f);
+
+  static const char *const other[] = {"uptime", "loadavg", "version", "kmsg",
+                                      "filesystems", "cmdline", NULL};
+  for (int i = 0; other[i]; i++)
+    fclose(fixture_open("proc/%s", other[i]));
+  static const char *const dirs[] = {"sys", "net", "bus", "irq", "fs",
+                                     "driver", "tty", "thread-self", NULL};
+  for (int i = 0; dirs[i]; i++)
+    fixture_mkdir("proc/%s", dirs[i]);
+}
+
+static void fixture_config(void) {
+  FILE *f = fixture_open("container.config");
+  fprintf(f, "# Droidspaces Container Configuration\n# Generated by "
+             "microbench\n\nname=bench\nhostname=bench\n"
+             "rootfs_path=/data/local/Droidspaces/Containers/bench/rootfs\n"
+             "enable_ipv6=0\nenable_android_storage=1\nenable_hw_access=0\n"
+             "enable_gpu_mode=1\nselinux_permissive=0\nvolatile_mode=0\n"
+             "foreground=0\nnet_mode=nat\n");
+  fprintf(f, "upstream_interfaces=");
+  for (int i = 0; i < DS_MAX_UPSTREAM_IFACES; i++)
+    fprintf(f, "%swlan%d", i ? "," : "", i);
+  fprintf(f, "\nport_forwards=");
+  for (int i = 0; i < DS_MAX_PORT_FORWARDS; i++)
+    fprintf(f, "%s%d:%d/%s", i ? "," : "", 8000 + i, 80 + i,
+            i % 2 ? "udp" : "tcp");
+  fprintf(f, "\nstatic_nat_ip=172.28.5.9\nmemory_limit=2147483648\n"
+             "cpu_quota=400000\ncpu_period=100000\npids_limit=4096\n"
+             "uuid=2f2505981269cf8a97dd212acca51ba0\n"
+             "dns_servers=1.1.1.1,8.8.8.8,9.9.9.9\n"
+             "hotplug_classes=input,sound,video4linux\nbind_mounts=");
+  for (int i = 0; i < 64; i++)
+    fprintf(f, "%s/storage/emulated/0/share%d:/mnt/share%d", i ? "," : "", i,
+            i);
+  fprintf(f, "\n\n# Android App Configuration\n");
+  for (int i = 0; i < 200; i++)
+    fprintf(f, "app_setting_%d=value-%d\n", i, i * 31);
+  fclose(f);
+}
+
+static void fixture_build(void) {
+  snprintf(g_fixture, sizeof(g_fixture), "/tmp/ds-micro.XXXXXX");
+  if (!mkdtemp(g_fixture)) {
+    perror("mkdtemp");
+    exit(1);
+  }
+  fixture_mkdir("proc");
+  fixture_mkdir("proc/self");
+  fixture_mkdir("roots");
+  fixture_mkdir("roots/host");
+  for (int pid = 1; pid <= g_fixture_pids; pid++)
+    fixture_pid(pid);
+  fixture_mountinfo();
+  fixture_proc_files();
+  fixture_config();
+}
+
+/* Private mount namespace with the fixture over /proc */
+static int fixture_enter(void) {
+  uid_t uid = getuid();
+  gid_t gid = getgid();
+  if (unshare(CLONE_NEWNS | (uid ? CLONE_NEWUSER : 0)) < 0)
+    return -1;
+
+  if (uid) {
+    char map[64];
+    snprintf(map, sizeof(map), "0 %u 1", (unsigned)uid);
+    if (write_file("/proc/self/setgroups", "deny") < 0 ||
+        write_file("/proc/self/uid_map", map) < 0)
+      return -1;
+    snprintf(map, sizeof(map), "0 %u 1", (unsigned)gid);
+    if (write_file("/proc/self/gid_map", map) < 0)
+      return -1;
+  }
+
+  char proc[PATH_MAX + 8];
+  snprintf(proc, sizeof(proc), "%s/proc", g_fixture);
+  if (mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) < 0 ||
+      mount(proc, "/proc", NULL, MS_BIND, NULL) < 0)
+    return -1;
+  g_fixture_mode = uid ? "fixture (user namespace)" : "fixture";
+  return 0;
+}
+
+static int rm_entry(const char *path, const struct stat *st, int flag,
+                    struct FTW *ftw) {
+  (void)st;
+  (void)ftw;
+  if (flag == FTW_DP)
+    rmdir(path);
+  else
+    unlink(path);
+  return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * Benchmarks
+ * ---------------------------------------------------------------------------*/
+
+static volatile unsigned long g_sink;
+static char g_config_path[PATH_MAX + 32];
+static char g_ct_name[64];
+static struct ds_config g_cfg;
+static struct ds_config g_vcfg;
+
+static const char *const dev_names[] = {
+    "null", "zero", "full", "random", "urandom", "tty", "console", "ptmx",
+    "pts", "shm", "mqueue", "fd", "stdin", "kmsg", "mem", "kmem", "port",
+    "binder", "hwbinder", "vndbinder", "ashmem", "ion", "dma_heap",
+    "kgsl-3d0", "mali0", "dri", "fuse", "tun", "loop0", "loop-control",
+    "mmcblk0", "mmcblk0p1", "sda", "sda12", "block", "input", "uinput",
+    "video0", "media0", "snd", "ttyMSM0", "ttyHS0", "rpmsg_ctrl0", "qseecom",
+    "smcinvoke", "ipa", "wlan", "rmnet_ctrl", "diag", "hw_random", "watchdog",
+    "watchdog0", "rtc0", "pmsg0", "usb-ffs", "mtp_usb", "android_adb",
+    "cpu_dma_latency", "device-mapper", "dm-0", "dm-17", "zram0", "vda",
+    "nvme0n1", "nvme0n1p2", "sg0", "bsg", "i2c-0", "spidev0.0", "gpiochip0",
+    "iio:device0", "hidraw0", "fb0", "vcs", "vcsa1", "userfaultfd", "kvm",
+    "vhost-net", "vfio", "tpm0", "tpmrm0", "mtd0", "ubi0", "tty0", "ttyS3",
+    "ttyUSB0", "ttyACM0", "nvram", "hwrng", "Modem_Ctrl", "ramdump_adsp"};
+static unsigned int g_dev_idx;
+
+static const char *const cidrs[] = {"172.28.0.0/16", "10.0.3.1/24",
+                                    "192.168.42.129", "100.64.0.0/10",
+                                    "0.0.0.0/0", "203.0.113.7/32"};
+static unsigned int g_cidr_idx;
+
+static void b_collect_pids(void) {
+  pid_t *pids;
+  size_t count;
+  if (collect_pids(&pids, &count) == 0) {
+    g_sink += count;
+    free(pids);
+  }
+}
+
+static void b_find_container_hit(void) {
+  g_sink += (unsigned long)find_container_by_name(g_ct_name);
+}
+
+static void b_find_container_miss(void) {
+  g_sink += (unsigned long)find_container_by_name("no-such-container");
+}
+
+static void b_is_dangerous_node(void) {
+  size_t n = sizeof(dev_names) / sizeof(dev_names[0]);
+  g_sink += (unsigned long)is_dangerous_node(dev_names[g_dev_idx++ % n]);
+}
+
+/* One pass over a synthetic 5000-node /dev: the fixed names above, then
+ * numbered variants of them (loop12, ttyS41, kgsl-3d07 ...) */
+#define DEV_PASS_NODES 5000
+static char g_dev_pass[DEV_PASS_NODES][40];
+
+static void b_is_dangerous_node_pass(void) {
+  size_t n = sizeof(dev_names) / sizeof(dev_names[0]);
+  if (!g_dev_pass[0][0]) {
+    for (size_t i = 0; i < DEV_PASS_NODES; i++) {
+      if (i < n)
+        snprintf(g_dev_pass[i], sizeof(g_dev_pass[i]), "%s", dev_names[i]);
+      else
+        snprintf(g_dev_pass[i], sizeof(g_dev_pass[i]), "%s%zu",
+                 dev_names[i % n], i / n);
+    }
+  }
+  unsigned long blocked = 0;
+  for (size_t i = 0; i < DEV_PASS_NODES; i++)
+    blocked += (unsigned long)is_dangerous_node(g_dev_pass[i]);
+  g_sink += blocked;
+}
+
+static void b_parse_cidr(void) {
+  uint32_t ip, mask;
+  size_t n = sizeof(cidrs) / sizeof(cidrs[0]);
+  parse_cidr(cidrs[g_cidr_idx++ % n], &ip, &mask);
+  g_sink += ip ^ mask;
+}
+
+static void b_config_load(void) {
+  if (ds_config_load(g_config_path, &g_cfg) == 0)
+    g_sink += (unsigned long)g_cfg.bind_count;
+  free_config_binds(&g_cfg);
+  free_config_env_vars(&g_cfg);
+  free_config_unknown_lines(&g_cfg);
+  memset(&g_cfg, 0, sizeof(g_cfg)); /* list keys append on reload */
+}
+
+static void b_host_cgroups(void) {
+  g_sink += (unsigned long)ds_bench_host_cgroups();
+}
+
+static void b_getpid(void) { g_sink += (unsigned long)syscall(SYS_getpid); }
+
+static void b_read(void) {
+  static int zero_fd = -1;
+  char c;
+  if (zero_fd < 0)
+    zero_fd = open("/dev/zero", O_RDONLY | O_CLOEXEC);
+  g_sink += (unsigned long)read(zero_fd, &c, 1);
+}
+
+#define VIRT_BENCH(fn)                                                         \
+  static void b_##fn(void) {                                                   \
+    char *buf;                                                                 \
+    size_t size;                                                               \
+    if (ds_virtualize_##fn(&g_vcfg, NULL, &buf, &size) == 0) {                 \
+      g_sink += size;                                                          \
+      free(buf);                                                               \
+    }                                                                          \
+  }
+VIRT_BENCH(meminfo)
+VIRT_BENCH(stat)
+VIRT_BENCH(cpuinfo)
+
+struct micro {
+  const char *name;
+  void (*fn)(void);
+  int uses_proc; /* reads /proc, so the fixture matters */
+};
+
+static const struct micro micros[] = {
+    {"CollectPids", b_collect_pids, 1},
+    {"FindContainerByName/hit", b_find_container_hit, 1},
+    {"FindContainerByName/miss", b_find_container_miss, 1},
+    {"IsDangerousNode", b_is_dangerous_node, 0},
+    {"IsDangerousNode/5000nodes", b_is_dangerous_node_pass, 0},
+    {"VirtualizeMeminfo", b_meminfo, 1},
+    {"VirtualizeStat", b_stat, 1},
+    {"VirtualizeCpuinfo", b_cpuinfo, 1},
+    {"GetHostCgroups", b_host_cgroups, 1},
+    {"ConfigLoad", b_config_load, 0},
+    {"ParseCidr", b_parse_cidr, 0},
+    {NULL, NULL, 0}};
+
+/* Run bare, then again under the seccomp filter.  A filter can't be
+ * removed once installed, so these come after everything else. */
+static const struct micro syscall_micros[] = {
+    {"Syscall/getpid", b_getpid, 0},
+    {"Syscall/read", b_read, 0},
+    {NULL, NULL, 0}};
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Grow the iteration count until one timed batch covers target_ns */
+static void run_micro(const struct micro *m, double target_ns) {
+  unsigned long iters = 1;
+  double elapsed;
+  for (;;) {
+    m->fn(); /* warm caches and one-time init outside the counters */
+    g_allocs = g_alloc_bytes = 0;
+    g_counting = 1;
+    double t0 = now_ns();
+    for (unsigned long i = 0; i < iters; i++)
+      m->fn();
+    elapsed = now_ns() - t0;
+    g_counting = 0;
+    if (elapsed >= target_ns || iters >= 1000000000UL)
+      break;
+    double scale = elapsed > 0 ? target_ns * 1.2 / elapsed : 100.0;
+    if (scale > 100.0)
+      scale = 100.0;
+    if (scale < 2.0)
+      scale = 2.0;
+    iters = (unsigned long)((double)iters * scale);
+  }
+  char name[64];
+  snprintf(name, sizeof(name), "Benchmark%s", m->name);
+  printf("%-40s %10lu %14.1f ns/op %10.0f B/op %8.2f allocs/op\n", name,
+         iters, elapsed / (double)iters,
+         (double)g_alloc_bytes / (double)iters,
+         (double)g_allocs / (double)iters);
+  fflush(stdout);
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "Usage: %s [-f FILTER] [-t MS] [-p PIDS] [-m MOUNTS] [-c COUNT] "
+          "[-L]\n"
+          "  -f  only run benchmarks whose name contains FILTER\n"
+          "  -t  minimum time per benchmark in ms (default 500)\n"
+          "  -p  synthetic /proc/<pid> entries (default 4000)\n"
+          "  -m  synthetic mountinfo lines (default 3000)\n"
+          "  -c  container inits among the pids (default 8)\n"
+          "  -L  measure against the live host /proc instead of the fixture\n",
+          argv0);
+}
+
+int main(int argc, char **argv) {
+  const char *filter = NULL;
+  double target_ms = 500;
+  int live = 0, opt;
+  while ((opt = getopt(argc, argv, "f:t:p:m:c:Lh")) != -1) {
+    switch (opt) {
+    case 'f':
+      filter = optarg;
+      break;
+    case 't':
+      target_ms = atof(optarg);
+      break;
+    case 'p':
+      g_fixture_pids = atoi(optarg);
+      break;
+    case 'm':
+      g_fixture_mounts = atoi(optarg);
+      break;
+    case 'c':
+      g_fixture_containers = atoi(optarg);
+      break;
+    case 'L':
+      live = 1;
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 2;
+    }
+  }
+  if (g_fixture_pids < 1 || g_fixture_mounts < 3 || g_fixture_containers < 0 ||
+      g_fixture_containers > g_fixture_pids) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  fixture_build();
+  snprintf(g_config_path, sizeof(g_config_path), "%s/container.config",
+           g_fixture);
+
+  /* Last container in scan order: the worst case for a name lookup */
+  int last_ct = 0;
+  for (int pid = 1; pid <= g_fixture_pids; pid++)
+    if (fixture_is_container(pid))
+      last_ct = pid;
+  snprintf(g_ct_name, sizeof(g_ct_name), "bench-%d", last_ct);
+
+  safe_strncpy(g_vcfg.container_name, "bench", sizeof(g_vcfg.container_name));
+  g_vcfg.cpu_quota = 400000;
+  g_vcfg.cpu_period = 100000;
+
+  if (!live && fixture_enter() < 0)
+    fprintf(stderr, "[micro] cannot mount the fixture over /proc (%s); "
+                    "/proc helpers measure the live host\n",
+            strerror(errno));
+
+  struct utsname uts;
+  uname(&uts);
+  printf("goos: linux\ngoarch: %s\npkg: droidspaces/%s\n", uts.machine,
+         DS_VERSION);
+  printf("# kernel %s, /proc: %s, %d pids, %d mounts, %d containers\n",
+         uts.release, g_fixture_mode, g_fixture_pids, g_fixture_mounts,
+         g_fixture_containers);
+
+  for (const struct micro *m = micros; m->name; m++) {
+    if (filter && !strstr(m->name, filter))
+      continue;
+    if (m->uses_proc && strcmp(g_fixture_mode, "live") == 0 &&
+        strncmp(m->name, "FindContainer", 13) == 0)
+      continue; /* the fixture's container names do not exist on the host */
+    run_micro(m, target_ms * 1e6);
+  }
+
+  int ran_syscalls = 0;
+  for (const struct micro *m = syscall_micros; m->name; m++) {
+    if (filter && !strstr(m->name, filter))
+      continue;
+    run_micro(m, target_ms * 1e6);
+    ran_syscalls = 1;
+  }
+  if (ran_syscalls) {
+    /* The filter every container process runs with by default */
+    if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) < 0 ||
+        ds_seccomp_apply(0, 0) < 0) {
+      printf("# seccomp filter not installed (%s); skipping filtered runs\n",
+             strerror(errno));
+    } else {
+      for (const struct micro *m = syscall_micros; m->name; m++) {
+        if (filter && !strstr(m->name, filter))
+          continue;
+        char name[64];
+        snprintf(name, sizeof(name), "%s/seccomp", m->name);
+        struct micro filtered = {name, m->fn, m->uses_proc};
+        run_micro(&filtered, target_ms * 1e6);
+      }
+    }
+  }
+
+  nftw(g_fixture, rm_entry, 16, FTW_DEPTH | FTW_PHYS | FTW_MOUNT);
+  return 0;
+}
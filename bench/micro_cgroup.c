@@ -0,0 +1,16 @@
+/*
+ * Droidspaces v5 - Microbenchmark access to cgroup.c internals
+ *
+ * get_host_cgroups() is file-local, so the microbenchmark compiles cgroup.c
+ * into this unit (in place of cgroup.o) and reaches it through a thin shim.
+ *
+ * Copyright (C) 2026 ravindu644 <droidcasts@protonmail.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "cgroup.c"
+
+int ds_bench_host_cgroups(void) {
+  struct host_cgroup hosts[32];
+  return get_host_cgroups(hosts, 32);
+}
@@ -0,0 +1,541 @@
+/*
+ * Droidspaces v5 - /proc virtualization fixture checker
+ *
+ * Replays host inputs (bench/fixtures/vproc/<device>/: meminfo, stat,
+ * cpuinfo, loadavg, uptime and a cgroup/ directory with memory.max,
+ * memory.current and memory.stat) through every ds_virtualize_* generator
+ * under a set of container limits, checks the output against invariants
+ * and times each generator.  The bundled fixtures are synthetic,
+ * hand-written in each kernel's format; see the README next to them.
+ *
+ * Invariants, with N = the CPU count the container should see (its quota
+ * rounded up, capped at the host) and L = the effective memory limit:
+ *   meminfo  MemTotal == L, MemFree <= MemAvailable <= MemTotal, no swap,
+ *            no kB field above MemTotal, every host key kept in order
+ *   cpuinfo  exactly processors 0..N-1, non-processor lines kept
+ *   stat     exactly cpu0..cpuN-1, the "cpu" line is their sum, other
+ *            lines kept
+ *   sysfs    "0-<N-1>" (or "0")
+ *   uptime   container uptime, idle <= uptime * N
+ *   loadavg  no load above the host's, runnable <= total
+ *
+ * Exits non-zero when any invariant fails. Built and run by
+ * `make vprocbench`.
+ *
+ * Copyright (C) 2026 ravindu644 <droidcasts@protonmail.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "virtualize.h"
+#include <dirent.h>
+#include <time.h>
+
+/* Provided by main.c in the real binary */
+int ds_log_silent = 1;
+char ds_log_container_name[256] = "";
+unsigned int ds_log_debug_mask = 0;
+
+#define VP_DEFAULT_DIR "bench/fixtures/vproc"
+#define VP_DEFAULT_ITERS 2000
+#define VP_UPTIME_SEC 3600
+
+struct vp_scenario {
+  const char *name;
+  long long cpu_quota, cpu_period;
+  long long memory_limit;
+};
+
+/* The timed scenario is the first limited one */
+static const struct vp_scenario scenarios[] = {
+    {"unlimited", 0, 0, 0},
+    {"1cpu-512m", 100000, 100000, 512LL << 20},
+    {"2.5cpu-1g", 250000, 100000, 1LL << 30},
+    {"oversized", 12800000, 100000, 1LL << 40},
+};
+#define VP_TIMED 2
+
+struct vp_fixture {
+  char name[128];
+  char proc_root[PATH_MAX];
+  char cgroup_dir[PATH_MAX + 8];
+  char *meminfo, *stat, *cpuinfo, *loadavg, *uptime;
+  int host_cpus;
+  long long host_mem_kb;
+  long long cg_limit; /* bytes, 0 = "max", -1 = missing */
+};
+
+static int g_failures;
+
+/* ---------------------------------------------------------------------------
+ * Helpers
+ * ---------------------------------------------------------------------------*/
+
+static char *vp_slurp(const char *dir, const char *name) {
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return NULL;
+
+  size_t cap = 4096, len = 0;
+  char *buf = malloc(cap);
+  size_t n;
+  while (buf && (n = fread(buf + len, 1, cap - len - 1, f)) > 0) {
+    len += n;
+    if (cap - len < 2) {
+      char *grown = realloc(buf, cap * 2);
+      if (!grown) {
+        free(buf);
+        buf = NULL;
+        break;
+      }
+      buf = grown;
+      cap *= 2;
+    }
+  }
+  fclose(f);
+  if (buf)
+    buf[len] = '\0';
+  return buf;
+}
+
+static double vp_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Value of "Key:" in meminfo-style text, -1 when absent */
+static long long vp_field(const char *text, const char *key) {
+  size_t klen = strlen(key);
+  for (const char *p = text; p && *p;) {
+    if (strncmp(p, key, klen) == 0 && p[klen] == ':')
+      return atoll(p + klen + 1);
+    p = strchr(p, '\n');
+    if (p)
+      p++;
+  }
+  return -1;
+}
+
+/* Line-by-line iteration over a text buffer */
+static const char *vp_next_line(const char *p, char *line, size_t size) {
+  if (!p || !*p)
+    return NULL;
+  const char *nl = strchr(p, '\n');
+  size_t len = nl ? (size_t)(nl - p) : strlen(p);
+  if (len >= size)
+    len = size - 1;
+  memcpy(line, p, len);
+  line[len] = '\0';
+  return nl ? nl + 1 : p + strlen(p);
+}
+
+static int vp_has_line(const char *text, const char *want) {
+  char line[4096];
+  const char *p = text;
+  while ((p = vp_next_line(p, line, sizeof(line))))
+    if (strcmp(line, want) == 0)
+      return 1;
+  return 0;
+}
+
+static void vp_fail(const struct vp_fixture *fx, const struct vp_scenario *sc,
+                    const char *gen, const char *what) {
+  printf("FAIL %s/%s %s: %s\n", fx->name, sc->name, gen, what);
+  g_failures++;
+}
+
+/* ---------------------------------------------------------------------------
+ * Invariants
+ * ---------------------------------------------------------------------------*/
+
+static int vp_expected_cpus(const struct vp_fixture *fx,
+                            const struct vp_scenario *sc) {
+  if (sc->cpu_quota <= 0 || sc->cpu_period <= 0)
+    return fx->host_cpus;
+  long long n = (sc->cpu_quota + sc->cpu_period - 1) / sc->cpu_period;
+  if (n < 1)
+    n = 1;
+  return n > fx->host_cpus ? fx->host_cpus : (int)n;
+}
+
+/* Effective limit in kB, 0 when the container sees the host's memory */
+static long long vp_expected_mem_kb(const struct vp_fixture *fx,
+                                    const struct vp_scenario *sc) {
+  long long limit = fx->cg_limit > 0 ? fx->cg_limit : sc->memory_limit;
+  if (limit <= 0)
+    return 0;
+  if (limit > fx->host_mem_kb * 1024)
+    limit = fx->host_mem_kb * 1024;
+  return limit / 1024;
+}
+
+static void vp_check_meminfo(const struct vp_fixture *fx,
+                             const struct vp_scenario *sc, const char *out) {
+  char msg[256];
+  long long total = vp_field(out, "MemTotal");
+  long long free_kb = vp_field(out, "MemFree");
+  long long avail = vp_field(out, "MemAvailable");
+  long long want = vp_expected_mem_kb(fx, sc);
+
+  if (want > 0 && total != want) {
+    snprintf(msg, sizeof(msg), "MemTotal %lld kB, want %lld", total, want);
+    vp_fail(fx, sc, "meminfo", msg);
+  }
+  if (want == 0 && total != fx->host_mem_kb)
+    vp_fail(fx, sc, "meminfo", "unlimited MemTotal differs from the host");
+  if (free_kb < 0 || free_kb > total)
+    vp_fail(fx, sc, "meminfo", "MemFree outside [0, MemTotal]");
+  if (avail >= 0 && (avail > total || avail < free_kb))
+    vp_fail(fx, sc, "meminfo", "MemAvailable outside [MemFree, MemTotal]");
+  if (want > 0 && (vp_field(out, "SwapTotal") > 0 ||
+                   vp_field(out, "SwapFree") > 0))
+    vp_fail(fx, sc, "meminfo", "swap visible under a memory limit");
+
+  /* Same keys in the same order, nothing above MemTotal */
+  char hl[512], ol[512], hkey[256], okey[256];
+  const char *h = fx->meminfo, *o = out;
+  while ((h = vp_next_line(h, hl, sizeof(hl)))) {
+    o = vp_next_line(o, ol, sizeof(ol));
+    if (!o || sscanf(hl, "%255[^:]", hkey) != 1 ||
+        sscanf(ol, "%255[^:]", okey) != 1 || strcmp(hkey, okey) != 0) {
+      snprintf(msg, sizeof(msg), "key '%.200s' missing or out of order", hkey);
+      vp_fail(fx, sc, "meminfo", msg);
+      return;
+    }
+    long long v = vp_field(ol, okey);
+    if (want > 0 && strstr(ol, " kB") && v > total) {
+      snprintf(msg, sizeof(msg), "%.200s %lld kB above MemTotal", okey, v);
+      vp_fail(fx, sc, "meminfo", msg);
+    }
+  }
+}
+
+static void vp_check_cpuinfo(const struct vp_fixture *fx,
+                             const struct vp_scenario *sc, const char *out) {
+  char msg[256], line[4096];
+  int n = vp_expected_cpus(fx, sc), seen = 0, id;
+  const char *p = out;
+
+  while ((p = vp_next_line(p, line, sizeof(line)))) {
+    if (sscanf(line, "processor : %d", &id) != 1)
+      continue;
+    if (id != seen) {
+      snprintf(msg, sizeof(msg), "processor %d where %d was expected", id,
+               seen);
+      vp_fail(fx, sc, "cpuinfo", msg);
+      return;
+    }
+    seen++;
+  }
+  if (seen != n) {
+    snprintf(msg, sizeof(msg), "%d processors, want %d", seen, n);
+    vp_fail(fx, sc, "cpuinfo", msg);
+  }
+
+  /* Lines after the last processor block describe the whole SoC */
+  const char *q = fx->cpuinfo;
+  int in_block = 0;
+  while ((q = vp_next_line(q, line, sizeof(line)))) {
+    if (sscanf(line, "processor : %d", &id) == 1)
+      in_block = 1;
+    else if (!line[0])
+      in_block = 0;
+    else if (!in_block && !vp_has_line(out, line)) {
+      snprintf(msg, sizeof(msg), "lost '%.200s'", line);
+      vp_fail(fx, sc, "cpuinfo", msg);
+    }
+  }
+}
+
+static void vp_check_stat(const struct vp_fixture *fx,
+                          const struct vp_scenario *sc, const char *out) {
+  char msg[256], line[4096];
+  int n = vp_expected_cpus(fx, sc), seen = 0, id;
+  unsigned long long sum[10] = {0}, agg[10] = {0};
+  int have_agg = 0;
+  const char *p = out;
+
+  while ((p = vp_next_line(p, line, sizeof(line)))) {
+    unsigned long long v[10] = {0};
+    if (strncmp(line, "cpu ", 4) == 0) {
+      sscanf(line + 4, "%llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
+             &agg[0], &agg[1], &agg[2], &agg[3], &agg[4], &agg[5], &agg[6],
+             &agg[7], &agg[8], &agg[9]);
+      have_agg++;
+    } else if (sscanf(line, "cpu%d", &id) == 1) {
+      if (id >= n) {
+        snprintf(msg, sizeof(msg), "cpu%d visible with %d allowed", id, n);
+        vp_fail(fx, sc, "stat", msg);
+      }
+      sscanf(line, "cpu%*d %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
+             &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8],
+             &v[9]);
+      for (int i = 0; i < 10; i++)
+        sum[i] += v[i];
+      seen++;
+    }
+  }
+  if (seen != n) {
+    snprintf(msg, sizeof(msg), "%d cpuN lines, want %d", seen, n);
+    vp_fail(fx, sc, "stat", msg);
+  }
+  if (have_agg != 1)
+    vp_fail(fx, sc, "stat", "missing or repeated aggregate cpu line");
+  else if (memcmp(sum, agg, sizeof(sum)) != 0)
+    vp_fail(fx, sc, "stat", "aggregate cpu line is not the sum of cpuN");
+
+  p = fx->stat;
+  while ((p = vp_next_line(p, line, sizeof(line)))) {
+    if (strncmp(line, "cpu", 3) != 0 && !vp_has_line(out, line)) {
+      snprintf(msg, sizeof(msg), "lost '%.40s'", line);
+      vp_fail(fx, sc, "stat", msg);
+    }
+  }
+}
+
+static void vp_check_sysfs(const struct vp_fixture *fx,
+                           const struct vp_scenario *sc, const char *out) {
+  char want[32], msg[128];
+  int n = vp_expected_cpus(fx, sc);
+  if (n == 1)
+    snprintf(want, sizeof(want), "0\n");
+  else
+    snprintf(want, sizeof(want), "0-%d\n", n - 1);
+  if (strcmp(out, want) != 0) {
+    snprintf(msg, sizeof(msg), "'%.20s', want '%.20s'", out, want);
+    vp_fail(fx, sc, "cpu_sysfs", msg);
+  }
+}
+
+static void vp_check_uptime(const struct vp_fixture *fx,
+                            const struct vp_scenario *sc, const char *out) {
+  double up, idle;
+  if (sscanf(out, "%lf %lf", &up, &idle) != 2) {
+    vp_fail(fx, sc, "uptime", "unparsable");
+    return;
+  }
+  if (up < VP_UPTIME_SEC - 5 || up > VP_UPTIME_SEC + 60)
+    vp_fail(fx, sc, "uptime", "uptime is not the container's");
+  /* Both values are rounded to two decimals */
+  int n = vp_expected_cpus(fx, sc);
+  if (idle < 0 || idle > (up + 0.005) * n + 0.005)
+    vp_fail(fx, sc, "uptime", "idle outside [0, uptime * cpus]");
+}
+
+static void vp_check_loadavg(const struct vp_fixture *fx,
+                             const struct vp_scenario *sc, const char *out) {
+  double l[3], h[3];
+  int run, total, hrun, htotal;
+  if (sscanf(out, "%lf %lf %lf %d/%d", &l[0], &l[1], &l[2], &run, &total) !=
+          5 ||
+      sscanf(fx->loadavg, "%lf %lf %lf %d/%d", &h[0], &h[1], &h[2], &hrun,
+             &htotal) != 5) {
+    vp_fail(fx, sc, "loadavg", "unparsable");
+    return;
+  }
+  for (int i = 0; i < 3; i++) {
+    /* The generator prints two decimals */
+    if (l[i] < 0 || l[i] > h[i] + 0.005)
+      vp_fail(fx, sc, "loadavg", "load above the host's");
+  }
+  if (run > total || total < 1 || total > htotal)
+    vp_fail(fx, sc, "loadavg", "runnable/total out of range");
+}
+
+/* ---------------------------------------------------------------------------
+ * Driver
+ * ---------------------------------------------------------------------------*/
+
+typedef int (*vp_gen_fn)(struct ds_config *, const struct ds_vsource *,
+                         char **, size_t *);
+typedef void (*vp_check_fn)(const struct vp_fixture *,
+                            const struct vp_scenario *, const char *);
+
+static const struct {
+  const char *name;
+  vp_gen_fn gen;
+  vp_check_fn check;
+} generators[] = {
+    {"meminfo", ds_virtualize_meminfo, vp_check_meminfo},
+    {"cpuinfo", ds_virtualize_cpuinfo, vp_check_cpuinfo},
+    {"stat", ds_virtualize_stat, vp_check_stat},
+    {"cpu_sysfs", ds_virtualize_cpu_sysfs, vp_check_sysfs},
+    {"uptime", ds_virtualize_uptime, vp_check_uptime},
+    {"loadavg", ds_virtualize_loadavg, vp_check_loadavg},
+};
+#define VP_NGEN (sizeof(generators) / sizeof(generators[0]))
+
+static int vp_load(struct vp_fixture *fx, const char *dir, const char *name) {
+  memset(fx, 0, sizeof(*fx));
+  safe_strncpy(fx->name, name, sizeof(fx->name));
+  snprintf(fx->proc_root, sizeof(fx->proc_root), "%s/%s", dir, name);
+  snprintf(fx->cgroup_dir, sizeof(fx->cgroup_dir), "%s/cgroup",
+           fx->proc_root);
+
+  fx->meminfo = vp_slurp(fx->proc_root, "meminfo");
+  fx->stat = vp_slurp(fx->proc_root, "stat");
+  fx->cpuinfo = vp_slurp(fx->proc_root, "cpuinfo");
+  fx->loadavg = vp_slurp(fx->proc_root, "loadavg");
+  fx->uptime = vp_slurp(fx->proc_root, "uptime");
+  if (!fx->meminfo || !fx->stat || !fx->cpuinfo || !fx->loadavg ||
+      !fx->uptime) {
+    fprintf(stderr, "vproc: %s: incomplete fixture\n", fx->proc_root);
+    return -1;
+  }
+
+  /* /proc/stat lists the online CPUs, which is what sysconf() reports */
+  char line[4096];
+  int id;
+  const char *p = fx->stat;
+  while ((p = vp_next_line(p, line, sizeof(line))))
+    if (isdigit((unsigned char)line[3]) && sscanf(line, "cpu%d", &id) == 1)
+      fx->host_cpus++;
+  fx->host_mem_kb = vp_field(fx->meminfo, "MemTotal");
+
+  char *max = vp_slurp(fx->cgroup_dir, "memory.max");
+  fx->cg_limit = !max ? -1 : strncmp(max, "max", 3) == 0 ? 0 : atoll(max);
+  free(max);
+  return 0;
+}
+
+static void vp_free(struct vp_fixture *fx) {
+  free(fx->meminfo);
+  free(fx->stat);
+  free(fx->cpuinfo);
+  free(fx->loadavg);
+  free(fx->uptime);
+}
+
+static void vp_setup(struct ds_config *cfg, const struct vp_scenario *sc) {
+  memset(cfg, 0, sizeof(*cfg));
+  safe_strncpy(cfg->container_name, "vproc-fixture",
+               sizeof(cfg->container_name));
+  cfg->cpu_quota = sc->cpu_quota;
+  cfg->cpu_period = sc->cpu_period;
+  cfg->memory_limit = sc->memory_limit;
+  clock_gettime(CLOCK_MONOTONIC, &cfg->start_time);
+  cfg->start_time.tv_sec -= VP_UPTIME_SEC;
+}
+
+static void vp_run_fixture(struct vp_fixture *fx, int iters) {
+  struct ds_vsource src = {fx->proc_root, fx->cgroup_dir, fx->host_cpus};
+  struct ds_config *cfg = calloc(1, sizeof(*cfg));
+  if (!cfg)
+    return;
+
+  for (size_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++) {
+    const struct vp_scenario *sc = &scenarios[s];
+    int before = g_failures;
+    vp_setup(cfg, sc);
+    for (size_t g = 0; g < VP_NGEN; g++) {
+      char *buf = NULL;
+      size_t size = 0;
+      if (generators[g].gen(cfg, &src, &buf, &size) != 0) {
+        vp_fail(fx, sc, generators[g].name, "generator failed");
+        continue;
+      }
+      if (size != strlen(buf))
+        vp_fail(fx, sc, generators[g].name, "size does not match the text");
+      generators[g].check(fx, sc, buf);
+      free(buf);
+    }
+    if (g_failures == before)
+      printf("ok   %s/%s (%d cpus, %lld kB)\n", fx->name, sc->name,
+             vp_expected_cpus(fx, sc),
+             vp_expected_mem_kb(fx, sc) ? vp_expected_mem_kb(fx, sc)
+                                        : fx->host_mem_kb);
+  }
+
+  /* Timing, Go-benchmark style so runs can be compared with benchstat */
+  vp_setup(cfg, &scenarios[VP_TIMED]);
+  for (size_t g = 0; g < VP_NGEN && iters > 0; g++) {
+    double t0 = vp_now_ns();
+    for (int i = 0; i < iters; i++) {
+      char *buf = NULL;
+      size_t size = 0;
+      if (generators[g].gen(cfg, &src, &buf, &size) == 0)
+        free(buf);
+    }
+    printf("BenchmarkVproc/%s/%s\t%d\t%.0f ns/op\n", fx->name,
+           generators[g].name, iters, (vp_now_ns() - t0) / iters);
+  }
+  free(cfg);
+}
+
+static int vp_cmp(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "Usage: %s [-d DIR] [-k ITERS] [-f FIXTURE]\n"
+          "  -d DIR      fixture corpus (default " VP_DEFAULT_DIR ")\n"
+          "  -k ITERS    timed calls per generator, 0 skips timing "
+          "(default %d)\n"
+          "  -f FIXTURE  only run fixtures whose name contains FIXTURE\n",
+          argv0, VP_DEFAULT_ITERS);
+}
+
+int main(int argc, char **argv) {
+  const char *dir = VP_DEFAULT_DIR, *filter = NULL;
+  int iters = VP_DEFAULT_ITERS, opt;
+
+  while ((opt = getopt(argc, argv, "d:k:f:h")) != -1) {
+    switch (opt) {
+    case 'd':
+      dir = optarg;
+      break;
+    case 'k':
+      iters = atoi(optarg);
+      break;
+    case 'f':
+      filter = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 2;
+    }
+  }
+
+  DIR *d = opendir(dir);
+  if (!d) {
+    fprintf(stderr, "vproc: %s: %s\n", dir, strerror(errno));
+    return 2;
+  }
+  char *names[64];
+  int count = 0;
+  struct dirent *de;
+  while ((de = readdir(d)) && count < 64) {
+    if (de->d_name[0] == '.' || (filter && !strstr(de->d_name, filter)))
+      continue;
+    char path[PATH_MAX];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+    if (stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+      names[count++] = strdup(de->d_name);
+  }
+  closedir(d);
+  qsort(names, (size_t)count, sizeof(names[0]), vp_cmp);
+
+  int ran = 0;
+  for (int i = 0; i < count; i++) {
+    struct vp_fixture fx = {0};
+    if (names[i] && vp_load(&fx, dir, names[i]) == 0) {
+      vp_run_fixture(&fx, iters);
+      ran++;
+    } else {
+      g_failures++;
+    }
+    vp_free(&fx);
+    free(names[i]);
+  }
+
+  if (!ran) {
+    fprintf(stderr, "vproc: no fixtures under %s\n", dir);
+    return 2;
+  }
+  printf("%d fixture(s), %d failure(s)\n", ran, g_failures);
+  return g_failures ? 1 : 0;
+}
@@ -6,6 +6,8 @@
  */
 
 #include "droidspace.h"
+#include <sys/file.h>
+#include <sys/statvfs.h>
 
 /* ---------------------------------------------------------------------------
  * Android detection
@@ -28,42 +30,142 @@ int is_android(void) {
 
 /* ---------------------------------------------------------------------------
  * Android optimizations
+ *
+ * Each tweak is a binder round-trip into system_server (100-500 ms on
+ * mid-range phones), so they never run on the start or stop path. The
+ * wanted state is recorded in <workspace>/android.state together with the
+ * host boot_id, and a detached worker applies it. Once the tweaks are on for
+ * this boot, further starts only read that record.
  * ---------------------------------------------------------------------------*/
 
+#define ANDROID_STATE_FILE "android.state"
+#define BOOT_ID_LEN 36
+
+/* Fixed-size record "<boot_id> <0|1>\n": rewritten in place, never torn */
+struct android_state {
+  char boot_id[BOOT_ID_LEN + 1];
+  int enabled;
+};
+
+static void android_state_path(char *buf, size_t size) {
+  snprintf(buf, size, "%s/" ANDROID_STATE_FILE, get_workspace_dir());
+}
+
+static int android_state_read(int fd, struct android_state *st) {
+  char rec[BOOT_ID_LEN + 4];
+  if (pread(fd, rec, sizeof(rec) - 1, 0) != (ssize_t)sizeof(rec) - 1 ||
+      rec[BOOT_ID_LEN] != ' ' || (rec[BOOT_ID_LEN + 1] != '0' &&
+                                  rec[BOOT_ID_LEN + 1] != '1'))
+    return -1;
+  memcpy(st->boot_id, rec, BOOT_ID_LEN);
+  st->boot_id[BOOT_ID_LEN] = '\0';
+  st->enabled = rec[BOOT_ID_LEN + 1] == '1';
+  return 0;
+}
+
+static void android_apply_tweaks(int enable) {
+  char *args1[] = {"cmd",
+                   "device_config",
+                   "put",
+                   "activity_manager",
+                   "max_phantom_processes",
+                   enable ? "2147483647" : "32",
+                   NULL};
+  run_command_quiet(args1);
+  char *args2[] = {"cmd", "device_config", "set_sync_disabled_for_tests",
+                   enable ? "persistent" : "none", NULL};
+  run_command_quiet(args2);
+  char *args3[] = {"dumpsys", "deviceidle", enable ? "disable" : "enable",
+                   NULL};
+  run_command_quiet(args3);
+}
+
+/* Detached worker: applies whatever the record asks for when it gets the
+ * lock, so overlapping start/stop transitions settle on the latest one. */
+static void android_tweaks_worker(const char *path) {
+  pid_t pid = fork();
+  if (pid < 0) {
+    ds_warn("Failed to fork Android optimization worker: %s", strerror(errno));
+    return;
+  }
+  if (pid > 0) {
+    waitpid(pid, NULL, 0);
+    return;
+  }
+
+  /* Reparent to init so neither start nor stop ever waits on binder */
+  if (fork() != 0)
+    _exit(0);
+  setsid();
+
+  int devnull = open("/dev/null", O_RDWR);
+  if (devnull >= 0) {
+    dup2(devnull, STDIN_FILENO);
+    dup2(devnull, STDOUT_FILENO);
+    dup2(devnull, STDERR_FILENO);
+    if (devnull > STDERR_FILENO)
+      close(devnull);
+  }
+  /* Drop inherited descriptors (sync pipes, PTY masters, locks) so their
+   * owners still see EOF/close while the worker runs */
+  DIR *d = opendir("/proc/self/fd");
+  if (d) {
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+      int fd = atoi(de->d_name);
+      if (fd > STDERR_FILENO && fd != dirfd(d))
+        close(fd);
+    }
+    closedir(d);
+  }
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  struct android_state st;
+  if (fd >= 0 && flock(fd, LOCK_EX) == 0 && android_state_read(fd, &st) == 0)
+    android_apply_tweaks(st.enabled);
+  _exit(0);
+}
+
 void android_optimizations(int enable) {
   if (!is_android())
     return;
 
-  if (enable) {
-    ds_log("Applying Android system optimizations...");
-    char *args1[] = {"cmd",
-                     "device_config",
-                     "put",
-                     "activity_manager",
-                     "max_phantom_processes",
-                     "2147483647",
-                     NULL};
-    run_command_quiet(args1);
-    char *args2[] = {"cmd", "device_config", "set_sync_disabled_for_tests",
-                     "persistent", NULL};
-    run_command_quiet(args2);
-    char *args3[] = {"dumpsys", "deviceidle", "disable", NULL};
-    run_command_quiet(args3);
-  } else {
-    char *args1[] = {"cmd",
-                     "device_config",
-                     "put",
-                     "activity_manager",
-                     "max_phantom_processes",
-                     "32",
-                     NULL};
-    run_command_quiet(args1);
-    char *args2[] = {"cmd", "device_config", "set_sync_disabled_for_tests",
-                     "none", NULL};
-    run_command_quiet(args2);
-    char *args3[] = {"dumpsys", "deviceidle", "enable", NULL};
-    run_command_quiet(args3);
+  char boot_id[BOOT_ID_LEN + 1];
+  if (get_boot_id(boot_id, sizeof(boot_id)) < 0) {
+    /* No boot_id: nothing to key the record on, apply in line */
+    android_apply_tweaks(enable);
+    return;
+  }
+
+  char path[PATH_MAX];
+  android_state_path(path, sizeof(path));
+  int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    android_apply_tweaks(enable);
+    return;
+  }
+
+  struct android_state st;
+  int known = android_state_read(fd, &st) == 0 &&
+              strcmp(st.boot_id, boot_id) == 0;
+  /* Already wanted this boot, or nothing to revert since the last boot */
+  if ((known && st.enabled == enable) || (!known && !enable)) {
+    close(fd);
+    return;
+  }
+
+  char rec[BOOT_ID_LEN + 4];
+  snprintf(rec, sizeof(rec), "%s %d\n", boot_id, enable);
+  ssize_t w = pwrite(fd, rec, strlen(rec), 0);
+  close(fd);
+  if (w != (ssize_t)strlen(rec)) {
+    android_apply_tweaks(enable);
+    return;
   }
+
+  if (enable)
+    ds_log("Applying Android system optimizations in the background...");
+  android_tweaks_worker(path);
 }
 
 /* ---------------------------------------------------------------------------
@@ -74,9 +176,15 @@ void android_remount_data_suid(void) {
   if (!is_android())
     return;
 
-  ds_log("Ensuring /data is mounted with suid support...");
   /* On some Android versions, /data is mounted nosuid. We need suid for
-   * sudo/su/ping within the container if it's stored on /data. */
+   * sudo/su/ping within the container if it's stored on /data. The flag is
+   * one statvfs away, so only spawn mount when it is actually set (once per
+   * boot in practice). */
+  struct statvfs sv;
+  if (statvfs("/data", &sv) == 0 && !(sv.f_flag & ST_NOSUID))
+    return;
+
+  ds_log("Ensuring /data is mounted with suid support...");
   char *args[] = {"mount", "-o", "remount,suid", "/data", NULL};
   if (run_command_quiet(args) != 0) {
     ds_warn(
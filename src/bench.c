@@ -0,0 +1,631 @@
+/*
+ * Droidspaces v5 - NAT data-path benchmark (bench net)
+ *
+ * Starts a throwaway NAT container and measures TCP/UDP throughput and
+ * request/response latency host -> container over the veth, through a port
+ * forward, and over loopback as the host-mode baseline.  Both ends are this
+ * binary: the server is a forked child that joins the container's network
+ * namespace, so any rootfs works and no tools are needed inside it.
+ *
+ * Copyright (C) 2026 ravindu644 <droidcasts@protonmail.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "droidspace.h"
+#include <ifaddrs.h>
+#include <netinet/tcp.h>
+
+#define BENCH_NET_NAME "ds-bench-net"
+#define BENCH_NET_PORT 5201      /* server port on every path */
+#define BENCH_NET_FWD_PORT 25201 /* host side of the port forward */
+#define BENCH_NET_SECONDS 3      /* default length of each stream test */
+#define BENCH_NET_RR_SAMPLES 2000
+#define BENCH_NET_TCP_CHUNK (128 * 1024)
+#define BENCH_NET_UDP_BIG 1400 /* fits a 1500 MTU with IP + UDP headers */
+#define BENCH_NET_UDP_SMALL 64
+
+/* Control bytes: first byte of a TCP connection, or of an echoed datagram */
+#define BN_OP_SINK 'S'
+#define BN_OP_ECHO 'E'
+#define BN_OP_STATS 'C'
+#define BN_OP_DATA 'D'
+
+/* ---------------------------------------------------------------------------
+ * Server (runs in the namespace under test)
+ * ---------------------------------------------------------------------------*/
+
+static void bn_serve_tcp(int c, uint64_t *udp_pkts, uint64_t *udp_bytes) {
+  char op;
+  if (read(c, &op, 1) != 1)
+    return;
+
+  static char buf[BENCH_NET_TCP_CHUNK];
+  if (op == BN_OP_SINK) {
+    uint64_t total = 0;
+    ssize_t n;
+    while ((n = read(c, buf, sizeof(buf))) > 0)
+      total += (uint64_t)n;
+    write_all(c, &total, sizeof(total));
+  } else if (op == BN_OP_ECHO) {
+    int one = 1;
+    setsockopt(c, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    ssize_t n;
+    while ((n = read(c, buf, sizeof(buf))) > 0)
+      if (write_all(c, buf, (size_t)n) != n)
+        break;
+  } else if (op == BN_OP_STATS) {
+    uint64_t stats[2] = {*udp_pkts, *udp_bytes};
+    write_all(c, stats, sizeof(stats));
+    *udp_pkts = *udp_bytes = 0;
+  }
+}
+
+static void bn_server_loop(int lfd, int ufd) {
+  uint64_t udp_pkts = 0, udp_bytes = 0;
+  struct pollfd pfd[2] = {{.fd = lfd, .events = POLLIN},
+                          {.fd = ufd, .events = POLLIN}};
+  char dgram[2048];
+
+  for (;;) {
+    if (poll(pfd, 2, -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      _exit(1);
+    }
+    if (pfd[1].revents & POLLIN) {
+      struct sockaddr_storage from;
+      socklen_t flen = sizeof(from);
+      ssize_t n;
+      while ((n = recvfrom(ufd, dgram, sizeof(dgram), MSG_DONTWAIT,
+                           (struct sockaddr *)&from, &flen)) > 0) {
+        if (dgram[0] == BN_OP_ECHO) {
+          sendto(ufd, dgram, (size_t)n, 0, (struct sockaddr *)&from, flen);
+        } else {
+          udp_pkts++;
+          udp_bytes += (uint64_t)n;
+        }
+        flen = sizeof(from);
+      }
+    }
+    if (pfd[0].revents & POLLIN) {
+      int c = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+      if (c >= 0) {
+        bn_serve_tcp(c, &udp_pkts, &udp_bytes);
+        close(c);
+      }
+    }
+  }
+}
+
+static int bn_bind(int type, uint32_t addr_be, uint16_t port) {
+  int fd = socket(AF_INET, type | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return -1;
+  int one = 1, rcvbuf = 4 * 1024 * 1024;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  struct sockaddr_in sa = {.sin_family = AF_INET,
+                           .sin_port = htons(port),
+                           .sin_addr.s_addr = addr_be};
+  if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0 ||
+      (type == SOCK_STREAM && listen(fd, 16) < 0)) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/* First IPv4 address on eth0, or "" */
+static void bn_eth0_addr(char *out, size_t size) {
+  struct ifaddrs *ifa_list, *ifa;
+  out[0] = '\0';
+  if (getifaddrs(&ifa_list) < 0)
+    return;
+  for (ifa = ifa_list; ifa; ifa = ifa->ifa_next) {
+    if (ifa->ifa_addr && ifa->ifa_addr->sa_family == AF_INET &&
+        strcmp(ifa->ifa_name, "eth0") == 0) {
+      inet_ntop(AF_INET, &((struct sockaddr_in *)ifa->ifa_addr)->sin_addr,
+                out, (socklen_t)size);
+      break;
+    }
+  }
+  freeifaddrs(ifa_list);
+}
+
+/*
+ * Join the container's netns and make sure eth0 is addressed.  The DHCP
+ * client in a real distro does this within a second or two; a minimal rootfs
+ * has none, so after a short wait the leased address is applied directly.
+ */
+static int bn_enter_container_net(pid_t init_pid, struct ds_config *cfg,
+                                  char *ip, size_t ip_size) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/ns/net", init_pid);
+  int nsfd = open(path, O_RDONLY | O_CLOEXEC);
+  if (nsfd < 0 || setns(nsfd, CLONE_NEWNET) < 0)
+    return -1;
+  close(nsfd);
+
+  for (int i = 0; i < 50; i++) {
+    bn_eth0_addr(ip, ip_size);
+    if (ip[0])
+      return 0;
+    usleep(100000);
+  }
+
+  ds_nl_ctx_t *ctx = ds_nl_open();
+  if (!ctx)
+    return -1;
+  ds_nl_link_up(ctx, "lo");
+  ds_nl_link_up(ctx, "eth0");
+  uint8_t prefix = cfg->net_bridgeless ? 32 : DS_NAT_PREFIX;
+  int ret = ds_nl_add_addr4(ctx, "eth0", inet_addr(cfg->static_nat_ip), prefix);
+  if (ret == 0 && cfg->net_bridgeless)
+    ret = ds_nl_add_route4(ctx, inet_addr(DS_NAT_GW_IP), 32, 0,
+                           ds_nl_get_ifindex(ctx, "eth0"));
+  ds_nl_close(ctx);
+  if (ret < 0 && ret != -EEXIST)
+    return -1;
+  safe_strncpy(ip, cfg->static_nat_ip, ip_size);
+  return 0;
+}
+
+/* Fork a server; init_pid 0 serves from the host namespace on loopback.
+ * Returns the child pid and the address it is reachable on. */
+static pid_t bn_spawn_server(pid_t init_pid, struct ds_config *cfg, char *ip,
+                             size_t ip_size) {
+  int pipefd[2];
+  if (pipe2(pipefd, O_CLOEXEC) < 0)
+    return -1;
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    close(pipefd[0]);
+    close(pipefd[1]);
+    return -1;
+  }
+  if (pid == 0) {
+    close(pipefd[0]);
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    char addr[INET_ADDRSTRLEN] = "127.0.0.1";
+    if (init_pid > 0 &&
+        bn_enter_container_net(init_pid, cfg, addr, sizeof(addr)) < 0)
+      _exit(1);
+    uint32_t bind_be = init_pid > 0 ? INADDR_ANY : htonl(INADDR_LOOPBACK);
+    int lfd = bn_bind(SOCK_STREAM, bind_be, BENCH_NET_PORT);
+    int ufd = bn_bind(SOCK_DGRAM, bind_be, BENCH_NET_PORT);
+    if (lfd < 0 || ufd < 0)
+      _exit(1);
+    write_all(pipefd[1], addr, strlen(addr) + 1);
+    close(pipefd[1]);
+    bn_server_loop(lfd, ufd);
+    _exit(0);
+  }
+
+  close(pipefd[1]);
+  ssize_t n = read(pipefd[0], ip, ip_size - 1);
+  close(pipefd[0]);
+  if (n <= 0) {
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    return -1;
+  }
+  ip[n] = '\0';
+  return pid;
+}
+
+/* ---------------------------------------------------------------------------
+ * Client tests
+ * ---------------------------------------------------------------------------*/
+
+struct bn_result {
+  const char *path;
+  const char *test;
+  double gbps, pps, loss_pct;
+  double p50_us, p90_us, p99_us, max_us;
+  int samples;
+  int ok;
+};
+
+static double bn_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int bn_connect(int type, const char *ip, uint16_t port) {
+  int fd = socket(AF_INET, type | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return -1;
+  int sndbuf = 4 * 1024 * 1024;
+  setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+  struct timeval tv = {.tv_sec = 2};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  struct sockaddr_in sa = {.sin_family = AF_INET, .sin_port = htons(port)};
+  inet_pton(AF_INET, ip, &sa.sin_addr);
+  if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static int bn_udp_stats(const char *ip, uint16_t port, uint64_t stats[2]) {
+  int fd = bn_connect(SOCK_STREAM, ip, port);
+  if (fd < 0)
+    return -1;
+  char op = BN_OP_STATS;
+  int ret = (write(fd, &op, 1) == 1 &&
+             ds_read_exact(fd, stats, 2 * sizeof(uint64_t)) == 0)
+                ? 0
+                : -1;
+  close(fd);
+  return ret;
+}
+
+static void bn_tcp_stream(struct bn_result *r, const char *ip, uint16_t port,
+                          int seconds) {
+  int fd = bn_connect(SOCK_STREAM, ip, port);
+  if (fd < 0)
+    return;
+  static char buf[BENCH_NET_TCP_CHUNK];
+  buf[0] = BN_OP_SINK;
+  if (write(fd, buf, 1) != 1) {
+    close(fd);
+    return;
+  }
+  double t0 = bn_now(), end = t0 + seconds;
+  while (bn_now() < end)
+    if (write_all(fd, buf, sizeof(buf)) != (ssize_t)sizeof(buf))
+      break;
+  shutdown(fd, SHUT_WR);
+  struct timeval tv = {.tv_sec = 10};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  uint64_t total = 0;
+  if (ds_read_exact(fd, &total, sizeof(total)) == 0) {
+    double secs = bn_now() - t0;
+    r->gbps = (double)total * 8 / secs / 1e9;
+    r->pps = -1;
+    r->ok = 1;
+  }
+  close(fd);
+}
+
+static void bn_udp_stream(struct bn_result *r, const char *ip, uint16_t port,
+                          size_t payload, int seconds) {
+  uint64_t stats[2];
+  if (bn_udp_stats(ip, port, stats) < 0) /* also resets the counters */
+    return;
+  int fd = bn_connect(SOCK_DGRAM, ip, port);
+  if (fd < 0)
+    return;
+  char buf[BENCH_NET_UDP_BIG];
+  memset(buf, 0, sizeof(buf));
+  buf[0] = BN_OP_DATA;
+  uint64_t sent = 0;
+  double t0 = bn_now(), end = t0 + seconds;
+  while (bn_now() < end) {
+    for (int i = 0; i < 64; i++)
+      if (send(fd, buf, payload, 0) == (ssize_t)payload)
+        sent++;
+  }
+  double secs = bn_now() - t0;
+  close(fd);
+  usleep(200000); /* let the receiver drain its queue */
+  if (bn_udp_stats(ip, port, stats) < 0 || sent == 0)
+    return;
+  r->pps = (double)stats[0] / secs;
+  r->gbps = (double)stats[1] * 8 / secs / 1e9;
+  r->loss_pct = 100.0 * (1.0 - (double)stats[0] / (double)sent);
+  if (r->loss_pct < 0)
+    r->loss_pct = 0;
+  r->ok = 1;
+}
+
+static int bn_cmp_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile over sorted samples */
+static double bn_pct(const double *v, int n, int p) {
+  int rank = (p * n + 99) / 100;
+  return v[rank < 1 ? 0 : (rank > n ? n - 1 : rank - 1)];
+}
+
+static void bn_rr(struct bn_result *r, const char *ip, uint16_t port,
+                  int type) {
+  int fd = bn_connect(type, ip, port);
+  if (fd < 0)
+    return;
+  char op = BN_OP_ECHO, byte = BN_OP_ECHO;
+  if (type == SOCK_STREAM) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (write(fd, &op, 1) != 1) {
+      close(fd);
+      return;
+    }
+  }
+
+  static double us[BENCH_NET_RR_SAMPLES];
+  int n = 0, lost = 0;
+  for (int i = 0; i < BENCH_NET_RR_SAMPLES; i++) {
+    double t0 = bn_now();
+    if (write(fd, &byte, 1) != 1 || read(fd, &byte, 1) != 1) {
+      if (type == SOCK_STREAM)
+        break;
+      lost++;
+      continue;
+    }
+    us[n++] = (bn_now() - t0) * 1e6;
+  }
+  close(fd);
+  if (n == 0)
+    return;
+  qsort(us, (size_t)n, sizeof(double), bn_cmp_double);
+  r->p50_us = bn_pct(us, n, 50);
+  r->p90_us = bn_pct(us, n, 90);
+  r->p99_us = bn_pct(us, n, 99);
+  r->max_us = us[n - 1];
+  r->samples = n;
+  r->loss_pct = 100.0 * lost / BENCH_NET_RR_SAMPLES;
+  r->gbps = r->pps = -1;
+  r->ok = 1;
+}
+
+#define BN_TESTS 5
+
+static void bn_run_path(struct bn_result *out, const char *path,
+                        const char *ip, uint16_t port, int seconds) {
+  static const char *const names[BN_TESTS] = {"tcp_stream", "udp_stream",
+                                              "udp_small", "tcp_rr", "udp_rr"};
+  for (int t = 0; t < BN_TESTS; t++) {
+    struct bn_result *r = &out[t];
+    memset(r, 0, sizeof(*r));
+    r->path = path;
+    r->test = names[t];
+    r->gbps = r->pps = r->p50_us = -1;
+    ds_log("[BENCH] %s %s -> %s:%u", path, names[t], ip, port);
+    switch (t) {
+    case 0:
+      bn_tcp_stream(r, ip, port, seconds);
+      break;
+    case 1:
+      bn_udp_stream(r, ip, port, BENCH_NET_UDP_BIG, seconds);
+      break;
+    case 2:
+      bn_udp_stream(r, ip, port, BENCH_NET_UDP_SMALL, seconds);
+      break;
+    case 3:
+      bn_rr(r, ip, port, SOCK_STREAM);
+      break;
+    default:
+      bn_rr(r, ip, port, SOCK_DGRAM);
+      break;
+    }
+    if (!r->ok)
+      ds_warn("[BENCH] %s %s failed", path, names[t]);
+  }
+}
+
+/* ---------------------------------------------------------------------------
+ * Port-forward mirror
+ * ---------------------------------------------------------------------------*/
+
+/*
+ * The container's forwards are PREROUTING DNAT rules, which host-local
+ * traffic never traverses.  While the test runs, the same translation is
+ * mirrored into OUTPUT for the gateway address so the host can drive it.
+ */
+static int bn_output_dnat(char *action, char *proto,
+                          const char *container_ip) {
+  char dport[8], to[INET_ADDRSTRLEN + 8];
+  snprintf(dport, sizeof(dport), "%d", BENCH_NET_FWD_PORT);
+  snprintf(to, sizeof(to), "%s:%d", container_ip, BENCH_NET_PORT);
+  char *argv[] = {"iptables", "-t",    "nat",  action,
+                  "OUTPUT",   "-p",    proto,  "-d",
+                  DS_NAT_GW_IP, "--dport", dport, "-j",
+                  "DNAT",     "--to-destination", to, NULL};
+  return run_command_quiet(argv);
+}
+
+/* ---------------------------------------------------------------------------
+ * Report
+ * ---------------------------------------------------------------------------*/
+
+static void bn_fmt(char *buf, size_t size, double v, int decimals) {
+  if (v < 0)
+    snprintf(buf, size, "-");
+  else
+    snprintf(buf, size, "%.*f", decimals, v);
+}
+
+static void bn_print_table(const struct bn_result *res, int count) {
+  printf("\n" C_BOLD "%-8s %-11s %9s %11s %7s %9s %9s %9s" C_RESET "\n",
+         "PATH", "TEST", "Gbps", "pps", "loss%", "p50 us", "p90 us",
+         "p99 us");
+  for (int i = 0; i < count; i++) {
+    const struct bn_result *r = &res[i];
+    if (!r->ok) {
+      printf("%-8s %-11s " C_RED "failed" C_RESET "\n", r->path, r->test);
+      continue;
+    }
+    char gbps[16], pps[16], p50[16], p90[16], p99[16];
+    bn_fmt(gbps, sizeof(gbps), r->gbps, 3);
+    bn_fmt(pps, sizeof(pps), r->pps, 0);
+    int rr = r->samples > 0;
+    bn_fmt(p50, sizeof(p50), rr ? r->p50_us : -1, 1);
+    bn_fmt(p90, sizeof(p90), rr ? r->p90_us : -1, 1);
+    bn_fmt(p99, sizeof(p99), rr ? r->p99_us : -1, 1);
+    printf("%-8s %-11s %9s %11s %7.2f %9s %9s %9s\n", r->path, r->test, gbps,
+           pps, r->loss_pct, p50, p90, p99);
+  }
+  printf("\n");
+}
+
+static void bn_print_json(const struct bn_result *res, int count,
+                          const struct ds_config *cfg, const char *ip,
+                          int seconds) {
+  char mtu[16] = "";
+  if (!cfg->net_bridgeless)
+    read_file("/sys/class/net/" DS_NAT_BRIDGE "/mtu", mtu, sizeof(mtu));
+  mtu[strcspn(mtu, "\n")] = '\0';
+  printf("{\"bench\":\"net\",\"version\":\"%s\",\"mode\":\"%s\","
+         "\"bridge_mtu\":%s,\"container_ip\":\"%s\",\"seconds\":%d,"
+         "\"results\":[",
+         DS_VERSION, cfg->net_bridgeless ? "bridgeless" : "bridge",
+         mtu[0] ? mtu : "null", ip, seconds);
+  for (int i = 0; i < count; i++) {
+    const struct bn_result *r = &res[i];
+    printf("%s{\"path\":\"%s\",\"test\":\"%s\",\"ok\":%s", i ? "," : "",
+           r->path, r->test, r->ok ? "true" : "false");
+    if (r->ok) {
+      if (r->gbps >= 0)
+        printf(",\"gbps\":%.4f", r->gbps);
+      if (r->pps >= 0)
+        printf(",\"pps\":%.0f", r->pps);
+      printf(",\"loss_pct\":%.3f", r->loss_pct);
+      if (r->samples > 0)
+        printf(",\"samples\":%d,\"p50_us\":%.2f,\"p90_us\":%.2f,"
+               "\"p99_us\":%.2f,\"max_us\":%.2f",
+               r->samples, r->p50_us, r->p90_us, r->p99_us, r->max_us);
+    }
+    printf("}");
+  }
+  printf("]}\n");
+}
+
+/* ---------------------------------------------------------------------------
+ * Entry point
+ * ---------------------------------------------------------------------------*/
+
+int ds_bench_net(struct ds_config *cfg, const char *seconds_arg,
+                 int json_output) {
+  int seconds = BENCH_NET_SECONDS;
+  if (seconds_arg) {
+    seconds = atoi(seconds_arg);
+    if (seconds < 1 || seconds > 600) {
+      ds_error("bench net: duration must be 1-600 seconds, got '%s'",
+               seconds_arg);
+      return 1;
+    }
+  }
+
+  /* Always the fixed name: a config auto-loaded from next to the rootfs may
+   * carry the real container's name, whose workspace entry is removed below */
+  safe_strncpy(cfg->container_name, BENCH_NET_NAME, sizeof(cfg->container_name));
+  safe_strncpy(cfg->hostname, BENCH_NET_NAME, sizeof(cfg->hostname));
+  cfg->pidfile[0] = '\0';
+  if (!cfg->rootfs_path[0] && !cfg->rootfs_img_path[0]) {
+    ds_error("bench net needs a rootfs to boot (-r DIR or -i IMAGE).");
+    return 1;
+  }
+
+  if (is_container_running(cfg, NULL)) {
+    ds_error("'%s' is already running - stop it before benchmarking.",
+             cfg->container_name);
+    return 1;
+  }
+
+  /* A clean, temporary NAT container: nothing saved next to the rootfs and
+   * no IP or forwards inherited from a config found there. */
+  cfg->config_file[0] = '\0';
+  cfg->static_nat_ip[0] = '\0';
+  cfg->foreground = 0;
+  cfg->port_forward_count = 2;
+  for (int i = 0; i < 2; i++) {
+    struct ds_port_forward *pf = &cfg->port_forwards[i];
+    memset(pf, 0, sizeof(*pf));
+    pf->host_port = BENCH_NET_FWD_PORT;
+    pf->container_port = BENCH_NET_PORT;
+    safe_strncpy(pf->proto, i ? "udp" : "tcp", sizeof(pf->proto));
+  }
+
+  /* With --json, stdout carries only the report: container start/stop
+   * chatter goes to stderr until then */
+  int saved_stdout = -1;
+  if (json_output) {
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+  }
+
+  struct bn_result res[3 * BN_TESTS];
+  int nres = 0, ret = 1, fwd_rules = 0;
+  pid_t host_srv = -1, ct_srv = -1, init_pid = 0;
+  char host_ip[INET_ADDRSTRLEN], ct_ip[INET_ADDRSTRLEN] = "";
+
+  /* Host-mode baseline first, before the container adds any rules */
+  host_srv = bn_spawn_server(0, cfg, host_ip, sizeof(host_ip));
+  if (host_srv < 0) {
+    ds_error("bench net: cannot start the loopback server on port %d: %s",
+             BENCH_NET_PORT, strerror(errno));
+    goto out;
+  }
+  bn_run_path(&res[nres], "host", host_ip, BENCH_NET_PORT, seconds);
+  nres += BN_TESTS;
+
+  ds_log("[BENCH] Starting temporary NAT container '%s'...",
+         cfg->container_name);
+  if (start_rootfs(cfg) != 0 || !is_container_running(cfg, &init_pid)) {
+    ds_error("bench net: failed to start the temporary container.");
+    goto out;
+  }
+
+  ct_srv = bn_spawn_server(init_pid, cfg, ct_ip, sizeof(ct_ip));
+  if (ct_srv < 0) {
+    ds_error("bench net: cannot start the server inside '%s'.",
+             cfg->container_name);
+    goto out;
+  }
+  bn_run_path(&res[nres], "veth", ct_ip, BENCH_NET_PORT, seconds);
+  nres += BN_TESTS;
+
+  fwd_rules = bn_output_dnat("-I", "tcp", ct_ip) == 0 &&
+              bn_output_dnat("-I", "udp", ct_ip) == 0;
+  if (fwd_rules) {
+    bn_run_path(&res[nres], "portfwd", DS_NAT_GW_IP, BENCH_NET_FWD_PORT,
+                seconds);
+    nres += BN_TESTS;
+  } else {
+    ds_warn("[BENCH] Could not mirror the port forward into OUTPUT - "
+            "skipping the portfwd path.");
+  }
+  ret = 0;
+
+out:
+  if (ct_ip[0]) {
+    bn_output_dnat("-D", "tcp", ct_ip);
+    bn_output_dnat("-D", "udp", ct_ip);
+  }
+  if (host_srv > 0) {
+    kill(host_srv, SIGKILL);
+    waitpid(host_srv, NULL, 0);
+  }
+  if (ct_srv > 0) {
+    kill(ct_srv, SIGKILL);
+    waitpid(ct_srv, NULL, 0);
+  }
+  if (init_pid > 0)
+    stop_rootfs(cfg, 0);
+
+  /* Drop the workspace mirror start_rootfs() wrote for the temporary name */
+  char dir[PATH_MAX];
+  snprintf(dir, sizeof(dir), "%s/Containers/%s", get_workspace_dir(),
+           cfg->container_name);
+  remove_recursive(dir);
+
+  if (saved_stdout >= 0) {
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+  }
+  if (ret == 0) {
+    if (json_output)
+      bn_print_json(res, nres, cfg, ct_ip, seconds);
+    else
+      bn_print_table(res, nres);
+  }
+  return ret;
+}
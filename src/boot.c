@@ -191,13 +191,12 @@ int internal_boot(struct ds_config *cfg) {
   /* Detect init system once - used for seccomp and cgroup setup */
   int is_systemd = is_systemd_rootfs(cfg->rootfs_path);
 
-  /* Apply Seccomp filters early for host protection.
-   * Minimal blocks kexec/module loading for all kernels/modes.
-   * Android setup handles keyring compat and manual deadlock shield. */
-  ds_seccomp_apply_minimal(cfg->hw_access, cfg->privileged_mask);
-  android_seccomp_setup(is_systemd,
-                        cfg->block_nested_ns &&
-                            !(cfg->privileged_mask & DS_PRIV_NOSEC));
+  /* Apply the seccomp filter early for host protection.
+   * One merged program: kexec/module loading blocks for all kernels/modes,
+   * keyring compat and the manual deadlock shield. */
+  ds_seccomp_apply(cfg->privileged_mask,
+                   cfg->block_nested_ns &&
+                       !(cfg->privileged_mask & DS_PRIV_NOSEC));
 
   /* 3. Setup volatile overlay INSIDE the container's mount namespace.
    * This MUST happen here (not in parent) so the overlay's connection to
@@ -508,8 +507,10 @@ int internal_boot(struct ds_config *cfg) {
   /* 22. Set container identity for systemd/openrc */
   write_file(DS_SYSTEMD_CONTAINER_MARKER, "droidspaces");
 
-  /* 23. Clear environment and set container defaults */
-  ds_env_boot_setup(cfg);
+  /* 23. Build the container environment (passed to init as envp) */
+  char **init_envp = ds_env_build(cfg, 0);
+  if (!init_envp)
+    ds_die("Out of memory building the container environment");
   ds_env_save("/run/droidspaces.env", cfg);
 
   /* 23b. Integration with /etc/profile.d for universal sourcing */
@@ -594,7 +595,7 @@ int internal_boot(struct ds_config *cfg) {
 
   init_args[argc] = NULL;
 
-  if (execve("/sbin/init", init_args, environ) < 0) {
+  if (execve("/sbin/init", init_args, init_envp) < 0) {
     ds_error("Failed to execute /sbin/init: %s", strerror(errno));
     ds_die("Container boot failed. Please ensure the rootfs path is correct "
            "and contains a valid /sbin/init binary.");
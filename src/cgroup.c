@@ -42,7 +42,7 @@ static int ds_cgroup_is_supported(struct host_cgroup *hc, const char *name) {
     /* V2: "hc->controllers" is just "unified", we must read cgroup.controllers */
     char path[PATH_MAX];
     char buf[256];
-    snprintf(path, sizeof(path), "%s/cgroup.controllers", hc->mountpoint);
+    snprintf(path, sizeof(path), "%.4070s/cgroup.controllers", hc->mountpoint);
     if (read_file(path, buf, sizeof(buf)) > 0) {
       return ds_cgroup_match_controller(buf, name);
     }
@@ -454,78 +454,119 @@ int setup_cgroups(int is_systemd, int force_cgroupv1) {
   return 0;
 }
 
-/**
- * Move a process (usually self) into the same cgroup hierarchy as target_pid.
- * This is used by 'enter' to ensure the process is physically inside the
- * container's cgroup subtree on the host, which is required for D-Bus/logind
- * inside the container to correctly move the process into session scopes.
- */
-int ds_cgroup_attach(pid_t target_pid) {
-  struct host_cgroup hosts[32];
-  int n = get_host_cgroups(hosts, 32);
+/* Find the cgroup in host hierarchy h that ds-enter leaves for target_pid
+ * belong under.  ns_prefix is prepended to the /proc/<pid>/cgroup path when
+ * the caller reads it from inside a cgroup namespace rooted at that prefix
+ * (the monitor), so the result is always relative to h->mountpoint. */
+static int cgroup_attach_subpath(const struct host_cgroup *h, pid_t target_pid,
+                                 const char *ns_prefix, char *subpath,
+                                 size_t size) {
+  const char *ctrl = (h->version == 2) ? NULL : h->controllers;
+  char first_ctrl[64];
 
-  for (int i = 0; i < n; i++) {
-    const char *ctrl = (hosts[i].version == 2) ? NULL : hosts[i].controllers;
-    char first_ctrl[64];
+  if (h->version == 1 && ctrl) {
+    if (sscanf(ctrl, "%63[^,]", first_ctrl) == 1)
+      ctrl = first_ctrl;
+  }
 
-    if (hosts[i].version == 1 && ctrl) {
-      if (sscanf(ctrl, "%63[^,]", first_ctrl) == 1)
-        ctrl = first_ctrl;
-    }
+  /* 1. Discover where target_pid lives in this hierarchy */
+  char proc_path[PATH_MAX];
+  snprintf(proc_path, sizeof(proc_path), "/proc/%d/cgroup", target_pid);
 
-    /* 1. Discover where target_pid lives in this hierarchy */
-    char proc_path[PATH_MAX];
-    snprintf(proc_path, sizeof(proc_path), "/proc/%d/cgroup", target_pid);
+  FILE *f = fopen(proc_path, "re");
+  if (!f)
+    return -1;
 
-    FILE *f = fopen(proc_path, "re");
-    if (!f)
+  char line[1024];
+  subpath[0] = '\0';
+  while (fgets(line, sizeof(line), f)) {
+    char *col1 = strchr(line, ':');
+    if (!col1)
+      continue;
+    char *col2 = strchr(col1 + 1, ':');
+    if (!col2)
       continue;
 
-    char line[1024];
-    char subpath[PATH_MAX] = {0};
-    while (fgets(line, sizeof(line), f)) {
-      char *col1 = strchr(line, ':');
-      if (!col1)
-        continue;
-      char *col2 = strchr(col1 + 1, ':');
-      if (!col2)
-        continue;
+    char *subsys = col1 + 1;
+    *col2 = '\0';
+    char *path = col2 + 1;
 
-      char *subsys = col1 + 1;
-      *col2 = '\0';
-      char *path = col2 + 1;
+    int match = 0;
+    if (h->version == 2 && subsys[0] == '\0') {
+      match = 1;
+    } else if (h->version == 1 && ctrl && strstr(subsys, ctrl)) {
+      match = 1;
+    }
 
-      int match = 0;
-      if (hosts[i].version == 2 && subsys[0] == '\0') {
-        match = 1;
-      } else if (hosts[i].version == 1 && ctrl && strstr(subsys, ctrl)) {
-        match = 1;
+    if (match) {
+      char *nl = strchr(path, '\n');
+      if (nl)
+        *nl = '\0';
+      if (ns_prefix && ns_prefix[0]) {
+        safe_strncpy(subpath, ns_prefix, size);
+        if (strcmp(path, "/") != 0)
+          strncat(subpath, path, size - strlen(subpath) - 1);
+      } else {
+        safe_strncpy(subpath, path, size);
       }
 
-      if (match) {
-        char *nl = strchr(path, '\n');
-        if (nl)
-          *nl = '\0';
-        safe_strncpy(subpath, path, sizeof(subpath));
-
-        /* Professional refinement: if the path ends in a systemd management
-         * unit (.scope, .service, .slice), strip that component. This ensures
-         * the 'ds-enter-PID' cgroup is created as a peer to 'init.scope'
-         * (the container root) rather than being nested inside it. This is
-         * cleaner for systemd's accounting and avoids "non-leaf" V2 errors. */
-        char *last_slash = strrchr(subpath, '/');
-        if (last_slash && last_slash != subpath) {
-          if (strstr(last_slash, ".scope") || strstr(last_slash, ".service") ||
-              strstr(last_slash, ".slice")) {
-            *last_slash = '\0';
-          }
+      /* Professional refinement: if the path ends in a systemd management
+       * unit (.scope, .service, .slice), strip that component. This ensures
+       * the 'ds-enter-PID' cgroup is created as a peer to 'init.scope'
+       * (the container root) rather than being nested inside it. This is
+       * cleaner for systemd's accounting and avoids "non-leaf" V2 errors. */
+      char *last_slash = strrchr(subpath, '/');
+      if (last_slash && last_slash != subpath) {
+        if (strstr(last_slash, ".scope") || strstr(last_slash, ".service") ||
+            strstr(last_slash, ".slice")) {
+          *last_slash = '\0';
         }
-        break;
       }
+      break;
     }
-    fclose(f);
+  }
+  fclose(f);
+
+  return subpath[0] ? 0 : -1;
+}
+
+/* Create ds-enter-<self> under dirfd and move the calling process into it */
+static void cgroup_attach_at(int dirfd) {
+  char leaf[32];
+  snprintf(leaf, sizeof(leaf), "ds-enter-%d", (int)getpid());
 
-    if (subpath[0] == '\0')
+  if (mkdirat(dirfd, leaf, 0755) < 0 && errno != EEXIST)
+    return;
+
+  /* Move self into the leaf via cgroup.procs (moves whole process,
+   * not just the calling thread - unlike the legacy /tasks interface). */
+  char procs[64];
+  snprintf(procs, sizeof(procs), "%s/cgroup.procs", leaf);
+  int fd = openat(dirfd, procs, O_WRONLY | O_CLOEXEC);
+  if (fd < 0)
+    return;
+
+  char pid_s[32];
+  int len = snprintf(pid_s, sizeof(pid_s), "%d", (int)getpid());
+  if (write(fd, pid_s, (size_t)len) < 0) {
+  }
+  close(fd);
+}
+
+/**
+ * Move a process (usually self) into the same cgroup hierarchy as target_pid.
+ * This is used by 'enter' to ensure the process is physically inside the
+ * container's cgroup subtree on the host, which is required for D-Bus/logind
+ * inside the container to correctly move the process into session scopes.
+ */
+int ds_cgroup_attach(pid_t target_pid) {
+  struct host_cgroup hosts[32];
+  int n = get_host_cgroups(hosts, 32);
+
+  for (int i = 0; i < n; i++) {
+    char subpath[PATH_MAX];
+    if (cgroup_attach_subpath(&hosts[i], target_pid, NULL, subpath,
+                              sizeof(subpath)) < 0)
       continue;
 
     /* 2. Create a fresh leaf cgroup under init's path.
@@ -538,42 +579,74 @@ int ds_cgroup_attach(pid_t target_pid) {
      * the new directory so the write always succeeds, and the process appears
      * in the hierarchy as a proper descendant of init's cgroup rather than
      * leaking to the cgroup root ("/"). */
-    /* Build: <mountpoint>/<subpath>/ds-enter-<pid>
+    /* Build: <mountpoint>/<subpath>
      * subpath always starts with '/' so we skip the extra separator.
      * Use strncat chains - snprintf of two PATH_MAX strings into one
      * PATH_MAX buffer triggers -Wformat-truncation=2 at compile time. */
-    char leaf_dir[PATH_MAX];
-    char enter_suffix[32];
-    safe_strncpy(leaf_dir, hosts[i].mountpoint, sizeof(leaf_dir));
-    /* subpath begins with '/', append directly - no extra '/' needed. */
-    strncat(leaf_dir, subpath, sizeof(leaf_dir) - strlen(leaf_dir) - 1);
-    snprintf(enter_suffix, sizeof(enter_suffix), "/ds-enter-%d", (int)getpid());
-    strncat(leaf_dir, enter_suffix, sizeof(leaf_dir) - strlen(leaf_dir) - 1);
-
-    if (mkdir(leaf_dir, 0755) < 0 && errno != EEXIST) {
+    char parent_dir[PATH_MAX];
+    safe_strncpy(parent_dir, hosts[i].mountpoint, sizeof(parent_dir));
+    strncat(parent_dir, subpath, sizeof(parent_dir) - strlen(parent_dir) - 1);
+
+    int dirfd = open(parent_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd < 0)
       continue;
-    }
+    cgroup_attach_at(dirfd);
+    close(dirfd);
+  }
 
-    /* 3. Move self into the leaf via cgroup.procs (moves whole process,
-     *    not just the calling thread - unlike the legacy /tasks interface). */
-    char procs_path[PATH_MAX];
-    safe_strncpy(procs_path, leaf_dir, sizeof(procs_path));
-    strncat(procs_path, "/cgroup.procs",
-            sizeof(procs_path) - strlen(procs_path) - 1);
+  return 0;
+}
+
+/**
+ * Open the directories ds_cgroup_attach() would create its ds-enter leaves
+ * in, one per host hierarchy, so they can be cached and handed to enter/run
+ * (see entry.c).  in_cgns is set when the caller sits in the container's
+ * cgroup namespace, whose root is droidspaces/<name> on every hierarchy.
+ * Returns the number of fds stored in fds[].
+ */
+int ds_cgroup_open_attach_dirs(const char *container_name, pid_t target_pid,
+                               int in_cgns, int *fds, int max) {
+  struct host_cgroup hosts[32];
+  int n = get_host_cgroups(hosts, 32);
+  int count = 0;
+
+  char prefix[PATH_MAX] = "";
+  if (in_cgns) {
+    char safe_name[256];
+    sanitize_container_name(container_name, safe_name, sizeof(safe_name));
+    snprintf(prefix, sizeof(prefix), "/droidspaces/%s", safe_name);
+  }
 
-    int fd = open(procs_path, O_WRONLY | O_CLOEXEC);
-    if (fd < 0) {
+  for (int i = 0; i < n && count < max; i++) {
+    char subpath[PATH_MAX];
+    if (cgroup_attach_subpath(&hosts[i], target_pid, prefix, subpath,
+                              sizeof(subpath)) < 0)
       continue;
-    }
 
-    char pid_s[32];
-    int len = snprintf(pid_s, sizeof(pid_s), "%d", (int)getpid());
-    if (write(fd, pid_s, len) < 0) {
-    }
-    close(fd);
+    char parent_dir[PATH_MAX];
+    safe_strncpy(parent_dir, hosts[i].mountpoint, sizeof(parent_dir));
+    strncat(parent_dir, subpath, sizeof(parent_dir) - strlen(parent_dir) - 1);
+
+    int fd = open(parent_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0)
+      fds[count++] = fd;
   }
 
-  return 0;
+  return count;
+}
+
+/* ds_cgroup_attach() with the directories already resolved */
+void ds_cgroup_attach_dirs(const int *fds, int n) {
+  for (int i = 0; i < n; i++)
+    cgroup_attach_at(fds[i]);
+}
+
+/* ds_cgroup_detach() counterpart for leaves made by ds_cgroup_attach_dirs() */
+void ds_cgroup_detach_dirs(const int *fds, int n, pid_t child_pid) {
+  char leaf[32];
+  snprintf(leaf, sizeof(leaf), "ds-enter-%d", (int)child_pid);
+  for (int i = 0; i < n; i++)
+    unlinkat(fds[i], leaf, AT_REMOVEDIR);
 }
 
 /* ---------------------------------------------------------------------------
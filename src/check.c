@@ -40,6 +40,141 @@ static void check_append(const char *fmt, ...) {
   }
 }
 
+/* ---------------------------------------------------------------------------
+ * Host capability cache
+ *
+ * Kernel features that only change with a reboot or a different kernel
+ * (namespaces, pivot_root, seccomp, bridge/veth links, netfilter modules,
+ * filesystems) are probed once and recorded in <workspace>/host.caps, keyed
+ * by the kernel release and build string and the host boot_id. Later
+ * processes answer from the record instead of forking unshare() probes,
+ * spawning modprobe or creating probe links; `check --refresh` drops it.
+ * ---------------------------------------------------------------------------*/
+
+#define HOSTCAP_FILE "host.caps"
+#define HOSTCAP_MAGIC 0x50414344u /* "DCAP" */
+#define HOSTCAP_VERSION 1u
+
+struct hostcap_rec {
+  uint32_t magic;
+  uint32_t version;
+  char boot_id[40];
+  char release[65]; /* utsname.release */
+  char build[65];   /* utsname.version */
+  uint32_t known;   /* DS_HOSTCAP_* bits that have been probed */
+  uint32_t present; /* ... and were found */
+};
+
+static struct hostcap_rec g_hostcap;
+static int g_hostcap_loaded = 0;
+
+static void hostcap_path(char *buf, size_t size) {
+  snprintf(buf, size, "%s/" HOSTCAP_FILE, get_workspace_dir());
+}
+
+/* Reads the record on disk if it was written for this kernel and boot */
+static int hostcap_read(struct hostcap_rec *out) {
+  char path[PATH_MAX];
+  hostcap_path(path, sizeof(path));
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+  ssize_t n = read(fd, out, sizeof(*out));
+  close(fd);
+  if (n != (ssize_t)sizeof(*out) ||
+      memcmp(out, &g_hostcap, offsetof(struct hostcap_rec, known)) != 0)
+    return -1;
+  out->present &= out->known;
+  return 0;
+}
+
+static void hostcap_load(void) {
+  if (g_hostcap_loaded)
+    return;
+  g_hostcap_loaded = 1;
+
+  memset(&g_hostcap, 0, sizeof(g_hostcap));
+  g_hostcap.magic = HOSTCAP_MAGIC;
+  g_hostcap.version = HOSTCAP_VERSION;
+  struct utsname uts;
+  if (get_boot_id(g_hostcap.boot_id, sizeof(g_hostcap.boot_id)) < 0 ||
+      uname(&uts) < 0) {
+    g_hostcap.boot_id[0] = '\0'; /* no key: probe every time, never save */
+    return;
+  }
+  safe_strncpy(g_hostcap.release, uts.release, sizeof(g_hostcap.release));
+  safe_strncpy(g_hostcap.build, uts.version, sizeof(g_hostcap.build));
+
+  struct hostcap_rec rec;
+  if (hostcap_read(&rec) == 0) {
+    g_hostcap.known = rec.known;
+    g_hostcap.present = rec.present;
+  }
+}
+
+static void hostcap_save(void) {
+  if (!g_hostcap.boot_id[0])
+    return;
+
+  /* Keep what other processes probed since we loaded */
+  struct hostcap_rec rec;
+  if (hostcap_read(&rec) == 0) {
+    uint32_t theirs = rec.known & ~g_hostcap.known;
+    g_hostcap.known |= theirs;
+    g_hostcap.present |= rec.present & theirs;
+  }
+
+  char path[PATH_MAX], tmp[PATH_MAX + 8];
+  hostcap_path(path, sizeof(path));
+  snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+  int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return;
+  int ok = write_all(fd, &g_hostcap, sizeof(g_hostcap)) ==
+           (ssize_t)sizeof(g_hostcap);
+  close(fd);
+  if (!ok || rename(tmp, path) < 0)
+    unlink(tmp);
+}
+
+int ds_hostcap_get(uint32_t cap) {
+  hostcap_load();
+  if ((g_hostcap.known & cap) != cap)
+    return -1;
+  return (g_hostcap.present & cap) == cap;
+}
+
+void ds_hostcap_set(uint32_t cap, int present) {
+  hostcap_load();
+  uint32_t p = present ? (g_hostcap.present | cap) : (g_hostcap.present & ~cap);
+  if ((g_hostcap.known & cap) == cap && p == g_hostcap.present)
+    return;
+  g_hostcap.known |= cap;
+  g_hostcap.present = p;
+  hostcap_save();
+}
+
+/* Forgets every recorded answer so the next probes run live */
+void ds_hostcap_refresh(void) {
+  hostcap_load();
+  g_hostcap.known = 0;
+  g_hostcap.present = 0;
+  char path[PATH_MAX];
+  hostcap_path(path, sizeof(path));
+  unlink(path);
+}
+
+/* Filesystems can still appear later in a boot (module autoload on first
+ * mount), so only their presence is recorded. */
+int ds_hostcap_fs(uint32_t cap, const char *fstype) {
+  if (ds_hostcap_get(cap) == 1)
+    return 1;
+  if (grep_file("/proc/filesystems", fstype) <= 0)
+    return 0;
+  ds_hostcap_set(cap, 1);
+  return 1;
+}
+
 /* ---------------------------------------------------------------------------
  * Requirement checks
  * ---------------------------------------------------------------------------*/
@@ -49,7 +184,35 @@ static int check_root(void) {
   return is_root;
 }
 
-int check_ns(int flag, const char *name) {
+static uint32_t ns_hostcap(int flag) {
+  switch (flag) {
+  case CLONE_NEWNS:
+    return DS_HOSTCAP_NS_MNT;
+  case CLONE_NEWPID:
+    return DS_HOSTCAP_NS_PID;
+  case CLONE_NEWUTS:
+    return DS_HOSTCAP_NS_UTS;
+  case CLONE_NEWIPC:
+    return DS_HOSTCAP_NS_IPC;
+  case CLONE_NEWNET:
+    return DS_HOSTCAP_NS_NET;
+  case CLONE_NEWCGROUP:
+    return DS_HOSTCAP_NS_CGROUP;
+  default:
+    return 0;
+  }
+}
+
+/* Only root's probes are definitive (unshare needs CAP_SYS_ADMIN) */
+static int hostcap_record(uint32_t cap, int present) {
+  if (cap && getuid() == 0)
+    ds_hostcap_set(cap, present);
+  return present;
+}
+
+/* 1: present, 0: definitively absent, -1: inconclusive (fork failed or
+ * unshare hit a transient/permission error), which must not be cached */
+static int probe_ns(int flag, const char *name) {
   /* 1. Fast check for kernel support via /proc */
   char path[PATH_MAX];
   snprintf(path, sizeof(path), "/proc/self/ns/%s", name);
@@ -60,36 +223,62 @@ int check_ns(int flag, const char *name) {
    * We fork because unshare() affects the current process. */
   pid_t p = fork();
   if (p < 0)
-    return 0;
+    return -1;
 
   if (p == 0) {
     if (unshare(flag) < 0) {
-      _exit(1);
+      /* EINVAL: the kernel was built without this namespace */
+      _exit(errno == EINVAL ? 2 : 1);
     }
     _exit(0);
   }
 
   int status;
-  waitpid(p, &status, 0);
-  return (WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  if (waitpid(p, &status, 0) < 0 || !WIFEXITED(status))
+    return -1;
+  switch (WEXITSTATUS(status)) {
+  case 0:
+    return 1;
+  case 2:
+    return 0;
+  default:
+    return -1;
+  }
+}
+
+int check_ns(int flag, const char *name) {
+  uint32_t cap = ns_hostcap(flag);
+  int cached = cap ? ds_hostcap_get(cap) : -1;
+  if (cached >= 0)
+    return cached;
+  int present = probe_ns(flag, name);
+  if (present < 0)
+    return 0;
+  return hostcap_record(cap, present);
 }
 
 static int check_pivot_root(void) {
+  int cached = ds_hostcap_get(DS_HOSTCAP_PIVOT_ROOT);
+  if (cached >= 0)
+    return cached;
   /* Probe the syscall directly instead of guessing from fstype.
    * pivot_root(".", ".") returns EINVAL (bad args) when the syscall is
    * present but args are wrong, or ENOSYS when not compiled in.
    * This works correctly even on ramfs/rootfs roots (e.g. recovery env). */
   int ret = syscall(__NR_pivot_root, ".", ".");
-  if (ret < 0 && errno == ENOSYS)
-    return 0;
-  return 1;
+  return hostcap_record(DS_HOSTCAP_PIVOT_ROOT, !(ret < 0 && errno == ENOSYS));
 }
 
 static int check_loop(void) { return access("/dev/loop-control", F_OK) == 0; }
 
 static int check_seccomp(void) {
+  int cached = ds_hostcap_get(DS_HOSTCAP_SECCOMP);
+  if (cached >= 0)
+    return cached;
   /* Probe for SECCOMP_MODE_FILTER support */
-  return (prctl(PR_GET_SECCOMP, 0, 0, 0, 0) >= 0 || errno == EINVAL);
+  return hostcap_record(DS_HOSTCAP_SECCOMP,
+                        prctl(PR_GET_SECCOMP, 0, 0, 0, 0) >= 0 ||
+                            errno == EINVAL);
 }
 
 /* ---------------------------------------------------------------------------
@@ -108,6 +297,9 @@ static int check_seccomp(void) {
 + *
 ---------------------------------------------------------------------------*/
 static int check_bridge_support(void) {
+  int cached = ds_hostcap_get(DS_HOSTCAP_BRIDGE);
+  if (cached >= 0)
+    return cached;
   if (!is_root)
     return 0;
   ds_nl_ctx_t *ctx = ds_nl_open();
@@ -117,16 +309,22 @@ static int check_bridge_support(void) {
    * support */
   if (ds_nl_link_exists(ctx, "ds-cap-br0")) {
     ds_nl_close(ctx);
+    ds_hostcap_set(DS_HOSTCAP_BRIDGE, 1);
     return 1;
   }
   int ret = ds_nl_create_bridge(ctx, "ds-cap-br0");
   if (ret == 0)
     ds_nl_del_link(ctx, "ds-cap-br0");
   ds_nl_close(ctx);
+  if (ret == 0 || ret == -EOPNOTSUPP)
+    ds_hostcap_set(DS_HOSTCAP_BRIDGE, ret == 0);
   return (ret == 0);
 }
 
 static int check_veth_support(void) {
+  int cached = ds_hostcap_get(DS_HOSTCAP_VETH);
+  if (cached >= 0)
+    return cached;
   if (!is_root)
     return 0;
   ds_nl_ctx_t *ctx = ds_nl_open();
@@ -136,6 +334,7 @@ static int check_veth_support(void) {
    * support */
   if (ds_nl_link_exists(ctx, "ds-cap-h0")) {
     ds_nl_close(ctx);
+    ds_hostcap_set(DS_HOSTCAP_VETH, 1);
     return 1;
   }
   int ret = ds_nl_create_veth(ctx, "ds-cap-h0", "ds-cap-p0");
@@ -143,6 +342,8 @@ static int check_veth_support(void) {
     ds_nl_del_link(ctx,
                    "ds-cap-h0"); /* deleting host side also kills the peer */
   ds_nl_close(ctx);
+  if (ret == 0 || ret == -EOPNOTSUPP)
+    ds_hostcap_set(DS_HOSTCAP_VETH, ret == 0);
   return (ret == 0);
 }
 
@@ -174,7 +375,7 @@ int check_requirements_hw(int hw_access) {
   }
 
   /* devtmpfs is only needed for --hw-access; without it we use tmpfs */
-  if (hw_access && grep_file("/proc/filesystems", "devtmpfs") == 0) {
+  if (hw_access && !ds_hostcap_fs(DS_HOSTCAP_DEVTMPFS, "devtmpfs")) {
     ds_warn("Hardware access mode is active but this kernel does not support "
             "devtmpfs. GPU and hardware nodes may not be available.");
   }
@@ -257,12 +458,20 @@ void print_ds_check(const char *name, const char *desc, int status,
   }
 }
 
-int check_requirements_detailed(void) {
+int check_requirements_detailed(int refresh) {
   check_buf_pos = 0;
   check_buf[0] = '\0';
 
   check_root();
 
+  /* Answers come from the host capability snapshot when one exists for this
+   * kernel and boot; --refresh probes everything live again. */
+  int cached = ds_hostcap_get(DS_HOSTCAP_NS_PID) >= 0;
+  if (refresh) {
+    ds_hostcap_refresh();
+    cached = 0;
+  }
+
   check_append("\n" C_BOLD
                "Droidspaces v%s — Checking system requirements..." C_RESET
                "\n\n",
@@ -370,7 +579,7 @@ int check_requirements_detailed(void) {
   print_ds_check("Cgroup namespace", "Control Group namespace isolation",
                  check_ns(CLONE_NEWCGROUP, "cgroup"), "OPT");
 
-  int has_devtmpfs = grep_file("/proc/filesystems", "devtmpfs");
+  int has_devtmpfs = ds_hostcap_fs(DS_HOSTCAP_DEVTMPFS, "devtmpfs");
   print_ds_check(
       "devtmpfs support",
       "Required for hardware access mode; tmpfs fallback used otherwise",
@@ -390,7 +599,7 @@ int check_requirements_detailed(void) {
   print_ds_check("TUN/TAP support", "Virtual network device support",
                  access("/dev/net/tun", F_OK) == 0, "OPT");
   print_ds_check("OverlayFS support", "Required for --volatile mode",
-                 grep_file("/proc/filesystems", "overlay"), "OPT");
+                 ds_hostcap_fs(DS_HOSTCAP_OVERLAY, "overlay"), "OPT");
   print_ds_check("Network namespace",
                  "Network namespace isolation for --net=nat/none",
                  check_ns(CLONE_NEWNET, "net"), "OPT");
@@ -416,6 +625,9 @@ int check_requirements_detailed(void) {
     check_append(C_BOLD C_YELLOW "\n[!] Warning: You are not root. Some checks "
                                  "may be inaccurate.\n" C_RESET);
   }
+  if (cached)
+    check_append(C_DIM "\nResults cached for this boot; run 'droidspaces "
+                       "check --refresh' to probe again.\n" C_RESET);
   check_append("\n");
 
   /* One-shot output to terminal */
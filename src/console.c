@@ -24,13 +24,45 @@ static pid_t read_current_container_pid(const char *pidfile) {
   return -1;
 }
 
+/* Input hook for the relay: intercepts the CTRL+ALT+Q (\x1b\x11) escape
+ * sequence instead of forwarding it to the container. */
+static size_t console_filter_input(void *ctx, const char *buf, size_t n) {
+  struct ds_config *cfg = ctx;
+  static int exit_detected = 0;
+
+  if (n < 2 || buf[0] != '\x1b' || buf[1] != '\x11')
+    return n;
+
+  if (exit_detected == 0) {
+    /* Droidspaces Specific: Graceful background shutdown.
+     * We fork a detached child to call stop_rootfs() silently.
+     * This allows the current console_monitor_loop to keep running,
+     * streaming the systemd/sysvinit shutdown logs to the user's
+     * terminal until the container naturally dies and the PTY hangs
+     * up.
+     */
+    pid_t bg_pid = fork();
+    if (bg_pid == 0) {
+      /* Background shutdown process */
+      setsid();
+      ds_log_silent = 1;
+      stop_rootfs(cfg, 0);
+      _exit(0);
+    } else if (bg_pid > 0) {
+      /* Parent console loop just marks exit and continues streaming */
+      exit_detected = 1;
+    }
+  }
+  return 0; /* Don't write the CTRL+ALT+Q sequence to the PTY */
+}
+
 int console_monitor_loop(int master_fd, pid_t monitor_pid,
                          struct ds_config *cfg) {
   int epfd, sfd;
   sigset_t mask;
   struct signalfd_siginfo fdsi;
   struct epoll_event ev, events[10];
-  char buf[4096];
+  static struct ds_pty_relay relay;
   ssize_t n;
   int ret = 0;
 
@@ -54,19 +86,15 @@ int console_monitor_loop(int master_fd, pid_t monitor_pid,
     return -1;
   }
 
-  /* 1. Watch user stdin */
-  ev.events = EPOLLIN;
-  ev.data.fd = STDIN_FILENO;
-  if (epoll_ctl(epfd, EPOLL_CTL_ADD, STDIN_FILENO, &ev) < 0)
-    ds_warn("epoll_ctl(stdin) failed: %s", strerror(errno));
-
-  /* 2. Watch PTY master */
-  ev.events = EPOLLIN | EPOLLHUP | EPOLLERR;
-  ev.data.fd = master_fd;
-  if (epoll_ctl(epfd, EPOLL_CTL_ADD, master_fd, &ev) < 0)
+  /* 1. Watch user stdin, PTY master and stdout through the relay */
+  if (ds_relay_open(&relay, epfd, master_fd) < 0)
     ds_warn("epoll_ctl(master_fd) failed: %s", strerror(errno));
+  relay.in_filter = console_filter_input;
+  relay.filter_ctx = cfg;
+  if (cfg->record_sessions && !getenv("DS_SESSION_RECORDED"))
+    relay.rec = ds_record_open(cfg->container_name, "console", STDIN_FILENO);
 
-  /* 3. Watch signalfd */
+  /* 2. Watch signalfd */
   ev.events = EPOLLIN;
   ev.data.fd = sfd;
   if (epoll_ctl(epfd, EPOLL_CTL_ADD, sfd, &ev) < 0)
@@ -93,60 +121,10 @@ int console_monitor_loop(int master_fd, pid_t monitor_pid,
       break;
     }
 
-    for (int i = 0; i < nfds; i++) {
+    for (int i = 0; i < nfds && running; i++) {
       int fd = events[i].data.fd;
 
-      if (fd == STDIN_FILENO) {
-        /* User input -> Container master */
-        n = read(STDIN_FILENO, buf, sizeof(buf));
-        if (n > 0) {
-          /* Check for CTRL+ALT+Q (\x1b\x11) escape sequence */
-          if (n >= 2 && buf[0] == '\x1b' && buf[1] == '\x11') {
-            static int exit_detected = 0;
-            if (exit_detected == 0) {
-              /* Droidspaces Specific: Graceful background shutdown.
-               * We fork a detached child to call stop_rootfs() silently.
-               * This allows the current console_monitor_loop to keep running,
-               * streaming the systemd/sysvinit shutdown logs to the user's
-               * terminal until the container naturally dies and the PTY hangs
-               * up.
-               */
-              pid_t bg_pid = fork();
-              if (bg_pid == 0) {
-                /* Background shutdown process */
-                setsid();
-                ds_log_silent = 1;
-                stop_rootfs(cfg, 0);
-                _exit(0);
-              } else if (bg_pid > 0) {
-                /* Parent console loop just marks exit and continues streaming
-                 */
-                exit_detected = 1;
-              }
-            }
-            continue; /* Don't write the CTRL+ALT+Q sequence to the PTY */
-          }
-
-          if (write_all(master_fd, buf, (size_t)n) < 0) {
-            running = 0;
-            break;
-          }
-        } else if (n == 0) {
-          /* EOF on stdin */
-        }
-      } else if (fd == master_fd) {
-        /* Container output -> User stdout */
-        if (events[i].events & (EPOLLHUP | EPOLLERR)) {
-          running = 0;
-          break;
-        }
-        n = read(master_fd, buf, sizeof(buf));
-        if (n > 0) {
-          write_all(STDOUT_FILENO, buf, (size_t)n);
-        } else {
-          running = 0;
-        }
-      } else if (fd == sfd) {
+      if (fd == sfd) {
         /* Signal handling */
         n = read(sfd, &fdsi, sizeof(fdsi));
         if (n != sizeof(fdsi))
@@ -161,18 +139,26 @@ int console_monitor_loop(int master_fd, pid_t monitor_pid,
           }
         } else if (fdsi.ssi_signo == SIGWINCH) {
           struct winsize ws;
-          if (ioctl(STDIN_FILENO, TIOCGWINSZ, &ws) == 0)
+          if (ioctl(STDIN_FILENO, TIOCGWINSZ, &ws) == 0) {
             ioctl(master_fd, TIOCSWINSZ, &ws);
+            ds_record_resize(relay.rec, ws.ws_col, ws.ws_row);
+          }
         } else if (fdsi.ssi_signo == SIGINT || fdsi.ssi_signo == SIGTERM) {
           /* Forward to container init (read live PID) */
           pid_t live_pid = read_current_container_pid(cfg->pidfile);
           if (live_pid > 0)
             kill(live_pid, (int)fdsi.ssi_signo);
         }
+      } else if (ds_relay_event(&relay, fd, events[i].events)) {
+        /* PTY hung up (and its output is flushed) or stdout is gone */
+        running = 0;
       }
     }
   }
 
+  ds_relay_close(&relay);
+  ds_record_close(relay.rec);
+
   /* Restore terminal settings */
   if (is_tty == 0) {
     tcsetattr(STDIN_FILENO, TCSAFLUSH, &oldtios);
@@ -7,6 +7,7 @@
 
 #include "droidspace.h"
 #include "virtualize.h"
+#include <malloc.h>
 
 /* ---------------------------------------------------------------------------
  * External Command Lock - CLI-only ownership
@@ -259,6 +260,54 @@ int is_valid_container_pid(pid_t pid) {
   return 1;
 }
 
+/* ---------------------------------------------------------------------------
+ * Monitor event sources (one boot cycle, see ds_evloop.c)
+ * ---------------------------------------------------------------------------*/
+
+struct mon_wait {
+  pid_t mid_pid;
+  int status;
+  int done;
+};
+
+static int mon_reap(struct mon_wait *w) {
+  if (!w->done) {
+    pid_t r = waitpid(w->mid_pid, &w->status, WNOHANG);
+    if (r == w->mid_pid || (r < 0 && errno != EINTR))
+      w->done = 1;
+  }
+  return w->done;
+}
+
+static void mon_on_signal(struct ds_ev *ev, uint32_t events) {
+  (void)events;
+  /* Drain every queued signal; SIGCHLD is the only one acted on here */
+  struct signalfd_siginfo fdsi;
+  while (read(ev->fd, &fdsi, sizeof(fdsi)) == (ssize_t)sizeof(fdsi))
+    ;
+  /* The intermediate is gone: end this cycle's ds_ev_run() */
+  if (mon_reap(ev->arg))
+    ds_ev_stop();
+}
+
+static void mon_on_entry(struct ds_ev *ev, uint32_t events) {
+  (void)events;
+  ds_entry_serve(ev->fd);
+}
+
+static void mon_on_hotplug(struct ds_ev *ev, uint32_t events) {
+  (void)events;
+  ds_hotplug_process(ev->fd, ev->arg);
+}
+
+static void mon_on_virtualize(struct ds_ev *ev, uint32_t events) {
+  (void)events;
+  struct ds_config *cfg = ev->arg;
+  ds_ev_timer_ack(ev);
+  if (cfg->container_pid > 0)
+    ds_virtualize_update(cfg);
+}
+
 /* ---------------------------------------------------------------------------
  * Start
  * ---------------------------------------------------------------------------*/
@@ -494,6 +543,10 @@ int start_rootfs(struct ds_config *cfg) {
     firmware_path_add(fw_path);
   }
 
+  /* Compile the device blocklist (plus workspace devices.rules) while the
+   * host workspace is in view; init and the monitor inherit it. */
+  ds_dev_blocklist_init();
+
   cfg->tty_count = DS_MAX_TTYS;
   ds_fix_host_ptys();
 
@@ -583,6 +636,13 @@ int start_rootfs(struct ds_config *cfg) {
 
     prctl(PR_SET_NAME, "[ds-monitor]", 0, 0, 0);
 
+#ifdef M_ARENA_MAX
+    /* The monitor is single-threaded and only makes small, short-lived
+     * allocations; pin glibc to the main arena so nothing it links in can
+     * reserve 64 MiB of address space for a per-thread one. */
+    mallopt(M_ARENA_MAX, 1);
+#endif
+
     /* Unshare namespaces - Monitor enters new UTS, IPC, and optionally Cgroup
      * namespaces immediately. PID namespace is NOT unshared here because
      * unshare(CLONE_NEWPID) can only be called once per process. Instead,
@@ -611,7 +671,7 @@ int start_rootfs(struct ds_config *cfg) {
     sigaddset(&mask, SIGTERM);
     sigaddset(&mask, SIGINT);
     sigprocmask(SIG_BLOCK, &mask, NULL);
-    int sfd = signalfd(-1, &mask, SFD_CLOEXEC);
+    int sfd = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
 
     /* Adaptive Cgroup Namespace (introduced in Linux 4.6).
      *
@@ -633,6 +693,23 @@ int start_rootfs(struct ds_config *cfg) {
 
     int stdio_redirected = 0;
 
+    /* Entry socket for enter/run (see entry.c); bound once, serves every
+     * boot cycle */
+    int entry_srv = ds_entry_listen(cfg->container_name);
+
+    /* Hot-plugged devices for an isolated /dev (see hardware.c) */
+    int hotplug_fd = ds_hotplug_open(cfg);
+
+    /* Everything the monitor serves from here on - the cycle's signals,
+     * entry requests, uevents and the NAT services - runs from one epoll
+     * loop in this thread (see ds_evloop.c) */
+    if (ds_ev_init() < 0)
+      ds_warn("Monitor: event loop unavailable: %s", strerror(errno));
+
+    /* Drop the CLI's dead stack and heap before the first intermediate
+     * fork inherits them */
+    ds_release_boot_memory();
+
     /* ── Reboot-aware boot loop ──
      * Each iteration forks an intermediate child that creates a fresh PID
      * namespace (unshare(CLONE_NEWPID)) and then forks the container init.
@@ -728,6 +805,11 @@ int start_rootfs(struct ds_config *cfg) {
       /* ── INTERMEDIATE PROCESS ──
        * Create a fresh PID namespace (and NET namespace for NAT/none modes)
        * for this boot cycle. */
+      if (entry_srv >= 0)
+        close(entry_srv);
+      if (hotplug_fd >= 0)
+        close(hotplug_fd);
+
       int clone_flags = CLONE_NEWPID;
       if (cfg->net_mode != DS_NET_HOST)
         clone_flags |= CLONE_NEWNET;
@@ -877,7 +959,7 @@ int start_rootfs(struct ds_config *cfg) {
             ds_warn("[NET] Monitor: setup_veth_host_side failed - "
                     "container will have no internet");
           } else {
-            /* Start the dynamic route monitor thread to handle WiFi/Mobile
+            /* Start the dynamic route monitor to handle WiFi/Mobile
              * switches */
             ds_net_start_route_monitor();
 
@@ -901,6 +983,9 @@ int start_rootfs(struct ds_config *cfg) {
           close(cfg->net_done_pipe[1]);
           cfg->net_done_pipe[1] = -1;
         }
+
+        if (entry_srv >= 0)
+          ds_entry_publish(cfg, init_pid, cg_ns_ok);
       }
     }
     /* ─────────────────────────────────────────────────────────────────── */
@@ -922,6 +1007,13 @@ int start_rootfs(struct ds_config *cfg) {
       stdio_redirected = 1;
     }
 
+    /* Host-side boot work for this cycle is done.  Binds and preserved
+     * config lines were only needed by internal_boot(); a reboot reloads
+     * both from the workspace config (only the env block is carried). */
+    free_config_binds(cfg);
+    free_config_unknown_lines(cfg);
+    ds_release_boot_memory();
+
     /* MONITOR waits for intermediate to complete */
 
     /* CRITICAL TIMING: Close sync pipe write end ONLY after intermediate
@@ -934,33 +1026,37 @@ int start_rootfs(struct ds_config *cfg) {
       sync_pipe[1] = -1;
     }
 
-    int status;
-    while (1) {
-      pid_t r = waitpid(mid_pid, &status, WNOHANG);
-      if (r == mid_pid)
-        break;
-      if (r < 0 && errno != EINTR)
-        break;
+    /* Sleep in the event loop until the intermediate exits.  Sources that
+     * persist across cycles are registered per cycle so a reboot starts
+     * from a clean set; the NAT services register themselves. */
+    struct mon_wait mw = {.mid_pid = mid_pid};
+    struct ds_ev sig_ev = {.fd = -1}, entry_ev = {.fd = -1},
+                 hotplug_ev = {.fd = -1}, virt_ev = {.fd = -1};
+    if (sfd >= 0)
+      ds_ev_add(&sig_ev, sfd, EPOLLIN, mon_on_signal, &mw);
+    if (entry_srv >= 0)
+      ds_ev_add(&entry_ev, entry_srv, EPOLLIN, mon_on_entry, NULL);
+    if (hotplug_fd >= 0)
+      ds_ev_add(&hotplug_ev, hotplug_fd, EPOLLIN, mon_on_hotplug, cfg);
+    if (cfg->virtualization &&
+        ds_ev_timer_add(&virt_ev, 500, 500, mon_on_virtualize, cfg) < 0)
+      ds_warn("Monitor: virtualization timer: %s", strerror(errno));
+
+    /* The intermediate may already be gone (SIGCHLD consumed before the
+     * signalfd was registered) */
+    if (!mon_reap(&mw) && (sig_ev.fd < 0 || ds_ev_run() < 0)) {
+      while (waitpid(mid_pid, &mw.status, 0) < 0 && errno == EINTR)
+        ;
+    }
+    int status = mw.status;
 
-      /* Periodic tasks for monitor process */
-      if (cfg->virtualization && cfg->container_pid > 0) {
-        ds_virtualize_update(cfg);
-      }
+    ds_ev_close(&virt_ev);
+    ds_ev_del(&hotplug_ev);
+    ds_ev_del(&entry_ev);
+    ds_ev_del(&sig_ev);
 
-      /* Wait for next update or a signal (500ms for responsiveness) */
-      if (sfd >= 0) {
-        struct pollfd pfd = {.fd = sfd, .events = POLLIN};
-        if (poll(&pfd, 1, 500) > 0) {
-          /* Signal received, drain signalfd to prevent busy-wait */
-          struct signalfd_siginfo fdsi;
-          if (read(sfd, &fdsi, sizeof(fdsi)) < 0) {
-            /* Handle or ignore error */
-          }
-        }
-      } else {
-        usleep(500000);
-      }
-    }
+    /* Init is gone: its namespaces must not be handed out any more */
+    ds_entry_unpublish();
 
     /* Log what monitor saw */
     if (WIFEXITED(status)) {
@@ -1014,17 +1110,17 @@ int start_rootfs(struct ds_config *cfg) {
       /* Reload from workspace (canonical path the user edits) */
       {
         free_config_binds(cfg);
-        /* Preserve env_vars across the reboot */
-        struct ds_env_var *saved_vars = cfg->env_vars;
+        /* Preserve the env block across the reboot */
+        char *saved_env = cfg->env_block;
+        size_t saved_env_len = cfg->env_block_len;
         int saved_count = cfg->env_var_count;
-        int saved_cap = cfg->env_var_capacity;
         int old_force_cgv1 = cfg->force_cgroupv1;
 
         struct ds_config reboot_cfg = *cfg;
         if (ds_config_load_by_name(cfg->container_name, &reboot_cfg) == 0) {
-          reboot_cfg.env_vars = saved_vars;
+          reboot_cfg.env_block = saved_env;
+          reboot_cfg.env_block_len = saved_env_len;
           reboot_cfg.env_var_count = saved_count;
-          reboot_cfg.env_var_capacity = saved_cap;
           if (strcmp(cfg->dns_servers, reboot_cfg.dns_servers) != 0) {
             reboot_cfg.dns_server_content[0] = '\0';
             ds_get_dns_servers(reboot_cfg.dns_servers,
@@ -1052,10 +1148,9 @@ int start_rootfs(struct ds_config *cfg) {
         ds_log_silent = 1;
 
       /* Stop the DNS proxy before re-entering the boot loop.  The reboot
-       * path skips full cleanup, so without this the old proxy thread keeps
-       * running and ds_dns_proxy_start() on the next cycle overwrites g_proxy
-       * with memset - losing the thread ID and leaking a zombie thread.
-       * ds_dns_proxy_start() will restart it cleanly after veth setup. */
+       * path skips full cleanup, so without this the old proxy sockets stay
+       * registered with the event loop until ds_dns_proxy_start() on the
+       * next cycle, which restarts it cleanly after veth setup. */
       ds_dns_proxy_stop();
 
       goto reboot_loop;
@@ -1355,28 +1450,21 @@ int stop_rootfs(struct ds_config *cfg, int skip_unmount) {
  * Namespace Entry (shared for enter and run)
  * ---------------------------------------------------------------------------*/
 
-int enter_namespace(pid_t pid, struct ds_config *cfg) {
-  /* Verify process is still alive before trying to enter namespaces */
-  if (kill(pid, 0) < 0) {
-    ds_error("Container PID %d is no longer alive.", pid);
-    return -1;
-  }
+static const char *const ns_names[DS_NS_COUNT] = {"mnt", "uts",    "ipc",
+                                                   "pid", "cgroup", "net"};
 
-  const char *ns_names[] = {"mnt", "uts", "ipc", "pid", "cgroup", "net"};
-  int ns_fds[6];
+/* Open every /proc/<pid>/ns/<type> descriptor up front (CRITICAL: before any
+ * setns).  Missing optional namespaces are left at -1. */
+int open_namespace_fds(pid_t pid, int ns_fds[DS_NS_COUNT]) {
   char path[PATH_MAX];
 
-  /* 1. Open all namespace descriptors first (CRITICAL: before any setns) */
-  for (int i = 0; i < 6; i++) {
+  for (int i = 0; i < DS_NS_COUNT; i++) {
     snprintf(path, sizeof(path), "/proc/%d/ns/%s", pid, ns_names[i]);
-    ns_fds[i] = open(path, O_RDONLY);
+    ns_fds[i] = open(path, O_RDONLY | O_CLOEXEC);
     if (ns_fds[i] < 0) {
       if (i == 0) { /* mnt is mandatory */
         ds_error("Failed to open mount namespace at %s: %s", path,
                  strerror(errno));
-        /* Cleanup previous fds */
-        for (int j = 0; j < i; j++)
-          close(ns_fds[j]);
         return -1;
       }
       if (errno != ENOENT && i != 5) {
@@ -1386,8 +1474,12 @@ int enter_namespace(pid_t pid, struct ds_config *cfg) {
     }
   }
 
-  /* 2. Enter namespaces */
-  for (int i = 0; i < 6; i++) {
+  return 0;
+}
+
+/* setns() into each open descriptor; every fd is closed on return */
+int enter_namespace_fds(int ns_fds[DS_NS_COUNT], struct ds_config *cfg) {
+  for (int i = 0; i < DS_NS_COUNT; i++) {
     if (ns_fds[i] < 0)
       continue;
 
@@ -1395,15 +1487,18 @@ int enter_namespace(pid_t pid, struct ds_config *cfg) {
      */
     if (i == 5 && cfg && cfg->net_mode == DS_NET_HOST) {
       close(ns_fds[i]);
+      ns_fds[i] = -1;
       continue;
     }
 
     if (setns(ns_fds[i], 0) < 0) {
       if (i == 0) { /* mnt is mandatory */
         ds_error("setns(mnt) failed: %s", strerror(errno));
-        for (int j = i; j < 6; j++)
+        for (int j = i; j < DS_NS_COUNT; j++) {
           if (ns_fds[j] >= 0)
             close(ns_fds[j]);
+          ns_fds[j] = -1;
+        }
         return -1;
       }
       if (i != 5) {
@@ -1411,18 +1506,43 @@ int enter_namespace(pid_t pid, struct ds_config *cfg) {
       }
     }
     close(ns_fds[i]);
+    ns_fds[i] = -1;
   }
 
   return 0;
 }
 
+int enter_namespace(pid_t pid, struct ds_config *cfg) {
+  /* Verify process is still alive before trying to enter namespaces */
+  if (kill(pid, 0) < 0) {
+    ds_error("Container PID %d is no longer alive.", pid);
+    return -1;
+  }
+
+  int ns_fds[DS_NS_COUNT];
+  if (open_namespace_fds(pid, ns_fds) < 0)
+    return -1;
+
+  return enter_namespace_fds(ns_fds, cfg);
+}
+
 /* ---------------------------------------------------------------------------
  * Enter / Run
  * ---------------------------------------------------------------------------*/
 
-int enter_rootfs(struct ds_config *cfg, const char *user) {
-  pid_t pid = 0;
-  if (!is_container_running(cfg, &pid) || pid <= 0) {
+/* Resolve the container PID, namespaces, cgroup and env for enter/run.
+ * The monitor's cached entry descriptor covers all of it in one round trip;
+ * without one (older monitor, reboot in progress) fall back to validating
+ * the pidfile and parsing the env file here. */
+static int prepare_entry(struct ds_config *cfg, struct ds_entry_desc *entry,
+                         pid_t *pid) {
+  if (ds_entry_fetch(cfg, entry) == 0) {
+    *pid = entry->init_pid;
+    return 0;
+  }
+
+  *pid = 0;
+  if (!is_container_running(cfg, pid) || *pid <= 0) {
     ds_error("Container '%s' is not running or invalid.", cfg->container_name);
     return -1;
   }
@@ -1435,11 +1555,127 @@ int enter_rootfs(struct ds_config *cfg, const char *user) {
     parse_env_file_to_config(cfg->env_file, cfg);
     ds_log_silent = prev_silent;
   }
+  return 0;
+}
+
+/* Child side of enter/run: join the container's cgroup subtree and
+ * namespaces, from the cached descriptor when there is one */
+static int join_container(struct ds_config *cfg, struct ds_entry_desc *entry,
+                          pid_t pid) {
+  ds_log_silent = 1;
+  if (entry->init_pid > 0)
+    ds_cgroup_attach_dirs(entry->cg_fds, entry->cg_count);
+  else
+    ds_cgroup_attach(pid);
+  ds_log_silent = 0;
+
+  int ret = entry->init_pid > 0 ? enter_namespace_fds(entry->ns_fds, cfg)
+                                : enter_namespace(pid, cfg);
+  ds_entry_release(entry);
+  return ret;
+}
+
+/* Parent side: remove the child's ds-enter leaf and drop the descriptor */
+static void finish_entry(struct ds_entry_desc *entry, pid_t child) {
+  if (entry->init_pid > 0)
+    ds_cgroup_detach_dirs(entry->cg_fds, entry->cg_count, child);
+  else
+    ds_cgroup_detach(child);
+  ds_entry_release(entry);
+}
+
+/* Session-leader side of an interactive shell: fork the login shell for
+ * user on tty->slave, wait for it and exit with its status. The caller has
+ * already made this process the session leader of tty->slave (see the
+ * LXC-style notes in enter_rootfs). */
+static void run_login_session(struct ds_config *cfg, const char *user,
+                              struct ds_tty_info *tty)
+    __attribute__((noreturn));
+static void run_login_session(struct ds_config *cfg, const char *user,
+                              struct ds_tty_info *tty) {
+  /* Must fork again to actually be in the new PID namespace */
+  pid_t shell_pid = fork();
+  if (shell_pid < 0)
+    _exit(EXIT_FAILURE);
+  if (shell_pid == 0) {
+    /* The controlling terminal and session leader were established in
+     * the intermediate (parent of this fork) - do NOT call setsid()
+     * or TIOCSCTTY here.  This process (bash) is a child member of
+     * the intermediate's session and inherits pts/1 as its ctty.
+     * Being a non-session-leader is deliberate: when the user runs
+     * 'login' inside bash, login's vhangup() sends SIGHUP only to
+     * the session leader (the intermediate, which ignores it), so
+     * bash is unaffected and its prompt returns after login exits. */
+    if (ds_terminal_set_stdfds(tty->slave) < 0)
+      _exit(EXIT_FAILURE);
+
+    if (tty->slave > STDERR_FILENO)
+      close(tty->slave);
+
+    if (chdir("/") < 0)
+      _exit(EXIT_FAILURE);
+
+    /* Fixed, user-defined and /etc/environment variables, handed to
+     * execve() as-is */
+    char **envp = ds_env_build(cfg, 1);
+    if (!envp)
+      _exit(EXIT_FAILURE);
+
+    /* Primary path: proper login via su -l <user>.
+     * This gives the correct home directory, shell, and login environment
+     * from the container's /etc/passwd.  user is always non-NULL here
+     * (main.c defaults to "root" when no argument is given). */
+    char *shell_argv[] = {"su", "-l", (char *)(uintptr_t)user, NULL};
+    execve("/bin/su", shell_argv, envp);
+    execve("/usr/bin/su", shell_argv, envp);
+
+    /* Fallback: su not available - look up the shell from /etc/passwd */
+    char user_shell[PATH_MAX] = {0};
+    if (get_user_shell(user, user_shell, sizeof(user_shell)) == 0) {
+      if (access(user_shell, X_OK) == 0) {
+        const char *sh_name = strrchr(user_shell, '/');
+        sh_name = sh_name ? sh_name + 1 : user_shell;
+        char *sh_argv[] = {(char *)(uintptr_t)sh_name, "-l", NULL};
+        execve(user_shell, sh_argv, envp);
+      }
+    }
+
+    /* Last resort: try shells in priority order */
+    const char *shells[] = {"/bin/bash", "/bin/ash", "/bin/sh", NULL};
+    for (int i = 0; shells[i]; i++) {
+      if (access(shells[i], X_OK) == 0) {
+        const char *sh_name = strrchr(shells[i], '/');
+        sh_name = sh_name ? sh_name + 1 : shells[i];
+        char *sh_argv[] = {(char *)(uintptr_t)sh_name, "-l", NULL};
+        execve(shells[i], sh_argv, envp);
+      }
+    }
+
+    ds_error("Failed to find any usable shell");
+    _exit(EXIT_FAILURE);
+  }
+  /* Intermediate: intentionally keep tty->slave open as the peer fd.
+   * This holds a stable reference on the pts slave entry for the entire
+   * session, preventing it from being destroyed during the brief
+   * vhangup()/reopen window when the user runs 'login'.
+   * The fd is released automatically when we _exit below. */
+  int status = 0;
+  while (waitpid(shell_pid, &status, 0) < 0 && errno == EINTR)
+    ;
+  _exit(WIFSIGNALED(status) ? 128 + WTERMSIG(status) : WEXITSTATUS(status));
+}
+
+int enter_rootfs(struct ds_config *cfg, const char *user) {
+  struct ds_entry_desc entry;
+  pid_t pid;
+  if (prepare_entry(cfg, &entry, &pid) < 0)
+    return -1;
 
   ds_log("Entering container '%s' as %s...", cfg->container_name, user);
 
   int sv[2];
   if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+    ds_entry_release(&entry);
     free_config_env_vars(cfg);
     return -1;
   }
@@ -1448,6 +1684,7 @@ int enter_rootfs(struct ds_config *cfg, const char *user) {
   if (child < 0) {
     close(sv[0]);
     close(sv[1]);
+    ds_entry_release(&entry);
     free_config_env_vars(cfg);
     return -1;
   }
@@ -1460,11 +1697,7 @@ int enter_rootfs(struct ds_config *cfg, const char *user) {
      * subtree, which is required for D-Bus/logind inside to move it into
      * session scopes.
      */
-    ds_log_silent = 1;
-    ds_cgroup_attach(pid);
-    ds_log_silent = 0;
-
-    if (enter_namespace(pid, cfg) < 0)
+    if (join_container(cfg, &entry, pid) < 0)
       _exit(EXIT_FAILURE);
 
     /* Apply identical security hardening as internal_boot().
@@ -1472,9 +1705,9 @@ int enter_rootfs(struct ds_config *cfg, const char *user) {
      * inherited only via fork/exec from PID 1 - entering processes arrive via
      * setns() and are NOT children of init, so they inherit nothing. */
     ds_log_silent = 1;
-    ds_seccomp_apply_minimal(cfg->hw_access, cfg->privileged_mask);
-    android_seccomp_setup(0, cfg->block_nested_ns &&
-                                 !(cfg->privileged_mask & DS_PRIV_NOSEC));
+    ds_seccomp_apply(cfg->privileged_mask,
+                     cfg->block_nested_ns &&
+                         !(cfg->privileged_mask & DS_PRIV_NOSEC));
     ds_apply_capability_hardening(cfg->hw_access, cfg->privileged_mask);
     ds_log_silent = 0;
 
@@ -1524,74 +1757,7 @@ int enter_rootfs(struct ds_config *cfg, const char *user) {
     close(tty.master);
     close(sv[1]);
 
-    /* Must fork again to actually be in the new PID namespace */
-    pid_t shell_pid = fork();
-    if (shell_pid < 0)
-      _exit(EXIT_FAILURE);
-    if (shell_pid == 0) {
-      /* The controlling terminal and session leader were established in
-       * the intermediate (parent of this fork) - do NOT call setsid()
-       * or TIOCSCTTY here.  This process (bash) is a child member of
-       * the intermediate's session and inherits pts/1 as its ctty.
-       * Being a non-session-leader is deliberate: when the user runs
-       * 'login' inside bash, login's vhangup() sends SIGHUP only to
-       * the session leader (the intermediate, which ignores it), so
-       * bash is unaffected and its prompt returns after login exits. */
-      if (ds_terminal_set_stdfds(tty.slave) < 0)
-        _exit(EXIT_FAILURE);
-
-      if (tty.slave > STDERR_FILENO)
-        close(tty.slave);
-
-      if (chdir("/") < 0)
-        _exit(EXIT_FAILURE);
-
-      /* Apply fixed and user-defined environment */
-      ds_env_boot_setup(cfg);
-      load_etc_environment();
-
-      extern char **environ;
-
-      /* Primary path: proper login via su -l <user>.
-       * This gives the correct home directory, shell, and login environment
-       * from the container's /etc/passwd.  user is always non-NULL here
-       * (main.c defaults to "root" when no argument is given). */
-      char *shell_argv[] = {"su", "-l", (char *)(uintptr_t)user, NULL};
-      execve("/bin/su", shell_argv, environ);
-      execve("/usr/bin/su", shell_argv, environ);
-
-      /* Fallback: su not available - look up the shell from /etc/passwd */
-      char user_shell[PATH_MAX] = {0};
-      if (get_user_shell(user, user_shell, sizeof(user_shell)) == 0) {
-        if (access(user_shell, X_OK) == 0) {
-          const char *sh_name = strrchr(user_shell, '/');
-          sh_name = sh_name ? sh_name + 1 : user_shell;
-          char *sh_argv[] = {(char *)(uintptr_t)sh_name, "-l", NULL};
-          execve(user_shell, sh_argv, environ);
-        }
-      }
-
-      /* Last resort: try shells in priority order */
-      const char *shells[] = {"/bin/bash", "/bin/ash", "/bin/sh", NULL};
-      for (int i = 0; shells[i]; i++) {
-        if (access(shells[i], X_OK) == 0) {
-          const char *sh_name = strrchr(shells[i], '/');
-          sh_name = sh_name ? sh_name + 1 : shells[i];
-          char *sh_argv[] = {(char *)(uintptr_t)sh_name, "-l", NULL};
-          execve(shells[i], sh_argv, environ);
-        }
-      }
-
-      ds_error("Failed to find any usable shell");
-      _exit(EXIT_FAILURE);
-    }
-    /* Intermediate: intentionally keep tty.slave open as the peer fd.
-     * This holds a stable reference on the pts slave entry for the entire
-     * session, preventing it from being destroyed during the brief
-     * vhangup()/reopen window when the user runs 'login'.
-     * The fd is released automatically when we _exit below. */
-    waitpid(shell_pid, NULL, 0);
-    _exit(EXIT_SUCCESS);
+    run_login_session(cfg, user, &tty);
   }
 
   close(sv[1]);
@@ -1603,7 +1769,7 @@ int enter_rootfs(struct ds_config *cfg, const char *user) {
   if (master_fd < 0) {
     ds_error("Failed to receive PTY master from child");
     waitpid(child, NULL, 0);
-    ds_cgroup_detach(child);
+    finish_entry(&entry, child);
     return -1;
   }
 
@@ -1620,7 +1786,13 @@ int enter_rootfs(struct ds_config *cfg, const char *user) {
   struct termios old_tios;
   int has_tty = (ds_setup_tios(STDIN_FILENO, &old_tios) == 0);
 
-  ds_terminal_proxy(master_fd);
+  /* Under the daemon, a recorded session is already captured there */
+  struct ds_recorder *rec = NULL;
+  if (cfg->record_sessions && !getenv("DS_SESSION_RECORDED"))
+    rec = ds_record_open(cfg->container_name, "enter", STDIN_FILENO);
+
+  ds_terminal_proxy(master_fd, rec);
+  ds_record_close(rec);
 
   if (has_tty) {
     tcsetattr(STDIN_FILENO, TCSAFLUSH, &old_tios);
@@ -1628,32 +1800,23 @@ int enter_rootfs(struct ds_config *cfg, const char *user) {
 
   close(master_fd);
   waitpid(child, NULL, 0);
-  ds_cgroup_detach(child);
+  finish_entry(&entry, child);
   free_config_env_vars(cfg);
   return 0;
 }
 
 int run_in_rootfs(struct ds_config *cfg, int argc, char **argv) {
   (void)argc;
-  pid_t pid = 0;
-  if (!is_container_running(cfg, &pid) || pid <= 0) {
-    ds_error("Container '%s' is not running or invalid.", cfg->container_name);
+  struct ds_entry_desc entry;
+  pid_t pid;
+  if (prepare_entry(cfg, &entry, &pid) < 0)
     return -1;
-  }
 
   /* Removed verbose status log to allow raw output stream */
 
-  /* Parse environment file while host paths are reachable */
-  if (cfg->env_file[0] != '\0') {
-    free_config_env_vars(cfg);
-    int prev_silent = ds_log_silent;
-    ds_log_silent = 1;
-    parse_env_file_to_config(cfg->env_file, cfg);
-    ds_log_silent = prev_silent;
-  }
-
   pid_t child = fork();
   if (child < 0) {
+    ds_entry_release(&entry);
     free_config_env_vars(cfg);
     return -1;
   }
@@ -1662,19 +1825,15 @@ int run_in_rootfs(struct ds_config *cfg, int argc, char **argv) {
     /* Mirror enter_rootfs: attach to the container's cgroup subtree before
      * crossing into its namespaces, so the command is properly accounted
      * under systemd's hierarchy instead of leaking to the cgroup root. */
-    ds_log_silent = 1;
-    ds_cgroup_attach(pid);
-    ds_log_silent = 0;
-
-    if (enter_namespace(pid, cfg) < 0)
+    if (join_container(cfg, &entry, pid) < 0)
       _exit(EXIT_FAILURE);
 
     /* Apply identical security hardening as internal_boot() and enter_rootfs().
      * Same reasoning: run processes are not children of container PID 1. */
     ds_log_silent = 1;
-    ds_seccomp_apply_minimal(cfg->hw_access, cfg->privileged_mask);
-    android_seccomp_setup(0, cfg->block_nested_ns &&
-                                 !(cfg->privileged_mask & DS_PRIV_NOSEC));
+    ds_seccomp_apply(cfg->privileged_mask,
+                     cfg->block_nested_ns &&
+                         !(cfg->privileged_mask & DS_PRIV_NOSEC));
     ds_apply_capability_hardening(cfg->hw_access, cfg->privileged_mask);
     ds_log_silent = 0;
 
@@ -1685,9 +1844,14 @@ int run_in_rootfs(struct ds_config *cfg, int argc, char **argv) {
       if (chdir("/") < 0)
         _exit(EXIT_FAILURE);
 
-      /* Setup environment */
-      ds_env_boot_setup(cfg);
-      load_etc_environment();
+      /* Setup environment.  execvp() resolves argv[0] against the PATH in
+       * environ, so install the block there instead of passing it to
+       * execve() directly. */
+      extern char **environ;
+      char **envp = ds_env_build(cfg, 1);
+      if (!envp)
+        _exit(EXIT_FAILURE);
+      environ = envp;
 
       /* Run the command directly as an alien process (instant results) */
       if (argv[1] == NULL && strchr(argv[0], ' ') != NULL) {
@@ -1708,11 +1872,965 @@ int run_in_rootfs(struct ds_config *cfg, int argc, char **argv) {
 
   int status;
   waitpid(child, &status, 0);
-  ds_cgroup_detach(child);
+  finish_entry(&entry, child);
   free_config_env_vars(cfg);
   return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
 }
 
+/* ---------------------------------------------------------------------------
+ * Batch run
+ *
+ * run-batch enters the container once and runs a whole list of commands as
+ * children of one in-container helper.  Input (a file, or stdin) is either:
+ *   - a JSON array whose items are shell strings or argv arrays,
+ *     e.g. ["uname -a", ["ls", "-l", "/"]];
+ *   - NUL-delimited shell commands (when the input contains a NUL byte);
+ *   - newline-delimited shell commands (blank lines skipped).
+ * Each command gets /dev/null as stdin; its stdout and stderr are captured
+ * (up to BATCH_OUT_MAX bytes each, the rest is read and dropped) and printed
+ * as one framed record once it exits:
+ *   @@ds-batch <index> exit=<code> stdout=<bytes> stderr=<bytes>\n
+ *   <stdout bytes><stderr bytes>
+ * or, with --json, one object per line (bytes that are not UTF-8 come out
+ * as \u00XX escapes):
+ *   {"index":0,"exit":0,"stdout":"...","stderr":"..."}
+ * A capped stream adds " truncated=1" to the header line, or
+ * "truncated":true to the object.
+ * ---------------------------------------------------------------------------*/
+
+struct batch_list {
+  char ***cmds; /* NULL-terminated argv per command, strings point into buf */
+  int count;
+  int cap;
+};
+
+static int batch_add(struct batch_list *b, char **argv) {
+  if (b->count == b->cap) {
+    int ncap = b->cap ? b->cap * 2 : 16;
+    char ***n = realloc(b->cmds, (size_t)ncap * sizeof(*n));
+    if (!n)
+      return -1;
+    b->cmds = n;
+    b->cap = ncap;
+  }
+  b->cmds[b->count++] = argv;
+  return 0;
+}
+
+static int batch_add_shell(struct batch_list *b, char *cmd) {
+  char **argv = malloc(4 * sizeof(*argv));
+  if (!argv)
+    return -1;
+  argv[0] = "/bin/sh";
+  argv[1] = "-c";
+  argv[2] = cmd;
+  argv[3] = NULL;
+  if (batch_add(b, argv) < 0) {
+    free(argv);
+    return -1;
+  }
+  return 0;
+}
+
+static void batch_free(struct batch_list *b) {
+  for (int i = 0; i < b->count; i++)
+    free(b->cmds[i]);
+  free(b->cmds);
+  memset(b, 0, sizeof(*b));
+}
+
+/* A JSON string used as a command word: a \u0000 escape can't be passed
+ * through execve(), so such strings are rejected. */
+static char *batch_json_word(char **pp, const char *end) {
+  size_t len;
+  char *s = ds_json_get_str(pp, end, &len);
+  return (s && strlen(s) == len) ? s : NULL;
+}
+
+static int batch_parse_json(char *buf, size_t len, struct batch_list *b) {
+  char *end = buf + len;
+  char *p = ds_json_skip_ws(buf, end) + 1; /* caller saw the '[' */
+
+  for (;;) {
+    p = ds_json_skip_ws(p, end);
+    if (p < end && *p == ']' && b->count == 0)
+      return 0;
+
+    if (p < end && *p == '"') {
+      char *s = batch_json_word(&p, end);
+      if (!s || batch_add_shell(b, s) < 0)
+        goto bad;
+    } else if (p < end && *p == '[') {
+      char **argv = NULL;
+      int argc = 0;
+      p = ds_json_skip_ws(p + 1, end);
+      while (p < end && *p != ']') {
+        char *s = (*p == '"') ? batch_json_word(&p, end) : NULL;
+        char **n = s ? realloc(argv, (size_t)(argc + 2) * sizeof(*argv)) : NULL;
+        if (!n) {
+          free(argv);
+          goto bad;
+        }
+        argv = n;
+        argv[argc++] = s;
+        argv[argc] = NULL;
+        p = ds_json_skip_ws(p, end);
+        if (p < end && *p == ',')
+          p = ds_json_skip_ws(p + 1, end);
+        else if (p >= end || *p != ']') {
+          free(argv);
+          goto bad;
+        }
+      }
+      if (p >= end || argc == 0 || batch_add(b, argv) < 0) {
+        free(argv);
+        goto bad;
+      }
+      p++;
+    } else {
+      goto bad;
+    }
+
+    p = ds_json_skip_ws(p, end);
+    if (p < end && *p == ',') {
+      p++;
+      continue;
+    }
+    if (p < end && *p == ']')
+      return 0;
+    goto bad;
+  }
+
+bad:
+  ds_error("run-batch: invalid JSON input near offset %zu", (size_t)(p - buf));
+  return -1;
+}
+
+static int batch_parse(char *buf, size_t len, struct batch_list *b) {
+  char *p = ds_json_skip_ws(buf, buf + len);
+  if (p < buf + len && *p == '[')
+    return batch_parse_json(buf, len, b);
+
+  char sep = memchr(buf, '\0', len) ? '\0' : '\n';
+  char *end = buf + len;
+  p = buf;
+  while (p < end) {
+    char *e = memchr(p, sep, (size_t)(end - p));
+    if (!e)
+      e = end;
+    *e = '\0';
+    char *line = p;
+    p = e + 1;
+    if (sep == '\n' && e > line && e[-1] == '\r')
+      e[-1] = '\0';
+    if (line[strspn(line, " \t\r")] == '\0')
+      continue;
+    if (batch_add_shell(b, line) < 0)
+      return -1;
+  }
+  return 0;
+}
+
+/* Read all of fd into a NUL-terminated heap buffer */
+static char *batch_read_input(int fd, size_t *len_out) {
+  size_t len = 0, cap = 4096;
+  char *buf = malloc(cap);
+  if (!buf)
+    return NULL;
+  for (;;) {
+    if (cap - len < 2) {
+      char *n = realloc(buf, cap * 2);
+      if (!n) {
+        free(buf);
+        return NULL;
+      }
+      buf = n;
+      cap *= 2;
+    }
+    ssize_t r = read(fd, buf + len, cap - len - 1);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r < 0) {
+      free(buf);
+      return NULL;
+    }
+    if (r == 0)
+      break;
+    len += (size_t)r;
+  }
+  buf[len] = '\0';
+  *len_out = len;
+  return buf;
+}
+
+#define BATCH_OUT_MAX (8u << 20)
+
+struct batch_out {
+  char *data;
+  size_t len;
+  size_t cap;
+  int truncated;
+};
+
+static int batch_drain(int fd, struct batch_out *o) {
+  if (o->len >= BATCH_OUT_MAX) {
+    /* keep the pipe flowing so the command can finish */
+    char sink[4096];
+    ssize_t r = read(fd, sink, sizeof(sink));
+    if (r < 0)
+      return errno == EINTR ? 1 : -1;
+    if (r > 0)
+      o->truncated = 1;
+    return r > 0;
+  }
+  if (o->cap - o->len < 4096) {
+    size_t ncap = o->cap ? o->cap * 2 : 8192;
+    char *n = realloc(o->data, ncap);
+    if (!n)
+      return -1;
+    o->data = n;
+    o->cap = ncap;
+  }
+  size_t room = o->cap - o->len;
+  if (room > BATCH_OUT_MAX - o->len)
+    room = BATCH_OUT_MAX - o->len;
+  ssize_t r = read(fd, o->data + o->len, room);
+  if (r < 0)
+    return errno == EINTR ? 1 : -1;
+  o->len += (size_t)r;
+  return r > 0;
+}
+
+/* Run one command from inside the container; returns its exit code */
+static int batch_exec_one(char **argv, char **envp, int devnull,
+                          struct batch_out *out, struct batch_out *err) {
+  int po[2], pe[2];
+  if (pipe2(po, O_CLOEXEC) < 0)
+    return 127;
+  if (pipe2(pe, O_CLOEXEC) < 0) {
+    close(po[0]);
+    close(po[1]);
+    return 127;
+  }
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    close(po[0]);
+    close(po[1]);
+    close(pe[0]);
+    close(pe[1]);
+    return 127;
+  }
+  if (pid == 0) {
+    dup2(devnull, STDIN_FILENO);
+    dup2(po[1], STDOUT_FILENO);
+    dup2(pe[1], STDERR_FILENO);
+    if (chdir("/") < 0)
+      _exit(127);
+    extern char **environ;
+    environ = envp;
+    execvp(argv[0], argv);
+    dprintf(STDERR_FILENO, "%s: %s\n", argv[0], strerror(errno));
+    _exit(127);
+  }
+  close(po[1]);
+  close(pe[1]);
+
+  struct pollfd pfd[2] = {{.fd = po[0], .events = POLLIN},
+                          {.fd = pe[0], .events = POLLIN}};
+  struct batch_out *dst[2] = {out, err};
+  int open_fds = 2;
+  while (open_fds > 0) {
+    if (poll(pfd, 2, -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    for (int i = 0; i < 2; i++) {
+      if (pfd[i].fd < 0 || !(pfd[i].revents & (POLLIN | POLLHUP | POLLERR)))
+        continue;
+      if (batch_drain(pfd[i].fd, dst[i]) <= 0) {
+        close(pfd[i].fd);
+        pfd[i].fd = -1;
+        open_fds--;
+      }
+    }
+  }
+  for (int i = 0; i < 2; i++)
+    if (pfd[i].fd >= 0)
+      close(pfd[i].fd);
+
+  int status = 0;
+  pid_t r;
+  while ((r = waitpid(pid, &status, 0)) < 0 && errno == EINTR)
+    ;
+  if (r < 0)
+    return 127;
+  if (WIFEXITED(status))
+    return WEXITSTATUS(status);
+  return WIFSIGNALED(status) ? 128 + WTERMSIG(status) : 1;
+}
+
+static void batch_emit(int index, int code, const struct batch_out *out,
+                       const struct batch_out *err, int json) {
+  if (json) {
+    printf("{\"index\":%d,\"exit\":%d,\"stdout\":", index, code);
+    ds_json_put_str(stdout, out->data ? out->data : "", out->len);
+    fputs(",\"stderr\":", stdout);
+    ds_json_put_str(stdout, err->data ? err->data : "", err->len);
+    fputs(out->truncated || err->truncated ? ",\"truncated\":true}\n" : "}\n",
+          stdout);
+  } else {
+    printf("@@ds-batch %d exit=%d stdout=%zu stderr=%zu%s\n", index, code,
+           out->len, err->len,
+           out->truncated || err->truncated ? " truncated=1" : "");
+    if (out->len)
+      fwrite(out->data, 1, out->len, stdout);
+    if (err->len)
+      fwrite(err->data, 1, err->len, stdout);
+  }
+  fflush(stdout);
+}
+
+int run_batch_in_rootfs(struct ds_config *cfg, const char *input, int json) {
+  int in_fd = STDIN_FILENO;
+  if (input && strcmp(input, "-") != 0) {
+    in_fd = open(input, O_RDONLY | O_CLOEXEC);
+    if (in_fd < 0) {
+      ds_error("run-batch: cannot open %s: %s", input, strerror(errno));
+      return -1;
+    }
+  }
+
+  size_t len = 0;
+  char *buf = batch_read_input(in_fd, &len);
+  if (in_fd != STDIN_FILENO)
+    close(in_fd);
+  if (!buf) {
+    ds_error("run-batch: failed to read commands: %s", strerror(errno));
+    return -1;
+  }
+
+  struct batch_list batch = {0};
+  int parsed = batch_parse(buf, len, &batch);
+  if (parsed < 0 || batch.count == 0) {
+    if (parsed == 0)
+      ds_error("run-batch: no commands given");
+    batch_free(&batch);
+    free(buf);
+    return -1;
+  }
+
+  struct ds_entry_desc entry;
+  pid_t pid;
+  if (prepare_entry(cfg, &entry, &pid) < 0) {
+    batch_free(&batch);
+    free(buf);
+    return -1;
+  }
+
+  /* Opened on the host before setns(), handed to every command */
+  int devnull = open("/dev/null", O_RDWR | O_CLOEXEC);
+
+  fflush(stdout);
+  pid_t child = fork();
+  if (child < 0) {
+    ds_entry_release(&entry);
+    free_config_env_vars(cfg);
+    batch_free(&batch);
+    free(buf);
+    if (devnull >= 0)
+      close(devnull);
+    return -1;
+  }
+
+  if (child == 0) {
+    /* One setup for the whole batch: same steps as run_in_rootfs() */
+    if (join_container(cfg, &entry, pid) < 0)
+      _exit(EXIT_FAILURE);
+
+    ds_log_silent = 1;
+    ds_seccomp_apply(cfg->privileged_mask,
+                     cfg->block_nested_ns &&
+                         !(cfg->privileged_mask & DS_PRIV_NOSEC));
+    ds_apply_capability_hardening(cfg->hw_access, cfg->privileged_mask);
+    ds_log_silent = 0;
+
+    /* setns(pid) only applies to children: fork once more so every
+     * command is a child of a process inside the container PID namespace */
+    pid_t runner = fork();
+    if (runner < 0)
+      _exit(EXIT_FAILURE);
+    if (runner == 0) {
+      char **envp = ds_env_build(cfg, 1);
+      if (!envp)
+        _exit(EXIT_FAILURE);
+
+      int failed = 0;
+      for (int i = 0; i < batch.count; i++) {
+        struct batch_out out = {0}, err = {0};
+        int code = batch_exec_one(batch.cmds[i], envp, devnull, &out, &err);
+        batch_emit(i, code, &out, &err, json);
+        free(out.data);
+        free(err.data);
+        if (code != 0)
+          failed = 1;
+      }
+      _exit(failed ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+
+    int status = 0;
+    pid_t r;
+    while ((r = waitpid(runner, &status, 0)) < 0 && errno == EINTR)
+      ;
+    _exit(r > 0 && WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE);
+  }
+
+  if (devnull >= 0)
+    close(devnull);
+
+  int status = 0;
+  pid_t r;
+  while ((r = waitpid(child, &status, 0)) < 0 && errno == EINTR)
+    ;
+  finish_entry(&entry, child);
+  free_config_env_vars(cfg);
+  batch_free(&batch);
+  free(buf);
+  return r > 0 && WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/* ---------------------------------------------------------------------------
+ * Multiplexed shells
+ * ---------------------------------------------------------------------------*/
+
+/*
+ * Many PTY channels (the app's terminal tabs) over one daemon connection.
+ * A "joiner" child enters the container once and stays there; each
+ * DS_MUX_OPEN then costs it a pty and the two forks of enter_rootfs' session
+ * layout. This process stays on the host and relays the channel frames.
+ *
+ * Frames (see droidspace.h), every payload starting with a u16 channel id:
+ *   OPEN   client: ch, rows, cols, [user]   server: ch, i32 pid or -errno
+ *   DATA   both ways: ch, bytes
+ *   WINCH  client: ch, rows, cols
+ *   CLOSE  client: ch (hang up)             server: ch, i32 exit code
+ * Every OPEN is acked; a channel whose OPEN succeeded ends with a CLOSE from
+ * the server once its shell has exited and all of its output was sent.
+ * Half-closing the connection hangs up all channels and ends with MSG_EXIT.
+ *
+ * Joiner and server talk over a SOCK_SEQPACKET pair: spawn requests one
+ * way, spawn results (each followed by the master fd) and exit reports back.
+ */
+
+#define MUX_IOBUF 16384
+#define MUX_INPUT_MAX (256 * 1024) /* unwritten input kept per channel */
+#define MUX_LINGER_MS 1000         /* joiner wait for sessions at the end */
+#define MUX_EV_CONN UINT32_MAX
+#define MUX_EV_CTL (UINT32_MAX - 1)
+#define MUX_RUNNING (-1)
+
+struct mux_spawn {
+  uint16_t ch, rows, cols;
+  char user[64];
+};
+
+#define MUX_SPAWNED 1
+#define MUX_EXITED 2
+
+struct mux_report {
+  int kind;
+  uint16_t ch;
+  pid_t pid;  /* session leader, or -errno when the spawn failed */
+  int status; /* MUX_EXITED: exit code of the shell */
+};
+
+struct mux_chan {
+  int used;
+  uint16_t ch;
+  int master; /* -1 while spawning and after hangup */
+  pid_t pid;  /* 0 while spawning */
+  int hungup, exited, code;
+  char *in; /* input the master could not take yet */
+  size_t in_len;
+  struct ds_recorder *rec;
+};
+
+/* Joiner: open one shell session and hand its master to the server */
+static void mux_spawn_shell(struct ds_config *cfg, int ctl, int sfd,
+                            const struct mux_spawn *req, int *live) {
+  struct mux_report rep = {MUX_SPAWNED, req->ch, 0, 0};
+  struct ds_tty_info tty;
+  if (ds_terminal_create(&tty) < 0) {
+    rep.pid = -(errno ? errno : EIO);
+    send(ctl, &rep, sizeof(rep), MSG_NOSIGNAL);
+    return;
+  }
+  struct winsize ws = {req->rows, req->cols, 0, 0};
+  ioctl(tty.master, TIOCSWINSZ, &ws);
+
+  pid_t child = fork();
+  if (child == 0) {
+    close(ctl);
+    close(sfd);
+    close(tty.master);
+    sigset_t none;
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, NULL);
+    signal(SIGPIPE, SIG_DFL);
+
+    /* Same hardening and session layout as enter_rootfs */
+    ds_log_silent = 1;
+    ds_seccomp_apply(cfg->privileged_mask,
+                     cfg->block_nested_ns &&
+                         !(cfg->privileged_mask & DS_PRIV_NOSEC));
+    ds_apply_capability_hardening(cfg->hw_access, cfg->privileged_mask);
+    ds_log_silent = 0;
+    if (setsid() < 0 || ioctl(tty.slave, TIOCSCTTY, 0) < 0)
+      _exit(EXIT_FAILURE);
+    signal(SIGHUP, SIG_IGN);
+    run_login_session(cfg, req->user, &tty);
+  }
+
+  rep.pid = child < 0 ? -errno : child;
+  close(tty.slave);
+  if (send(ctl, &rep, sizeof(rep), MSG_NOSIGNAL) == (ssize_t)sizeof(rep) &&
+      child > 0)
+    ds_send_fd(ctl, tty.master);
+  close(tty.master);
+  if (child > 0)
+    (*live)++;
+}
+
+static void mux_joiner(struct ds_config *cfg, struct ds_entry_desc *entry,
+                       pid_t pid, int ctl) __attribute__((noreturn));
+static void mux_joiner(struct ds_config *cfg, struct ds_entry_desc *entry,
+                       pid_t pid, int ctl) {
+  if (join_container(cfg, entry, pid) < 0)
+    _exit(EXIT_FAILURE);
+
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGCHLD);
+  sigprocmask(SIG_BLOCK, &mask, NULL);
+  int sfd = signalfd(-1, &mask, SFD_CLOEXEC);
+  if (sfd < 0)
+    _exit(EXIT_FAILURE);
+
+  /* Runs until the server closes ctl, then gives the sessions it hung up
+   * a moment to exit so their cgroup leaf can be removed */
+  struct pollfd pfd[2] = {{.fd = ctl, .events = POLLIN},
+                          {.fd = sfd, .events = POLLIN}};
+  int live = 0;
+  while (pfd[0].fd >= 0 || live > 0) {
+    int n = poll(pfd, 2, pfd[0].fd >= 0 ? -1 : MUX_LINGER_MS);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+
+    if (pfd[1].revents & POLLIN) {
+      struct signalfd_siginfo si;
+      if (read(sfd, &si, sizeof(si)) < 0 && errno != EAGAIN)
+        break;
+      int st;
+      pid_t p;
+      while ((p = waitpid(-1, &st, WNOHANG)) > 0) {
+        live--;
+        struct mux_report rep = {MUX_EXITED, 0, p,
+                                 WIFSIGNALED(st) ? 128 + WTERMSIG(st)
+                                                 : WEXITSTATUS(st)};
+        if (pfd[0].fd >= 0)
+          send(ctl, &rep, sizeof(rep), MSG_NOSIGNAL);
+      }
+    }
+
+    if (pfd[0].fd >= 0 && pfd[0].revents) {
+      struct mux_spawn req;
+      ssize_t r = recv(ctl, &req, sizeof(req), 0);
+      if (r == (ssize_t)sizeof(req)) {
+        req.user[sizeof(req.user) - 1] = '\0';
+        mux_spawn_shell(cfg, ctl, sfd, &req, &live);
+      } else if (r == 0 || (r < 0 && errno != EINTR)) {
+        pfd[0].fd = -1;
+      }
+    }
+  }
+  _exit(EXIT_SUCCESS);
+}
+
+static int mux_send_status(int conn, uint8_t type, uint16_t ch, int32_t v) {
+  uint8_t p[6];
+  uint16_t nch = htons(ch);
+  uint32_t nv = htonl((uint32_t)v);
+  memcpy(p, &nch, 2);
+  memcpy(p + 2, &nv, 4);
+  return ds_send_frame(conn, type, p, sizeof(p));
+}
+
+static struct mux_chan *mux_find(struct mux_chan *t, uint16_t ch) {
+  for (int i = 0; i < DS_MUX_MAX_CHANNELS; i++)
+    if (t[i].used && t[i].ch == ch)
+      return &t[i];
+  return NULL;
+}
+
+static void mux_arm(int epfd, struct mux_chan *t, struct mux_chan *c) {
+  struct epoll_event ev = {.events = EPOLLIN | (c->in_len ? EPOLLOUT : 0),
+                           .data.u32 = (uint32_t)(c - t)};
+  epoll_ctl(epfd, EPOLL_CTL_MOD, c->master, &ev);
+}
+
+/* Forward a master's output; returns -1 once the slave side is gone (EIO)
+ * or the client connection failed.  Normally one buffer per wakeup: epoll
+ * is level-triggered, so a tab flooding output (`yes`) comes straight back
+ * without starving the other tabs or the client's input (Ctrl-C).  drain
+ * empties the master, for the tail of an exited shell. */
+static int mux_pump_output(int conn, struct mux_chan *c, uint8_t *buf,
+                           int drain) {
+  uint16_t nch = htons(c->ch);
+  memcpy(buf, &nch, 2);
+  for (;;) {
+    ssize_t n = read(c->master, buf + 2, MUX_IOBUF);
+    if (n > 0) {
+      ds_record_output(c->rec, buf + 2, (size_t)n);
+      if (ds_send_frame(conn, DS_MUX_DATA, buf, (uint32_t)n + 2) < 0)
+        return -1;
+      if (!drain)
+        return 0;
+      continue;
+    }
+    if (n < 0 && errno == EINTR)
+      continue;
+    return (n < 0 && errno == EAGAIN) ? 0 : -1;
+  }
+}
+
+/* Queue-then-write keeps one tab whose program stops reading its input from
+ * stalling the others */
+static void mux_write_input(int epfd, struct mux_chan *t, struct mux_chan *c,
+                            const uint8_t *data, size_t len) {
+  if (!c->in_len) {
+    while (len) {
+      ssize_t w = write(c->master, data, len);
+      if (w < 0 && errno == EINTR)
+        continue;
+      if (w <= 0)
+        break;
+      data += w;
+      len -= (size_t)w;
+    }
+  }
+  if (!len)
+    return;
+  if (c->in_len + len > MUX_INPUT_MAX) {
+    ds_warn("[MUX] Channel %u is not reading its input, dropped %zu bytes",
+            c->ch, len);
+    return;
+  }
+  char *in = realloc(c->in, c->in_len + len);
+  if (!in)
+    return;
+  memcpy(in + c->in_len, data, len);
+  c->in = in;
+  c->in_len += len;
+  mux_arm(epfd, t, c);
+}
+
+static void mux_flush_input(int epfd, struct mux_chan *t, struct mux_chan *c) {
+  size_t off = 0;
+  while (off < c->in_len) {
+    ssize_t w = write(c->master, c->in + off, c->in_len - off);
+    if (w < 0 && errno == EINTR)
+      continue;
+    if (w <= 0)
+      break;
+    off += (size_t)w;
+  }
+  memmove(c->in, c->in + off, c->in_len - off);
+  c->in_len -= off;
+  if (!c->in_len)
+    mux_arm(epfd, t, c);
+}
+
+static void mux_hangup(int epfd, struct mux_chan *c) {
+  c->hungup = 1;
+  if (c->master >= 0) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, c->master, NULL);
+    close(c->master);
+    c->master = -1;
+  }
+  free(c->in);
+  c->in = NULL;
+  c->in_len = 0;
+  ds_record_close(c->rec);
+  c->rec = NULL;
+}
+
+/* A channel is done once its shell exited and its master is drained */
+static void mux_finish(int conn, struct mux_chan *c) {
+  if (!c->exited || c->master >= 0)
+    return;
+  mux_send_status(conn, DS_MUX_CLOSE, c->ch, c->code);
+  memset(c, 0, sizeof(*c));
+  c->master = -1;
+}
+
+static void mux_open(int conn, int ctl, struct mux_chan *t, uint16_t ch,
+                     const uint8_t *p, size_t len) {
+  struct mux_spawn req;
+  memset(&req, 0, sizeof(req));
+  req.ch = ch;
+  int err = 0;
+  if (len < 4) {
+    err = EINVAL;
+  } else {
+    uint16_t ws[2];
+    memcpy(ws, p, 4);
+    req.rows = ntohs(ws[0]) ? ntohs(ws[0]) : 24;
+    req.cols = ntohs(ws[1]) ? ntohs(ws[1]) : 80;
+    size_t ulen = len - 4;
+    if (ulen >= sizeof(req.user))
+      err = ENAMETOOLONG;
+    else if (memchr(p + 4, '\0', ulen) || memchr(p + 4, '/', ulen))
+      err = EINVAL;
+    else if (ulen)
+      memcpy(req.user, p + 4, ulen);
+    else
+      strcpy(req.user, "root");
+  }
+
+  struct mux_chan *c = NULL;
+  if (!err && mux_find(t, ch))
+    err = EEXIST;
+  for (int i = 0; !err && !c && i < DS_MUX_MAX_CHANNELS; i++)
+    if (!t[i].used)
+      c = &t[i];
+  if (!err && !c)
+    err = EMFILE;
+  if (!err && send(ctl, &req, sizeof(req), MSG_NOSIGNAL) < 0)
+    err = errno;
+  if (err) {
+    mux_send_status(conn, DS_MUX_OPEN, ch, -err);
+    return;
+  }
+  memset(c, 0, sizeof(*c));
+  c->used = 1;
+  c->ch = ch;
+  c->master = -1;
+}
+
+/* One frame from the client; -1 ends the session */
+static int mux_client_frame(int conn, int ctl, int epfd, struct mux_chan *t,
+                            uint8_t *buf) {
+  uint8_t type;
+  uint32_t len;
+  if (ds_recv_frame_hdr(conn, &type, &len) < 0)
+    return -1;
+  if (len > MUX_IOBUF + 2) {
+    ds_error("[MUX] Oversized frame (%u bytes), closing", len);
+    return -1;
+  }
+  if (len && ds_read_exact(conn, buf, len) < 0)
+    return -1;
+  if (len < 2)
+    return 0;
+
+  uint16_t nch;
+  memcpy(&nch, buf, 2);
+  uint16_t ch = ntohs(nch);
+  struct mux_chan *c = mux_find(t, ch);
+
+  switch (type) {
+  case DS_MUX_OPEN:
+    mux_open(conn, ctl, t, ch, buf + 2, len - 2);
+    break;
+  case DS_MUX_DATA:
+    if (c && c->master >= 0)
+      mux_write_input(epfd, t, c, buf + 2, len - 2);
+    break;
+  case DS_MUX_WINCH:
+    if (c && c->master >= 0 && len >= 6) {
+      uint16_t ws[2];
+      memcpy(ws, buf + 2, 4);
+      struct winsize w = {ntohs(ws[0]), ntohs(ws[1]), 0, 0};
+      ioctl(c->master, TIOCSWINSZ, &w);
+      ds_record_resize(c->rec, w.ws_col, w.ws_row);
+    }
+    break;
+  case DS_MUX_CLOSE:
+    if (c)
+      mux_hangup(epfd, c);
+    break;
+  default:
+    break;
+  }
+  return 0;
+}
+
+/* One report from the joiner; -1 if it is gone */
+static int mux_joiner_report(struct ds_config *cfg, int conn, int ctl,
+                             int epfd, struct mux_chan *t, uint8_t *buf) {
+  struct mux_report rep;
+  ssize_t r = recv(ctl, &rep, sizeof(rep), 0);
+  if (r < 0 && errno == EINTR)
+    return 0;
+  if (r != (ssize_t)sizeof(rep))
+    return -1;
+
+  if (rep.kind == MUX_SPAWNED) {
+    struct mux_chan *c = NULL;
+    for (int i = 0; !c && i < DS_MUX_MAX_CHANNELS; i++)
+      if (t[i].used && !t[i].pid && t[i].ch == rep.ch)
+        c = &t[i];
+    int fd = rep.pid > 0 ? ds_recv_fd(ctl) : -1;
+    if (!c) {
+      if (fd >= 0)
+        close(fd);
+      return 0;
+    }
+    if (rep.pid <= 0 || fd < 0) {
+      mux_send_status(conn, DS_MUX_OPEN, rep.ch, rep.pid < 0 ? rep.pid : -EIO);
+      if (fd >= 0)
+        close(fd);
+      /* a session that did start hangs up; its exit report is ignored */
+      memset(c, 0, sizeof(*c));
+      c->master = -1;
+      return 0;
+    }
+    c->pid = rep.pid;
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    struct epoll_event ev = {.events = EPOLLIN,
+                             .data.u32 = (uint32_t)(c - t)};
+    if (c->hungup || epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+      close(fd); /* closed by the client before the shell was up */
+    } else {
+      c->master = fd;
+      if (cfg->record_sessions) {
+        char kind[16]; /* one file per tab: names are per process */
+        snprintf(kind, sizeof(kind), "tab%u", c->ch);
+        c->rec = ds_record_open(cfg->container_name, kind, fd);
+      }
+    }
+    mux_send_status(conn, DS_MUX_OPEN, rep.ch, rep.pid);
+  } else if (rep.kind == MUX_EXITED) {
+    for (int i = 0; i < DS_MUX_MAX_CHANNELS; i++) {
+      struct mux_chan *c = &t[i];
+      if (!c->used || c->pid != rep.pid)
+        continue;
+      /* output still in the pty belongs before the CLOSE */
+      if (c->master >= 0)
+        mux_pump_output(conn, c, buf, 1);
+      mux_hangup(epfd, c);
+      c->exited = 1;
+      c->code = rep.status;
+      mux_finish(conn, c);
+      break;
+    }
+  }
+  return 0;
+}
+
+int mux_rootfs(struct ds_config *cfg, int conn) {
+  struct ds_entry_desc entry;
+  pid_t pid;
+  if (prepare_entry(cfg, &entry, &pid) < 0) {
+    ds_send_exit(conn, 1);
+    return -1;
+  }
+
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) < 0) {
+    ds_entry_release(&entry);
+    free_config_env_vars(cfg);
+    ds_send_exit(conn, 1);
+    return -1;
+  }
+
+  pid_t joiner = fork();
+  if (joiner < 0) {
+    close(sv[0]);
+    close(sv[1]);
+    ds_entry_release(&entry);
+    free_config_env_vars(cfg);
+    ds_send_exit(conn, 1);
+    return -1;
+  }
+  if (joiner == 0) {
+    close(sv[0]);
+    close(conn);
+    mux_joiner(cfg, &entry, pid, sv[1]);
+  }
+  close(sv[1]);
+  int ctl = sv[0];
+
+  ds_log("Serving terminal channels for container '%s'...",
+         cfg->container_name);
+
+  struct mux_chan t[DS_MUX_MAX_CHANNELS];
+  memset(t, 0, sizeof(t));
+  for (int i = 0; i < DS_MUX_MAX_CHANNELS; i++)
+    t[i].master = -1;
+  static uint8_t buf[MUX_IOBUF + 2];
+
+  int code = 1;
+  int epfd = epoll_create1(EPOLL_CLOEXEC);
+  struct epoll_event ev = {.events = EPOLLIN, .data.u32 = MUX_EV_CONN};
+  if (epfd >= 0 && epoll_ctl(epfd, EPOLL_CTL_ADD, conn, &ev) == 0) {
+    ev.data.u32 = MUX_EV_CTL;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, ctl, &ev) == 0)
+      code = MUX_RUNNING;
+  }
+
+  while (code == MUX_RUNNING) {
+    struct epoll_event evs[16];
+    int n = epoll_wait(epfd, evs, 16, -1);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      code = 1;
+      break;
+    }
+    for (int i = 0; i < n && code == MUX_RUNNING; i++) {
+      uint32_t id = evs[i].data.u32;
+      if (id == MUX_EV_CONN) {
+        if (mux_client_frame(conn, ctl, epfd, t, buf) < 0)
+          code = 0;
+      } else if (id == MUX_EV_CTL) {
+        if (mux_joiner_report(cfg, conn, ctl, epfd, t, buf) < 0) {
+          ds_error("[MUX] Lost the container session process");
+          code = 1;
+        }
+      } else if (id < DS_MUX_MAX_CHANNELS && t[id].master >= 0) {
+        struct mux_chan *c = &t[id];
+        if ((evs[i].events & EPOLLOUT) && c->in_len)
+          mux_flush_input(epfd, t, c);
+        if (evs[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+          if (mux_pump_output(conn, c, buf, 0) < 0) {
+            mux_hangup(epfd, c);
+            mux_finish(conn, c);
+          }
+        }
+      }
+    }
+  }
+
+  /* Hang up what is left; the joiner sees ctl close and winds down */
+  for (int i = 0; i < DS_MUX_MAX_CHANNELS; i++)
+    if (t[i].used)
+      mux_hangup(epfd, &t[i]);
+  if (epfd >= 0)
+    close(epfd);
+  close(ctl);
+  while (waitpid(joiner, NULL, 0) < 0 && errno == EINTR)
+    ;
+  finish_entry(&entry, joiner);
+  free_config_env_vars(cfg);
+  ds_send_exit(conn, code);
+  return code ? -1 : 0;
+}
+
 /* ---------------------------------------------------------------------------
  * Other operations
  * ---------------------------------------------------------------------------*/
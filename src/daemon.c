@@ -25,6 +25,7 @@
 #include <arpa/inet.h>
 #include <poll.h>
 #include <stddef.h>
+#include <sys/inotify.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <sys/wait.h>
@@ -37,6 +38,7 @@
 #define DS_MAX_ARG 8192
 #define DS_IOBUF 8192
 #define DS_POLL_MS 100
+#define DS_REQ_TIMEOUT_S 10 /* a client that stalls mid-frame is dropped */
 
 #define MSG_OUT ((uint8_t)0x01)
 #define MSG_ERR ((uint8_t)0x02)
@@ -44,6 +46,10 @@
 #define MSG_EXIT ((uint8_t)0xFF)
 
 #define REQ_FLAG_PTY (1u << 0)
+#define REQ_FLAG_STDIN (1u << 1) /* pipe mode: client streams stdin as MSG_OUT,
+                                    a zero-length frame is eof */
+#define REQ_FLAG_MUX (1u << 2)   /* `mux`: channel frames, see serve_mux */
+#define DS_MUX_FD 3
 #define EXIT_PENDING (-1)
 
 static FILE *g_daemon_log_fp = NULL;
@@ -101,7 +107,7 @@ static volatile sig_atomic_t g_sigusr2_received = 0;
 
 /* wire protocol helpers */
 
-static int read_exact(int fd, void *buf, size_t n) {
+int ds_read_exact(int fd, void *buf, size_t n) {
   uint8_t *p = (uint8_t *)buf;
   while (n) {
     ssize_t r = read(fd, p, n);
@@ -113,7 +119,7 @@ static int read_exact(int fd, void *buf, size_t n) {
   return 0;
 }
 
-static int send_frame(int fd, uint8_t type, const void *data, uint32_t len) {
+int ds_send_frame(int fd, uint8_t type, const void *data, uint32_t len) {
   uint8_t hdr[5];
   uint32_t nl = htonl(len);
   hdr[0] = type;
@@ -125,9 +131,9 @@ static int send_frame(int fd, uint8_t type, const void *data, uint32_t len) {
   return 0;
 }
 
-static int recv_frame_hdr(int fd, uint8_t *type_out, uint32_t *len_out) {
+int ds_recv_frame_hdr(int fd, uint8_t *type_out, uint32_t *len_out) {
   uint8_t hdr[5];
-  if (read_exact(fd, hdr, 5) < 0)
+  if (ds_read_exact(fd, hdr, 5) < 0)
     return -1;
   *type_out = hdr[0];
   uint32_t nl;
@@ -136,18 +142,33 @@ static int recv_frame_hdr(int fd, uint8_t *type_out, uint32_t *len_out) {
   return 0;
 }
 
-static void send_exit(int fd, int code) {
+void ds_send_exit(int fd, int code) {
   uint32_t nc = htonl((uint32_t)code);
-  send_frame(fd, MSG_EXIT, &nc, 4);
+  ds_send_frame(fd, MSG_EXIT, &nc, 4);
 }
 
 /* abstract socket setup */
 
+/*
+ * DS_DAEMON_SOCK moves the daemon and its clients to another abstract name,
+ * so `make daemonbench` can run a private daemon beside the real one. Read
+ * once; daemonize() clears the environment but puts a private name back,
+ * so every reexec() (including after a binary swap) keeps it.
+ */
+static const char *sock_name(void) {
+  static char name[64];
+  if (!name[0]) {
+    const char *env = getenv("DS_DAEMON_SOCK");
+    safe_strncpy(name, (env && env[0]) ? env : DS_SOCK_NAME, sizeof(name));
+  }
+  return name;
+}
+
 static socklen_t make_addr(struct sockaddr_un *addr) {
   memset(addr, 0, sizeof(*addr));
   addr->sun_family = AF_UNIX;
-  size_t nlen = strlen(DS_SOCK_NAME);
-  memcpy(addr->sun_path + 1, DS_SOCK_NAME, nlen);
+  size_t nlen = strlen(sock_name());
+  memcpy(addr->sun_path + 1, sock_name(), nlen);
   return (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + nlen);
 }
 
@@ -172,7 +193,7 @@ static void free_req(ds_req_t *r) {
 static int recv_req(int fd, ds_req_t *r) {
   memset(r, 0, sizeof(*r));
   uint32_t nf, na;
-  if (read_exact(fd, &nf, 4) < 0 || read_exact(fd, &na, 4) < 0)
+  if (ds_read_exact(fd, &nf, 4) < 0 || ds_read_exact(fd, &na, 4) < 0)
     return -1;
   r->flags = ntohl(nf);
   uint32_t argc = ntohl(na);
@@ -181,7 +202,7 @@ static int recv_req(int fd, ds_req_t *r) {
 
   for (uint32_t i = 0; i < argc; i++) {
     uint32_t nl;
-    if (read_exact(fd, &nl, 4) < 0)
+    if (ds_read_exact(fd, &nl, 4) < 0)
       return -1;
     uint32_t al = ntohl(nl);
     if (al > DS_MAX_ARG)
@@ -189,7 +210,7 @@ static int recv_req(int fd, ds_req_t *r) {
     r->argv[i] = (char *)malloc((size_t)al + 1);
     if (!r->argv[i])
       return -1;
-    if (al && read_exact(fd, r->argv[i], al) < 0)
+    if (al && ds_read_exact(fd, r->argv[i], al) < 0)
       return -1;
     r->argv[i][al] = '\0';
     r->argc++; /* safely increment once we actually have the string */
@@ -198,7 +219,7 @@ static int recv_req(int fd, ds_req_t *r) {
 
   if (r->flags & REQ_FLAG_PTY) {
     uint16_t ws[2];
-    if (read_exact(fd, ws, 4) < 0)
+    if (ds_read_exact(fd, ws, 4) < 0)
       return -1;
     r->rows = ntohs(ws[0]);
     r->cols = ntohs(ws[1]);
@@ -235,7 +256,7 @@ static char **make_exec_argv(ds_req_t *r) {
   return av;
 }
 
-static void drain_fd(int fd, int conn, uint8_t type) {
+static void drain_fd(int fd, int conn, uint8_t type, struct ds_recorder *rec) {
   char buf[DS_IOBUF];
   int fl = fcntl(fd, F_GETFL);
   fcntl(fd, F_SETFL, fl | O_NONBLOCK);
@@ -243,23 +264,28 @@ static void drain_fd(int fd, int conn, uint8_t type) {
     ssize_t n = read(fd, buf, sizeof(buf));
     if (n <= 0)
       break;
-    send_frame(conn, type, buf, (uint32_t)n);
+    ds_record_output(rec, buf, (size_t)n);
+    ds_send_frame(conn, type, buf, (uint32_t)n);
   }
   fcntl(fd, F_SETFL, fl);
 }
 
-/* unified session handler for both pty and pipe modes */
+/* unified session handler for both pty and pipe modes. rec_name/rec_kind
+ * are set when this pty session should be recorded (see session_record) */
 
-static void handle_session(int conn, ds_req_t *r) {
+static void handle_session(int conn, ds_req_t *r, const char *rec_name,
+                           const char *rec_kind) {
   int is_pty = (r->flags & REQ_FLAG_PTY);
+  int feed_stdin = !is_pty && (r->flags & REQ_FLAG_STDIN);
   int master = -1, slave = -1;
-  int out[2] = {-1, -1}, err[2] = {-1, -1};
+  int out[2] = {-1, -1}, err[2] = {-1, -1}, in[2] = {-1, -1};
+  struct ds_recorder *rec = NULL;
   char buf[DS_IOBUF];
 
   if (is_pty) {
     if (openpty(&master, &slave, NULL, NULL, NULL) < 0) {
-      send_frame(conn, MSG_ERR, "daemon: openpty failed\n", 23);
-      send_exit(conn, 1);
+      ds_send_frame(conn, MSG_ERR, "daemon: openpty failed\n", 23);
+      ds_send_exit(conn, 1);
       return;
     }
     struct winsize ws = {r->rows, r->cols, 0, 0};
@@ -279,8 +305,8 @@ static void handle_session(int conn, ds_req_t *r) {
      * ends are a separate file description and remain blocking.
      */
     if (pipe2(out, O_CLOEXEC) < 0 || pipe2(err, O_CLOEXEC) < 0) {
-      send_frame(conn, MSG_ERR, "daemon: pipe2 failed\n", 21);
-      send_exit(conn, 1);
+      ds_send_frame(conn, MSG_ERR, "daemon: pipe2 failed\n", 21);
+      ds_send_exit(conn, 1);
       if (out[0] >= 0) {
         close(out[0]);
         close(out[1]);
@@ -291,6 +317,15 @@ static void handle_session(int conn, ds_req_t *r) {
       }
       return;
     }
+    if (feed_stdin && pipe2(in, O_CLOEXEC) < 0) {
+      ds_send_frame(conn, MSG_ERR, "daemon: pipe2 failed\n", 21);
+      ds_send_exit(conn, 1);
+      close(out[0]);
+      close(out[1]);
+      close(err[0]);
+      close(err[1]);
+      return;
+    }
   }
 
   char **av = make_exec_argv(r);
@@ -303,8 +338,12 @@ static void handle_session(int conn, ds_req_t *r) {
       close(out[1]);
       close(err[0]);
       close(err[1]);
+      if (in[0] >= 0) {
+        close(in[0]);
+        close(in[1]);
+      }
     }
-    send_exit(conn, 1);
+    ds_send_exit(conn, 1);
     return;
   }
 
@@ -319,9 +358,13 @@ static void handle_session(int conn, ds_req_t *r) {
       close(out[1]);
       close(err[0]);
       close(err[1]);
+      if (in[0] >= 0) {
+        close(in[0]);
+        close(in[1]);
+      }
     }
-    send_frame(conn, MSG_ERR, "daemon: fork failed\n", 20);
-    send_exit(conn, 1);
+    ds_send_frame(conn, MSG_ERR, "daemon: fork failed\n", 20);
+    ds_send_exit(conn, 1);
     return;
   }
 
@@ -339,11 +382,17 @@ static void handle_session(int conn, ds_req_t *r) {
     } else {
       close(out[0]);
       close(err[0]);
-      int dn = open("/dev/null", O_RDWR);
-      if (dn >= 0) {
-        dup2(dn, STDIN_FILENO);
-        if (dn > STDERR_FILENO)
-          close(dn);
+      if (feed_stdin) {
+        close(in[1]);
+        dup2(in[0], STDIN_FILENO);
+        close(in[0]);
+      } else {
+        int dn = open("/dev/null", O_RDWR);
+        if (dn >= 0) {
+          dup2(dn, STDIN_FILENO);
+          if (dn > STDERR_FILENO)
+            close(dn);
+        }
       }
       dup2(out[1], STDOUT_FILENO);
       dup2(err[1], STDERR_FILENO);
@@ -352,11 +401,19 @@ static void handle_session(int conn, ds_req_t *r) {
     }
     /* Prevent the spawned child from proxying back to the daemon */
     setenv("DS_NO_PROXY", "1", 1);
+    /* ...and from recording the session a second time */
+    if (is_pty && rec_name)
+      setenv("DS_SESSION_RECORDED", "1", 1);
     reexec(av);
   }
 
   free(av);
 
+  /* the child's output waits in the pty until the loop below reads it, so
+   * nothing is missed by opening the recording only now */
+  if (is_pty && rec_name)
+    rec = ds_record_open(rec_name, rec_kind, master);
+
   int epfd = epoll_create1(EPOLL_CLOEXEC);
   if (epfd < 0) {
     if (is_pty) {
@@ -370,7 +427,8 @@ static void handle_session(int conn, ds_req_t *r) {
     }
     kill(child, SIGTERM);
     waitpid(child, NULL, 0);
-    send_exit(conn, 1);
+    ds_record_close(rec);
+    ds_send_exit(conn, 1);
     return;
   }
 
@@ -389,6 +447,10 @@ static void handle_session(int conn, ds_req_t *r) {
     close(out[1]);
     close(err[1]);
     out[1] = err[1] = -1;
+    if (in[0] >= 0) {
+      close(in[0]);
+      in[0] = -1;
+    }
     /* Read ends are now exclusively owned by the parent.  Set O_NONBLOCK
      * here so epoll's edge reads can drain without blocking. */
     fcntl(out[0], F_SETFL, O_NONBLOCK);
@@ -404,7 +466,7 @@ static void handle_session(int conn, ds_req_t *r) {
 
   /* watch the connection for dead clients or pty input */
   ev.events = EPOLLHUP | EPOLLERR;
-  if (is_pty)
+  if (is_pty || feed_stdin)
     ev.events |= EPOLLIN;
   ev.data.fd = conn;
   epoll_ctl(epfd, EPOLL_CTL_ADD, conn, &ev);
@@ -427,31 +489,51 @@ static void handle_session(int conn, ds_req_t *r) {
           waitpid(child, NULL, 0);
           goto session_end;
         }
-        if (is_pty && (events[i].events & EPOLLIN)) {
+        if ((is_pty || feed_stdin) && (events[i].events & EPOLLIN)) {
           uint8_t type;
           uint32_t mlen;
-          if (recv_frame_hdr(conn, &type, &mlen) < 0) {
+          if (ds_recv_frame_hdr(conn, &type, &mlen) < 0) {
             kill(child, SIGHUP);
             waitpid(child, NULL, 0);
             goto session_end;
           }
-          if (type == MSG_OUT && mlen > 0 && mlen <= (uint32_t)sizeof(buf)) {
-            if (read_exact(conn, buf, mlen) == 0)
+          if (is_pty && type == MSG_OUT && mlen > 0 &&
+              mlen <= (uint32_t)sizeof(buf)) {
+            if (ds_read_exact(conn, buf, mlen) == 0)
               write_all(master, buf, mlen);
-          } else if (type == MSG_WINCH && mlen == 4) {
+          } else if (is_pty && type == MSG_WINCH && mlen == 4) {
             uint16_t wd[2];
-            if (read_exact(conn, wd, 4) == 0) {
+            if (ds_read_exact(conn, wd, 4) == 0) {
               struct winsize nws = {ntohs(wd[0]), ntohs(wd[1]), 0, 0};
               ioctl(master, TIOCSWINSZ, &nws);
+              ds_record_resize(rec, nws.ws_col, nws.ws_row);
               kill(-child, SIGWINCH); /* signal the whole process group */
             }
+          } else if (feed_stdin && type == MSG_OUT) {
+            /* stdin for the child; zero length means the client hit eof */
+            if (mlen == 0 && in[1] >= 0) {
+              close(in[1]);
+              in[1] = -1;
+            }
+            uint32_t rem = mlen;
+            while (rem) {
+              uint32_t c =
+                  (rem < (uint32_t)sizeof(buf)) ? rem : (uint32_t)sizeof(buf);
+              if (ds_read_exact(conn, buf, c) < 0)
+                goto session_end;
+              if (in[1] >= 0 && write_all(in[1], buf, c) < 0) {
+                close(in[1]);
+                in[1] = -1;
+              }
+              rem -= c;
+            }
           } else {
             /* drain unknown frames so we don't stall the pipe */
             uint32_t rem = mlen;
             while (rem) {
               uint32_t c =
                   (rem < (uint32_t)sizeof(buf)) ? rem : (uint32_t)sizeof(buf);
-              if (read_exact(conn, buf, c) < 0)
+              if (ds_read_exact(conn, buf, c) < 0)
                 goto session_end;
               rem -= c;
             }
@@ -465,7 +547,9 @@ static void handle_session(int conn, ds_req_t *r) {
             ssize_t n = read(fd, buf, sizeof(buf));
             if (n > 0) {
               uint8_t t = (fd == err[0]) ? MSG_ERR : MSG_OUT;
-              if (send_frame(conn, t, buf, (uint32_t)n) < 0) {
+              if (fd == master)
+                ds_record_output(rec, buf, (size_t)n);
+              if (ds_send_frame(conn, t, buf, (uint32_t)n) < 0) {
                 kill(child, is_pty ? SIGHUP : SIGTERM);
                 waitpid(child, NULL, 0);
                 goto session_end;
@@ -515,13 +599,13 @@ static void handle_session(int conn, ds_req_t *r) {
      * might still be holding it */
     if (child_done == 1) {
       if (out[0] >= 0)
-        drain_fd(out[0], conn, MSG_OUT);
+        drain_fd(out[0], conn, MSG_OUT, NULL);
       if (err[0] >= 0)
-        drain_fd(err[0], conn, MSG_ERR);
+        drain_fd(err[0], conn, MSG_ERR, NULL);
       break;
     } else if (child_done == 2) {
       if (is_pty && master >= 0)
-        drain_fd(master, conn, MSG_OUT);
+        drain_fd(master, conn, MSG_OUT, rec);
       break;
     }
   }
@@ -533,23 +617,392 @@ static void handle_session(int conn, ds_req_t *r) {
   }
 
 session_end:
+  ds_record_close(rec);
   close(epfd);
+  if (in[1] >= 0)
+    close(in[1]);
   if (master >= 0)
     close(master);
   if (out[0] >= 0)
     close(out[0]);
   if (err[0] >= 0)
     close(err[0]);
-  send_exit(conn, exit_code == EXIT_PENDING ? 0 : exit_code);
+  ds_send_exit(conn, exit_code == EXIT_PENDING ? 0 : exit_code);
+}
+
+/* config cache
+ *
+ * the app's settings screens call `config get --json` a lot. the accept loop
+ * keeps every container's rendered json in memory and refreshes an entry
+ * only when inotify reports its container.config changed (saves are
+ * tmp+rename, so IN_MOVED_TO; editors give IN_CLOSE_WRITE). connection
+ * handlers are forked after pending events are drained, so each one
+ * inherits an up-to-date snapshot and answers without parsing anything.
+ * only "valid" is left out of the snapshot: it depends on the rootfs or
+ * image still existing, which no config event reports, so it is checked
+ * when the answer is sent.
+ */
+
+struct cfg_cache_ent {
+  char name[256];
+  int wd;     /* watch on Containers/<name>, -1 if none */
+  char *json; /* rendered config minus its "valid" member; NULL when the
+               * config is missing or unreadable */
+  size_t len;
+  char *rootfs; /* path "valid" depends on; NULL if invalid regardless */
+  int record;   /* record_sessions=1 */
+};
+
+static struct cfg_cache_ent *g_cfg_cache = NULL;
+static int g_cfg_cache_n = 0, g_cfg_cache_cap = 0;
+static int g_cfg_ifd = -1;
+static int g_cfg_root_wd = -1;
+
+#define CFG_DIR_EVENTS                                                         \
+  (IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | IN_DELETE_SELF)
+
+static void cfg_cache_refresh(struct cfg_cache_ent *e) {
+  free(e->json);
+  free(e->rootfs);
+  e->json = NULL;
+  e->rootfs = NULL;
+  e->len = 0;
+  e->record = 0;
+
+  struct ds_config *cfg = calloc(1, sizeof(*cfg));
+  if (!cfg)
+    return;
+  cfg->net_ready_pipe[0] = cfg->net_ready_pipe[1] = -1;
+  cfg->net_done_pipe[0] = cfg->net_done_pipe[1] = -1;
+
+  int prev = ds_log_silent;
+  ds_log_silent = 1;
+  if (ds_config_load_by_name(e->name, cfg) == 0) {
+    size_t len = 0;
+    char *json = ds_config_render_json(cfg, &len);
+    /* {"valid":<bool>,"config":{...}}: keep what follows the bool */
+    const char *rest = json ? strstr(json, ",\"config\":") : NULL;
+    if (rest) {
+      e->len = len - (size_t)(rest - json);
+      e->json = malloc(e->len);
+      if (e->json)
+        memcpy(e->json, rest, e->len);
+    }
+    free(json);
+    /* ds_config_validate() minus its existence checks */
+    const char *path =
+        cfg->rootfs_img_path[0] ? cfg->rootfs_img_path : cfg->rootfs_path;
+    if (cfg->container_name[0] && path[0] &&
+        !(cfg->rootfs_path[0] && cfg->rootfs_img_path[0]))
+      e->rootfs = strdup(path);
+    e->record = cfg->record_sessions;
+  }
+  ds_log_silent = prev;
+
+  free_config_unknown_lines(cfg);
+  free_config_env_vars(cfg);
+  free_config_binds(cfg);
+  free(cfg);
+}
+
+static struct cfg_cache_ent *cfg_cache_find(const char *name) {
+  for (int i = 0; i < g_cfg_cache_n; i++)
+    if (strcmp(g_cfg_cache[i].name, name) == 0)
+      return &g_cfg_cache[i];
+  return NULL;
+}
+
+static void cfg_cache_add(const char *name) {
+  if (name[0] == '.' || strlen(name) >= sizeof(g_cfg_cache[0].name))
+    return;
+  struct cfg_cache_ent *e = cfg_cache_find(name);
+  if (!e) {
+    if (g_cfg_cache_n >= DS_MAX_CONTAINERS)
+      return;
+    if (g_cfg_cache_n == g_cfg_cache_cap) {
+      int cap = g_cfg_cache_cap ? g_cfg_cache_cap * 2 : 16;
+      struct cfg_cache_ent *tmp =
+          realloc(g_cfg_cache, (size_t)cap * sizeof(*tmp));
+      if (!tmp)
+        return;
+      g_cfg_cache = tmp;
+      g_cfg_cache_cap = cap;
+    }
+    e = &g_cfg_cache[g_cfg_cache_n++];
+    memset(e, 0, sizeof(*e));
+    safe_strncpy(e->name, name, sizeof(e->name));
+
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s/Containers/%s", get_workspace_dir(), name);
+    e->wd = inotify_add_watch(g_cfg_ifd, dir, CFG_DIR_EVENTS | IN_ONLYDIR);
+  }
+  cfg_cache_refresh(e);
+}
+
+static void cfg_cache_remove(struct cfg_cache_ent *e) {
+  if (e->wd >= 0)
+    inotify_rm_watch(g_cfg_ifd, e->wd);
+  free(e->json);
+  free(e->rootfs);
+  *e = g_cfg_cache[--g_cfg_cache_n];
+}
+
+static void cfg_cache_init(void) {
+  char root[PATH_MAX];
+  snprintf(root, sizeof(root), "%s/Containers", get_workspace_dir());
+  mkdir_p(root, 0755);
+
+  g_cfg_ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (g_cfg_ifd < 0) {
+    ds_warn("daemon: inotify unavailable (%s), config cache disabled",
+            strerror(errno));
+    return;
+  }
+  g_cfg_root_wd = inotify_add_watch(
+      g_cfg_ifd, root,
+      IN_CREATE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | IN_ONLYDIR);
+  if (g_cfg_root_wd < 0) {
+    close(g_cfg_ifd);
+    g_cfg_ifd = -1;
+    return;
+  }
+
+  DIR *d = opendir(root);
+  if (!d)
+    return;
+  struct dirent *ent;
+  while ((ent = readdir(d)) != NULL) {
+    if (ent->d_type == DT_DIR || ent->d_type == DT_UNKNOWN)
+      cfg_cache_add(ent->d_name);
+  }
+  closedir(d);
+}
+
+/* drain pending inotify events; called before every fork of a handler */
+static void cfg_cache_process(void) {
+  if (g_cfg_ifd < 0)
+    return;
+
+  char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  for (;;) {
+    ssize_t n = read(g_cfg_ifd, buf, sizeof(buf));
+    if (n <= 0)
+      break;
+    for (char *p = buf; p < buf + n;) {
+      const struct inotify_event *ev = (const struct inotify_event *)p;
+      p += sizeof(*ev) + ev->len;
+
+      if (ev->mask & IN_Q_OVERFLOW) {
+        /* lost events: everything is suspect */
+        for (int i = 0; i < g_cfg_cache_n; i++)
+          cfg_cache_refresh(&g_cfg_cache[i]);
+        continue;
+      }
+
+      if (ev->wd == g_cfg_root_wd) {
+        if (!ev->len || !(ev->mask & IN_ISDIR))
+          continue;
+        if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+          cfg_cache_add(ev->name);
+        } else {
+          struct cfg_cache_ent *e = cfg_cache_find(ev->name);
+          if (e)
+            cfg_cache_remove(e);
+        }
+        continue;
+      }
+
+      for (int i = 0; i < g_cfg_cache_n; i++) {
+        struct cfg_cache_ent *e = &g_cfg_cache[i];
+        if (e->wd != ev->wd)
+          continue;
+        if (ev->mask & IN_IGNORED)
+          e->wd = -1;
+        else if (ev->len && strcmp(ev->name, "container.config") == 0)
+          cfg_cache_refresh(e);
+        break;
+      }
+    }
+  }
+}
+
+/*
+ * serve `[--name=N | -n N] config get --json` from the cache. anything with
+ * other options (--conf, --rootfs, overrides, a key) goes through the normal
+ * re-exec path so its output stays identical to the cli's.
+ */
+static int try_serve_config_get(int conn, ds_req_t *r) {
+  if (g_cfg_ifd < 0)
+    return 0;
+
+  const char *name = NULL;
+  int json = 0, pos = 0;
+  for (int i = 0; i < r->argc; i++) {
+    const char *a = r->argv[i];
+    if (strcmp(a, "--json") == 0)
+      json = 1;
+    else if (strncmp(a, "--name=", 7) == 0)
+      name = a + 7;
+    else if ((strcmp(a, "--name") == 0 || strcmp(a, "-n") == 0) &&
+             i + 1 < r->argc)
+      name = r->argv[++i];
+    else if (strncmp(a, "-n", 2) == 0 && a[2])
+      name = a + 2;
+    else if (a[0] == '-')
+      return 0;
+    else if (pos == 0 && strcmp(a, "config") == 0)
+      pos = 1;
+    else if (pos == 1 && strcmp(a, "get") == 0)
+      pos = 2;
+    else
+      return 0;
+  }
+  if (!json || pos != 2 || !name || !name[0])
+    return 0;
+
+  char safe_name[256];
+  sanitize_container_name(name, safe_name, sizeof(safe_name));
+  struct cfg_cache_ent *e = cfg_cache_find(safe_name);
+  if (!e || !e->json)
+    return 0; /* let the cli produce the proper error */
+
+  int valid = e->rootfs && access(e->rootfs, F_OK) == 0;
+  char head[16];
+  int hlen = snprintf(head, sizeof(head), "{\"valid\":%s",
+                      valid ? "true" : "false");
+  char *out = malloc((size_t)hlen + e->len);
+  if (!out)
+    return 0;
+  memcpy(out, head, (size_t)hlen);
+  memcpy(out + hlen, e->json, e->len);
+  ds_send_frame(conn, MSG_OUT, out, (uint32_t)((size_t)hlen + e->len));
+  free(out);
+  ds_send_exit(conn, 0);
+  return 1;
+}
+
+/*
+ * the target container is the --name/-n given before the command; *cmd gets
+ * the command word ("session" when there is none)
+ */
+static const char *req_target(ds_req_t *r, const char **cmd) {
+  const char *name = NULL;
+  *cmd = "session";
+  for (int i = 0; i < r->argc; i++) {
+    const char *a = r->argv[i];
+    if (strncmp(a, "--name=", 7) == 0)
+      name = a + 7;
+    else if ((strcmp(a, "--name") == 0 || strcmp(a, "-n") == 0) &&
+             i + 1 < r->argc)
+      name = r->argv[++i];
+    else if (strncmp(a, "-n", 2) == 0 && a[2])
+      name = a + 2;
+    else if (a[0] != '-') {
+      *cmd = a; /* options after the command belong to it (run) */
+      break;
+    }
+  }
+  return name;
+}
+
+/*
+ * pty sessions of containers with record_sessions=1 are recorded here, at
+ * the daemon, so the file has exactly what the client saw. *cmd labels the
+ * recording and goes into its filename, so it is one of a fixed set of
+ * kinds, never the client's word. the config comes from the cache when
+ * it's on.
+ */
+static const char *session_record(ds_req_t *r, const char **cmd) {
+  static const char *const kinds[] = {"enter", "run", "start", "restart",
+                                      NULL};
+  const char *word;
+  const char *name = req_target(r, &word);
+  if (!name || !name[0])
+    return NULL;
+
+  *cmd = "session";
+  for (int i = 0; kinds[i]; i++)
+    if (strcmp(word, kinds[i]) == 0)
+      *cmd = kinds[i];
+
+  static char safe_name[256];
+  sanitize_container_name(name, safe_name, sizeof(safe_name));
+  if (g_cfg_ifd >= 0) {
+    struct cfg_cache_ent *e = cfg_cache_find(safe_name);
+    return (e && e->record) ? safe_name : NULL;
+  }
+
+  struct ds_config *cfg = calloc(1, sizeof(*cfg));
+  if (!cfg)
+    return NULL;
+  cfg->net_ready_pipe[0] = cfg->net_ready_pipe[1] = -1;
+  cfg->net_done_pipe[0] = cfg->net_done_pipe[1] = -1;
+  int prev = ds_log_silent;
+  ds_log_silent = 1;
+  int record = ds_config_load_by_name(safe_name, cfg) == 0 &&
+               cfg->record_sessions;
+  ds_log_silent = prev;
+  free_config_unknown_lines(cfg);
+  free_config_env_vars(cfg);
+  free_config_binds(cfg);
+  free(cfg);
+  return record ? safe_name : NULL;
+}
+
+/*
+ * multiplexed sessions: one connection carries many pty channels (the app's
+ * terminal tabs). the connection becomes fd 3 of a `mux` process that joins
+ * the container once and then opens shells on request (mux_rootfs), so a new
+ * tab costs a pty and two forks instead of a connection, a re-exec and a
+ * full container entry. it speaks the DS_MUX_* frames and ends with MSG_EXIT.
+ */
+static void serve_mux(int conn, ds_req_t *r) {
+  const char *cmd;
+  req_target(r, &cmd);
+  char **av = make_exec_argv(r);
+  if (strcmp(cmd, "mux") != 0 || (r->flags & REQ_FLAG_PTY) || !av) {
+    ds_send_frame(conn, MSG_ERR, "daemon: bad mux request\n", 24);
+    ds_send_exit(conn, 1);
+    _exit(1);
+  }
+
+  if (conn != DS_MUX_FD) {
+    if (dup2(conn, DS_MUX_FD) < 0)
+      _exit(1);
+    close(conn);
+  }
+  fcntl(DS_MUX_FD, F_SETFD, 0);
+  int dn = open("/dev/null", O_RDONLY);
+  if (dn >= 0) {
+    dup2(dn, STDIN_FILENO);
+    if (dn > STDERR_FILENO)
+      close(dn);
+  }
+  setenv("DS_NO_PROXY", "1", 1);
+  setenv("DS_MUX_FD", "3", 1);
+  reexec(av);
 }
 
 /* handle incoming client connections */
 
+static void set_recv_timeout(int fd, int secs) {
+  struct timeval tv = {secs, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
 static void handle_conn(int conn) {
+  /*
+   * every read from the client happens once data is there, so blocking on
+   * one for long means a half-sent request or frame. without a timeout the
+   * handler (and its session) would sit there until the client goes away;
+   * reconnect storms from a wedged app piled these up.
+   */
+  set_recv_timeout(conn, DS_REQ_TIMEOUT_S);
+
   ds_req_t req;
   if (recv_req(conn, &req) < 0) {
-    send_frame(conn, MSG_ERR, "daemon: bad request\n", 20);
-    send_exit(conn, 1);
+    ds_send_frame(conn, MSG_ERR, "daemon: bad request\n", 20);
+    ds_send_exit(conn, 1);
     close(conn);
     _exit(1);
   }
@@ -567,14 +1020,20 @@ static void handle_conn(int conn) {
       continue;
     if (strcmp(req.argv[i], "daemon") == 0 ||
         strcmp(req.argv[i], "client") == 0) {
-      send_frame(conn, MSG_ERR, "daemon: recursive call refused\n", 31);
-      send_exit(conn, 1);
+      ds_send_frame(conn, MSG_ERR, "daemon: recursive call refused\n", 31);
+      ds_send_exit(conn, 1);
       free_req(&req);
       close(conn);
       _exit(1);
     }
   }
 
+  if (try_serve_config_get(conn, &req)) {
+    free_req(&req);
+    close(conn);
+    _exit(0);
+  }
+
   /* log the request */
   {
     char cmdline[DS_MAX_ARG * 2] = {0};
@@ -586,11 +1045,22 @@ static void handle_conn(int conn) {
         off += (size_t)n;
     }
     ds_log("Client connected. Mode: %s",
-           (req.flags & REQ_FLAG_PTY) ? "PTY" : "PIPE");
+           (req.flags & REQ_FLAG_MUX)   ? "MUX"
+           : (req.flags & REQ_FLAG_PTY) ? "PTY"
+                                        : "PIPE");
     ds_log("Executing command: %s", cmdline);
   }
 
-  handle_session(conn, &req);
+  if (req.flags & REQ_FLAG_MUX) {
+    /* the mux process blocks on the connection between tab requests */
+    set_recv_timeout(conn, 0);
+    serve_mux(conn, &req);
+  }
+
+  const char *rec_kind = NULL;
+  const char *rec_name =
+      (req.flags & REQ_FLAG_PTY) ? session_record(&req, &rec_kind) : NULL;
+  handle_session(conn, &req, rec_name, rec_kind);
 
   ds_log("Session finished. Client disconnected.");
   free_req(&req);
@@ -607,7 +1077,10 @@ static void daemonize(int foreground) {
    * Termux). This prevents false-positive detections and ensures a clean state
    * for all Droidspaces tasks.
    */
+  const char *sock = sock_name(); /* resolved before the env is gone */
   clearenv();
+  if (strcmp(sock, DS_SOCK_NAME) != 0)
+    setenv("DS_DAEMON_SOCK", sock, 1);
   if (is_android()) {
     setenv(
         "PATH",
@@ -783,7 +1256,7 @@ int ds_daemon_run(int foreground, char **argv) {
   ensure_workspace();
 
   if (ds_daemon_probe()) {
-    ds_error("Daemon is already running (@%s)", DS_SOCK_NAME);
+    ds_error("Daemon is already running (@%s)", sock_name());
     return 1;
   }
 
@@ -813,8 +1286,9 @@ int ds_daemon_run(int foreground, char **argv) {
   /* SIGUSR2: app sends this after a live binary swap as an acknowledgment */
   signal(SIGUSR2, sigusr2_handler);
 
-  /* Write PID file so the Android app can signal us */
-  {
+  /* Write PID file so the Android app can signal us (not for a private
+   * DS_DAEMON_SOCK instance, which would clobber the real daemon's) */
+  if (strcmp(sock_name(), DS_SOCK_NAME) == 0) {
     char pid_path[PATH_MAX];
     snprintf(pid_path, sizeof(pid_path), "%s/droidspacesd.pid",
              get_workspace_dir());
@@ -834,7 +1308,7 @@ int ds_daemon_run(int foreground, char **argv) {
   struct sockaddr_un addr;
   socklen_t alen = make_addr(&addr);
   if (bind(srv, (struct sockaddr *)&addr, alen) < 0) {
-    ds_error("daemon: bind(@%s): %s", DS_SOCK_NAME, strerror(errno));
+    ds_error("daemon: bind(@%s): %s", sock_name(), strerror(errno));
     if (errno == EADDRINUSE) {
       ds_log("Is another droidspaces daemon stuck? Check 'ps' to see.");
     }
@@ -853,7 +1327,9 @@ int ds_daemon_run(int foreground, char **argv) {
 
   fprintf(stdout, "\nDroidspaces Daemon - v" DS_VERSION "\n\n");
   fflush(stdout);
-  ds_log("Listening on @" DS_SOCK_NAME " (PID %d)", getpid());
+  ds_log("Listening on @%s (PID %d)", sock_name(), getpid());
+
+  cfg_cache_init();
 
   for (;;) {
     /* Acknowledge a live binary swap signalled by the Android app. */
@@ -863,6 +1339,17 @@ int ds_daemon_run(int foreground, char **argv) {
              "binary automatically.");
     }
 
+    struct pollfd pfds[2] = {{srv, POLLIN, 0}, {g_cfg_ifd, POLLIN, 0}};
+    if (poll(pfds, g_cfg_ifd >= 0 ? 2 : 1, -1) < 0) {
+      if (errno != EINTR)
+        ds_error("poll: %s", strerror(errno));
+      continue;
+    }
+    /* Always settle the config cache before forking a handler from it */
+    cfg_cache_process();
+    if (!(pfds[0].revents & POLLIN))
+      continue;
+
     int conn = accept4(srv, NULL, NULL, SOCK_CLOEXEC);
     if (conn < 0) {
       if (errno == EINTR || errno == EAGAIN)
@@ -944,6 +1431,19 @@ int ds_client_run(int argc, char **argv) {
     }
   }
 
+  /* run-batch reads its command list from stdin unless given a file, and
+   * pipe-mode children otherwise get /dev/null: stream it over instead */
+  int feed_stdin = 0;
+  for (int i = 0; i < argc; i++) {
+    if (strcmp(argv[i], "run-batch") == 0) {
+      feed_stdin = 1;
+      for (int j = i + 1; j < argc; j++)
+        if (argv[j][0] != '-' || strcmp(argv[j], "-") == 0)
+          feed_stdin = strcmp(argv[j], "-") == 0;
+      break;
+    }
+  }
+
   int has_tty = isatty(STDIN_FILENO) && isatty(STDOUT_FILENO);
 
   if (interactive && !has_tty) {
@@ -1003,6 +1503,8 @@ int ds_client_run(int argc, char **argv) {
 
   /* send the request */
   uint32_t flags = interactive ? REQ_FLAG_PTY : 0u;
+  if (feed_stdin)
+    flags |= REQ_FLAG_STDIN;
   uint32_t nf = htonl(flags), na = htonl((uint32_t)argc);
   if (write_all(sock, &nf, 4) < 0 || write_all(sock, &na, 4) < 0)
     goto send_err;
@@ -1022,6 +1524,23 @@ int ds_client_run(int argc, char **argv) {
       goto send_err;
   }
 
+  /* the batch is read to eof before anything runs, so send it up front.
+   * this also covers stdin redirected from a file, which epoll refuses */
+  if (feed_stdin) {
+    char ibuf[DS_IOBUF];
+    for (;;) {
+      ssize_t n = read(STDIN_FILENO, ibuf, sizeof(ibuf));
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        break;
+      if (ds_send_frame(sock, MSG_OUT, ibuf, (uint32_t)n) < 0)
+        goto send_err;
+    }
+    if (ds_send_frame(sock, MSG_OUT, NULL, 0) < 0)
+      goto send_err;
+  }
+
   /* run the relay loop */
   struct termios orig;
   int raw_tty_active = 0;
@@ -1060,7 +1579,7 @@ int ds_client_run(int argc, char **argv) {
       struct winsize nws = {24, 80, 0, 0};
       ioctl(STDIN_FILENO, TIOCGWINSZ, &nws);
       uint16_t wd2[2] = {htons(nws.ws_row), htons(nws.ws_col)};
-      send_frame(sock, MSG_WINCH, wd2, 4);
+      ds_send_frame(sock, MSG_WINCH, wd2, 4);
     }
 
     int nfds = epoll_wait(epfd, events, 4, raw_tty_active ? 200 : -1);
@@ -1074,7 +1593,7 @@ int ds_client_run(int argc, char **argv) {
       if (fd == STDIN_FILENO) {
         ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
         if (n > 0) {
-          if (send_frame(sock, MSG_OUT, buf, (uint32_t)n) < 0)
+          if (ds_send_frame(sock, MSG_OUT, buf, (uint32_t)n) < 0)
             done = 1;
         } else {
           done = 1;
@@ -1095,7 +1614,7 @@ int ds_client_run(int argc, char **argv) {
             if (!pending)
               break;
 
-            if (recv_frame_hdr(sock, &type, &mlen) < 0) {
+            if (ds_recv_frame_hdr(sock, &type, &mlen) < 0) {
               done = 1;
               break;
             }
@@ -1103,7 +1622,7 @@ int ds_client_run(int argc, char **argv) {
             if (type == MSG_EXIT) {
               uint32_t nc = 0;
               if (mlen >= 4)
-                read_exact(sock, &nc, 4);
+                ds_read_exact(sock, &nc, 4);
               exit_code = (int)ntohl(nc);
               done = 1;
               break;
@@ -1114,7 +1633,7 @@ int ds_client_run(int argc, char **argv) {
             while (rem) {
               uint32_t c =
                   (rem < (uint32_t)sizeof(buf)) ? rem : (uint32_t)sizeof(buf);
-              if (read_exact(sock, buf, c) < 0) {
+              if (ds_read_exact(sock, buf, c) < 0) {
                 done = 1;
                 break;
               }
@@ -69,6 +69,7 @@
 #define DS_AUTHOR "ravindu644"
 #define DS_REPO "https://github.com/ravindu644/Droidspaces-OSS"
 #define DS_MAX_TTYS 6
+#define DS_TTY_NAME_MAX 32 /* "/dev/pts/" + up to 10 digits, with headroom */
 #define DS_UUID_LEN 32
 #define DS_MAX_CONTAINERS 1024
 #define DS_STOP_TIMEOUT 15 /* seconds */
@@ -76,6 +77,10 @@
 #define DS_PID_SCAN_DELAY_US 200000 /* 200ms */
 #define DS_RETRY_DELAY_US 200000    /* 200ms */
 #define DS_REBOOT_EXIT 249          /* exit code: in-container reboot */
+#define DS_NS_COUNT 6 /* mnt uts ipc pid cgroup net, in setns() order */
+#define DS_THREAD_STACK_SIZE (128 * 1024) /* see ds_thread_create() */
+#define DS_STACK_TRIM_SLACK (16 * 1024)   /* see ds_release_boot_memory() */
+#define DS_ENTRY_MAX_CG 32
 
 /* Workspace paths */
 #define DS_WORKSPACE_ANDROID "/data/local/Droidspaces"
@@ -144,10 +149,12 @@
 
 extern int ds_log_silent;
 extern char ds_log_container_name[256];
+extern unsigned int ds_log_debug_mask;
 
 void ds_log_internal(const char *prefix, const char *color, int is_err,
                      const char *fmt, ...);
 void ds_die_internal(const char *fmt, ...);
+void ds_log_debug_init(const char *spec);
 void rotate_log(const char *path, size_t max_size);
 int check_ns(int flag, const char *name);
 
@@ -156,6 +163,44 @@ int check_ns(int flag, const char *name);
 #define ds_error(fmt, ...) ds_log_internal("-", C_RED, 1, fmt, ##__VA_ARGS__)
 #define ds_die(fmt, ...) ds_die_internal(fmt, ##__VA_ARGS__)
 
+/* Per-subsystem debug logging.
+ *
+ * ds_dbg(NET, "fmt", ...) is gated twice, both BEFORE any formatting:
+ *   1. Compile time: DS_DEBUG_SUBSYS is a bitmask of subsystems built in
+ *      (make DEBUG_LOG=1 sets it to all).  Release builds use 0, so every
+ *      ds_dbg() call folds to nothing - no branch, no vsnprintf, no strings.
+ *   2. Run time: ds_log_debug_mask, populated from DS_DEBUG=net,dns,... by
+ *      ds_log_debug_init() in main().
+ * Enabled messages carry the usual "[NET]" style tag, so they land in the
+ * container log file and stay filtered from the terminal like the rest. */
+enum ds_log_subsys {
+  DS_LOG_NET = 0,
+  DS_LOG_IPT,
+  DS_LOG_DNS,
+  DS_LOG_DHCP,
+  DS_LOG_SEC,
+  DS_LOG_GPU,
+  DS_LOG_FW,
+  DS_LOG_CGROUP,
+  DS_LOG_VIRT,
+  DS_LOG_DAEMON,
+  DS_LOG_SUBSYS_COUNT
+};
+
+#ifndef DS_DEBUG_SUBSYS
+#define DS_DEBUG_SUBSYS 0u
+#endif
+
+#define ds_dbg_enabled(sub)                                                    \
+  ((DS_DEBUG_SUBSYS & (1u << DS_LOG_##sub)) &&                                 \
+   (ds_log_debug_mask & (1u << DS_LOG_##sub)))
+
+#define ds_dbg(sub, fmt, ...)                                                  \
+  do {                                                                         \
+    if (ds_dbg_enabled(sub))                                                   \
+      ds_log_internal("+", C_DIM, 0, "[" #sub "] " fmt, ##__VA_ARGS__);        \
+  } while (0)
+
 /* ---------------------------------------------------------------------------
  * Data structures
  * ---------------------------------------------------------------------------*/
@@ -220,14 +265,10 @@ struct ds_bind_mount {
   char dest[PATH_MAX];
 };
 
-struct ds_env_var {
-  char *key;
-  char *value;
-};
-
+/* Preserved unknown config line, allocated to fit (newline included) */
 struct ds_config_line {
-  char line[2048];
   struct ds_config_line *next;
+  char line[];
 };
 
 /* Terminal/TTY info - one per allocated PTY */
@@ -235,7 +276,7 @@ struct ds_config_line {
 struct ds_tty_info {
   int master;          /* master fd (stays in parent/monitor) */
   int slave;           /* slave fd (bind-mounted into container) */
-  char name[PATH_MAX]; /* slave device path (e.g. /dev/pts/3) */
+  char name[DS_TTY_NAME_MAX]; /* slave device path (e.g. /dev/pts/3) */
 };
 
 /* Container configuration - replaces all global variables */
@@ -267,18 +308,16 @@ struct ds_port_forward {
 #define DS_PRIV_FULL (0xFF) /* All above */
 
 struct ds_config {
-  /* Paths */
-  char rootfs_path[PATH_MAX];     /* --rootfs=  */
-  char rootfs_img_path[PATH_MAX]; /* --rootfs-img= */
-  char pidfile[PATH_MAX];         /* --pidfile= or auto-resolved */
-  char container_name[256];       /* --name= or auto-generated */
-  char hostname[256];             /* --hostname= or container_name */
-  char dns_servers[1024];         /* --dns= (comma/space separated) */
-  enum ds_net_mode net_mode;      /* --net=host|nat|none */
-  char dns_server_content[1024];  /* In-memory DNS config for boot */
+  /* Layout: small, frequently touched fields first (identity, flags, pids,
+   * fds) so the hot part of the struct sits in a few cache lines; the large
+   * path/text buffers follow.  Per-container scans that only need identity
+   * should use struct ds_config_summary / is_container_running_by_name()
+   * rather than building one of these on the stack. */
 
-  /* UUID for PID discovery */
-  char uuid[DS_UUID_LEN + 1];
+  /* Identity */
+  char container_name[256];  /* --name= or auto-generated */
+  char uuid[DS_UUID_LEN + 1]; /* UUID for PID discovery */
+  enum ds_net_mode net_mode; /* --net=host|nat|none */
 
   /* Flags */
   int foreground;         /* --foreground */
@@ -295,14 +334,17 @@ struct ds_config {
   int block_nested_ns;    /* --block-nested-namespaces: fix VFS deadlock by
                                blocking nested namespace creation */
   int privileged_mask;    /* --privileged bitmask */
-  char prog_name[64];     /* argv[0] for logging */
+  int virtualization;     /* --virtualization: enable resource virtualization */
+  int record_sessions;    /* --record-sessions: asciicast of enter/console */
+  char hotplug_classes[256]; /* --gpu: subsystems hot-plugged into /dev,
+                                "" = DS_HOTPLUG_DEFAULT_CLASSES, "none" */
 
   /* Runtime state */
-  char volatile_dir[PATH_MAX];    /* temporary overlay dir */
-  pid_t container_pid;            /* PID 1 of the container (host view) */
-  pid_t intermediate_pid;         /* intermediate fork pid */
-  int is_img_mount;               /* 1 if rootfs was loop-mounted from .img */
-  char img_mount_point[PATH_MAX]; /* where the .img was mounted */
+  pid_t container_pid;        /* PID 1 of the container (host view) */
+  pid_t intermediate_pid;     /* intermediate fork pid */
+  int is_img_mount;           /* 1 if rootfs was loop-mounted from .img */
+  struct timespec start_time; /* when the container was started */
+  unsigned long ns_inode;     /* PID namespace inode for identity verification */
 
   /* ── NAT networking synchronization pipes ─────────────────────────────
    * Both pairs are initialised to {-1,-1} in main() after memset.
@@ -310,58 +352,71 @@ struct ds_config {
   int net_ready_pipe[2]; /* child → monitor: "I am in my new netns"  */
   int net_done_pipe[2];  /* monitor → child: "veth peer is in place" */
 
-  /* Custom bind mounts (dynamically allocated) */
-  struct ds_bind_mount *binds;
-  int bind_count;
-  int bind_capacity;
-
   /* Configuration persistence */
-  char config_file[PATH_MAX];
   int config_file_specified;
   int config_file_existed;
 
-  /* Terminal (console + ttys) */
-  struct ds_tty_info console;
-  struct ds_tty_info ttys[DS_MAX_TTYS];
-  int tty_count; /* how many TTYs are active */
+  /* Custom bind mounts (dynamically allocated) */
+  struct ds_bind_mount *binds;
+  int bind_count;
+  int bind_capacity;
 
-  /* Environment variables (dynamically allocated) */
-  char env_file[PATH_MAX];
-  struct ds_env_var *env_vars;
+  /* Environment variables: "KEY=VALUE\0" entries packed back to back in
+   * one heap block (dynamically allocated, see environment.c) */
+  char *env_block;
+  size_t env_block_len;
   int env_var_count;
-  int env_var_capacity;
 
   /* Unknown config lines (preserved from Android metadata) */
   struct ds_config_line *unknown_head;
   struct ds_config_line *unknown_tail;
 
-  /* Port forwarding (--port HOST:CONTAINER[/proto]) */
-  struct ds_port_forward port_forwards[DS_MAX_PORT_FORWARDS];
-  int port_forward_count;
-  char nat_container_ip[INET_ADDRSTRLEN]; /* assigned container IP, for cleanup
-                                           */
+  /* Resource limits */
+  long long memory_limit; /* memory.max in bytes */
+  long long cpu_quota;    /* cpu.max quota in us */
+  long long cpu_period;   /* cpu.max period in us */
+  long long pids_limit;   /* pids.max */
+
+  /* Terminal (console + ttys) */
+  struct ds_tty_info console;
+  struct ds_tty_info ttys[DS_MAX_TTYS];
+  int tty_count; /* how many TTYs are active */
 
   /* Static NAT IP (--nat-ip, or auto-assigned on first boot and persisted).
    * Once set in container.config, this IP is reused on every subsequent boot
    * instead of re-deriving a PID-hash IP.  Plain dotted-decimal, no CIDR. */
   char static_nat_ip[INET_ADDRSTRLEN];
+  char nat_container_ip[INET_ADDRSTRLEN]; /* assigned container IP, for cleanup
+                                           */
+  char prog_name[64]; /* argv[0] for logging */
+
+  /* Port forwarding (--port HOST:CONTAINER[/proto]) */
+  int port_forward_count;
+  struct ds_port_forward port_forwards[DS_MAX_PORT_FORWARDS];
 
   /* Upstream interfaces for NAT routing (--upstream wlan0,rmnet0,...) */
-  char upstream_ifaces[DS_MAX_UPSTREAM_IFACES][IFNAMSIZ];
   int upstream_iface_count;
+  char upstream_ifaces[DS_MAX_UPSTREAM_IFACES][IFNAMSIZ];
 
-  /* Resource limits */
-  long long memory_limit; /* memory.max in bytes */
-  long long cpu_quota;    /* cpu.max quota in us */
-  long long cpu_period;   /* cpu.max period in us */
-  long long pids_limit;   /* pids.max */
+  /* Names and DNS */
+  char hostname[256];            /* --hostname= or container_name */
+  char dns_servers[1024];        /* --dns= (comma/space separated) */
+  char dns_server_content[1024]; /* In-memory DNS config for boot */
 
-  int virtualization; /* --virtualization: enable resource virtualization */
-  struct timespec start_time; /* when the container was started */
-  unsigned long ns_inode;     /* PID namespace inode for identity verification */
+  /* Paths */
+  char rootfs_path[PATH_MAX];     /* --rootfs=  */
+  char rootfs_img_path[PATH_MAX]; /* --rootfs-img= */
+  char pidfile[PATH_MAX];         /* --pidfile= or auto-resolved */
+  char config_file[PATH_MAX];
+  char env_file[PATH_MAX];
+  char volatile_dir[PATH_MAX];    /* temporary overlay dir */
+  char img_mount_point[PATH_MAX]; /* where the .img was mounted */
 };
 
 #define OPT_VIRTUALIZATION 268
+#define OPT_JSON 269
+#define OPT_RECORD_SESSIONS 270
+#define OPT_REFRESH 271
 
 /* ---------------------------------------------------------------------------
  * utils.c
@@ -379,6 +434,7 @@ int write_file_atomic(const char *path, const char *content);
 ssize_t write_all(int fd, const void *buf, size_t count);
 int generate_uuid(char *buf, size_t size);
 int get_kernel_version(int *major, int *minor);
+int get_boot_id(char *buf, size_t size);
 int mkdir_p(const char *path, mode_t mode);
 int remove_recursive(const char *path);
 int collect_pids(pid_t **pids_out, size_t *count_out);
@@ -399,8 +455,15 @@ int ds_get_selinux_status(void);
 void ds_set_selinux_permissive(void);
 int get_selinux_context(const char *path, char *buf, size_t size);
 int set_selinux_context(const char *path, const char *context);
+int ds_utf8_seq(const unsigned char *p, const unsigned char *end);
+void ds_json_put_str(FILE *f, const char *s, size_t len);
+char *ds_json_skip_ws(char *p, const char *end);
+char *ds_json_get_str(char **pp, const char *end, size_t *len_out);
 int ds_send_fd(int sock, int fd);
 int ds_recv_fd(int sock);
+int ds_thread_create(pthread_t *tid, int detached, void *(*fn)(void *),
+                     void *arg);
+void ds_release_boot_memory(void);
 void print_ds_banner(void);
 void print_privileged_warning(int privileged_mask);
 int is_systemd_rootfs(const char *path);
@@ -417,7 +480,20 @@ void ds_format_size(long long bytes, char *buf, size_t sz);
  * config.c
  * ---------------------------------------------------------------------------*/
 
+/* Identity subset of container.config used by workspace-wide scans */
+struct ds_config_summary {
+  char container_name[256];
+  char uuid[DS_UUID_LEN + 1];
+  char static_nat_ip[INET_ADDRSTRLEN];
+  int net_mode; /* enum ds_net_mode */
+};
+
 int ds_config_load(const char *config_path, struct ds_config *cfg);
+int ds_config_peek(const char *config_path, struct ds_config_summary *out);
+char *ds_config_render_json(struct ds_config *cfg, size_t *len_out);
+int ds_config_set_kv(struct ds_config *cfg, const char *key, const char *val,
+                     char *errbuf, size_t errsize);
+int ds_config_command(struct ds_config *cfg, int argc, char **argv, int json);
 int ds_config_load_by_name(const char *name, struct ds_config *cfg);
 int ds_config_save(const char *config_path, struct ds_config *cfg);
 int ds_config_save_by_name(const char *name, struct ds_config *cfg);
@@ -442,8 +518,7 @@ void ds_set_selinux_permissive(void);
 int ds_get_selinux_status(void);
 void android_remount_data_suid(void);
 int android_setup_storage(const char *rootfs_path);
-int android_seccomp_setup(int is_systemd, int block_nested_ns);
-int ds_seccomp_apply_minimal(int hw_access, int privileged_mask);
+int ds_seccomp_apply(int privileged_mask, int block_nested_ns);
 
 /* ---------------------------------------------------------------------------
  * mount.c
@@ -489,6 +564,10 @@ int ds_cgroup_get_limits(struct ds_config *cfg, long long *mem_limit,
 int ds_cgroup_get_usage(struct ds_config *cfg, long long *mem_usage,
                         long long *cpu_usage, long long *pids_usage);
 int ds_cgroup_attach(pid_t target_pid);
+int ds_cgroup_open_attach_dirs(const char *container_name, pid_t target_pid,
+                               int in_cgns, int *fds, int max);
+void ds_cgroup_attach_dirs(const int *fds, int n);
+void ds_cgroup_detach_dirs(const int *fds, int n, pid_t child_pid);
 /* Remove the ds-enter-<child_pid> leaf cgroup after an enter/run session. */
 void ds_cgroup_detach(pid_t child_pid);
 /* Remove the entire /sys/fs/cgroup/droidspaces/<name>/ subtree on stop. */
@@ -498,6 +577,21 @@ void ds_cgroup_cleanup_container(const char *container_name);
  * hardware.c
  * ---------------------------------------------------------------------------*/
 
+/* A host GPU/hardware node from the device manifest */
+struct ds_dev_node {
+  char path[96]; /* host path, under /dev */
+  dev_t rdev;
+  mode_t mode;
+  gid_t gid;
+};
+
+void ds_dev_blocklist_init(void);
+int ds_dev_manifest(const struct ds_dev_node **nodes);
+
+/* Subsystems whose hot-plugged nodes reach --gpu containers by default */
+#define DS_HOTPLUG_DEFAULT_CLASSES "tty,usb,video4linux,hidraw"
+int ds_hotplug_open(const struct ds_config *cfg);
+void ds_hotplug_process(int fd, const struct ds_config *cfg);
 int scan_host_gpu_gids(gid_t *gids, int max_gids);
 void mirror_gpu_nodes(const char *dev_path);
 int setup_gpu_groups(void);
@@ -525,6 +619,7 @@ void ds_net_derive_handshake(pid_t init_pid, struct ds_config *cfg,
                              struct ds_net_handshake *hs);
 void ds_net_cleanup(struct ds_config *cfg, pid_t container_pid);
 void ds_net_start_route_monitor(void);
+void ds_net_stop_route_monitor(void);
 int ds_net_disable_tx_checksum(const char *ifname);
 void parse_cidr(const char *cidr, uint32_t *ip_out, uint32_t *mask_out);
 
@@ -604,15 +699,14 @@ void ds_net_resolve_static_ip(struct ds_config *cfg);
  * ds_dhcp.c
  * ---------------------------------------------------------------------------*/
 
-/* Start a single-lease DHCP server on veth_host (detached monitor thread).
+/* Start a single-lease DHCP server on veth_host (monitor event loop source).
  * Offers offer_ip_be to any DHCP client that broadcasts on the interface.
  * gw_ip_be becomes the router/server-id option (typically DS_NAT_GW_IP). */
 void ds_dhcp_server_start(struct ds_config *cfg, const char *veth_host,
                           uint32_t offer_ip_be, uint32_t gw_ip_be,
                           const uint8_t peer_mac[6]);
 
-/* Stop the DHCP server and unblock its recv() loop. Call before veth teardown.
- */
+/* Stop the DHCP server and close its socket. Call before veth teardown. */
 void ds_dhcp_server_stop(void);
 
 /* ---------------------------------------------------------------------------
@@ -627,17 +721,46 @@ void ds_dhcp_server_stop(void);
  * proxy entirely - those servers are written directly to resolv.conf).
  * ---------------------------------------------------------------------------*/
 
-/* Start the DNS proxy thread.  Must be called after setup_veth_host_side()
- * so DS_NAT_GW_IP (172.28.0.1) is already assigned to the bridge/veth. */
+/* Start the DNS proxy on the monitor's event loop.  Must be called after
+ * setup_veth_host_side() so DS_NAT_GW_IP (172.28.0.1) is already assigned
+ * to the bridge/veth. */
 void ds_dns_proxy_start(struct ds_config *cfg, pid_t container_pid);
 
-/* Stop the proxy and join its thread.  Called from ds_net_cleanup(). */
+/* Stop the proxy, dropping queries in flight.  Called from ds_net_cleanup(). */
 void ds_dns_proxy_stop(void);
 
 /* Re-probe upstream DNS for new_iface and update the proxy in-memory.
  * Called from do_upstream_reprobe() when the route monitor switches tables. */
 void ds_dns_proxy_update_upstream(const char *new_iface);
 
+/* ---------------------------------------------------------------------------
+ * ds_evloop.c
+ *
+ * The monitor's single event loop.  A source is a caller-owned struct ds_ev;
+ * its fd is -1 while unregistered.
+ * ---------------------------------------------------------------------------*/
+
+struct ds_ev;
+typedef void (*ds_ev_cb)(struct ds_ev *ev, uint32_t events);
+
+struct ds_ev {
+  int fd;
+  ds_ev_cb cb;
+  void *arg;
+};
+
+int ds_ev_init(void);
+int ds_ev_add(struct ds_ev *ev, int fd, uint32_t events, ds_ev_cb cb,
+              void *arg);
+void ds_ev_del(struct ds_ev *ev);
+void ds_ev_close(struct ds_ev *ev);
+int ds_ev_timer_add(struct ds_ev *ev, long first_ms, long interval_ms,
+                    ds_ev_cb cb, void *arg);
+void ds_ev_timer_arm(struct ds_ev *ev, long first_ms, long interval_ms);
+void ds_ev_timer_ack(struct ds_ev *ev);
+int ds_ev_run(void);
+void ds_ev_stop(void);
+
 /* ---------------------------------------------------------------------------
  * terminal.c
  * ---------------------------------------------------------------------------*/
@@ -648,7 +771,52 @@ int ds_terminal_make_controlling(int fd);
 int ds_setup_tios(int fd, struct termios *old);
 void build_container_ttys_string(struct ds_tty_info *ttys, int count, char *buf,
                                  size_t size);
-int ds_terminal_proxy(int master_fd);
+struct ds_recorder;
+int ds_terminal_proxy(int master_fd, struct ds_recorder *rec);
+
+/* Non-blocking PTY relay shared by enter/run and the foreground console.
+ * Each direction has its own ring; queued output is flushed with writev()
+ * and user input is always serviced before container output. */
+#define DS_RELAY_RING_SIZE (64 * 1024)
+
+struct ds_relay_ring {
+  char buf[DS_RELAY_RING_SIZE];
+  size_t head; /* offset of the oldest queued byte */
+  size_t len;  /* queued bytes */
+};
+
+struct ds_pty_relay {
+  int epfd, in_fd, out_fd, master_fd;
+  int in_flags, out_flags, master_flags; /* restored by ds_relay_close() */
+  uint32_t in_ev, out_ev, master_ev;     /* currently armed epoll masks */
+  int in_pollable, out_pollable;
+  int in_done, master_hup, master_done, out_error;
+  int eof_ends;   /* stdin EOF ends the relay (enter/run) */
+  int throttle;   /* DS_PTY_THROTTLE: drop backlog instead of stalling */
+  size_t dropped; /* output bytes discarded since the last notice */
+  /* Optional hook run on each chunk of user input; returns the number of
+   * leading bytes to forward (0 swallows the chunk). */
+  size_t (*in_filter)(void *ctx, const char *buf, size_t n);
+  void *filter_ctx;
+  struct ds_recorder *rec; /* optional session recording of the output */
+  struct ds_relay_ring to_master, to_out;
+};
+
+int ds_relay_open(struct ds_pty_relay *r, int epfd, int master_fd);
+int ds_relay_event(struct ds_pty_relay *r, int fd, uint32_t events);
+void ds_relay_close(struct ds_pty_relay *r);
+
+/* ---------------------------------------------------------------------------
+ * record.c
+ * ---------------------------------------------------------------------------*/
+
+struct ds_recorder *ds_record_open(const char *name, const char *kind,
+                                   int size_fd);
+void ds_record_output(struct ds_recorder *r, const void *data, size_t len);
+void ds_record_resize(struct ds_recorder *r, unsigned cols, unsigned rows);
+void ds_record_close(struct ds_recorder *r);
+int ds_replay_command(struct ds_config *cfg, const char *which,
+                      const char *speed_arg);
 
 /* ---------------------------------------------------------------------------
  * console.c
@@ -671,6 +839,7 @@ int find_available_name(const char *base_name, char *final_name, size_t size);
 int resolve_pidfile_from_name(const char *name, char *pidfile, size_t size);
 int auto_resolve_pidfile(struct ds_config *cfg);
 int is_container_running(struct ds_config *cfg, pid_t *pid_out);
+int is_container_running_by_name(const char *name, pid_t *pid_out);
 int is_container_init(pid_t pid);
 int ds_metadata_sync(pid_t pid);
 int count_running_containers(char *first_name, size_t size);
@@ -678,6 +847,7 @@ pid_t find_container_init_pid(const char *uuid);
 pid_t find_container_by_name(const char *name);
 int sync_pidfile(const char *src_pidfile, const char *name);
 int show_containers(void);
+int show_memory_stats(int json);
 int scan_containers(void);
 void write_plain_env_file(const char *src, const char *dst);
 
@@ -692,8 +862,7 @@ int internal_boot(struct ds_config *cfg);
  * environment.c
  * ---------------------------------------------------------------------------*/
 
-void load_etc_environment(void);
-void ds_env_boot_setup(struct ds_config *cfg);
+char **ds_env_build(struct ds_config *cfg, int with_etc_environment);
 void ds_env_save(const char *path, struct ds_config *cfg);
 void parse_env_file_to_config(const char *path, struct ds_config *cfg);
 
@@ -704,13 +873,36 @@ void parse_env_file_to_config(const char *path, struct ds_config *cfg);
 int is_valid_container_pid(pid_t pid);
 int start_rootfs(struct ds_config *cfg);
 int stop_rootfs(struct ds_config *cfg, int skip_unmount);
+int open_namespace_fds(pid_t pid, int ns_fds[DS_NS_COUNT]);
+int enter_namespace_fds(int ns_fds[DS_NS_COUNT], struct ds_config *cfg);
 int enter_namespace(pid_t pid, struct ds_config *cfg);
 int enter_rootfs(struct ds_config *cfg, const char *user);
 int run_in_rootfs(struct ds_config *cfg, int argc, char **argv);
+int run_batch_in_rootfs(struct ds_config *cfg, const char *input, int json);
+int mux_rootfs(struct ds_config *cfg, int conn);
 int show_info(struct ds_config *cfg, int trust_cfg_pid);
 int show_container_uptime(struct ds_config *cfg);
 int restart_rootfs(struct ds_config *cfg);
 
+/* ---------------------------------------------------------------------------
+ * entry.c
+ * ---------------------------------------------------------------------------*/
+
+/* What enter/run needs to join a running container, cached by its monitor */
+struct ds_entry_desc {
+  pid_t init_pid;
+  int ns_fds[DS_NS_COUNT]; /* -1 where the namespace is unavailable */
+  int cg_fds[DS_ENTRY_MAX_CG]; /* ds-enter leaf parents, one per hierarchy */
+  int cg_count;
+};
+
+int ds_entry_listen(const char *container_name);
+void ds_entry_publish(struct ds_config *cfg, pid_t init_pid, int in_cgns);
+void ds_entry_unpublish(void);
+void ds_entry_serve(int srv);
+int ds_entry_fetch(struct ds_config *cfg, struct ds_entry_desc *desc);
+void ds_entry_release(struct ds_entry_desc *desc);
+
 /* ---------------------------------------------------------------------------
  * documentation.c
  * ---------------------------------------------------------------------------*/
@@ -723,8 +915,35 @@ void print_documentation(const char *argv0);
 
 int is_dangerous_node(const char *name);
 int check_requirements(void);
+
+/* Host capability cache: <workspace>/host.caps, keyed by kernel build and
+ * boot_id. ds_hostcap_get() returns 1 or 0, or -1 when not probed yet. */
+#define DS_HOSTCAP_BRIDGE (1u << 0)    /* bridge links (CONFIG_BRIDGE) */
+#define DS_HOSTCAP_VETH (1u << 1)      /* veth pairs (CONFIG_VETH) */
+#define DS_HOSTCAP_NF_LOADED (1u << 2) /* netfilter modules loaded this boot */
+#define DS_HOSTCAP_OVERLAY (1u << 3)   /* overlay filesystem */
+#define DS_HOSTCAP_DEVTMPFS (1u << 4)  /* devtmpfs filesystem */
+#define DS_HOSTCAP_NS_MNT (1u << 5)    /* namespaces, functional unshare() */
+#define DS_HOSTCAP_NS_PID (1u << 6)
+#define DS_HOSTCAP_NS_UTS (1u << 7)
+#define DS_HOSTCAP_NS_IPC (1u << 8)
+#define DS_HOSTCAP_NS_NET (1u << 9)
+#define DS_HOSTCAP_NS_CGROUP (1u << 10)
+#define DS_HOSTCAP_PIVOT_ROOT (1u << 11) /* pivot_root syscall */
+#define DS_HOSTCAP_SECCOMP (1u << 12)    /* seccomp filter mode */
+int ds_hostcap_get(uint32_t cap);
+void ds_hostcap_set(uint32_t cap, int present);
+void ds_hostcap_refresh(void);
+int ds_hostcap_fs(uint32_t cap, const char *fstype);
 int check_requirements_hw(int hw_access);
-int check_requirements_detailed(void);
+int check_requirements_detailed(int refresh);
+
+/* ---------------------------------------------------------------------------
+ * bench.c
+ * ---------------------------------------------------------------------------*/
+
+int ds_bench_net(struct ds_config *cfg, const char *seconds_arg,
+                 int json_output);
 
 /* ---------------------------------------------------------------------------
  * daemon.c - daemon, client, and probe entry points
@@ -734,4 +953,18 @@ int ds_daemon_run(int foreground, char **argv);
 int ds_client_run(int argc, char **argv);
 int ds_daemon_probe(void);
 
+/* Wire frames: [u8 type][u32 BE length][payload] */
+int ds_read_exact(int fd, void *buf, size_t n);
+int ds_send_frame(int fd, uint8_t type, const void *data, uint32_t len);
+int ds_recv_frame_hdr(int fd, uint8_t *type_out, uint32_t *len_out);
+void ds_send_exit(int fd, int code);
+
+/* Channel frames of a multiplexed connection (REQ_FLAG_MUX, served by
+ * mux_rootfs). Every payload starts with a u16 BE channel id. */
+#define DS_MUX_OPEN ((uint8_t)0x10)
+#define DS_MUX_DATA ((uint8_t)0x11)
+#define DS_MUX_WINCH ((uint8_t)0x12)
+#define DS_MUX_CLOSE ((uint8_t)0x13)
+#define DS_MUX_MAX_CHANNELS 64
+
 #endif /* DROIDSPACE_H */
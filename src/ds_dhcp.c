@@ -3,9 +3,9 @@
  *
  * ds_dhcp.c - Embedded single-lease DHCP server for NAT containers.
  *
- * Runs as a joinable thread inside the monitor process. Bound exclusively to
- * the container's veth_host interface via SO_BINDTODEVICE so it never
- * interferes with any DHCP server already running on the host.
+ * Runs inside the monitor process as a source on its event loop (see
+ * ds_evloop.c). Bound exclusively to the container's veth_host interface so
+ * it never interferes with any DHCP server already running on the host.
  *
  * Serves a single static lease (the deterministic IP from veth_peer_ip()) in
  * response to DHCPDISCOVER and DHCPREQUEST. Handles lease renewals for the
@@ -29,8 +29,6 @@
 #include <netinet/in.h>
 #include <netinet/ip.h>
 #include <netinet/udp.h>
-#include <poll.h>
-#include <sys/eventfd.h>
 #include <sys/ioctl.h>
 
 /* ---------------------------------------------------------------------------
@@ -101,9 +99,10 @@ struct dhcp_pkt {
  * ---------------------------------------------------------------------------*/
 
 typedef struct {
-  int sock;
-  int stop_efd;
+  struct ds_ev ev; /* AF_PACKET socket on the monitor's event loop */
+  int ifindex;
   char iface[IFNAMSIZ];
+  char offer_str[INET_ADDRSTRLEN];
   uint32_t offer_ip_be;  /* IP we are offering */
   uint32_t gw_ip_be;     /* Gateway IP (usually bridge IP) */
   uint32_t netmask_be;   /* 255.255.0.0 for /16               */
@@ -111,18 +110,9 @@ typedef struct {
   uint32_t dns2_be;      /* DNS 2 */
   uint8_t peer_mac[6];   /* Container's MAC */
   uint8_t server_mac[6]; /* Bridge's MAC */
-  volatile sig_atomic_t stop;
-  pthread_t tid; /* Server thread ID */
-  /* Startup synchronization: ds_dhcp_server_start() blocks until the thread
-   * has finished socket setup and logged "DHCP Server started", ensuring the
-   * log line always appears before any subsequent caller logs (port forwards,
-   * boot message, foreground prompt). */
-  pthread_cond_t ready_cond;
-  int ready; /* set to 1 by thread once past bind() */
 } ds_dhcp_ctx_t;
 
-static ds_dhcp_ctx_t g_dhcp;
-static pthread_mutex_t g_dhcp_lock = PTHREAD_MUTEX_INITIALIZER;
+static ds_dhcp_ctx_t g_dhcp = {.ev = {.fd = -1}};
 
 /* ---------------------------------------------------------------------------
  * Option helpers
@@ -317,193 +307,130 @@ static int send_reply(int sock, int ifindex, const struct dhcp_pkt *pkt,
 }
 
 /* ---------------------------------------------------------------------------
- * Core server loop (runs as joinable thread)
+ * Frame handler (one received frame per call)
  * ---------------------------------------------------------------------------*/
 
-static void *dhcp_server_loop(void *arg) {
-  ds_dhcp_ctx_t *ctx = (ds_dhcp_ctx_t *)arg;
-
-  char offer_str[INET_ADDRSTRLEN];
-  struct in_addr tmp_addr;
-  tmp_addr.s_addr = ctx->offer_ip_be;
-  if (!inet_ntop(AF_INET, &tmp_addr, offer_str, sizeof(offer_str)))
-    offer_str[0] = '\0';
-
-  int packet_sock = -1;
+static void dhcp_handle_frame(ds_dhcp_ctx_t *ctx, const uint8_t *rx_buf,
+                              ssize_t len) {
   struct dhcp_pkt reply;
-  uint8_t rx_buf[2048];
-
-  /* 0. Create the AF_PACKET socket for SNIFFING EVERYTHING.
-   * We use SOCK_RAW + ETH_P_ALL to ensure NO kernel filtering hidden from us.
-   */
-  packet_sock = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
-  if (packet_sock < 0) {
-    ds_warn("[DHCP] packet socket: %s", strerror(errno));
-    pthread_mutex_lock(&g_dhcp_lock);
-    ctx->ready = 1;
-    pthread_cond_signal(&ctx->ready_cond);
-    pthread_mutex_unlock(&g_dhcp_lock);
-    goto out;
-  }
-
-  struct sockaddr_ll sll;
-  memset(&sll, 0, sizeof(sll));
-  sll.sll_family = AF_PACKET;
-  sll.sll_ifindex = (int)if_nametoindex(ctx->iface);
-  sll.sll_protocol = htons(ETH_P_ALL);
-
-  if (bind(packet_sock, (struct sockaddr *)&sll, sizeof(sll)) < 0) {
-    ds_warn("[DHCP] packet bind(%s): %s", ctx->iface, strerror(errno));
-    pthread_mutex_lock(&g_dhcp_lock);
-    ctx->ready = 1;
-    pthread_cond_signal(&ctx->ready_cond);
-    pthread_mutex_unlock(&g_dhcp_lock);
-    goto out;
-  }
-
-  ds_log("DHCP Server started on %s  offer=%s", ctx->iface, offer_str);
-
-  /* Signal the launcher that we are fully up and the log line has been
-   * emitted.  From this point the caller's subsequent logs (port forwards,
-   * boot message, foreground prompt) will always appear after us. */
-  pthread_mutex_lock(&g_dhcp_lock);
-  ctx->ready = 1;
-  pthread_cond_signal(&ctx->ready_cond);
-  pthread_mutex_unlock(&g_dhcp_lock);
-
-  struct pollfd fds[2];
-  fds[0].fd = packet_sock;
-  fds[0].events = POLLIN;
-  fds[1].fd = ctx->stop_efd;
-  fds[1].events = POLLIN;
-
-  while (!ctx->stop) {
-    /* ── Multiplex ────────────────────────────────────────────────────── */
-    int poll_ret = poll(fds, 2, -1);
-    if (poll_ret < 0) {
-      if (errno == EINTR || errno == EAGAIN)
-        continue;
-      ds_warn("[DHCP] poll: %s", strerror(errno));
-      break;
-    }
-
-    if (fds[1].revents & POLLIN) {
-      /* Stop signaled via eventfd */
-      break;
-    }
-
-    if (!(fds[0].revents & POLLIN))
-      continue;
 
-    /* ── Receive ──────────────────────────────────────────────────────── */
-    ssize_t len = recv(packet_sock, rx_buf, sizeof(rx_buf), 0);
-    if (len < 0) {
-      if (errno == EINTR || errno == EAGAIN)
-        continue;
-      if (errno == ENETDOWN || errno == ESHUTDOWN || errno == EBADF)
-        break;
-      ds_warn("[DHCP] packet recv: %s", strerror(errno));
-      break;
-    }
+  /* 1. Ethernet Header (14 bytes) */
+  if (len < (ssize_t)(sizeof(struct ethhdr) + sizeof(struct iphdr) +
+                      sizeof(struct udphdr)))
+    return;
 
-    /* 1. Ethernet Header (14 bytes) */
-    if (len < (ssize_t)(sizeof(struct ethhdr) + sizeof(struct iphdr) +
-                        sizeof(struct udphdr)))
-      continue;
+  struct ethhdr eth;
+  memcpy(&eth, rx_buf, sizeof(eth));
+  if (ntohs(eth.h_proto) != ETH_P_IP)
+    return;
 
-    struct ethhdr eth;
-    memcpy(&eth, rx_buf, sizeof(eth));
-    if (ntohs(eth.h_proto) != ETH_P_IP)
-      continue;
+  /* 2. IP Header */
+  struct iphdr ip;
+  memcpy(&ip, rx_buf + sizeof(eth), sizeof(ip));
+  if (ip.protocol != IPPROTO_UDP || ip.ihl < 5)
+    return;
 
-    /* 2. IP Header */
-    struct iphdr ip;
-    memcpy(&ip, rx_buf + sizeof(eth), sizeof(ip));
-    if (ip.protocol != IPPROTO_UDP || ip.ihl < 5)
-      continue;
+  /* 3. UDP Header */
+  int ip_hdr_len = ip.ihl * 4;
+  if (len < (ssize_t)(sizeof(eth) + ip_hdr_len + sizeof(struct udphdr)))
+    return;
 
-    /* 3. UDP Header */
-    int ip_hdr_len = ip.ihl * 4;
-    if (len < (ssize_t)(sizeof(eth) + ip_hdr_len + sizeof(struct udphdr)))
-      continue;
+  struct udphdr udp;
+  memcpy(&udp, rx_buf + sizeof(eth) + ip_hdr_len, sizeof(udp));
 
-    struct udphdr udp;
-    memcpy(&udp, rx_buf + sizeof(eth) + ip_hdr_len, sizeof(udp));
+  if (ntohs(udp.dest) != DHCP_SERVER_PORT)
+    return;
 
-    if (ntohs(udp.dest) != DHCP_SERVER_PORT)
-      continue;
+  /* 4. DHCP Payload */
+  int payload_off = (int)sizeof(eth) + ip_hdr_len + (int)sizeof(udp);
+  int req_len = (int)len - payload_off;
+  if (req_len < (int)offsetof(struct dhcp_pkt, options))
+    return;
 
-    /* 4. DHCP Payload */
-    int payload_off = (int)sizeof(eth) + ip_hdr_len + (int)sizeof(udp);
-    int req_len = (int)len - payload_off;
-    if (req_len < (int)offsetof(struct dhcp_pkt, options))
-      continue;
+  /* FIND-04: Fix unaligned pointer cast by copying to stack */
+  struct dhcp_pkt req;
+  if (req_len > (int)sizeof(req))
+    req_len = (int)sizeof(req);
+  memcpy(&req, rx_buf + payload_off, (size_t)req_len);
 
-    /* FIND-04: Fix unaligned pointer cast by copying to stack */
-    struct dhcp_pkt req;
-    if (req_len > (int)sizeof(req))
-      req_len = (int)sizeof(req);
-    memcpy(&req, rx_buf + payload_off, (size_t)req_len);
+  if (ntohl(req.magic) != DHCP_MAGIC)
+    return;
 
-    if (ntohl(req.magic) != DHCP_MAGIC)
-      continue;
+  if (req.op != BOOTP_REQUEST)
+    return;
 
-    if (req.op != BOOTP_REQUEST)
-      continue;
+  int opts_len = (int)(req_len - (int)offsetof(struct dhcp_pkt, options));
 
-    int opts_len = (int)(req_len - (int)offsetof(struct dhcp_pkt, options));
+  /* MAC filter */
+  if (memcmp(req.chaddr, ctx->peer_mac, 6) != 0) {
+    ds_dbg(DHCP, "Ignoring xid=%08x from foreign chaddr "
+                 "%02x:%02x:%02x:%02x:%02x:%02x",
+           ntohl(req.xid), req.chaddr[0], req.chaddr[1], req.chaddr[2],
+           req.chaddr[3], req.chaddr[4], req.chaddr[5]);
+    return;
+  }
 
-    /* MAC filter */
-    if (memcmp(req.chaddr, ctx->peer_mac, 6) != 0)
-      continue;
+  uint8_t type_byte = 0;
+  if (opt_get(req.options, opts_len, OPT_MSG_TYPE, &type_byte, 1) < 0)
+    return;
 
-    uint8_t type_byte = 0;
-    if (opt_get(req.options, opts_len, OPT_MSG_TYPE, &type_byte, 1) < 0)
-      continue;
+  /* ── Dispatch ─────────────────────────────────────────────────────── */
+  switch (type_byte) {
+
+  case DHCPDISCOVER:
+    ds_log("[DHCP] DISCOVER  xid=%08x  chaddr=%02x:%02x:%02x:%02x:%02x:%02x",
+           ntohl(req.xid), req.chaddr[0], req.chaddr[1], req.chaddr[2],
+           req.chaddr[3], req.chaddr[4], req.chaddr[5]);
+    {
+      int plen = build_reply(&reply, &req, DHCPOFFER, ctx);
+      if (send_reply(ctx->ev.fd, ctx->ifindex, &reply, plen, ctx) == 0)
+        ds_log("[DHCP] OFFER    → %s  xid=%08x", ctx->offer_str,
+               ntohl(req.xid));
+    }
+    break;
+
+  case DHCPREQUEST: {
+    /* Skip SERVER_ID check for INIT-REBOOT (broadcast requests)
+     * Some clients (like Void's dhclient) might be rebinding/rebooting. */
+    uint8_t sid[4];
+    if (opt_get(req.options, opts_len, OPT_SERVER_ID, sid, 4) == 4) {
+      uint32_t sid_be;
+      memcpy(&sid_be, sid, 4);
+      if (sid_be != ctx->gw_ip_be)
+        break;
+    }
 
-    /* ── Dispatch ─────────────────────────────────────────────────────── */
-    switch (type_byte) {
-
-    case DHCPDISCOVER:
-      ds_log("[DHCP] DISCOVER  xid=%08x  chaddr=%02x:%02x:%02x:%02x:%02x:%02x",
-             ntohl(req.xid), req.chaddr[0], req.chaddr[1], req.chaddr[2],
-             req.chaddr[3], req.chaddr[4], req.chaddr[5]);
-      {
-        int plen = build_reply(&reply, &req, DHCPOFFER, ctx);
-        if (send_reply(packet_sock, sll.sll_ifindex, &reply, plen, ctx) == 0)
-          ds_log("[DHCP] OFFER    → %s  xid=%08x", offer_str, ntohl(req.xid));
-      }
-      break;
+    ds_log("[DHCP] REQUEST   xid=%08x  chaddr=%02x:%02x:%02x:%02x:%02x:%02x",
+           ntohl(req.xid), req.chaddr[0], req.chaddr[1], req.chaddr[2],
+           req.chaddr[3], req.chaddr[4], req.chaddr[5]);
 
-    case DHCPREQUEST: {
-      /* Skip SERVER_ID check for INIT-REBOOT (broadcast requests)
-       * Some clients (like Void's dhclient) might be rebinding/rebooting. */
-      uint8_t sid[4];
-      if (opt_get(req.options, opts_len, OPT_SERVER_ID, sid, 4) == 4) {
-        uint32_t sid_be;
-        memcpy(&sid_be, sid, 4);
-        if (sid_be != ctx->gw_ip_be)
-          break;
-      }
+    int plen = build_reply(&reply, &req, DHCPACK, ctx);
+    if (send_reply(ctx->ev.fd, ctx->ifindex, &reply, plen, ctx) == 0)
+      ds_log("[DHCP] ACK      → %s  xid=%08x", ctx->offer_str,
+             ntohl(req.xid));
+    break;
+  }
+  }
+}
 
-      ds_log("[DHCP] REQUEST   xid=%08x  chaddr=%02x:%02x:%02x:%02x:%02x:%02x",
-             ntohl(req.xid), req.chaddr[0], req.chaddr[1], req.chaddr[2],
-             req.chaddr[3], req.chaddr[4], req.chaddr[5]);
+/* Event loop callback: the packet socket is readable (or has failed) */
+static void dhcp_on_packet(struct ds_ev *ev, uint32_t events) {
+  (void)events;
+  ds_dhcp_ctx_t *ctx = ev->arg;
+  uint8_t rx_buf[2048];
 
-      int plen = build_reply(&reply, &req, DHCPACK, ctx);
-      if (send_reply(packet_sock, sll.sll_ifindex, &reply, plen, ctx) == 0)
-        ds_log("[DHCP] ACK      → %s  xid=%08x", offer_str, ntohl(req.xid));
-      break;
-    }
-    }
+  ssize_t len = recv(ev->fd, rx_buf, sizeof(rx_buf), MSG_DONTWAIT);
+  if (len < 0) {
+    if (errno == EINTR || errno == EAGAIN)
+      return;
+    /* veth gone with the old netns (reboot/stop) */
+    if (errno != ENETDOWN && errno != ESHUTDOWN && errno != ENXIO)
+      ds_warn("[DHCP] packet recv: %s", strerror(errno));
+    ds_dhcp_server_stop();
+    return;
   }
 
-out:
-  if (packet_sock >= 0)
-    close(packet_sock);
-  ctx->sock = -1;
-  ds_log("[DHCP] Server stopped on %s", ctx->iface);
-  return NULL;
+  dhcp_handle_frame(ctx, rx_buf, len);
 }
 
 /* ---------------------------------------------------------------------------
@@ -513,18 +440,12 @@ out:
 void ds_dhcp_server_start(struct ds_config *cfg, const char *veth_host,
                           uint32_t offer_ip_be, uint32_t gw_ip_be,
                           const uint8_t peer_mac[6]) {
-  pthread_mutex_lock(&g_dhcp_lock);
+  /* A reboot cycle replaces the previous cycle's server */
+  ds_dhcp_server_stop();
 
   memset(&g_dhcp, 0, sizeof(g_dhcp));
-  g_dhcp.sock = -1;
-  g_dhcp.stop_efd = eventfd(0, EFD_CLOEXEC);
-  if (g_dhcp.stop_efd < 0) {
-    ds_warn("[DHCP] eventfd failed: %s - aborting", strerror(errno));
-    pthread_mutex_unlock(&g_dhcp_lock);
-    return;
-  }
+  g_dhcp.ev.fd = -1;
   g_dhcp.netmask_be = htonl(0xFFFF0000u); /* /16 */
-  g_dhcp.stop = 0;
   safe_strncpy(g_dhcp.iface, veth_host, sizeof(g_dhcp.iface));
   g_dhcp.offer_ip_be = offer_ip_be;
   g_dhcp.gw_ip_be = gw_ip_be;
@@ -589,66 +510,50 @@ void ds_dhcp_server_start(struct ds_config *cfg, const char *veth_host,
     }
   }
 
-  /* ── No sockets created here ────────────────────────────────────────── */
-  /* We build and bind all sockets inside dhcp_server_loop. This is cleaner
-   * and avoids having two threads access ctx->sock during teardown/start. */
-  g_dhcp.sock = -1;
-
-  /* ── Init startup synchronization ───────────────────────────────────── */
-  g_dhcp.ready = 0;
-  pthread_cond_init(&g_dhcp.ready_cond, NULL);
-
-  /* ── Spawn joinable thread ─────────────────────────────────────────── */
-  /* Joinable (default) so ds_dhcp_server_stop() can pthread_join() and
-   * guarantee the thread has fully exited before the next start() call
-   * calls memset(&g_dhcp, 0).  A detached thread could still be running
-   * when memset fires, corrupting its own context mid-loop. */
-  if (pthread_create(&g_dhcp.tid, NULL, dhcp_server_loop, &g_dhcp) != 0) {
-    ds_warn("[DHCP] pthread_create: %s", strerror(errno));
-    g_dhcp.sock = -1;
-    pthread_mutex_unlock(&g_dhcp_lock);
+  struct in_addr tmp_addr;
+  tmp_addr.s_addr = g_dhcp.offer_ip_be;
+  if (!inet_ntop(AF_INET, &tmp_addr, g_dhcp.offer_str,
+                 sizeof(g_dhcp.offer_str)))
+    g_dhcp.offer_str[0] = '\0';
+
+  /* AF_PACKET socket for SNIFFING EVERYTHING.
+   * We use SOCK_RAW + ETH_P_ALL to ensure NO kernel filtering hidden from us.
+   */
+  int packet_sock =
+      socket(AF_PACKET, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC,
+             htons(ETH_P_ALL));
+  if (packet_sock < 0) {
+    ds_warn("[DHCP] packet socket: %s", strerror(errno));
     return;
   }
 
-  /* Block until the thread has bound its socket and emitted the
-   * "DHCP Server started" log line (or failed).  This guarantees that
-   * all subsequent caller logs - port forwards, boot message, foreground
-   * prompt - are always sequenced strictly after the DHCP line.
-   *
-   * pthread_cond_wait atomically releases g_dhcp_lock while sleeping,
-   * so the DHCP thread can acquire it to set ready=1 and signal us. */
-  while (!g_dhcp.ready)
-    pthread_cond_wait(&g_dhcp.ready_cond, &g_dhcp_lock);
+  struct sockaddr_ll sll;
+  memset(&sll, 0, sizeof(sll));
+  sll.sll_family = AF_PACKET;
+  sll.sll_ifindex = (int)if_nametoindex(g_dhcp.iface);
+  sll.sll_protocol = htons(ETH_P_ALL);
+  g_dhcp.ifindex = sll.sll_ifindex;
 
-  pthread_mutex_unlock(&g_dhcp_lock);
-}
+  if (bind(packet_sock, (struct sockaddr *)&sll, sizeof(sll)) < 0) {
+    ds_warn("[DHCP] packet bind(%s): %s", g_dhcp.iface, strerror(errno));
+    close(packet_sock);
+    return;
+  }
 
-void ds_dhcp_server_stop(void) {
-  pthread_mutex_lock(&g_dhcp_lock);
-
-  if (g_dhcp.tid != 0) {
-    g_dhcp.stop = 1;
-    if (g_dhcp.stop_efd >= 0) {
-      uint64_t val = 1;
-      if (write(g_dhcp.stop_efd, &val, sizeof(val)) < 0) {
-        /* If write fails, we still proceed to join; poll would eventually
-         * timeout or error */
-      }
-    }
+  if (ds_ev_add(&g_dhcp.ev, packet_sock, EPOLLIN, dhcp_on_packet, &g_dhcp) <
+      0) {
+    ds_warn("[DHCP] event loop: %s", strerror(errno));
+    close(packet_sock);
+    return;
   }
 
-  pthread_t tid = g_dhcp.tid;
-  pthread_mutex_unlock(&g_dhcp_lock);
+  ds_log("DHCP Server started on %s  offer=%s", g_dhcp.iface,
+         g_dhcp.offer_str);
+}
 
-  if (tid != 0) {
-    pthread_join(tid, NULL);
-    pthread_mutex_lock(&g_dhcp_lock);
-    g_dhcp.tid = 0;
-    if (g_dhcp.stop_efd >= 0) {
-      close(g_dhcp.stop_efd);
-      g_dhcp.stop_efd = -1;
-    }
-    pthread_cond_destroy(&g_dhcp.ready_cond);
-    pthread_mutex_unlock(&g_dhcp_lock);
-  }
+void ds_dhcp_server_stop(void) {
+  if (g_dhcp.ev.fd < 0)
+    return;
+  ds_ev_close(&g_dhcp.ev);
+  ds_log("[DHCP] Server stopped on %s", g_dhcp.iface);
 }
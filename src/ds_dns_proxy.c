@@ -30,6 +30,12 @@
  *   3. Fallback: /etc/resolv.conf (loopback stubs are skipped)
  *   4. Last resort: DS_DNS_DEFAULT_1 / DS_DNS_DEFAULT_2
  *
+ * The proxy is a set of sources on the monitor's event loop (ds_evloop.c):
+ * the listening socket, one connected UDP socket per in-flight query and a
+ * timerfd armed only while queries are outstanding.  Nothing wakes up while
+ * the container is not resolving anything, and a slow upstream never stalls
+ * the other queries or the rest of the monitor.
+ *
  * When the route monitor switches upstream interfaces (wifi ↔ mobile data),
  * ds_dns_proxy_update_upstream() is called with the new interface name and
  * re-probes DNS in-process - no container restart required.
@@ -48,16 +54,16 @@
 #include <arpa/inet.h>
 #include <net/if.h>
 #include <netinet/in.h>
-#include <poll.h>
 
 /* DNS wire protocol - max UDP payload per RFC 1035 §2.3.4 */
 #define DNS_UDP_MAX 512
 /* Max buffer for upstream reply (EDNS0 can exceed 512 bytes) */
 #define DNS_REPLY_MAX 4096
-/* Upstream reply timeout */
-#define DNS_TIMEOUT_SEC 3
-/* Poll interval for stop-flag check (ms) */
-#define DNS_POLL_MS 200
+/* Upstream reply timeout (per server tried) */
+#define DNS_TIMEOUT_MS 3000
+/* Queries awaiting an upstream reply at once; more are dropped (the
+ * container's resolver retries) */
+#define DNS_MAX_INFLIGHT 32
 /* Buffer for one NetworkAgentInfo line from dumpsys (can be very long) */
 #define DUMPSYS_LINE_MAX 131072
 
@@ -65,20 +71,32 @@
  * Module state - one context per monitor process
  * ---------------------------------------------------------------------------*/
 
+/* One forwarded query: its own connected upstream socket, so the reply (or
+ * an ICMP refusal) comes back on a descriptor that identifies it */
+struct dns_pending {
+  struct ds_ev ev;         /* upstream socket, fd -1 = free slot */
+  in_addr_t upstream[2];   /* servers snapshotted when the query arrived */
+  int tries;               /* servers tried so far */
+  struct timespec deadline;
+  struct sockaddr_in client;
+  socklen_t clen;
+  size_t qlen;
+  uint8_t query[DNS_UDP_MAX];
+};
+
 typedef struct {
-  int sock;
-  in_addr_t dns1; /* current primary upstream, host order */
-  in_addr_t dns2; /* current secondary upstream           */
-  pthread_mutex_t dns_mutex;
-  volatile sig_atomic_t stop;
-  pthread_t tid;
+  struct ds_ev listen; /* DS_NAT_GW_IP:53 */
+  struct ds_ev timer;  /* armed while any query is in flight */
+  in_addr_t dns1;      /* current primary upstream   */
+  in_addr_t dns2;      /* current secondary upstream */
   pid_t container_pid;
   in_addr_t last_warn_v4; /* rate-limit per IP */
   time_t last_warn_time;  /* rate-limit threshold */
+  struct dns_pending pending[DNS_MAX_INFLIGHT];
 } ds_dns_proxy_ctx_t;
 
-static ds_dns_proxy_ctx_t g_proxy = {.sock = -1};
-static pthread_mutex_t g_proxy_lock = PTHREAD_MUTEX_INITIALIZER;
+static ds_dns_proxy_ctx_t g_proxy = {.listen = {.fd = -1},
+                                     .timer = {.fd = -1}};
 
 /* ---------------------------------------------------------------------------
  * Upstream DNS discovery
@@ -255,105 +273,173 @@ fill_missing:
 }
 
 /* ---------------------------------------------------------------------------
- * Forward one DNS query to upstream and return the reply.
- * Returns reply length on success, -1 on timeout or error.
+ * Query forwarding (event loop callbacks)
  * ---------------------------------------------------------------------------*/
-static ssize_t forward_dns_query(in_addr_t upstream, const uint8_t *query,
-                                 size_t qlen, uint8_t *reply_buf,
-                                 size_t reply_sz) {
-  int fwd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-  if (fwd < 0)
-    return -1;
-
-  struct timeval tv = {.tv_sec = DNS_TIMEOUT_SEC, .tv_usec = 0};
-  setsockopt(fwd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-  setsockopt(fwd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
-
-  struct sockaddr_in dst;
-  memset(&dst, 0, sizeof(dst));
-  dst.sin_family = AF_INET;
-  dst.sin_port = htons(53);
-  dst.sin_addr.s_addr = upstream;
-
-  ssize_t ret = -1;
-  if (sendto(fwd, query, qlen, 0, (struct sockaddr *)&dst, sizeof(dst)) ==
-      (ssize_t)qlen)
-    ret = recv(fwd, reply_buf, reply_sz, 0);
-
-  close(fwd);
-  return (ret > 0) ? ret : -1;
+
+static long ms_until(const struct timespec *t, const struct timespec *now) {
+  return (long)(t->tv_sec - now->tv_sec) * 1000 +
+         (t->tv_nsec - now->tv_nsec) / 1000000;
 }
 
-/* ---------------------------------------------------------------------------
- * Proxy thread loop
- * ---------------------------------------------------------------------------*/
-static void *dns_proxy_loop(void *arg) {
-  ds_dns_proxy_ctx_t *ctx = (ds_dns_proxy_ctx_t *)arg;
-  ds_log("[DNS] Proxy started on " DS_NAT_GW_IP ":53");
+/* Arm the timer for the earliest outstanding deadline, or disarm it */
+static void dns_rearm_timer(ds_dns_proxy_ctx_t *ctx) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
 
-  uint8_t query[DNS_UDP_MAX];
-  uint8_t reply[DNS_REPLY_MAX];
-  struct pollfd pfd = {.fd = ctx->sock, .events = POLLIN};
-
-  while (!ctx->stop) {
-    int pr = poll(&pfd, 1, DNS_POLL_MS);
-    if (pr < 0) {
-      if (errno == EINTR)
-        continue;
-      break;
+  long next = -1;
+  for (int i = 0; i < DNS_MAX_INFLIGHT; i++) {
+    if (ctx->pending[i].ev.fd < 0)
+      continue;
+    long ms = ms_until(&ctx->pending[i].deadline, &now);
+    if (next < 0 || ms < next)
+      next = ms;
+  }
+  /* 0 would disarm: an already-expired deadline fires in 1 ms */
+  ds_ev_timer_arm(&ctx->timer, next < 0 ? 0 : (next < 1 ? 1 : next), 0);
+}
+
+static void dns_on_reply(struct ds_ev *ev, uint32_t events);
+
+/* Send p's query to its next upstream.  Returns 0 if one is in flight. */
+static int dns_send_next(ds_dns_proxy_ctx_t *ctx, struct dns_pending *p) {
+  ds_ev_close(&p->ev);
+
+  while (p->tries < 2) {
+    in_addr_t up = p->upstream[p->tries++];
+    if (up == 0 || up == (in_addr_t)(-1))
+      continue;
+
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                    IPPROTO_UDP);
+    if (fd < 0)
+      return -1;
+
+    struct sockaddr_in dst;
+    memset(&dst, 0, sizeof(dst));
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons(53);
+    dst.sin_addr.s_addr = up;
+
+    if (connect(fd, (struct sockaddr *)&dst, sizeof(dst)) < 0 ||
+        send(fd, p->query, p->qlen, 0) != (ssize_t)p->qlen ||
+        ds_ev_add(&p->ev, fd, EPOLLIN, dns_on_reply, ctx) < 0) {
+      close(fd);
+      continue;
     }
-    if (pr == 0)
-      continue; /* timeout - recheck stop flag */
-
-    struct sockaddr_in client;
-    socklen_t clen = sizeof(client);
-    ssize_t qlen = recvfrom(ctx->sock, query, sizeof(query), 0,
-                            (struct sockaddr *)&client, &clen);
-    if (qlen < 0) {
-      if (ctx->stop)
-        break;
-      if (errno == EINTR || errno == EAGAIN)
-        continue;
-      ds_warn("[DNS] recvfrom: %s", strerror(errno));
-      break;
+
+    clock_gettime(CLOCK_MONOTONIC, &p->deadline);
+    p->deadline.tv_sec += DNS_TIMEOUT_MS / 1000;
+    p->deadline.tv_nsec += (DNS_TIMEOUT_MS % 1000) * 1000000L;
+    if (p->deadline.tv_nsec >= 1000000000L) {
+      p->deadline.tv_sec++;
+      p->deadline.tv_nsec -= 1000000000L;
     }
-    if (qlen < 12)
-      continue; /* too short to be a valid DNS header */
-
-    /* Snapshot current upstream servers under mutex */
-    pthread_mutex_lock(&ctx->dns_mutex);
-    in_addr_t d1 = ctx->dns1;
-    in_addr_t d2 = ctx->dns2;
-    pthread_mutex_unlock(&ctx->dns_mutex);
-
-    /* Try primary, then secondary on failure */
-    ssize_t rlen =
-        forward_dns_query(d1, query, (size_t)qlen, reply, sizeof(reply));
-    if (rlen < 0 && d2 != 0 && d2 != d1)
-      rlen = forward_dns_query(d2, query, (size_t)qlen, reply, sizeof(reply));
-
-    if (rlen < 0) {
-      char s[INET_ADDRSTRLEN];
-      struct in_addr ia;
-      ia.s_addr = d1;
-      inet_ntop(AF_INET, &ia, s, sizeof(s));
-
-      time_t now = time(NULL);
-      if (d1 != ctx->last_warn_v4 || (now - ctx->last_warn_time) > 30) {
-        ds_warn("[DNS] Upstream %s timed out - dropping query", s);
-        ctx->last_warn_v4 = d1;
-        ctx->last_warn_time = now;
-      }
+    return 0;
+  }
+  return -1;
+}
+
+/* Every upstream failed: drop the query with a rate-limited warning */
+static void dns_give_up(ds_dns_proxy_ctx_t *ctx, struct dns_pending *p) {
+  ds_ev_close(&p->ev);
+
+  char s[INET_ADDRSTRLEN];
+  struct in_addr ia;
+  ia.s_addr = p->upstream[0];
+  inet_ntop(AF_INET, &ia, s, sizeof(s));
+
+  time_t now = time(NULL);
+  if (p->upstream[0] != ctx->last_warn_v4 ||
+      (now - ctx->last_warn_time) > 30) {
+    ds_warn("[DNS] Upstream %s timed out - dropping query", s);
+    ctx->last_warn_v4 = p->upstream[0];
+    ctx->last_warn_time = now;
+  }
+}
+
+static void dns_on_reply(struct ds_ev *ev, uint32_t events) {
+  (void)events;
+  ds_dns_proxy_ctx_t *ctx = ev->arg;
+  struct dns_pending *p = (struct dns_pending *)ev;
+  uint8_t reply[DNS_REPLY_MAX];
+
+  ssize_t rlen = recv(ev->fd, reply, sizeof(reply), 0);
+  if (rlen < 0 && (errno == EAGAIN || errno == EINTR))
+    return;
+
+  if (rlen <= 0) {
+    /* ECONNREFUSED & co: fail over now rather than at the deadline */
+    if (dns_send_next(ctx, p) < 0)
+      dns_give_up(ctx, p);
+    dns_rearm_timer(ctx);
+    return;
+  }
+
+  ds_dbg(DNS, "Query id=%02x%02x %zu bytes → reply %zd bytes", p->query[0],
+         p->query[1], p->qlen, rlen);
+  sendto(ctx->listen.fd, reply, (size_t)rlen, 0,
+         (struct sockaddr *)&p->client, p->clen);
+  ds_ev_close(&p->ev);
+  dns_rearm_timer(ctx);
+}
+
+static void dns_on_timer(struct ds_ev *ev, uint32_t events) {
+  (void)events;
+  ds_dns_proxy_ctx_t *ctx = ev->arg;
+  ds_ev_timer_ack(ev);
+
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  for (int i = 0; i < DNS_MAX_INFLIGHT; i++) {
+    struct dns_pending *p = &ctx->pending[i];
+    if (p->ev.fd < 0 || ms_until(&p->deadline, &now) > 0)
       continue;
-    }
+    if (dns_send_next(ctx, p) < 0)
+      dns_give_up(ctx, p);
+  }
+  dns_rearm_timer(ctx);
+}
 
-    sendto(ctx->sock, reply, (size_t)rlen, 0, (struct sockaddr *)&client, clen);
+static void dns_on_query(struct ds_ev *ev, uint32_t events) {
+  (void)events;
+  ds_dns_proxy_ctx_t *ctx = ev->arg;
+  uint8_t query[DNS_UDP_MAX];
+  struct sockaddr_in client;
+  socklen_t clen = sizeof(client);
+
+  ssize_t qlen = recvfrom(ev->fd, query, sizeof(query), 0,
+                          (struct sockaddr *)&client, &clen);
+  if (qlen < 0) {
+    if (errno == EINTR || errno == EAGAIN)
+      return;
+    ds_warn("[DNS] recvfrom: %s", strerror(errno));
+    ds_dns_proxy_stop();
+    return;
+  }
+  if (qlen < 12)
+    return; /* too short to be a valid DNS header */
+
+  struct dns_pending *p = NULL;
+  for (int i = 0; i < DNS_MAX_INFLIGHT && !p; i++)
+    if (ctx->pending[i].ev.fd < 0)
+      p = &ctx->pending[i];
+  if (!p) {
+    ds_dbg(DNS, "Query id=%02x%02x dropped: %d queries in flight", query[0],
+           query[1], DNS_MAX_INFLIGHT);
+    return;
   }
 
-  close(ctx->sock);
-  ctx->sock = -1;
-  ds_log("[DNS] Proxy stopped");
-  return NULL;
+  p->upstream[0] = ctx->dns1;
+  p->upstream[1] = ctx->dns2 != ctx->dns1 ? ctx->dns2 : 0;
+  p->tries = 0;
+  p->client = client;
+  p->clen = clen;
+  p->qlen = (size_t)qlen;
+  memcpy(p->query, query, (size_t)qlen);
+
+  if (dns_send_next(ctx, p) < 0)
+    dns_give_up(ctx, p);
+  dns_rearm_timer(ctx);
 }
 
 /* ---------------------------------------------------------------------------
@@ -365,13 +451,13 @@ void ds_dns_proxy_start(struct ds_config *cfg, pid_t container_pid) {
   if (!cfg || cfg->net_mode != DS_NET_NAT || cfg->dns_servers[0])
     return;
 
-  pthread_mutex_lock(&g_proxy_lock);
+  ds_dns_proxy_stop();
 
   memset(&g_proxy, 0, sizeof(g_proxy));
-  g_proxy.sock = -1;
-  g_proxy.stop = 0;
+  g_proxy.listen.fd = g_proxy.timer.fd = -1;
+  for (int i = 0; i < DNS_MAX_INFLIGHT; i++)
+    g_proxy.pending[i].ev.fd = -1;
   g_proxy.container_pid = container_pid;
-  pthread_mutex_init(&g_proxy.dns_mutex, NULL);
 
   /* Probe initial upstream DNS.
    *
@@ -452,10 +538,11 @@ void ds_dns_proxy_start(struct ds_config *cfg, pid_t container_pid) {
   /* Create UDP socket bound to 172.28.0.1:53.
    * We bind to the specific gateway IP so the socket only receives queries
    * from the container - no accidental interception of host DNS traffic. */
-  int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  int sock =
+      socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
   if (sock < 0) {
     ds_warn("[DNS] socket: %s - proxy disabled", strerror(errno));
-    goto unlock;
+    return;
   }
 
   int one = 1;
@@ -472,33 +559,29 @@ void ds_dns_proxy_start(struct ds_config *cfg, pid_t container_pid) {
     ds_warn("[DNS] bind(" DS_NAT_GW_IP ":53): %s - proxy disabled",
             strerror(errno));
     close(sock);
-    goto unlock;
+    return;
   }
 
-  g_proxy.sock = sock;
-
-  /* Joinable - ds_dns_proxy_stop() does pthread_join() to guarantee
-   * the thread has fully exited before the next start() call. */
-  if (pthread_create(&g_proxy.tid, NULL, dns_proxy_loop, &g_proxy) != 0) {
-    ds_warn("[DNS] pthread_create: %s - proxy disabled", strerror(errno));
+  if (ds_ev_timer_add(&g_proxy.timer, 0, 0, dns_on_timer, &g_proxy) < 0 ||
+      ds_ev_add(&g_proxy.listen, sock, EPOLLIN, dns_on_query, &g_proxy) < 0) {
+    ds_warn("[DNS] event loop: %s - proxy disabled", strerror(errno));
+    ds_ev_close(&g_proxy.timer);
     close(sock);
-    g_proxy.sock = -1;
+    return;
   }
 
-unlock:
-  pthread_mutex_unlock(&g_proxy_lock);
+  ds_log("[DNS] Proxy started on " DS_NAT_GW_IP ":53");
 }
 
 void ds_dns_proxy_stop(void) {
-  pthread_mutex_lock(&g_proxy_lock);
-  g_proxy.stop = 1;
-  pthread_t tid = g_proxy.tid;
-  if (g_proxy.sock >= 0)
-    shutdown(g_proxy.sock, SHUT_RDWR); /* unblocks poll/recvfrom */
-  pthread_mutex_unlock(&g_proxy_lock);
-
-  if (tid != 0)
-    pthread_join(tid, NULL); /* wait fully before memset in next start() */
+  if (g_proxy.listen.fd < 0)
+    return;
+
+  for (int i = 0; i < DNS_MAX_INFLIGHT; i++)
+    ds_ev_close(&g_proxy.pending[i].ev);
+  ds_ev_close(&g_proxy.timer);
+  ds_ev_close(&g_proxy.listen);
+  ds_log("[DNS] Proxy stopped");
 }
 
 void ds_dns_proxy_update_upstream(const char *new_iface) {
@@ -507,20 +590,14 @@ void ds_dns_proxy_update_upstream(const char *new_iface) {
    * ISP DNS for that interface and updates the proxy's in-memory servers.
    * The container's resolv.conf still points to 172.28.0.1 - no restart
    * or resolv.conf rewrite needed from the container's perspective. */
-  pthread_mutex_lock(&g_proxy_lock);
-  int running = (g_proxy.sock >= 0 && g_proxy.tid != 0 && !g_proxy.stop);
-  pthread_mutex_unlock(&g_proxy_lock);
-
-  if (!running)
+  if (g_proxy.listen.fd < 0)
     return;
 
   char dns1[INET_ADDRSTRLEN], dns2[INET_ADDRSTRLEN];
   probe_upstream_dns(new_iface, dns1, dns2);
 
-  pthread_mutex_lock(&g_proxy.dns_mutex);
   g_proxy.dns1 = inet_addr(dns1);
   g_proxy.dns2 = inet_addr(dns2);
-  pthread_mutex_unlock(&g_proxy.dns_mutex);
 
   ds_log("[DNS] Upstream updated (iface=%s): %s / %s",
          new_iface ? new_iface : "?", dns1, dns2[0] ? dns2 : "(none)");
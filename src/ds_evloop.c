@@ -0,0 +1,197 @@
+/*
+ * Droidspaces v5 - High-performance Container Runtime
+ *
+ * ds_evloop.c - Single epoll loop for the monitor process.
+ *
+ * Everything the monitor serves after boot - the signalfd that reports the
+ * intermediate's exit, the entry socket, hot-plug uevents, and in NAT mode
+ * the DHCP server, DNS proxy and upstream route monitor - is a file
+ * descriptor registered here and dispatched from one epoll_wait() in the
+ * monitor's main thread.  Periodic work uses timerfds, so an idle monitor
+ * sleeps in the kernel until something actually happens.
+ *
+ * Sources are caller-owned struct ds_ev records (module statics), so a
+ * callback may remove or re-add any source, including itself.  Every
+ * registered descriptor is non-blocking, and callbacks should not block
+ * for long: while one runs, the DNS proxy and DHCP server answer nobody.
+ * Callbacks that do synchronous work:
+ *   - ds_entry_serve(): one request, bounded by the entry socket timeout
+ *   - ds_hotplug_process(): mknod/chown in the container's /dev
+ *   - ds_virtualize_update(): rewrites the virtualized /proc files
+ *   - the route monitor: on an upstream switch (Android), re-probing the
+ *     ISP DNS runs `dumpsys connectivity` and waits for it
+ *
+ * The loop itself only returns when ds_ev_stop() writes the shutdown
+ * eventfd.
+ *
+ * Copyright (C) 2026 ravindu644 <droidcasts@protonmail.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "droidspace.h"
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#define EV_BATCH 16
+
+static int g_epfd = -1;
+static struct ds_ev g_stop_ev = {.fd = -1};
+
+/* ---------------------------------------------------------------------------
+ * Setup
+ * ---------------------------------------------------------------------------*/
+
+static void stop_drain(struct ds_ev *ev, uint32_t events) {
+  (void)ev;
+  (void)events;
+}
+
+int ds_ev_init(void) {
+  if (g_epfd >= 0)
+    return 0;
+
+  g_epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (g_epfd < 0)
+    return -1;
+
+  int efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (efd < 0 || ds_ev_add(&g_stop_ev, efd, EPOLLIN, stop_drain, NULL) < 0) {
+    int saved = errno;
+    if (efd >= 0)
+      close(efd);
+    close(g_epfd);
+    g_epfd = -1;
+    errno = saved;
+    return -1;
+  }
+  return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * Sources
+ * ---------------------------------------------------------------------------*/
+
+int ds_ev_add(struct ds_ev *ev, int fd, uint32_t events, ds_ev_cb cb,
+              void *arg) {
+  if (g_epfd < 0 || fd < 0) {
+    errno = g_epfd < 0 ? ENOTCONN : EBADF;
+    return -1;
+  }
+
+  ev->fd = fd;
+  ev->cb = cb;
+  ev->arg = arg;
+
+  struct epoll_event e = {.events = events, .data.ptr = ev};
+  if (epoll_ctl(g_epfd, EPOLL_CTL_ADD, fd, &e) < 0) {
+    ev->fd = -1;
+    return -1;
+  }
+  return 0;
+}
+
+/* Must run before close(fd): the intermediate fork may hold a duplicate of
+ * the descriptor, which would keep a closed-but-registered fd firing. */
+void ds_ev_del(struct ds_ev *ev) {
+  if (ev->fd < 0)
+    return;
+  if (g_epfd >= 0)
+    epoll_ctl(g_epfd, EPOLL_CTL_DEL, ev->fd, NULL);
+  ev->fd = -1;
+}
+
+void ds_ev_close(struct ds_ev *ev) {
+  int fd = ev->fd;
+  ds_ev_del(ev);
+  if (fd >= 0)
+    close(fd);
+}
+
+/* ---------------------------------------------------------------------------
+ * Timers
+ * ---------------------------------------------------------------------------*/
+
+static struct timespec ms_to_ts(long ms) {
+  struct timespec ts = {.tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000L};
+  return ts;
+}
+
+int ds_ev_timer_add(struct ds_ev *ev, long first_ms, long interval_ms,
+                    ds_ev_cb cb, void *arg) {
+  int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+  if (tfd < 0)
+    return -1;
+  if (ds_ev_add(ev, tfd, EPOLLIN, cb, arg) < 0) {
+    close(tfd);
+    return -1;
+  }
+  ds_ev_timer_arm(ev, first_ms, interval_ms);
+  return 0;
+}
+
+/* first_ms == 0 disarms; interval_ms == 0 makes it one-shot */
+void ds_ev_timer_arm(struct ds_ev *ev, long first_ms, long interval_ms) {
+  if (ev->fd < 0)
+    return;
+  struct itimerspec its = {.it_value = ms_to_ts(first_ms),
+                           .it_interval = ms_to_ts(interval_ms)};
+  timerfd_settime(ev->fd, 0, &its, NULL);
+}
+
+/* Consume the expiration count so a level-triggered timer stops firing */
+void ds_ev_timer_ack(struct ds_ev *ev) {
+  uint64_t n;
+  if (read(ev->fd, &n, sizeof(n)) < 0) {
+    /* EAGAIN: a stale event for a re-armed timer - nothing to consume */
+  }
+}
+
+/* ---------------------------------------------------------------------------
+ * Dispatch
+ * ---------------------------------------------------------------------------*/
+
+int ds_ev_run(void) {
+  if (g_epfd < 0) {
+    errno = ENOTCONN;
+    return -1;
+  }
+
+  struct epoll_event evs[EV_BATCH];
+  while (1) {
+    int n = epoll_wait(g_epfd, evs, EV_BATCH, -1);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      ds_warn("[EV] epoll_wait: %s", strerror(errno));
+      return -1;
+    }
+
+    int stop = 0;
+    for (int i = 0; i < n; i++) {
+      struct ds_ev *ev = evs[i].data.ptr;
+      if (ev == &g_stop_ev) {
+        stop = 1;
+        continue;
+      }
+      /* Removed by an earlier callback in this batch */
+      if (ev->fd < 0)
+        continue;
+      ev->cb(ev, evs[i].events);
+    }
+
+    if (stop) {
+      uint64_t v;
+      if (read(g_stop_ev.fd, &v, sizeof(v)) < 0) {
+        /* Already drained */
+      }
+      return 0;
+    }
+  }
+}
+
+void ds_ev_stop(void) {
+  uint64_t one = 1;
+  if (g_stop_ev.fd >= 0 && write(g_stop_ev.fd, &one, sizeof(one)) < 0) {
+    /* Counter saturated: a stop is already pending */
+  }
+}
@@ -53,27 +53,73 @@ void parse_cidr(const char *cidr, uint32_t *ip_out, uint32_t *mask_out) {
 
 /* ---------------------------------------------------------------------------
  * Module loader - best-effort, harmless on built-in or absent modprobe
+ *
+ * A module counts as present when it shows up in /sys/module (under its own
+ * name or its modern alias) or its table is already registered in
+ * /proc/net/ip_tables_names; only the rest are handed to modprobe. The pass
+ * runs once per boot: the host capability cache remembers it, so built-in
+ * modules that never appear in /sys/module cost one modprobe per boot
+ * instead of one per process.
  * ---------------------------------------------------------------------------*/
 
 static int modules_probed = 0;
 
+static struct {
+  char *name;        /* modprobe argv wants it non-const */
+  const char *alias; /* modern name of the same module, or NULL */
+  const char *table; /* table it registers, or NULL */
+} nf_modules[] = {
+    {"iptable_nat", NULL, "nat"},
+    {"iptable_filter", NULL, "filter"},
+    {"iptable_mangle", NULL, "mangle"},
+    {"ip_conntrack", "nf_conntrack", NULL},
+    {"xt_conntrack", NULL, NULL},
+    {"nf_nat", NULL, NULL},
+    {"xt_addrtype", NULL, NULL}, /* required for --dst-type LOCAL DNAT */
+};
+
+static int nf_module_loaded(const char *name) {
+  char path[64];
+  snprintf(path, sizeof(path), "/sys/module/%s", name);
+  return access(path, F_OK) == 0;
+}
+
+/* Is table a whole line of the ip_tables_names contents? */
+static int nf_table_listed(const char *tables, const char *table) {
+  size_t len = strlen(table);
+  for (const char *p = tables; (p = strstr(p, table)) != NULL; p += len) {
+    if ((p == tables || p[-1] == '\n') && (p[len] == '\n' || p[len] == '\0'))
+      return 1;
+  }
+  return 0;
+}
+
 static void probe_iptables_modules(void) {
   if (modules_probed)
     return;
   modules_probed = 1;
 
-  char *mods[] = {"iptable_nat",
-                  "iptable_filter",
-                  "iptable_mangle",
-                  "ip_conntrack",
-                  "xt_conntrack",
-                  "nf_nat",
-                  "xt_addrtype", /* required for --dst-type LOCAL DNAT */
-                  NULL};
-  for (int i = 0; mods[i]; i++) {
-    char *a[] = {"modprobe", "-q", mods[i], NULL};
+  if (ds_hostcap_get(DS_HOSTCAP_NF_LOADED) == 1)
+    return;
+
+  char tables[256];
+  if (read_file("/proc/net/ip_tables_names", tables, sizeof(tables)) < 0)
+    tables[0] = '\0';
+
+  int spawned = 0;
+  for (size_t i = 0; i < sizeof(nf_modules) / sizeof(nf_modules[0]); i++) {
+    if (nf_module_loaded(nf_modules[i].name) ||
+        (nf_modules[i].alias && nf_module_loaded(nf_modules[i].alias)) ||
+        (nf_modules[i].table && nf_table_listed(tables, nf_modules[i].table)))
+      continue;
+    char *a[] = {"modprobe", "-q", nf_modules[i].name, NULL};
     run_command_quiet(a);
+    spawned++;
   }
+  ds_dbg(IPT, "Netfilter modules: %d modprobe(s) this boot", spawned);
+
+  if (getuid() == 0)
+    ds_hostcap_set(DS_HOSTCAP_NF_LOADED, 1);
 }
 
 /* ---------------------------------------------------------------------------
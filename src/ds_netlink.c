@@ -191,42 +191,53 @@ int ds_nl_probe_nat_capability(char *reason, size_t rsz) {
     return -1;
   }
 
-  ds_nl_ctx_t *ctx = ds_nl_open();
-  if (!ctx) {
-    snprintf(reason, rsz, "Failed to open NETLINK_ROUTE socket: %s",
-             strerror(errno));
-    return -1;
-  }
-
-  /* ── Step 2: CONFIG_BRIDGE ── */
-  int has_bridge = 1;
-  const char *probe_br = "ds-cap-br0";
-  ret = ds_nl_create_bridge(ctx, probe_br);
-  if (ret < 0) {
-    if (ret == -EOPNOTSUPP) {
-      has_bridge = 0;
-      ds_log("[NET] CONFIG_BRIDGE not supported - will fallback to bridgeless "
-             "NAT");
-    } else {
-      snprintf(reason, rsz, "Bridge probe failed unexpectedly: %s",
-               strerror(-ret));
-      ds_nl_close(ctx);
+  /* Bridge and veth support come from the host capability cache once
+   * probed this boot; only unknown features cost a probe link. */
+  int has_bridge = ds_hostcap_get(DS_HOSTCAP_BRIDGE);
+  int has_veth = ds_hostcap_get(DS_HOSTCAP_VETH);
+  int veth_err = -EOPNOTSUPP; /* the only failure the cache records */
+
+  if (has_bridge < 0 || has_veth < 0) {
+    ds_nl_ctx_t *ctx = ds_nl_open();
+    if (!ctx) {
+      snprintf(reason, rsz, "Failed to open NETLINK_ROUTE socket: %s",
+               strerror(errno));
       return -1;
     }
-  }
 
-  /* ── Step 3: CONFIG_VETH ── */
-  ret = ds_nl_create_veth(ctx, "ds-cap-h0", "ds-cap-p0");
-  int has_veth = (ret == 0);
-  int veth_err = ret;
+    /* ── Step 2: CONFIG_BRIDGE ── */
+    const char *probe_br = "ds-cap-br0";
+    if (has_bridge < 0) {
+      ret = ds_nl_create_bridge(ctx, probe_br);
+      if (ret < 0 && ret != -EOPNOTSUPP) {
+        snprintf(reason, rsz, "Bridge probe failed unexpectedly: %s",
+                 strerror(-ret));
+        ds_nl_close(ctx);
+        return -1;
+      }
+      has_bridge = (ret == 0);
+      if (has_bridge)
+        ds_nl_del_link(ctx, probe_br);
+      ds_hostcap_set(DS_HOSTCAP_BRIDGE, has_bridge);
+    }
 
-  /* ── Cleanup Probe Interfaces ── */
-  if (has_bridge)
-    ds_nl_del_link(ctx, probe_br);
-  if (has_veth)
-    ds_nl_del_link(ctx, "ds-cap-h0");
+    /* ── Step 3: CONFIG_VETH ── */
+    if (has_veth < 0) {
+      ret = ds_nl_create_veth(ctx, "ds-cap-h0", "ds-cap-p0");
+      has_veth = (ret == 0);
+      veth_err = ret;
+      if (has_veth)
+        ds_nl_del_link(ctx, "ds-cap-h0");
+      if (ret == 0 || ret == -EOPNOTSUPP)
+        ds_hostcap_set(DS_HOSTCAP_VETH, has_veth);
+    }
+
+    ds_nl_close(ctx);
+  }
 
-  ds_nl_close(ctx);
+  if (!has_bridge)
+    ds_log("[NET] CONFIG_BRIDGE not supported - will fallback to bridgeless "
+           "NAT");
 
   if (!has_veth) {
     if (veth_err == -EOPNOTSUPP) {
@@ -0,0 +1,423 @@
+/*
+ * Droidspaces v5 - High-performance Container Runtime
+ *
+ * Copyright (C) 2026 ravindu644 <droidcasts@protonmail.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "droidspace.h"
+
+/* ---------------------------------------------------------------------------
+ * Entry descriptor
+ *
+ * Without it, every enter/run validates the pidfile and re-parses the env
+ * file. It also walks mountinfo plus /proc/<pid>/cgroup once per hierarchy
+ * to find its cgroup, then opens each /proc/<pid>/ns/<type> before it can
+ * setns().
+ * The monitor already knows all of that for the life of a boot cycle.
+ *
+ * So, once init is up, the monitor opens the namespace fds and the ds-enter
+ * cgroup parent directories once.  It then hands them out over an abstract
+ * socket, @droidspaces-entry/<name>, together with the resolved env block.
+ * A client only has to setns() and exec.  Anything unexpected (no monitor,
+ * old monitor, a reboot in progress) makes ds_entry_fetch() fail and the
+ * caller falls back to the full path.
+ *
+ * Abstract names are scoped to the network namespace, so root inside a
+ * host-net container can reach (or squat) the socket.  Both ends therefore
+ * require a root peer that shares their mount and PID namespaces.
+ *
+ * Wire format, one connection per request:
+ *   client → monitor: u32 length, then that many bytes (ignored; always 0
+ *                     now, kept so either side of a version skew reads a
+ *                     whole request and fails the version check cleanly)
+ *   monitor → client: struct entry_wire + SCM_RIGHTS(ns fds, cgroup fds),
+ *                     then path_len bytes of the monitor's env_file path,
+ *                     then env_len bytes of "KEY=VALUE\0" entries
+ * ---------------------------------------------------------------------------*/
+
+#define DS_ENTRY_SOCK_PREFIX "droidspaces-entry/"
+#define DS_ENTRY_MAGIC 0x4e455344u /* "DSEN" */
+#define DS_ENTRY_VERSION 2
+#define DS_ENTRY_TIMEOUT_MS 1000
+#define DS_ENTRY_MAX_FDS (DS_NS_COUNT + DS_ENTRY_MAX_CG)
+
+struct entry_wire {
+  uint32_t magic;
+  uint32_t version;
+  int32_t init_pid;
+  uint32_t ns_mask; /* bit i: ns_fds[i] is present in SCM_RIGHTS */
+  uint32_t cg_count;
+  uint32_t env_count;
+  uint32_t path_len;
+  uint64_t env_len;
+};
+
+/* Monitor-side state: the published descriptor, the container's env_file
+ * and the block it was last resolved to (re-parsed only when it changes) */
+static struct ds_entry_desc g_entry = {.init_pid = 0};
+static char g_entry_env_file[PATH_MAX];
+static struct {
+  char path[PATH_MAX];
+  dev_t dev;
+  ino_t ino;
+  off_t size;
+  struct timespec mtime;
+  char *block;
+  size_t len;
+  int count;
+} g_entry_env;
+
+static socklen_t entry_addr(const char *container_name,
+                            struct sockaddr_un *addr) {
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+
+  /* Abstract name; names too long for sun_path are hashed (FNV-1a) */
+  char name[sizeof(addr->sun_path) - 1];
+  size_t max = sizeof(name) - sizeof(DS_ENTRY_SOCK_PREFIX);
+  if (strlen(container_name) <= max) {
+    snprintf(name, sizeof(name), DS_ENTRY_SOCK_PREFIX "%s", container_name);
+  } else {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (const char *p = container_name; *p; p++)
+      h = (h ^ (unsigned char)*p) * 0x100000001b3ULL;
+    snprintf(name, sizeof(name), DS_ENTRY_SOCK_PREFIX "#%016llx",
+             (unsigned long long)h);
+  }
+
+  size_t nlen = strlen(name);
+  memcpy(addr->sun_path + 1, name, nlen);
+  return (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + nlen);
+}
+
+static void entry_set_timeout(int fd) {
+  struct timeval tv = {.tv_sec = DS_ENTRY_TIMEOUT_MS / 1000,
+                       .tv_usec = (DS_ENTRY_TIMEOUT_MS % 1000) * 1000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+static int entry_read_exact(int fd, void *buf, size_t n) {
+  char *p = buf;
+  while (n > 0) {
+    ssize_t r = read(fd, p, n);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      return -1;
+    p += r;
+    n -= (size_t)r;
+  }
+  return 0;
+}
+
+static int entry_same_ns(pid_t pid, const char *ns) {
+  char path[64];
+  struct stat self_st, peer_st;
+  snprintf(path, sizeof(path), "/proc/self/ns/%s", ns);
+  if (stat(path, &self_st) < 0)
+    return 0;
+  snprintf(path, sizeof(path), "/proc/%d/ns/%s", (int)pid, ns);
+  if (stat(path, &peer_st) < 0)
+    return 0;
+  return self_st.st_dev == peer_st.st_dev && self_st.st_ino == peer_st.st_ino;
+}
+
+/* Root on the host side of the container boundary, not merely root */
+static int entry_peer_trusted(int fd) {
+  struct ucred cred;
+  socklen_t clen = sizeof(cred);
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &clen) < 0 ||
+      cred.uid != 0 || cred.pid <= 0)
+    return 0;
+  return entry_same_ns(cred.pid, "mnt") && entry_same_ns(cred.pid, "pid");
+}
+
+/* ---------------------------------------------------------------------------
+ * Monitor side
+ * ---------------------------------------------------------------------------*/
+
+/* Bind the entry socket.  Returns a non-blocking listening fd, or -1 (the
+ * container then simply runs without the fast path). */
+int ds_entry_listen(const char *container_name) {
+  struct sockaddr_un addr;
+  socklen_t alen = entry_addr(container_name, &addr);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (fd < 0)
+    return -1;
+  if (bind(fd, (struct sockaddr *)&addr, alen) < 0 || listen(fd, 16) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/* Cache the descriptor for the current boot cycle */
+void ds_entry_publish(struct ds_config *cfg, pid_t init_pid, int in_cgns) {
+  ds_entry_unpublish();
+
+  int prev_silent = ds_log_silent;
+  ds_log_silent = 1;
+  int ok = open_namespace_fds(init_pid, g_entry.ns_fds) == 0;
+  ds_log_silent = prev_silent;
+  if (!ok)
+    return;
+
+  g_entry.cg_count = ds_cgroup_open_attach_dirs(
+      cfg->container_name, init_pid, in_cgns, g_entry.cg_fds, DS_ENTRY_MAX_CG);
+  safe_strncpy(g_entry_env_file, cfg->env_file, sizeof(g_entry_env_file));
+  g_entry.init_pid = init_pid;
+}
+
+/* Drop the descriptor (init exited: reboot or shutdown) */
+void ds_entry_unpublish(void) {
+  if (g_entry.init_pid > 0)
+    ds_entry_release(&g_entry);
+  for (int i = 0; i < DS_NS_COUNT; i++)
+    g_entry.ns_fds[i] = -1;
+  g_entry.cg_count = 0;
+  g_entry.init_pid = 0;
+}
+
+/* Return the env block for path, re-parsing only when the file changed */
+static void entry_resolve_env(const char *path) {
+  struct stat st;
+  int have = path[0] && stat(path, &st) == 0;
+
+  if (strcmp(path, g_entry_env.path) == 0 &&
+      (!have ||
+       (st.st_dev == g_entry_env.dev && st.st_ino == g_entry_env.ino &&
+        st.st_size == g_entry_env.size &&
+        st.st_mtim.tv_sec == g_entry_env.mtime.tv_sec &&
+        st.st_mtim.tv_nsec == g_entry_env.mtime.tv_nsec)))
+    return;
+
+  free(g_entry_env.block);
+  memset(&g_entry_env, 0, sizeof(g_entry_env));
+  safe_strncpy(g_entry_env.path, path, sizeof(g_entry_env.path));
+  if (!have)
+    return;
+
+  g_entry_env.dev = st.st_dev;
+  g_entry_env.ino = st.st_ino;
+  g_entry_env.size = st.st_size;
+  g_entry_env.mtime = st.st_mtim;
+
+  /* parse_env_file_to_config() only touches the env members */
+  static struct ds_config scratch;
+  int prev_silent = ds_log_silent;
+  ds_log_silent = 1;
+  parse_env_file_to_config(path, &scratch);
+  ds_log_silent = prev_silent;
+
+  g_entry_env.block = scratch.env_block;
+  g_entry_env.len = scratch.env_block_len;
+  g_entry_env.count = scratch.env_var_count;
+  scratch.env_block = NULL;
+  scratch.env_block_len = 0;
+  scratch.env_var_count = 0;
+}
+
+/* Answer one pending connection on the entry socket.  Called from the
+ * monitor loop when srv is readable; never blocks longer than the socket
+ * timeout. */
+void ds_entry_serve(int srv) {
+  int conn = accept4(srv, NULL, NULL, SOCK_CLOEXEC);
+  if (conn < 0)
+    return;
+
+  /* Namespace and cgroup fds are root-equivalent: only hand them to host
+   * root */
+  if (g_entry.init_pid <= 0 || !entry_peer_trusted(conn))
+    goto out;
+  entry_set_timeout(conn);
+
+  /* The env_file a client asks for is never trusted; the request is only
+   * consumed so an older client isn't cut off mid-write */
+  uint32_t rlen;
+  char rbuf[PATH_MAX];
+  if (entry_read_exact(conn, &rlen, sizeof(rlen)) < 0 || rlen >= sizeof(rbuf))
+    goto out;
+  if (rlen && entry_read_exact(conn, rbuf, rlen) < 0)
+    goto out;
+
+  entry_resolve_env(g_entry_env_file);
+  uint32_t plen = (uint32_t)strlen(g_entry_env_file);
+
+  struct entry_wire w = {
+      .magic = DS_ENTRY_MAGIC,
+      .version = DS_ENTRY_VERSION,
+      .init_pid = g_entry.init_pid,
+      .cg_count = (uint32_t)g_entry.cg_count,
+      .env_count = (uint32_t)g_entry_env.count,
+      .path_len = plen,
+      .env_len = g_entry_env.len,
+  };
+  int fds[DS_ENTRY_MAX_FDS];
+  int nfds = 0;
+  for (int i = 0; i < DS_NS_COUNT; i++) {
+    if (g_entry.ns_fds[i] >= 0) {
+      w.ns_mask |= 1u << i;
+      fds[nfds++] = g_entry.ns_fds[i];
+    }
+  }
+  for (int i = 0; i < g_entry.cg_count; i++)
+    fds[nfds++] = g_entry.cg_fds[i];
+
+  char ctrl[CMSG_SPACE(sizeof(int) * DS_ENTRY_MAX_FDS)];
+  memset(ctrl, 0, sizeof(ctrl));
+  struct iovec io = {.iov_base = &w, .iov_len = sizeof(w)};
+  struct msghdr msg = {.msg_iov = &io, .msg_iovlen = 1};
+  msg.msg_control = ctrl;
+  msg.msg_controllen = CMSG_SPACE(sizeof(int) * (size_t)nfds);
+
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int) * (size_t)nfds);
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * (size_t)nfds);
+
+  if (sendmsg(conn, &msg, MSG_NOSIGNAL) != (ssize_t)sizeof(w))
+    goto out;
+  if (plen && write_all(conn, g_entry_env_file, plen) < 0)
+    goto out;
+  if (g_entry_env.len)
+    write_all(conn, g_entry_env.block, g_entry_env.len);
+
+out:
+  close(conn);
+}
+
+/* ---------------------------------------------------------------------------
+ * Client side
+ * ---------------------------------------------------------------------------*/
+
+/* Ask the container's monitor for its entry descriptor.  On success desc
+ * holds the fds (all O_CLOEXEC) and cfg->env_block the resolved env file,
+ * exactly as parse_env_file_to_config() would have produced it.  If the
+ * monitor resolved a different env_file than cfg names, the file is parsed
+ * here instead. */
+int ds_entry_fetch(struct ds_config *cfg, struct ds_entry_desc *desc) {
+  memset(desc, 0, sizeof(*desc));
+  for (int i = 0; i < DS_NS_COUNT; i++)
+    desc->ns_fds[i] = -1;
+
+  if (cfg->container_name[0] == '\0')
+    return -1;
+
+  struct sockaddr_un addr;
+  socklen_t alen = entry_addr(cfg->container_name, &addr);
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return -1;
+  entry_set_timeout(fd);
+
+  /* The peer must be a host-side monitor: anybody can bind an abstract name */
+  if (connect(fd, (struct sockaddr *)&addr, alen) < 0 ||
+      !entry_peer_trusted(fd))
+    goto fail;
+
+  /* MSG_NOSIGNAL: a monitor that hangs up early means fall back, not die */
+  uint32_t rlen = 0;
+  if (send(fd, &rlen, sizeof(rlen), MSG_NOSIGNAL) != (ssize_t)sizeof(rlen))
+    goto fail;
+
+  struct entry_wire w;
+  char ctrl[CMSG_SPACE(sizeof(int) * DS_ENTRY_MAX_FDS)];
+  memset(ctrl, 0, sizeof(ctrl));
+  struct iovec io = {.iov_base = &w, .iov_len = sizeof(w)};
+  struct msghdr msg = {.msg_iov = &io, .msg_iovlen = 1};
+  msg.msg_control = ctrl;
+  msg.msg_controllen = sizeof(ctrl);
+
+  ssize_t r;
+  do {
+    r = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+  } while (r < 0 && errno == EINTR);
+  if (r <= 0)
+    goto fail;
+
+  int fds[DS_ENTRY_MAX_FDS];
+  int nfds = 0;
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+      cmsg->cmsg_len >= CMSG_LEN(0)) {
+    size_t n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    nfds = n > DS_ENTRY_MAX_FDS ? DS_ENTRY_MAX_FDS : (int)n;
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * (size_t)nfds);
+  }
+
+  /* Every received fd is accounted for by ns_mask (DS_NS_COUNT bits) and
+   * cg_count; anything else is closed rather than leaked */
+  int expect = __builtin_popcount(w.ns_mask) + (int)w.cg_count;
+  if (r != (ssize_t)sizeof(w) || (msg.msg_flags & MSG_CTRUNC) ||
+      w.magic != DS_ENTRY_MAGIC || w.version != DS_ENTRY_VERSION ||
+      w.init_pid <= 0 || w.cg_count > DS_ENTRY_MAX_CG || nfds != expect ||
+      !(w.ns_mask & 1u) || (w.ns_mask >> DS_NS_COUNT) != 0 ||
+      w.path_len >= PATH_MAX || w.env_len > (64u << 20)) {
+    for (int i = 0; i < nfds; i++)
+      close(fds[i]);
+    goto fail;
+  }
+
+  int k = 0;
+  for (int i = 0; i < DS_NS_COUNT; i++)
+    if (w.ns_mask & (1u << i))
+      desc->ns_fds[i] = fds[k++];
+  for (uint32_t i = 0; i < w.cg_count; i++)
+    desc->cg_fds[desc->cg_count++] = fds[k++];
+  desc->init_pid = w.init_pid;
+
+  char env_path[PATH_MAX];
+  if (w.path_len && entry_read_exact(fd, env_path, w.path_len) < 0) {
+    ds_entry_release(desc);
+    goto fail;
+  }
+  env_path[w.path_len] = '\0';
+
+  char *block = NULL;
+  if (w.env_len) {
+    block = malloc((size_t)w.env_len);
+    if (!block || entry_read_exact(fd, block, (size_t)w.env_len) < 0) {
+      free(block);
+      ds_entry_release(desc);
+      goto fail;
+    }
+  }
+  close(fd);
+
+  free_config_env_vars(cfg);
+  if (strcmp(env_path, cfg->env_file) != 0) {
+    /* --env-file or an edited config names another file than the one the
+     * monitor was started with */
+    free(block);
+    if (cfg->env_file[0]) {
+      int prev_silent = ds_log_silent;
+      ds_log_silent = 1;
+      parse_env_file_to_config(cfg->env_file, cfg);
+      ds_log_silent = prev_silent;
+    }
+    return 0;
+  }
+  cfg->env_block = block;
+  cfg->env_block_len = (size_t)w.env_len;
+  cfg->env_var_count = (int)w.env_count;
+  return 0;
+
+fail:
+  close(fd);
+  return -1;
+}
+
+void ds_entry_release(struct ds_entry_desc *desc) {
+  for (int i = 0; i < DS_NS_COUNT; i++) {
+    if (desc->ns_fds[i] >= 0)
+      close(desc->ns_fds[i]);
+    desc->ns_fds[i] = -1;
+  }
+  for (int i = 0; i < desc->cg_count; i++)
+    close(desc->cg_fds[i]);
+  desc->cg_count = 0;
+}
@@ -8,51 +8,146 @@
 #include "droidspace.h"
 
 /* ---------------------------------------------------------------------------
- * Internal Helpers
+ * Environment block
+ *
+ * Every variable lives as "KEY=VALUE\0" in one contiguous buffer, so a whole
+ * environment is one allocation (plus the envp pointer array) instead of a
+ * key and a value malloc per variable followed by setenv() copies.  Later
+ * entries override earlier ones with the same key; ds_env_build() resolves
+ * that once, when the final envp is assembled.
  * ---------------------------------------------------------------------------*/
 
-static void set_container_defaults(const char *term) {
-  setenv("PATH", "/usr/local/sbin:/usr/local/bin:/usr/sbin:/usr/bin:/sbin:/bin",
-         1);
-  setenv("TERM", term ? term : "xterm-256color", 1);
-  setenv("HOME", "/root", 1);
-  setenv("container", "droidspaces", 1);
+struct env_block {
+  char *data;
+  size_t len, cap;
+  int count;
+};
+
+static int env_block_reserve(struct env_block *b, size_t extra) {
+  if (b->len + extra <= b->cap)
+    return 0;
+  size_t cap = b->cap ? b->cap : 1024;
+  while (cap < b->len + extra)
+    cap *= 2;
+  char *p = realloc(b->data, cap);
+  if (!p)
+    return -1;
+  b->data = p;
+  b->cap = cap;
+  return 0;
+}
+
+static int env_block_add(struct env_block *b, const char *key, size_t klen,
+                         const char *val, size_t vlen) {
+  if (env_block_reserve(b, klen + vlen + 2) < 0)
+    return -1;
+  char *p = b->data + b->len;
+  memcpy(p, key, klen);
+  p[klen] = '=';
+  memcpy(p + klen + 1, val, vlen);
+  p[klen + 1 + vlen] = '\0';
+  b->len += klen + vlen + 2;
+  b->count++;
+  return 0;
+}
+
+static int env_block_adds(struct env_block *b, const char *key,
+                          const char *val) {
+  return env_block_add(b, key, strlen(key), val, strlen(val));
+}
+
+/* Strip one pair of matching surrounding quotes in place */
+static void env_unquote(const char **val, size_t *vlen) {
+  const char *v = *val;
+  size_t n = *vlen;
+  if (n >= 2 && ((v[0] == '"' && v[n - 1] == '"') ||
+                 (v[0] == '\'' && v[n - 1] == '\''))) {
+    *val = v + 1;
+    *vlen = n - 2;
+  }
+}
+
+/* Slurp a small text file with one read; NUL-terminated, NULL on error */
+static char *env_read_file(const char *path, size_t *len_out) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return NULL;
+
+  struct stat st;
+  if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) ||
+      st.st_size > 16 * 1024 * 1024) {
+    close(fd);
+    errno = EINVAL;
+    return NULL;
+  }
+
+  size_t size = (size_t)st.st_size;
+  char *buf = malloc(size + 1);
+  if (!buf) {
+    close(fd);
+    return NULL;
+  }
+  size_t got = 0;
+  while (got < size) {
+    ssize_t r = read(fd, buf + got, size - got);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      break;
+    got += (size_t)r;
+  }
+  close(fd);
+  buf[got] = '\0';
+  *len_out = got;
+  return buf;
 }
 
-void load_etc_environment(void) {
-  FILE *envf = fopen("/etc/environment", "re");
-  if (!envf)
+/* /etc/environment: KEY=VALUE lines, optional quotes, # comments */
+static void env_add_etc_environment(struct env_block *b) {
+  size_t len = 0;
+  char *buf = env_read_file("/etc/environment", &len);
+  if (!buf)
     return;
 
-  char line[512];
-  while (fgets(line, sizeof(line), envf)) {
-    /* Strip newline */
-    char *nl = strchr(line, '\n');
-    if (nl)
-      *nl = '\0';
-    /* Skip comments and empty lines */
-    if (line[0] == '#' || line[0] == '\0')
+  char *save = NULL;
+  for (char *line = strtok_r(buf, "\n", &save); line;
+       line = strtok_r(NULL, "\n", &save)) {
+    if (line[0] == '#')
       continue;
-    /* Parse KEY=VALUE */
     char *eq = strchr(line, '=');
-    if (eq) {
-      *eq = '\0';
-      char *val = eq + 1;
-      /* Strip quotes */
-      size_t vlen = strlen(val);
-      if (vlen >= 2 && ((val[0] == '"' && val[vlen - 1] == '"') ||
-                        (val[0] == '\'' && val[vlen - 1] == '\''))) {
-        val[vlen - 1] = '\0';
-        val++;
-      }
-      setenv(line, val, 1);
-    }
+    if (!eq || eq == line)
+      continue;
+    const char *val = eq + 1;
+    size_t vlen = strlen(val);
+    env_unquote(&val, &vlen);
+    env_block_add(b, line, (size_t)(eq - line), val, vlen);
   }
-  fclose(envf);
+  free(buf);
+}
+
+static size_t env_key_len(const char *entry) {
+  const char *eq = strchr(entry, '=');
+  return eq ? (size_t)(eq - entry) : strlen(entry);
 }
 
-void ds_env_boot_setup(struct ds_config *cfg) {
-  /* Capture TERM before clearenv() */
+static unsigned int env_key_hash(const char *key, size_t len) {
+  unsigned int h = 2166136261u; /* FNV-1a */
+  for (size_t i = 0; i < len; i++)
+    h = (h ^ (unsigned char)key[i]) * 16777619u;
+  return h;
+}
+
+/*
+ * Build the complete container environment and return it as a NULL
+ * terminated envp for execve().  Order of precedence (last wins):
+ *   container defaults < user env file < /etc/environment (enter/run only)
+ *
+ * The result is a single allocation: the pointer array followed by the
+ * defaults/etc strings.  User variables point straight into cfg->env_block.
+ * It is meant to be consumed by exec, so it is never freed.
+ */
+char **ds_env_build(struct ds_config *cfg, int with_etc_environment) {
+  /* Capture TERM from the inherited environment */
   const char *saved_term = getenv("TERM");
   char term_buf[64] = "xterm-256color";
 
@@ -67,25 +162,98 @@ void ds_env_boot_setup(struct ds_config *cfg) {
     }
   }
 
-  clearenv();
-  set_container_defaults(term_buf);
+  struct env_block sys = {0};
+  env_block_adds(&sys, "PATH",
+                 "/usr/local/sbin:/usr/local/bin:/usr/sbin:/usr/bin:/sbin:/bin");
+  env_block_adds(&sys, "TERM", term_buf);
+  env_block_adds(&sys, "HOME", "/root");
+  env_block_adds(&sys, "container", "droidspaces");
 
   /* Set container_ttys for systemd/openrc if ttys were allocated */
   if (cfg->tty_count > 0) {
     char ttys_str[256];
     build_container_ttys_string(cfg->ttys, cfg->tty_count, ttys_str,
                                 sizeof(ttys_str));
-    setenv("container_ttys", ttys_str, 1);
+    env_block_adds(&sys, "container_ttys", ttys_str);
   }
 
   /* Standard Linux LANG default */
-  setenv("LANG", "en_US.UTF-8", 0);
+  env_block_adds(&sys, "LANG", "en_US.UTF-8");
+  size_t sys_defaults_len = sys.len;
+
+  if (with_etc_environment)
+    env_add_etc_environment(&sys);
+
+  if (!sys.data)
+    return NULL;
+
+  /* Candidate entries in precedence order */
+  int total = sys.count + cfg->env_var_count;
+  const char **cand = malloc((size_t)total * sizeof(*cand));
+  if (!cand) {
+    free(sys.data);
+    return NULL;
+  }
+  int n = 0;
+  for (size_t off = 0; off < sys_defaults_len; off += strlen(sys.data + off) + 1)
+    cand[n++] = sys.data + off;
+  for (size_t off = 0; off < cfg->env_block_len;
+       off += strlen(cfg->env_block + off) + 1)
+    cand[n++] = cfg->env_block + off;
+  for (size_t off = sys_defaults_len; off < sys.len;
+       off += strlen(sys.data + off) + 1)
+    cand[n++] = sys.data + off;
+
+  /* Keep the last definition of each key: walk backwards with an open
+   * addressing table of keys already taken. */
+  size_t slots = 16;
+  while (slots < (size_t)n * 2)
+    slots *= 2;
+  const char **seen = calloc(slots, sizeof(*seen));
+  char **envp = malloc(((size_t)n + 1) * sizeof(*envp) + sys.len);
+  if (!seen || !envp) {
+    free(seen);
+    free(envp);
+    free(cand);
+    free(sys.data);
+    return NULL;
+  }
 
-  /* User-defined variables - applied LAST so they override our defaults above
-   */
-  for (int i = 0; i < cfg->env_var_count; i++) {
-    setenv(cfg->env_vars[i].key, cfg->env_vars[i].value, 1);
+  /* Move the system strings behind the pointer array so the whole result
+   * is one block; rebase the candidates that pointed into sys.data. */
+  char *strings = (char *)(envp + n + 1);
+  memcpy(strings, sys.data, sys.len);
+  for (int i = 0; i < n; i++) {
+    if (cand[i] >= sys.data && cand[i] < sys.data + sys.len)
+      cand[i] = strings + (cand[i] - sys.data);
+  }
+  free(sys.data);
+
+  int keep = n;
+  for (int i = n - 1; i >= 0; i--) {
+    size_t klen = env_key_len(cand[i]);
+    size_t h = env_key_hash(cand[i], klen) & (slots - 1);
+    int dup = 0;
+    while (seen[h]) {
+      if (env_key_len(seen[h]) == klen && memcmp(seen[h], cand[i], klen) == 0) {
+        dup = 1;
+        break;
+      }
+      h = (h + 1) & (slots - 1);
+    }
+    if (dup)
+      continue;
+    seen[h] = cand[i];
+    envp[--keep] = (char *)(uintptr_t)cand[i];
   }
+  free(seen);
+  free(cand);
+
+  /* Compact survivors to the front, preserving order */
+  int out = n - keep;
+  memmove(envp, envp + keep, (size_t)out * sizeof(*envp));
+  envp[out] = NULL;
+  return envp;
 }
 
 void ds_env_save(const char *path, struct ds_config *cfg) {
@@ -98,12 +266,16 @@ void ds_env_save(const char *path, struct ds_config *cfg) {
     return;
   }
 
-  for (int i = 0; i < cfg->env_var_count; i++) {
-    const char *key = cfg->env_vars[i].key;
-    const char *val = cfg->env_vars[i].value;
+  for (size_t off = 0; off < cfg->env_block_len;) {
+    const char *entry = cfg->env_block + off;
+    size_t elen = strlen(entry);
+    off += elen + 1;
+
+    size_t klen = env_key_len(entry);
+    const char *val = entry + klen + (entry[klen] == '=' ? 1 : 0);
 
     /* Escape single quotes for shell safety in export format */
-    fprintf(f, "export %s='", key);
+    fprintf(f, "export %.*s='", (int)klen, entry);
     for (const char *p = val; *p; p++) {
       if (*p == '\'') {
         fprintf(f, "'\\''");
@@ -121,15 +293,18 @@ void ds_env_save(const char *path, struct ds_config *cfg) {
 /* ---------------------------------------------------------------------------
  * parse_env_file_to_config() - parse user environment variables into memory
  *
- * Called before fork() while host paths are still accessible.
- * Supports unlimited line length and variable count via dynamic allocation.
+ * Called before fork() while host paths are still accessible.  The file is
+ * read with one read() and parsed in place; every entry is no longer than
+ * its source line, so the env block is sized once from the file size and
+ * never reallocated.
  * ---------------------------------------------------------------------------*/
 void parse_env_file_to_config(const char *path, struct ds_config *cfg) {
   if (!path || path[0] == '\0' || !cfg)
     return;
 
-  FILE *f = fopen(path, "re");
-  if (!f) {
+  size_t size = 0;
+  char *buf = env_read_file(path, &size);
+  if (!buf) {
     /* Non-fatal: env file missing is fine, container still boots */
     if (errno != ENOENT) {
       ds_warn("Failed to open env file: %s (%s)", path, strerror(errno));
@@ -139,20 +314,29 @@ void parse_env_file_to_config(const char *path, struct ds_config *cfg) {
 
   ds_log("Parsing environment file: %s", path);
 
-  char *line = NULL;
-  size_t linecap = 0;
-  ssize_t linelen;
+  struct env_block b = {0};
+  if (env_block_reserve(&b, size + 1) < 0) {
+    ds_error("Out of memory while parsing env file");
+    free(buf);
+    return;
+  }
+
   int line_num = 0;
   int failed_count = 0;
+  char *next = buf;
 
-  while ((linelen = getline(&line, &linecap, f)) > 0) {
+  while (next && *next) {
+    char *line = next;
+    char *nl = strchr(line, '\n');
+    next = nl ? nl + 1 : NULL;
+    if (nl)
+      *nl = '\0';
     line_num++;
 
-    /* Strip trailing newline and carriage return */
-    while (linelen > 0 &&
-           (line[linelen - 1] == '\n' || line[linelen - 1] == '\r')) {
+    /* Strip trailing carriage return */
+    size_t linelen = strlen(line);
+    while (linelen > 0 && line[linelen - 1] == '\r')
       line[--linelen] = '\0';
-    }
 
     /* Skip empty lines */
     if (linelen == 0)
@@ -184,25 +368,19 @@ void parse_env_file_to_config(const char *path, struct ds_config *cfg) {
       failed_count++;
       continue;
     }
-
-    char *key = malloc(key_len + 1);
-    if (!key)
-      break;
-    memcpy(key, p, key_len);
-    key[key_len] = '\0';
+    *eq = '\0';
 
     /* Validate key: [A-Za-z_][A-Za-z0-9_]* */
-    if (!isalpha((unsigned char)key[0]) && key[0] != '_') {
+    if (!isalpha((unsigned char)p[0]) && p[0] != '_') {
       ds_warn("Env file line %d: invalid key '%s' "
               "(must start with letter or _), skipping",
-              line_num, key);
-      free(key);
+              line_num, p);
       failed_count++;
       continue;
     }
     int key_valid = 1;
     for (size_t i = 1; i < key_len; i++) {
-      if (!isalnum((unsigned char)key[i]) && key[i] != '_') {
+      if (!isalnum((unsigned char)p[i]) && p[i] != '_') {
         key_valid = 0;
         break;
       }
@@ -210,57 +388,42 @@ void parse_env_file_to_config(const char *path, struct ds_config *cfg) {
     if (!key_valid) {
       ds_warn("Env file line %d: invalid key '%s' "
               "(only [A-Za-z0-9_] allowed), skipping",
-              line_num, key);
-      free(key);
+              line_num, p);
       failed_count++;
       continue;
     }
 
-    /* Extract value - everything after '=' */
-    char *val = eq + 1;
+    /* Extract value - everything after '=', surrounding quotes stripped */
+    const char *val = eq + 1;
     size_t val_len = strlen(val);
-    char *value = NULL;
-
-    /* Strip surrounding quotes (single or double) */
-    if (val_len >= 2 && ((val[0] == '"' && val[val_len - 1] == '"') ||
-                         (val[0] == '\'' && val[val_len - 1] == '\''))) {
-      value = malloc(val_len - 1);
-      if (value) {
-        memcpy(value, val + 1, val_len - 2);
-        value[val_len - 2] = '\0';
-      }
-    } else {
-      value = strdup(val);
-    }
+    env_unquote(&val, &val_len);
 
-    if (!value) {
-      free(key);
-      break;
-    }
+    /* Fits by construction (see above), so this never reallocates */
+    env_block_add(&b, p, key_len, val, val_len);
+  }
 
-    /* Store in config, growing if needed */
-    if (cfg->env_var_count >= cfg->env_var_capacity) {
-      int new_cap = cfg->env_var_capacity ? cfg->env_var_capacity * 2 : 16;
-      struct ds_env_var *new_vars =
-          realloc(cfg->env_vars, new_cap * sizeof(struct ds_env_var));
-      if (!new_vars) {
-        ds_error("Out of memory while parsing env file");
-        failed_count++;
-        free(key);
-        free(value);
-        break;
-      }
-      cfg->env_vars = new_vars;
-      cfg->env_var_capacity = new_cap;
-    }
+  free(buf);
 
-    cfg->env_vars[cfg->env_var_count].key = key;
-    cfg->env_vars[cfg->env_var_count].value = value;
-    cfg->env_var_count++;
+  /* Append to anything already loaded */
+  if (cfg->env_block_len > 0 && b.len > 0) {
+    char *merged = realloc(cfg->env_block, cfg->env_block_len + b.len);
+    if (!merged) {
+      ds_error("Out of memory while parsing env file");
+      free(b.data);
+      return;
+    }
+    memcpy(merged + cfg->env_block_len, b.data, b.len);
+    cfg->env_block = merged;
+    cfg->env_block_len += b.len;
+    free(b.data);
+  } else if (b.len > 0) {
+    free(cfg->env_block);
+    cfg->env_block = b.data;
+    cfg->env_block_len = b.len;
+  } else {
+    free(b.data);
   }
-
-  free(line);
-  fclose(f);
+  cfg->env_var_count += b.count;
 
   if (failed_count > 0) {
     ds_log("Loaded %d environment variable(s) (%d failed)", cfg->env_var_count,
@@ -271,15 +434,11 @@ void parse_env_file_to_config(const char *path, struct ds_config *cfg) {
 }
 
 void free_config_env_vars(struct ds_config *cfg) {
-  if (!cfg || !cfg->env_vars)
+  if (!cfg)
     return;
 
-  for (int i = 0; i < cfg->env_var_count; i++) {
-    free(cfg->env_vars[i].key);
-    free(cfg->env_vars[i].value);
-  }
-  free(cfg->env_vars);
-  cfg->env_vars = NULL;
+  free(cfg->env_block);
+  cfg->env_block = NULL;
+  cfg->env_block_len = 0;
   cfg->env_var_count = 0;
-  cfg->env_var_capacity = 0;
 }
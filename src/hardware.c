@@ -20,6 +20,7 @@
 
 #include "droidspace.h"
 #include <dirent.h>
+#include <linux/netlink.h>
 
 #ifndef TMPFS_MAGIC
 #define TMPFS_MAGIC 0x01021994
@@ -42,7 +43,8 @@
 /*
  * Shared GPU/hardware device lists.
  *
- * Both scan_host_gpu_gids() and mirror_gpu_nodes() iterate these tables.
+ * The device manifest below is built from these tables, and both
+ * scan_host_gpu_gids() and mirror_gpu_nodes() read the manifest.
  * Add new devices here once; both functions pick them up automatically.
  */
 
@@ -56,7 +58,8 @@ static const struct {
     {"/dev/dma_heap", NULL},    {NULL, NULL}, /* sentinel */
 };
 
-/* Static paths: individual nodes that don't fit a directory scan */
+/* Static paths: individual nodes that don't fit a directory scan.
+ * All of them live directly under /dev. */
 static const char *gpu_static_devices[] = {
     /* Android IPC (Critical for Android containers/hosts) */
     "/dev/binder",
@@ -104,376 +107,718 @@ static const char *gpu_static_devices[] = {
 };
 
 /*
- * is_dangerous_node()
+ * Device blocklist
  *
- * Checks if a device node name is "dangerous" (part of the host display stack
- * or a privileged DRM master node) and should be blocked from container access.
+ * Host /dev names that must never reach a container: the display stack and
+ * DRM masters, consoles, modem and TEE channels, raw buses. Each entry is a
+ * pattern:
+ *
+ *   name     exactly this name
+ *   name*    name, or anything starting with it
+ *   name#    name followed by a digit (card0, fb1, ram15)
+ *   *name*   name anywhere in the node name
+ *   ~rule    the anchored rule, compared case-insensitively
+ *   !rule    allow: an exact, prefix or digit rule that overrides every block
+ *
+ * The rules are compiled once per process into a trie for the anchored
+ * patterns and an Aho-Corasick automaton for the substring ones, so
+ * is_dangerous_node() classifies a name in a single pass over its bytes.
+ * More rules, one per line, may be added in <workspace>/devices.rules; the
+ * file must be owned by root and not writable by group or others.
  */
-int is_dangerous_node(const char *name) {
-  /* Tier 1: DRM card nodes and control nodes */
-  if ((strncmp(name, "card", 4) == 0 &&
-       (name[4] == '\0' || isdigit(name[4]))) ||
-      (strncmp(name, "controlD", 8) == 0 &&
-       (name[8] == '\0' || isdigit(name[8])))) {
-    return 1;
-  }
-
-  /* Tier 2: NVIDIA Proprietary Master & Modeset Nodes */
-  if (strcmp(name, "nvidiactl") == 0 || strcmp(name, "nvidia-modeset") == 0)
-    return 1;
-  /* Block raw GPU nodes /dev/nvidia0, nvidia1, etc. */
-  if (strncmp(name, "nvidia", 6) == 0 && isdigit(name[6]))
-    return 1;
-  /* Block NVIDIA capability nodes */
-  if (strncmp(name, "nvidia-cap", 10) == 0)
-    return 1;
-
-  /* Tier 3 & 4: VGA Arbiter and Framebuffers */
-  if (strcmp(name, "vga_arbiter") == 0)
-    return 1;
-  if (strncmp(name, "fb", 2) == 0 && isdigit(name[2]))
-    return 1;
-
-  /* Tier 5: Host TTY nodes
-   *
-   * SAFE (pass through - legitimate dev/embedded devices):
-   *   ttyUSB*  USB-to-serial adapters (FTDI, CH340, CP2102, PL2303)
-   *   ttyACM*  USB CDC ACM (Arduino, ESP32-C3/S2, Pi Pico, STM32, Heimdall)
-   *   ttyAMA*  ARM AMBA UART (Raspberry Pi GPIO serial, ARM SoC hardware UART)
-   *   ttyTHS*  NVIDIA Tegra high-speed UART (Jetson boards)
-   *   ttymxc*  NXP i.MX UART (embedded SBCs)
-   *
-   * DANGEROUS (block - host console/modem paths):
-   *   ttyN     VT masters: DRM Master handover risk on VT switch
-   *   ttyS*    x86 hardware serial console (COM1/COM2)
-   *   ttyGS*   USB gadget serial (host-side gadget controller)
-   *   ttyHSL*  Qualcomm high-speed UART (modem console)
-   *   ttyMSM*  Qualcomm MSM serial console
-   *
-   * Unknown tty* nodes fall through as safe (dev-friendly default). */
-  if (strncmp(name, "tty", 3) == 0) {
-    /* Safe: check before any block rule */
-    if (strncmp(name, "ttyUSB", 6) == 0 || strncmp(name, "ttyACM", 6) == 0 ||
-        strncmp(name, "ttyAMA", 6) == 0 || strncmp(name, "ttyTHS", 6) == 0 ||
-        strncmp(name, "ttymxc", 6) == 0)
+static const char *const dev_blocklist_rules[] = {
+    /* Tier 1: DRM card nodes and control nodes */
+    "card", "card#", "controlD", "controlD#",
+
+    /* Tier 2: NVIDIA Proprietary Master & Modeset Nodes, raw GPU nodes
+     * (nvidia0, nvidia1, ...) and capability nodes */
+    "nvidiactl", "nvidia-modeset", "nvidia#", "nvidia-cap*",
+
+    /* Tier 3 & 4: VGA Arbiter and Framebuffers */
+    "vga_arbiter", "fb#",
+
+    /* Tier 5: Host TTY nodes
+     *
+     * SAFE (pass through - legitimate dev/embedded devices):
+     *   ttyUSB*  USB-to-serial adapters (FTDI, CH340, CP2102, PL2303)
+     *   ttyACM*  USB CDC ACM (Arduino, ESP32-C3/S2, Pi Pico, STM32, Heimdall)
+     *   ttyAMA*  ARM AMBA UART (Raspberry Pi GPIO serial, ARM SoC hardware UART)
+     *   ttyTHS*  NVIDIA Tegra high-speed UART (Jetson boards)
+     *   ttymxc*  NXP i.MX UART (embedded SBCs)
+     *
+     * Everything else is dangerous: VT masters (ttyN), x86 serial consoles
+     * (ttyS*), USB gadget serial (ttyGS*), Qualcomm/MSM modem consoles
+     * (ttyHSL*, ttyMSM*). Android kernels register hundreds of tty* nodes
+     * for virtual UARTs, modem channels (ttyCMIPC*), AT command interfaces
+     * (ttyC_AT) and vendor UART drivers, so the default for tty* is BLOCKED
+     * and the safe entries above pass through as allow rules. */
+    "!ttyUSB*", "!ttyACM*", "!ttyAMA*", "!ttyTHS*", "!ttymxc*", "tty*",
+
+    /* Tier 6: MediaTek Modem & Legacy BSD PTY masters */
+    "ccci*", "umts_*", "pty*",
+
+    /* Tier 7: Input Injection & RF Kill */
+    "uinput", "rfkill",
+
+    /* Tier 8: TEE, Connectivity & Power Management (Android/MTK):
+     * TrustZone / TEE / Secure OS, MediaTek Connectivity & Security, PMIC */
+    "tz*", "trusty*", "gz_*", "tee*", "conn*", "mtk_sec", "~mt_pmic*",
+    "tuihw", "wlan",
+
+    /* Tier 9: Legacy RAM disks */
+    "ram#",
+
+    /* Tier 10: Core virtualized nodes (should be unlinked and recreated) */
+    "console", "tty", "full", "null", "zero", "random", "urandom", "ptmx",
+    "initctl",
+
+    /* Systemic Hardening (Phase 12) */
+    /* Tier 10: Direct Host Access */
+    "mem", "kmem", "port",
+    /* Tier 11: DisplayPort Aux */
+    "drm_dp_aux*",
+    /* Tier 12: Virtual Consoles */
+    "vcs*",
+    /* Tier 13: Watchdogs */
+    "*watchdog*",
+
+    /* Tier 13.5: Qualcomm RPC & Secure Interfaces */
+    "*qseecom*", "*smcinvoke*", "*adsprpc*",
+
+    /* Tier 14: DMA/Memory Gaps */
+    "udmabuf", "snapshot",
+    /* Tier 15: TPM */
+    "tpm*",
+    /* Tier 16: MTK STP Combo Chip Bus (BT/GPS/WiFi transport) */
+    "stp*",
+
+    /* Tier 16.5: Qualcomm / Modem Connectivity Loopholes */
+    "rmnet_*", "ipa*", "at_usb*", "at_mdm*", "wwan_*", "btfmslim*",
+    "btpower*", "smd*", "apr_*", "*aud_*", "*icnss_*",
+
+    /* Tier 16.6: Hypervisor Consoles & Virtio Loopbacks */
+    "hvc*", "gh_*",
+
+    /* Tier 17: MTK Audio IPI / SCP IPC - known exploitable attack surface */
+    "audio_ipi", "scp_audio_ipi", "vow", "vcp",
+
+    /* Tier 17.5: Qualcomm SoC Tracing & DSP Debug */
+    "coresight*", "remoteproc*", "rpmsg_*", "cvp", "rdbg_*", "dcc_sram",
+    "spec_sync", "synx_device",
+
+    /* Tier 17.6: Android-Specific Compatibility Nodes (Anbox, etc.) */
+    "anbox-*", "android_ssusbcon",
+
+    /* Tier 18: eMMC Replay-Protected Memory Block - stores DRM/boot keys */
+    "rpmb*",
+
+    /* Tier 19: MTK Multimedia Profiler + Event Tracer (CMDQ-class IOCTL risk) */
+    "mmp", "met",
+
+    /* Tier 20: MTK Co-Processor Firmware IPC Channels */
+    "mcupm", "sspm", "scp",
+
+    /* Tier 21: MTK AED kernel exception daemon nodes */
+    "aed", "aed#",
+
+    /* Tier 22: Persistent RAM log writer (survives reboots, destroys host
+     * diagnostics) */
+    "pmsg*",
+
+    /* Tier 23: MTK Display Pipeline Sync (display-critical fence driver) */
+    "mdp_sync", "fmt_sync", "mtk_mdp", "mml_pq", "sec_display_debug",
+
+    /* Tier 24: GPS co-processor shared memory + power control */
+    "gps_emi", "gps_pwr",
+
+    /* Tier 25: Secure elements, biometrics, DRM key nodes */
+    "goodix_fp", "k250a", "drm_wv", "sec-nfc",
+
+    /* Tier 26: MTK debug/tracing nodes and QCOM/Other misc
+     * wmt*: wmtdetect, wmtWifi, wmtNfc, etc. */
+    "eara-io", "RT_Monitor", "stats", "wmt*",
+
+    /* Tier 27: MTK firmware log exporters */
+    "fw_log_*", "sa_log_wifi",
+
+    /* Tier 28: MTK Network Offload & USB IP Accelerators
+     * sipa_*: bypasses netfilter at hardware offload layer.
+     * mddp: MTK Distributed Data Path offload control. */
+    "sipa_*", "mddp", "usip",
+
+    /* Tier 29: Direct Bus Access (Exynos/Samsung)
+     * gpiochip*: Raw GPIO control of motherboard pins.
+     * i2c-*: Raw I2C bus access to CMOS sensors, power chips, and touchscreens.
+     * iio:device*: Industrial I/O for raw ADC/Sensor data. */
+    "gpiochip*", "i2c-*", "iio:device*",
+
+    /* Tier 30: Performance & Clock Scaling
+     * Cluster/GPU/Memory frequency overrides allow host sabotage. */
+    "cluster*", "gpu_freq*", "cpu_online_*", "memory_bandwidth",
+    "*msm_audio_ion*", "*msm_hdcp*", "*msm_sps*",
+
+    /* Tier 31: Exynos Modem & Multi-PDP
+     * NR (5G) and Multi-PDP packet bridges for Samsung modems. */
+    "nr_*", "multipdp*", "modem_boot*", "radio0",
+
+    /* Tier 32: Sensor Hub & DSPs
+     * BBD: Big Brother Daemon (Exynos sensor hub).
+     * SSP: Samsung Sensor Processor. */
+    "bbd_*", "ssp_*", "ssp_sensorhub",
+
+    /* Tier 33: Samsung Specific Hardware (Payment/Security)
+     * MST: Samsung Pay Magnetic Secure Transmission.
+     * QBT: Samsung Ultrasonic Fingerprint (Qualcomm/Samsung hybrid).
+     * DEK: Data Encryption Keys. */
+    "mst_ctrl", "qbt*", "dek_*",
+
+    /* Tier 34: Throughput & Latency Monitoring
+     * Removes dozens of performance tracking nodes from /dev listing. */
+    "*throughput*", "*latency*",
+
+    /* Tier 35: Exynos Multimedia & Misc Logic
+     * FIMG2D/G2D: Graphics accelerators that don't use DRM/RenderNodes.
+     * Vertex10: Proprietary hardware logic. */
+    "fimg2d", "fmp", "g2d", "vertex10", "self_display",
+
+    /* Tier 36: Misc Samsung Utility Nodes */
+    "ccic_misc", "hqm_event",
+
+    /* Tier 37: Exynos/Samsung specific - dymmy/dummy and Broadcom consoles,
+     * shared memory and raw sensors */
+    "*multipdp*", "ttyBCM*", "s5p-smem", "als_*",
+
+    NULL, /* sentinel */
+};
+
+#define DEV_BLOCKLIST_FILE "devices.rules"
+#define BL_MAX_NODES 16384
+
+/* Node flags: block kinds, the same kinds shifted up for allow rules */
+#define BL_EXACT 0x01
+#define BL_PREFIX 0x02
+#define BL_DIGIT 0x04
+#define BL_KINDS 0x07
+#define BL_ALLOW_SHIFT 3
+#define BL_SUBSTR 0x40
+
+/* Node 0 is "no node"; nodes 1..BL_ROOTS are the roots */
+enum { BL_ANCHORED, BL_FOLDED, BL_SUBSTRING, BL_ROOTS };
+
+struct bl_node {
+  uint32_t child; /* first child */
+  uint32_t next;  /* next sibling */
+  uint32_t fail;  /* substring automaton: longest proper suffix state */
+  uint8_t c;
+  uint8_t flags;
+};
+
+static struct bl_node *g_bl;
+static uint32_t g_bl_count, g_bl_cap;
+static uint32_t g_bl_root[BL_ROOTS][256]; /* root fan-out, 0 = no edge */
+static uint32_t g_bl_hash = 2166136261u;
+static pthread_once_t g_bl_once = PTHREAD_ONCE_INIT;
+
+static uint32_t fnv1a(uint32_t h, const char *s) {
+  do
+    h = (h ^ (uint8_t)*s) * 16777619u;
+  while (*s++);
+  return h;
+}
+
+static inline uint32_t bl_child(uint32_t n, uint8_t c) {
+  if (n <= BL_ROOTS)
+    return g_bl_root[n - 1][c];
+  for (uint32_t k = g_bl[n].child; k; k = g_bl[k].next)
+    if (g_bl[k].c == c)
+      return k;
+  return 0;
+}
+
+static uint32_t bl_add_child(uint32_t n, uint8_t c) {
+  uint32_t k = bl_child(n, c);
+  if (k)
+    return k;
+  if (g_bl_count == g_bl_cap) {
+    if (g_bl_cap >= BL_MAX_NODES)
       return 0;
-    /* Dangerous: VT masters */
-    if (isdigit(name[3]))
-      return 1;
-    /* Everything else is dangerous.
-     * Android kernels register hundreds of tty* nodes for virtual UARTs,
-     * modem channels (ttyCMIPC*), AT command interfaces (ttyC_AT), and
-     * arbitrary vendor UART drivers (ttya*..ttyz*, ttyC*, ttyb*, etc.).
-     * The old "unknown = safe" default was the bug - on Android the correct
-     * default is BLOCKED.  Explicit safe entries above still pass through. */
-    return 1;
-  }
-
-  /* Tier 6: MediaTek Modem & Legacy BSD PTYs */
-  if (strncmp(name, "ccci", 4) == 0 || strncmp(name, "umts_", 5) == 0)
-    return 1;
-  if (strncmp(name, "pty", 3) == 0) /* BSD PTY masters */
-    return 1;
-
-  /* Tier 7: Input Injection & RF Kill */
-  if (strcmp(name, "uinput") == 0 || strcmp(name, "rfkill") == 0)
-    return 1;
-
-  /* Tier 8: TEE, Connectivity & Power Management (Android/MTK) */
-  if (strncmp(name, "tz", 2) == 0 || strncmp(name, "trusty", 6) == 0 ||
-      strncmp(name, "gz_", 3) == 0 || strncmp(name, "tee", 3) == 0)
-    return 1; /* TrustZone / TEE / Secure OS */
-  if (strncmp(name, "conn", 4) == 0 || strcmp(name, "mtk_sec") == 0)
-    return 1; /* MediaTek Connectivity & Security */
-  if (strncasecmp(name, "mt_pmic", 7) == 0)
-    return 1; /* Power Management IC */
-  if (strcmp(name, "tuihw") == 0 || strcmp(name, "wlan") == 0)
-    return 1;
-
-  /* Tier 9: Legacy Clutter */
-  if (strncmp(name, "ram", 3) == 0 && isdigit(name[3]))
-    return 1; /* Legacy RAM disks */
-
-  /* Tier 10: Core virtualized nodes (should be unlinked and recreated) */
-  if (strcmp(name, "console") == 0 || strcmp(name, "tty") == 0 ||
-      strcmp(name, "full") == 0 || strcmp(name, "null") == 0 ||
-      strcmp(name, "zero") == 0 || strcmp(name, "random") == 0 ||
-      strcmp(name, "urandom") == 0 || strcmp(name, "ptmx") == 0 ||
-      strcmp(name, "initctl") == 0)
-    return 1;
-
-  /* Systemic Hardening (Phase 12) */
-  /* Tier 10: Direct Host Access */
-  if (strcmp(name, "mem") == 0 || strcmp(name, "kmem") == 0 ||
-      strcmp(name, "port") == 0)
-    return 1;
-  /* Tier 11: DisplayPort Aux */
-  if (strncmp(name, "drm_dp_aux", 10) == 0)
-    return 1;
-  /* Tier 12: Virtual Consoles */
-  if (strncmp(name, "vcs", 3) == 0)
-    return 1;
-  /* Tier 13: Watchdogs */
-  if (strstr(name, "watchdog") != NULL)
-    return 1;
-
-  /* Tier 13.5: Qualcomm RPC & Secure Interfaces */
-  if (strstr(name, "qseecom") != NULL || strstr(name, "smcinvoke") != NULL ||
-      strstr(name, "adsprpc") != NULL)
-    return 1;
-
-  /* Tier 14: DMA/Memory Gaps */
-  if (strcmp(name, "udmabuf") == 0 || strcmp(name, "snapshot") == 0)
-    return 1;
-  /* Tier 15: TPM */
-  if (strncmp(name, "tpm", 3) == 0)
-    return 1;
-  /* Tier 16: MTK STP Combo Chip Bus (BT/GPS/WiFi transport) */
-  if (strncmp(name, "stp", 3) == 0)
-    return 1;
-
-  /* Tier 16.5: Qualcomm / Modem Connectivity Loopholes */
-  if (strncmp(name, "rmnet_", 6) == 0 || strncmp(name, "ipa", 3) == 0 ||
-      strncmp(name, "at_usb", 6) == 0 || strncmp(name, "at_mdm", 6) == 0 ||
-      strncmp(name, "wwan_", 5) == 0 || strncmp(name, "btfmslim", 8) == 0 ||
-      strncmp(name, "btpower", 7) == 0 || strncmp(name, "smd", 3) == 0 ||
-      strncmp(name, "apr_", 4) == 0 || strstr(name, "aud_") != NULL ||
-      strstr(name, "icnss_") != NULL)
-    return 1;
-
-  /* Tier 16.6: Hypervisor Consoles & Virtio Loopbacks */
-  if (strncmp(name, "hvc", 3) == 0 || strncmp(name, "gh_", 3) == 0)
-    return 1;
-
-  /* Tier 17: MTK Audio IPI / SCP IPC - known exploitable attack surface */
-  if (strcmp(name, "audio_ipi") == 0 || strcmp(name, "scp_audio_ipi") == 0 ||
-      strcmp(name, "vow") == 0 || strcmp(name, "vcp") == 0)
-    return 1;
-
-  /* Tier 17.5: Qualcomm SoC Tracing & DSP Debug */
-  if (strncmp(name, "coresight", 9) == 0 ||
-      strncmp(name, "remoteproc", 10) == 0 || strncmp(name, "rpmsg_", 6) == 0 ||
-      strcmp(name, "cvp") == 0 || strncmp(name, "rdbg_", 5) == 0 ||
-      strcmp(name, "dcc_sram") == 0 || strcmp(name, "spec_sync") == 0 ||
-      strcmp(name, "synx_device") == 0)
-    return 1;
-
-  /* Tier 17.6: Android-Specific Compatibility Nodes (Anbox, etc.) */
-  if (strncmp(name, "anbox-", 6) == 0 || strcmp(name, "android_ssusbcon") == 0)
-    return 1;
-
-  /* Tier 18: eMMC Replay-Protected Memory Block - stores DRM/boot keys */
-  if (strncmp(name, "rpmb", 4) == 0)
-    return 1;
-
-  /* Tier 19: MTK Multimedia Profiler + Event Tracer (CMDQ-class IOCTL risk) */
-  if (strcmp(name, "mmp") == 0 || strcmp(name, "met") == 0)
-    return 1;
-
-  /* Tier 20: MTK Co-Processor Firmware IPC Channels */
-  if (strcmp(name, "mcupm") == 0 || strcmp(name, "sspm") == 0 ||
-      strcmp(name, "scp") == 0)
-    return 1;
-
-  /* Tier 21: MTK AED kernel exception daemon nodes */
-  if (strncmp(name, "aed", 3) == 0 && (name[3] == '\0' || isdigit(name[3])))
-    return 1;
-
-  /* Tier 22: Persistent RAM log writer (survives reboots, destroys host
-   * diagnostics) */
-  if (strncmp(name, "pmsg", 4) == 0)
-    return 1;
-
-  /* Tier 23: MTK Display Pipeline Sync (display-critical fence driver) */
-  if (strcmp(name, "mdp_sync") == 0 || strcmp(name, "fmt_sync") == 0 ||
-      strcmp(name, "mtk_mdp") == 0 || strcmp(name, "mml_pq") == 0 ||
-      strcmp(name, "sec_display_debug") == 0)
-    return 1;
-
-  /* Tier 24: GPS co-processor shared memory + power control */
-  if (strcmp(name, "gps_emi") == 0 || strcmp(name, "gps_pwr") == 0)
-    return 1;
-
-  /* Tier 25: Secure elements, biometrics, DRM key nodes */
-  if (strcmp(name, "goodix_fp") == 0 || strcmp(name, "k250a") == 0 ||
-      strcmp(name, "drm_wv") == 0 || strcmp(name, "sec-nfc") == 0)
-    return 1;
-
-  /* Tier 26: MTK debug/tracing nodes and QCOM/Other misc */
-  if (strcmp(name, "eara-io") == 0 || strcmp(name, "RT_Monitor") == 0 ||
-      strcmp(name, "stats") == 0)
-    return 1;
-  if (strncmp(name, "wmt", 3) == 0) /* wmtdetect, wmtWifi, wmtNfc, etc. */
-    return 1;
-
-  /* Tier 27: MTK firmware log exporters */
-  if (strncmp(name, "fw_log_", 7) == 0 || strcmp(name, "sa_log_wifi") == 0)
-    return 1;
-
-  /* Tier 28: MTK Network Offload & USB IP Accelerators
-   * sipa_*: bypasses netfilter at hardware offload layer.
-   * mddp: MTK Distributed Data Path offload control. */
-  if (strncmp(name, "sipa_", 5) == 0 || strcmp(name, "mddp") == 0 ||
-      strcmp(name, "usip") == 0)
-    return 1;
-
-  /* Tier 29: Direct Bus Access (Exynos/Samsung)
-   * gpiochip*: Raw GPIO control of motherboard pins.
-   * i2c-*: Raw I2C bus access to CMOS sensors, power chips, and touchscreens.
-   * iio:device*: Industrial I/O for raw ADC/Sensor data. */
-  if (strncmp(name, "gpiochip", 8) == 0 || strncmp(name, "i2c-", 4) == 0 ||
-      strncmp(name, "iio:device", 10) == 0)
-    return 1;
-
-  /* Tier 30: Performance & Clock Scaling
-   * Cluster/GPU/Memory frequency overrides allow host sabotage. */
-  if (strncmp(name, "cluster", 7) == 0 || strncmp(name, "gpu_freq", 8) == 0 ||
-      strncmp(name, "cpu_online_", 11) == 0 ||
-      strcmp(name, "memory_bandwidth") == 0 ||
-      strstr(name, "msm_audio_ion") != NULL ||
-      strstr(name, "msm_hdcp") != NULL || strstr(name, "msm_sps") != NULL)
-    return 1;
-
-  /* Tier 31: Exynos Modem & Multi-PDP
-   * NR (5G) and Multi-PDP packet bridges for Samsung modems. */
-  if (strncmp(name, "nr_", 3) == 0 || strncmp(name, "multipdp", 8) == 0 ||
-      strncmp(name, "modem_boot", 10) == 0 || strcmp(name, "radio0") == 0)
-    return 1;
-
-  /* Tier 32: Sensor Hub & DSPs
-   * BBD: Big Brother Daemon (Exynos sensor hub).
-   * SSP: Samsung Sensor Processor. */
-  if (strncmp(name, "bbd_", 4) == 0 || strncmp(name, "ssp_", 4) == 0 ||
-      strcmp(name, "ssp_sensorhub") == 0)
-    return 1;
-
-  /* Tier 33: Samsung Specific Hardware (Payment/Security)
-   * MST: Samsung Pay Magnetic Secure Transmission.
-   * QBT: Samsung Ultrasonic Fingerprint (Qualcomm/Samsung hybrid).
-   * DEK: Data Encryption Keys. */
-  if (strcmp(name, "mst_ctrl") == 0 || strncmp(name, "qbt", 3) == 0 ||
-      strncmp(name, "dek_", 4) == 0)
-    return 1;
-
-  /* Tier 34: Throughput & Latency Monitoring
-   * Removes dozens of performance tracking nodes from /dev listing. */
-  if (strstr(name, "throughput") != NULL || strstr(name, "latency") != NULL)
-    return 1;
-
-  /* Tier 35: Exynos Multimedia & Misc Logic
-   * FIMG2D/G2D: Graphics accelerators that don't use DRM/RenderNodes.
-   * Vertex10: Proprietary hardware logic. */
-  if (strcmp(name, "fimg2d") == 0 || strcmp(name, "fmp") == 0 ||
-      strcmp(name, "g2d") == 0 || strcmp(name, "vertex10") == 0 ||
-      strcmp(name, "self_display") == 0)
-    return 1;
-
-  /* Tier 36: Misc Samsung Utility Nodes */
-  if (strcmp(name, "ccic_misc") == 0 || strcmp(name, "hqm_event") == 0)
-    return 1;
-
-  /* Tier 37: Exynos/Samsung specific */
-  if (strstr(name, "multipdp") != NULL || strncmp(name, "ttyBCM", 6) == 0)
-    return 1; /* Catch dymmy/dummy and Broadcom consoles */
-  if (strcmp(name, "s5p-smem") == 0 || strncmp(name, "als_", 4) == 0)
-    return 1; /* Shared memory and raw sensors */
-  if (strstr(name, "throughput") != NULL)
-    return 1; /* Global throughput monitoring cleanup */
+    uint32_t cap = g_bl_cap ? g_bl_cap * 2 : 1024;
+    struct bl_node *p = realloc(g_bl, cap * sizeof(*p));
+    if (!p)
+      return 0;
+    g_bl = p;
+    g_bl_cap = cap;
+  }
+  k = g_bl_count++;
+  memset(&g_bl[k], 0, sizeof(g_bl[k]));
+  g_bl[k].c = c;
+  if (n <= BL_ROOTS) {
+    g_bl_root[n - 1][c] = k;
+  } else {
+    g_bl[k].next = g_bl[n].child;
+    g_bl[n].child = k;
+  }
+  return k;
+}
+
+/* Returns 0, or -1 for a malformed rule or a full automaton */
+static int bl_add_rule(const char *rule) {
+  const char *p = rule;
+  int allow = 0, fold = 0;
+  if (*p == '!') {
+    allow = 1;
+    p++;
+  }
+  if (*p == '~') {
+    fold = 1;
+    p++;
+  }
+
+  size_t len = strlen(p);
+  int root = fold ? BL_FOLDED : BL_ANCHORED;
+  uint8_t kind = BL_EXACT;
+  if (len > 2 && p[0] == '*' && p[len - 1] == '*') {
+    if (allow || fold)
+      return -1;
+    root = BL_SUBSTRING;
+    kind = BL_SUBSTR;
+    p++;
+    len -= 2;
+  } else if (len > 1 && p[len - 1] == '*') {
+    kind = BL_PREFIX;
+    len--;
+  } else if (len > 1 && p[len - 1] == '#') {
+    kind = BL_DIGIT;
+    len--;
+  }
+  if (len == 0 || memchr(p, '*', len) || memchr(p, '/', len))
+    return -1;
 
+  uint32_t n = (uint32_t)root + 1;
+  for (size_t i = 0; i < len && n; i++)
+    n = bl_add_child(n, fold ? (uint8_t)tolower((unsigned char)p[i])
+                             : (uint8_t)p[i]);
+  if (!n)
+    return -1;
+  g_bl[n].flags |= allow ? (uint8_t)(kind << BL_ALLOW_SHIFT) : kind;
+  g_bl_hash = fnv1a(g_bl_hash, rule);
   return 0;
 }
 
-/*
- * add_gpu_gid()
- *
- * Helper to stat a device and add its group ID if it's unique.
- */
-static void add_gpu_gid(const char *path, gid_t *gids, int *count,
-                        int max_gids) {
-  /* Defense in Depth: Always check against the dangerous node blocklist */
-  const char *name = strrchr(path, '/');
-  name = name ? name + 1 : path;
-  if (is_dangerous_node(name)) {
+/* Breadth-first failure links; a state matches if any suffix of it does */
+static void bl_link_substrings(void) {
+  const uint32_t root = BL_SUBSTRING + 1;
+  uint32_t *queue = malloc(g_bl_count * sizeof(*queue));
+  if (!queue) {
+    g_bl_count = 0; /* fail closed, see is_dangerous_node() */
     return;
   }
+  uint32_t head = 0, tail = 0;
+  for (int c = 0; c < 256; c++) {
+    uint32_t k = g_bl_root[BL_SUBSTRING][c];
+    if (k) {
+      g_bl[k].fail = root;
+      queue[tail++] = k;
+    }
+  }
+  while (head < tail) {
+    uint32_t n = queue[head++];
+    for (uint32_t k = g_bl[n].child; k; k = g_bl[k].next) {
+      uint32_t f = g_bl[n].fail, t;
+      while (!(t = bl_child(f, g_bl[k].c)) && f != root)
+        f = g_bl[f].fail;
+      g_bl[k].fail = t ? t : root;
+      g_bl[k].flags |= g_bl[g_bl[k].fail].flags & BL_SUBSTR;
+      queue[tail++] = k;
+    }
+  }
+  free(queue);
+}
 
-  struct stat st;
-  if (stat(path, &st) < 0)
+static void bl_load_file(void) {
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s/" DEV_BLOCKLIST_FILE, get_workspace_dir());
+  FILE *fp = fopen(path, "re");
+  if (!fp)
     return;
 
-  gid_t gid = st.st_gid;
-  if (gid == 0)
+  struct stat st;
+  if (fstat(fileno(fp), &st) < 0 || st.st_uid != 0 ||
+      (st.st_mode & (S_IWGRP | S_IWOTH))) {
+    ds_warn("[SEC] Ignoring %s: must be owned by root and not writable by "
+            "group or others",
+            path);
+    fclose(fp);
     return;
+  }
 
-  for (int i = 0; i < *count; i++) {
-    if (gids[i] == gid)
-      return;
+  char line[256];
+  int lineno = 0, added = 0;
+  while (fgets(line, sizeof(line), fp)) {
+    lineno++;
+    char *s = line;
+    while (isspace((unsigned char)*s))
+      s++;
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1]))
+      *--end = '\0';
+    if (*s == '\0' || *s == '#')
+      continue;
+    if (bl_add_rule(s) < 0)
+      ds_warn("[SEC] %s:%d: ignoring device rule '%s'", path, lineno, s);
+    else
+      added++;
   }
+  fclose(fp);
+  if (added)
+    ds_log("[SEC] Device blocklist: %d extra rule(s) from %s", added, path);
+}
 
-  if (*count < max_gids) {
-    gids[(*count)++] = gid;
-    ds_log("[GPU] GPU device %-30s → GID %d", path, (int)gid);
+static void dev_blocklist_compile(void) {
+  g_bl_count = BL_ROOTS + 1;
+  g_bl_cap = 1024;
+  g_bl = calloc(g_bl_cap, sizeof(*g_bl));
+  if (!g_bl) {
+    g_bl_count = 0;
+    return;
   }
+  for (int i = 0; dev_blocklist_rules[i] != NULL; i++)
+    bl_add_rule(dev_blocklist_rules[i]);
+  bl_load_file();
+  bl_link_substrings();
 }
 
 /*
- * scan_gpu_dir()
+ * ds_dev_blocklist_init()
  *
- * Dynamically scan a directory for device nodes matching a prefix.
+ * Compiles the blocklist, including the workspace rules file. Called early
+ * in start so the container's init and monitor inherit the compiled rules
+ * read from the host workspace; other callers compile it on first use.
  */
-static void scan_gpu_dir(const char *dir_path, const char *prefix, gid_t *gids,
-                         int *count, int max_gids) {
-  DIR *dir = opendir(dir_path);
-  if (!dir)
-    return;
+void ds_dev_blocklist_init(void) {
+  pthread_once(&g_bl_once, dev_blocklist_compile);
+}
 
-  struct dirent *entry;
-  char full_path[PATH_MAX];
+/* Does a rule of these kinds end here, given the rest of the name? */
+static inline int bl_hit(uint8_t kinds, const char *rest) {
+  return (kinds & BL_PREFIX) || ((kinds & BL_EXACT) && *rest == '\0') ||
+         ((kinds & BL_DIGIT) && isdigit((unsigned char)*rest));
+}
 
-  while ((entry = readdir(dir)) != NULL) {
-    /* Skip . and .. */
-    if (entry->d_name[0] == '.')
+/*
+ * is_dangerous_node()
+ *
+ * Checks if a device node name is "dangerous" (part of the host display stack
+ * or a privileged DRM master node) and should be blocked from container access.
+ * Walks the anchored, case-folded and substring automata side by side; an
+ * allow rule ends the walk at once, a block stands unless a longer anchored
+ * path still reaches an allow rule.
+ */
+int is_dangerous_node(const char *name) {
+  ds_dev_blocklist_init();
+  if (g_bl_count == 0)
+    return 1; /* out of memory while compiling: block everything */
+
+  const uint32_t sub_root = BL_SUBSTRING + 1;
+  uint32_t a = BL_ANCHORED + 1, f = BL_FOLDED + 1, m = sub_root;
+  int blocked = 0;
+
+  for (const char *p = name; *p; p++) {
+    uint8_t c = (uint8_t)*p;
+    if (a && (a = bl_child(a, c)) != 0) {
+      if (bl_hit((uint8_t)(g_bl[a].flags >> BL_ALLOW_SHIFT) & BL_KINDS, p + 1))
+        return 0;
+      blocked |= bl_hit(g_bl[a].flags & BL_KINDS, p + 1);
+    }
+    if (f && (f = bl_child(f, (uint8_t)tolower(c))) != 0) {
+      if (bl_hit((uint8_t)(g_bl[f].flags >> BL_ALLOW_SHIFT) & BL_KINDS, p + 1))
+        return 0;
+      blocked |= bl_hit(g_bl[f].flags & BL_KINDS, p + 1);
+    }
+    if (blocked) {
+      if (!a && !f)
+        return 1;
       continue;
+    }
+    uint32_t t;
+    while (!(t = bl_child(m, c)) && m != sub_root)
+      m = g_bl[m].fail;
+    m = t ? t : sub_root;
+    blocked = g_bl[m].flags & BL_SUBSTR;
+  }
+  return blocked != 0;
+}
 
-    /* Restricted to character devices only */
-    if (entry->d_type != DT_CHR && entry->d_type != DT_UNKNOWN)
-      continue;
+/*
+ * Device manifest
+ *
+ * One pass over the host /dev produces the list of GPU/hardware nodes that
+ * everything else in this file works from. Each distinct directory of the
+ * tables above is read once (the four /dev prefixes and the static nodes
+ * share a single /dev walk), and blocklisted names and non-character
+ * devices are dropped.
+ *
+ * The list of paths is cached in the workspace, stamped with the inode and
+ * mtime of every scanned directory. A node appearing or disappearing changes
+ * its directory's mtime, so an unchanged stamp means the same set of nodes
+ * and the next boot skips the walk. chown/chmod of a node (a vendor init
+ * re-owning /dev/kgsl-3d0) doesn't touch the mtime, so only paths are
+ * cached: device number, mode and group are stat'ed afresh on every
+ * ds_dev_manifest() call.
+ */
 
-    if (prefix && strncmp(entry->d_name, prefix, strlen(prefix)) != 0)
-      continue;
+#define DEV_MANIFEST_FILE "devices.cache"
+#define DEV_MANIFEST_MAGIC 0x56445344u /* "DSDV" */
+#define DEV_MANIFEST_VERSION 2u
+#define DEV_MANIFEST_MAX 256
+#define DEV_SCAN_MAX 8
+
+struct dev_dir_stamp {
+  uint64_t dev, ino;
+  int64_t sec, nsec;
+};
+
+struct dev_manifest_hdr {
+  uint32_t magic;
+  uint32_t version; /* format version and path size */
+  uint32_t tables;  /* hash of the scan tables the nodes came from */
+  uint32_t count;
+  struct dev_dir_stamp stamp[DEV_SCAN_MAX];
+};
+
+typedef char dev_path_t[sizeof(((struct ds_dev_node *)0)->path)];
+
+static dev_path_t g_dev_paths[DEV_MANIFEST_MAX];
+static struct ds_dev_node g_dev_nodes[DEV_MANIFEST_MAX];
+static struct dev_manifest_hdr g_dev_hdr;
+static int g_dev_count = -1;
+
+/* "/dev" first (home of the static nodes), then each distinct scan dir */
+static int dev_scan_dirs(const char *dirs[DEV_SCAN_MAX]) {
+  int n = 0;
+  dirs[n++] = "/dev";
+  for (int i = 0; gpu_scan_dirs[i].dir != NULL && n < DEV_SCAN_MAX; i++) {
+    int seen = 0;
+    for (int j = 0; j < n && !seen; j++)
+      seen = strcmp(dirs[j], gpu_scan_dirs[i].dir) == 0;
+    if (!seen)
+      dirs[n++] = gpu_scan_dirs[i].dir;
+  }
+  return n;
+}
+
+/* Hash of the tables and blocklist rules, so a binary with a different
+ * device list (or a changed devices.rules) never trusts a manifest written
+ * by another */
+static uint32_t dev_tables_hash(void) {
+  ds_dev_blocklist_init();
+  uint32_t h = g_bl_hash;
+  for (int i = 0; gpu_scan_dirs[i].dir != NULL; i++) {
+    h = fnv1a(h, gpu_scan_dirs[i].dir);
+    h = fnv1a(h, gpu_scan_dirs[i].prefix ? gpu_scan_dirs[i].prefix : "");
+  }
+  for (int i = 0; gpu_static_devices[i] != NULL; i++)
+    h = fnv1a(h, gpu_static_devices[i]);
+  return h;
+}
+
+static void dev_stamp_dirs(const char **dirs, int n,
+                           struct dev_dir_stamp *stamp) {
+  for (int i = 0; i < n; i++) {
+    struct stat st;
+    if (stat(dirs[i], &st) < 0)
+      continue; /* absent: stays zero */
+    stamp[i].dev = (uint64_t)st.st_dev;
+    stamp[i].ino = (uint64_t)st.st_ino;
+    stamp[i].sec = (int64_t)st.st_mtim.tv_sec;
+    stamp[i].nsec = (int64_t)st.st_mtim.tv_nsec;
+  }
+}
+
+/* Does the entry name of directory dir belong in the manifest? */
+static int dev_name_wanted(const char *dir, const char *name) {
+  for (int i = 0; gpu_scan_dirs[i].dir != NULL; i++) {
+    const char *prefix = gpu_scan_dirs[i].prefix;
+    if (strcmp(gpu_scan_dirs[i].dir, dir) == 0 &&
+        (!prefix || strncmp(name, prefix, strlen(prefix)) == 0))
+      return 1;
+  }
+  if (strcmp(dir, "/dev") == 0) {
+    for (int i = 0; gpu_static_devices[i] != NULL; i++)
+      if (strcmp(gpu_static_devices[i] + 5, name) == 0)
+        return 1;
+  }
+  return 0;
+}
 
-    /* Defense in Depth: Skip dangerous nodes during GID scanning */
-    if (is_dangerous_node(entry->d_name)) {
+static int dev_manifest_scan(const char **dirs, int ndirs) {
+  int count = 0;
+  for (int d = 0; d < ndirs; d++) {
+    DIR *dir = opendir(dirs[d]);
+    if (!dir)
       continue;
+
+    /* No d_type pre-filter: it can be DT_UNKNOWN on some Android kernels.
+     * fstatat() follows symlinks, like dev_manifest_stat() will. */
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+      const char *name = entry->d_name;
+      if (name[0] == '.' || !dev_name_wanted(dirs[d], name) ||
+          is_dangerous_node(name))
+        continue;
+
+      struct stat st;
+      if (fstatat(dirfd(dir), name, &st, 0) < 0 || !S_ISCHR(st.st_mode))
+        continue;
+      if (count == DEV_MANIFEST_MAX) {
+        ds_warn("[GPU] More than %d hardware nodes, ignoring the rest",
+                DEV_MANIFEST_MAX);
+        break;
+      }
+
+      char *path = g_dev_paths[count];
+      int len = snprintf(path, sizeof(dev_path_t), "%s/%s", dirs[d], name);
+      if (len < 0 || (size_t)len >= sizeof(dev_path_t))
+        continue;
+      count++;
     }
+    closedir(dir);
+  }
+  return count;
+}
+
+static void dev_manifest_path(char *buf, size_t size) {
+  snprintf(buf, size, "%s/" DEV_MANIFEST_FILE, get_workspace_dir());
+}
+
+/* Returns the node count of a cached manifest matching want, or -1 */
+static int dev_manifest_load(const struct dev_manifest_hdr *want) {
+  char path[PATH_MAX];
+  dev_manifest_path(path, sizeof(path));
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+
+  struct dev_manifest_hdr hdr;
+  int count = -1;
+  if (read(fd, &hdr, sizeof(hdr)) == (ssize_t)sizeof(hdr) &&
+      hdr.magic == want->magic && hdr.version == want->version &&
+      hdr.tables == want->tables &&
+      memcmp(hdr.stamp, want->stamp, sizeof(hdr.stamp)) == 0 &&
+      hdr.count <= DEV_MANIFEST_MAX) {
+    size_t len = hdr.count * sizeof(dev_path_t);
+    if (read(fd, g_dev_paths, len) == (ssize_t)len)
+      count = (int)hdr.count;
+  }
+  close(fd);
+
+  /* The nodes are mknod'ed into containers: accept nothing odd */
+  for (int i = 0; i < count; i++) {
+    const char *p = g_dev_paths[i];
+    if (!memchr(p, '\0', sizeof(dev_path_t)) || strncmp(p, "/dev/", 5) != 0 ||
+        strstr(p, ".."))
+      return -1;
+  }
+  return count;
+}
+
+static void dev_manifest_save(const struct dev_manifest_hdr *hdr) {
+  char path[PATH_MAX], tmp[PATH_MAX + 8];
+  dev_manifest_path(path, sizeof(path));
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+  int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return;
+  size_t len = hdr->count * sizeof(dev_path_t);
+  int ok = write_all(fd, hdr, sizeof(*hdr)) == (ssize_t)sizeof(*hdr) &&
+           (!len || write_all(fd, g_dev_paths, len) == (ssize_t)len);
+  close(fd);
+  if (!ok || rename(tmp, path) < 0)
+    unlink(tmp);
+}
 
-    snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, entry->d_name);
-    add_gpu_gid(full_path, gids, count, max_gids);
+/* Fill g_dev_nodes from the current state of each cached path; nodes that
+ * are gone or no longer character devices are skipped */
+static int dev_manifest_stat(int npaths) {
+  int count = 0;
+  for (int i = 0; i < npaths; i++) {
+    struct stat st;
+    if (stat(g_dev_paths[i], &st) < 0 || !S_ISCHR(st.st_mode))
+      continue;
+    struct ds_dev_node *n = &g_dev_nodes[count++];
+    memcpy(n->path, g_dev_paths[i], sizeof(n->path));
+    n->rdev = st.st_rdev;
+    n->mode = st.st_mode;
+    n->gid = st.st_gid;
   }
+  return count;
+}
 
-  closedir(dir);
+/*
+ * ds_dev_manifest()
+ *
+ * The host's GPU/hardware nodes: paths from memory or the workspace cache
+ * while the scanned directories are unchanged, otherwise from a fresh scan,
+ * then stat'ed for their current device number, mode and group.
+ * Must be called while /dev still refers to the host.
+ *
+ * Returns: number of nodes in *nodes
+ */
+int ds_dev_manifest(const struct ds_dev_node **nodes) {
+  const char *dirs[DEV_SCAN_MAX];
+  int ndirs = dev_scan_dirs(dirs);
+
+  struct dev_manifest_hdr want;
+  memset(&want, 0, sizeof(want));
+  want.magic = DEV_MANIFEST_MAGIC;
+  want.version = DEV_MANIFEST_VERSION << 16 | sizeof(dev_path_t);
+  want.tables = dev_tables_hash();
+  dev_stamp_dirs(dirs, ndirs, want.stamp);
+
+  *nodes = g_dev_nodes;
+  if (g_dev_count >= 0 &&
+      memcmp(g_dev_hdr.stamp, want.stamp, sizeof(want.stamp)) == 0)
+    return dev_manifest_stat(g_dev_count);
+
+  int count = dev_manifest_load(&want);
+  if (count >= 0) {
+    ds_dbg(GPU, "Device manifest: %d node(s) from cache", count);
+  } else {
+    /* stamped before the walk: a change during it invalidates the result */
+    count = dev_manifest_scan(dirs, ndirs);
+    want.count = (uint32_t)count;
+    dev_manifest_save(&want);
+    ds_dbg(GPU, "Device manifest: scanned %d node(s)", count);
+  }
+  g_dev_hdr = want;
+  g_dev_count = count;
+  return dev_manifest_stat(count);
 }
 
 /*
  * scan_host_gpu_gids()
  *
- * Scan known GPU device paths on the HOST and collect unique non-root GIDs.
- * Uses dynamic discovery where possible to avoid hardcoded path fragility.
+ * Collect the unique non-root GIDs of the host's GPU/hardware nodes.
  * Must be called BEFORE pivot_root while /dev still refers to the host.
  *
  * Returns: number of unique GIDs found (0 = no GPU devices)
  */
 int scan_host_gpu_gids(gid_t *gids, int max_gids) {
+  const struct ds_dev_node *nodes;
+  int n = ds_dev_manifest(&nodes);
   int count = 0;
 
-  /* 1. Dynamic directories */
-  for (int i = 0; gpu_scan_dirs[i].dir != NULL; i++)
-    scan_gpu_dir(gpu_scan_dirs[i].dir, gpu_scan_dirs[i].prefix, gids, &count,
-                 max_gids);
-
-  /* 2. Static individual nodes */
-  for (int i = 0; gpu_static_devices[i] != NULL; i++)
-    add_gpu_gid(gpu_static_devices[i], gids, &count, max_gids);
+  for (int i = 0; i < n && count < max_gids; i++) {
+    gid_t gid = nodes[i].gid;
+    int seen = gid == 0;
+    for (int j = 0; j < count && !seen; j++)
+      seen = gids[j] == gid;
+    if (seen)
+      continue;
+    gids[count++] = gid;
+    ds_log("[GPU] GPU device %-30s → GID %d", nodes[i].path, (int)gid);
+  }
 
   if (count > 0)
     ds_log("[GPU] Discovered %d unique GPU/Hardware group(s)", count);
@@ -491,10 +836,14 @@ int scan_host_gpu_gids(gid_t *gids, int max_gids) {
  * the kernel's devtmpfs.  So GPU nodes like /dev/kgsl-3d0, /dev/mali0 and
  * /dev/dri/renderD128 exist in ueventd's tmpfs but are absent (or appear as
  * empty directories) when we mount a fresh devtmpfs inside the container.
- * scan_host_gpu_gids() already detected those host nodes; here we just make
- * sure a matching character device node is present in the container /dev.
+ * The manifest already holds those host nodes, freshly stat'ed; here we just
+ * make sure a matching character device node is present in the container
+ * /dev.
  */
-static void mirror_gpu_node(const char *host_path, const char *dev_path) {
+static void mirror_gpu_node(const struct ds_dev_node *node,
+                            const char *dev_path) {
+  const char *host_path = node->path;
+
   /* host_path must be rooted under /dev/ */
   if (strncmp(host_path, "/dev/", 5) != 0)
     return;
@@ -507,16 +856,11 @@ static void mirror_gpu_node(const char *host_path, const char *dev_path) {
   if (is_dangerous_node(node_name))
     return;
 
-  /* Host node must be a character device.  Applies to BOTH root-owned
-   * (gid=0) and group-owned nodes - we do not filter by ownership here.
-   * add_gpu_gid() skips gid=0 because there is nothing to add to the
+  /* The manifest holds character devices only, root-owned (gid=0) and
+   * group-owned alike - we do not filter by ownership here.
+   * scan_host_gpu_gids() skips gid=0 because there is nothing to add to the
    * group list, but mirroring must still happen so the node is physically
    * present in devtmpfs regardless of who owns it. */
-  struct stat host_st;
-  if (stat(host_path, &host_st) < 0)
-    return;
-  if (!S_ISCHR(host_st.st_mode))
-    return;
 
   /* Build the container-side target path */
   const char *rel = host_path + 5; /* strip leading "/dev/" */
@@ -559,11 +903,10 @@ static void mirror_gpu_node(const char *host_path, const char *dev_path) {
   }
 
   /* Create the node with the same major:minor and permissions as the host */
-  mode_t mode = S_IFCHR | (host_st.st_mode & 0666);
-  if (mknod(tgt, mode, host_st.st_rdev) < 0) {
-    ds_warn("[GPU] mknod %s (%d:%d) failed: %s", tgt,
-            (int)major(host_st.st_rdev), (int)minor(host_st.st_rdev),
-            strerror(errno));
+  mode_t mode = S_IFCHR | (node->mode & 0666);
+  if (mknod(tgt, mode, node->rdev) < 0) {
+    ds_warn("[GPU] mknod %s (%d:%d) failed: %s", tgt, (int)major(node->rdev),
+            (int)minor(node->rdev), strerror(errno));
     return;
   }
 
@@ -574,60 +917,23 @@ static void mirror_gpu_node(const char *host_path, const char *dev_path) {
   chmod(tgt, 0660);
 
   ds_log("[GPU] Mirrored missing node: %-30s (%d:%d)", tgt,
-         (int)major(host_st.st_rdev), (int)minor(host_st.st_rdev));
-}
-
-/*
- * do_mirror_gpu_dir()
- *
- * Walk a host directory (e.g. /dev/dri, /dev/dma_heap) and call
- * mirror_gpu_node() for every entry that matches the optional prefix.
- *
- * We deliberately do NOT pre-filter by d_type here.  d_type can be
- * DT_UNKNOWN on some Android kernels/filesystems, which would silently
- * drop valid root-owned char devices before mirror_gpu_node() ever sees
- * them.  mirror_gpu_node() already does a stat()+S_ISCHR check and the
- * is_dangerous_node() gate - those are the single source of truth.
- */
-static void do_mirror_gpu_dir(const char *host_dir, const char *prefix,
-                              const char *dev_path) {
-  DIR *dir = opendir(host_dir);
-  if (!dir)
-    return;
-
-  struct dirent *entry;
-  char full_path[PATH_MAX];
-
-  while ((entry = readdir(dir)) != NULL) {
-    if (entry->d_name[0] == '.')
-      continue;
-    if (prefix && strncmp(entry->d_name, prefix, strlen(prefix)) != 0)
-      continue;
-
-    snprintf(full_path, sizeof(full_path), "%s/%s", host_dir, entry->d_name);
-    mirror_gpu_node(full_path, dev_path);
-  }
-
-  closedir(dir);
+         (int)major(node->rdev), (int)minor(node->rdev));
 }
 
 /*
  * mirror_gpu_nodes()
  *
  * Public entry point called from setup_dev() immediately after devtmpfs is
- * mounted.  Mirrors every GPU/hardware device node that scan_host_gpu_gids()
- * would detect, using the same scan paths so behaviour is always in sync.
+ * mounted.  Mirrors every node of the device manifest, so it always covers
+ * exactly what scan_host_gpu_gids() sees.
  *
  * Must be called BEFORE pivot_root while the host /dev is still accessible.
  */
 void mirror_gpu_nodes(const char *dev_path) {
-  /* Dynamic directories */
-  for (int i = 0; gpu_scan_dirs[i].dir != NULL; i++)
-    do_mirror_gpu_dir(gpu_scan_dirs[i].dir, gpu_scan_dirs[i].prefix, dev_path);
-
-  /* Static individual nodes */
-  for (int i = 0; gpu_static_devices[i] != NULL; i++)
-    mirror_gpu_node(gpu_static_devices[i], dev_path);
+  const struct ds_dev_node *nodes;
+  int n = ds_dev_manifest(&nodes);
+  for (int i = 0; i < n; i++)
+    mirror_gpu_node(&nodes[i], dev_path);
 }
 
 /*
@@ -966,3 +1272,266 @@ int setup_hardware_access(struct ds_config *cfg) {
 
   return 0;
 }
+
+/*
+ * Hot-plug propagation
+ *
+ * A --gpu container's /dev is a private tmpfs, so devices plugged in after
+ * boot (USB serial adapters, ADB phones, cameras) never show up in it. The
+ * monitor listens to kernel uevents and creates or removes the matching
+ * nodes in the container's /dev for the subsystems in hotplug_classes,
+ * subject to the same is_dangerous_node() blocklist as the boot-time mirror.
+ *
+ * Events are drained and coalesced per node before anything is touched, so
+ * a device storm (a hub with a dozen ports, a flapping cable) costs one
+ * pass with the last state of every node instead of one per event.
+ */
+
+#define HOTPLUG_BATCH 64
+#define HOTPLUG_RCVBUF (1024 * 1024)
+
+struct hotplug_event {
+  int add;
+  int block;
+  dev_t rdev;
+  char devname[128];
+};
+
+/*
+ * ds_hotplug_open()
+ *
+ * Returns a non-blocking kernel uevent socket when cfg's /dev should follow
+ * hot-plug events, or -1.
+ */
+int ds_hotplug_open(const struct ds_config *cfg) {
+  if (!cfg->gpu_mode || cfg->hw_access ||
+      strcmp(cfg->hotplug_classes, "none") == 0)
+    return -1; /* devtmpfs (hw_access) gets new nodes from the kernel */
+
+  int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                  NETLINK_KOBJECT_UEVENT);
+  if (fd < 0)
+    return -1;
+
+  /* Headroom for storms; FORCE needs CAP_NET_ADMIN, which we normally have */
+  int rcvbuf = HOTPLUG_RCVBUF;
+  if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) < 0)
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+  struct sockaddr_nl addr = {.nl_family = AF_NETLINK, .nl_groups = 1};
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    ds_warn("[HOTPLUG] Cannot listen for uevents: %s", strerror(errno));
+    close(fd);
+    return -1;
+  }
+  ds_log("[HOTPLUG] Forwarding hot-plugged %s devices",
+         cfg->hotplug_classes[0] ? cfg->hotplug_classes
+                                 : DS_HOTPLUG_DEFAULT_CLASSES);
+  return fd;
+}
+
+static int hotplug_class_wanted(const char *classes, const char *subsystem) {
+  size_t len = strlen(subsystem);
+  for (const char *p = classes; *p;) {
+    p += strspn(p, ", ");
+    size_t n = strcspn(p, ", ");
+    if (n && n == len && strncmp(p, subsystem, n) == 0)
+      return 1;
+    p += n;
+  }
+  return 0;
+}
+
+/* Kernel uevent: "action@devpath\0KEY=value\0..." */
+static int hotplug_parse(const char *buf, size_t len, const char *classes,
+                         struct hotplug_event *ev) {
+  const char *action = NULL, *devname = NULL, *subsystem = NULL;
+  const char *maj = NULL, *min = NULL;
+  for (size_t off = strnlen(buf, len) + 1; off < len;) {
+    const char *kv = buf + off;
+    size_t n = strnlen(kv, len - off);
+    if (strncmp(kv, "ACTION=", 7) == 0)
+      action = kv + 7;
+    else if (strncmp(kv, "DEVNAME=", 8) == 0)
+      devname = kv + 8;
+    else if (strncmp(kv, "SUBSYSTEM=", 10) == 0)
+      subsystem = kv + 10;
+    else if (strncmp(kv, "MAJOR=", 6) == 0)
+      maj = kv + 6;
+    else if (strncmp(kv, "MINOR=", 6) == 0)
+      min = kv + 6;
+    off += n + 1;
+  }
+  if (!action || !devname || !subsystem || !maj || !min)
+    return -1;
+  if (!hotplug_class_wanted(classes, subsystem))
+    return -1;
+
+  if (strcmp(action, "add") == 0)
+    ev->add = 1;
+  else if (strcmp(action, "remove") == 0)
+    ev->add = 0;
+  else
+    return -1;
+
+  /* DEVNAME is relative to /dev: no absolute paths, no way out of it */
+  size_t dlen = strlen(devname);
+  if (!dlen || dlen >= sizeof(ev->devname) || devname[0] == '/' ||
+      strstr(devname, "..") || strstr(devname, "//"))
+    return -1;
+  const char *base = strrchr(devname, '/');
+  if (is_dangerous_node(base ? base + 1 : devname))
+    return -1;
+
+  memcpy(ev->devname, devname, dlen + 1);
+  ev->block = strcmp(subsystem, "block") == 0;
+  ev->rdev = makedev(strtoul(maj, NULL, 10), strtoul(min, NULL, 10));
+  return 0;
+}
+
+/* Open the directory holding devname under dev_fd, creating missing
+ * parents. Never follows symlinks: the container owns this tree. */
+static int hotplug_parent(int dev_fd, char *devname, const char **leaf) {
+  int fd = dup(dev_fd);
+  char *p = devname, *slash;
+  while (fd >= 0 && (slash = strchr(p, '/')) != NULL) {
+    *slash = '\0';
+    mkdirat(fd, p, 0755);
+    int next = openat(fd, p, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    *slash = '/';
+    close(fd);
+    fd = next;
+    p = slash + 1;
+  }
+  *leaf = p;
+  return fd;
+}
+
+static void hotplug_apply(int dev_fd, struct hotplug_event *ev) {
+  const char *leaf;
+  int dir = hotplug_parent(dev_fd, ev->devname, &leaf);
+  if (dir < 0)
+    return;
+
+  mode_t type = ev->block ? S_IFBLK : S_IFCHR;
+  struct stat st;
+  int present = fstatat(dir, leaf, &st, AT_SYMLINK_NOFOLLOW) == 0;
+  int same = present && (st.st_mode & S_IFMT) == type && st.st_rdev == ev->rdev;
+
+  if (!ev->add) {
+    /* only the node we would have made, never something the container put
+     * there itself */
+    if (same && unlinkat(dir, leaf, 0) == 0)
+      ds_log("[HOTPLUG] Removed /dev/%s", ev->devname);
+    close(dir);
+    return;
+  }
+
+  if (present && !same) {
+    if (S_ISDIR(st.st_mode)) {
+      close(dir);
+      return;
+    }
+    unlinkat(dir, leaf, 0);
+  }
+  if (!same && mknodat(dir, leaf, type | 0660, ev->rdev) < 0) {
+    ds_warn("[HOTPLUG] mknod /dev/%s (%u:%u) failed: %s", ev->devname,
+            major(ev->rdev), minor(ev->rdev), strerror(errno));
+    close(dir);
+    return;
+  }
+  /* Pin the inode and re-check it: the container can swap the leaf for a
+   * symlink at any moment, and fchmodat() would follow one */
+  int node = openat(dir, leaf, O_PATH | O_NOFOLLOW | O_CLOEXEC);
+  if (node < 0 || fstat(node, &st) < 0 || (st.st_mode & S_IFMT) != type ||
+      st.st_rdev != ev->rdev) {
+    if (node >= 0)
+      close(node);
+    close(dir);
+    return;
+  }
+  if (fchownat(node, "", 0, DS_GPU_UNIFIED_GID,
+               AT_EMPTY_PATH | AT_SYMLINK_NOFOLLOW) < 0)
+    ds_warn("[HOTPLUG] chown /dev/%s → unified group: %s", ev->devname,
+            strerror(errno));
+  char node_path[32];
+  snprintf(node_path, sizeof(node_path), "/proc/self/fd/%d", node);
+  chmod(node_path, 0660);
+  close(node);
+  if (!same)
+    ds_log("[HOTPLUG] Added /dev/%s (%u:%u)", ev->devname, major(ev->rdev),
+           minor(ev->rdev));
+  close(dir);
+}
+
+static void hotplug_flush(pid_t pid, struct hotplug_event *evs, int n) {
+  if (!n || pid <= 0)
+    return;
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/root", (int)pid);
+  int root = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (root < 0)
+    return;
+  int dev = openat(root, "dev", O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  close(root);
+  if (dev < 0)
+    return;
+  for (int i = 0; i < n; i++)
+    hotplug_apply(dev, &evs[i]);
+  close(dev);
+}
+
+/*
+ * ds_hotplug_process()
+ *
+ * Drain the uevent socket and bring the running container's /dev in line.
+ * Called by the monitor whenever the socket is readable.
+ */
+void ds_hotplug_process(int fd, const struct ds_config *cfg) {
+  const char *classes =
+      cfg->hotplug_classes[0] ? cfg->hotplug_classes
+                              : DS_HOTPLUG_DEFAULT_CLASSES;
+  static struct hotplug_event evs[HOTPLUG_BATCH];
+  int n = 0;
+  char buf[8192];
+
+  for (;;) {
+    struct sockaddr_nl from;
+    struct iovec iov = {buf, sizeof(buf) - 1};
+    struct msghdr msg = {.msg_name = &from,
+                         .msg_namelen = sizeof(from),
+                         .msg_iov = &iov,
+                         .msg_iovlen = 1};
+    ssize_t len = recvmsg(fd, &msg, 0);
+    if (len < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno != ENOBUFS)
+        break; /* EAGAIN: drained */
+      ds_warn("[HOTPLUG] uevent queue overflowed, some devices were missed");
+      continue;
+    }
+    /* kernel only: userspace (udevd) rebroadcasts use other groups, but a
+     * privileged sender could still target ours */
+    if (from.nl_pid != 0 || (msg.msg_flags & MSG_TRUNC))
+      continue;
+    buf[len] = '\0';
+
+    struct hotplug_event ev;
+    if (hotplug_parse(buf, (size_t)len, classes, &ev) < 0)
+      continue;
+
+    /* coalesce: only the last state of each node matters */
+    int i = 0;
+    while (i < n && strcmp(evs[i].devname, ev.devname) != 0)
+      i++;
+    if (i == n && n == HOTPLUG_BATCH) {
+      hotplug_flush(cfg->container_pid, evs, n);
+      i = n = 0;
+    }
+    evs[i] = ev;
+    if (i == n)
+      n++;
+  }
+  hotplug_flush(cfg->container_pid, evs, n);
+}
@@ -9,6 +9,7 @@
 
 int ds_log_silent = 0;
 char ds_log_container_name[256] = "";
+unsigned int ds_log_debug_mask = 0;
 
 /* ---------------------------------------------------------------------------
  * Usage / Help
@@ -30,14 +31,27 @@ void print_usage(void) {
       "  restart                   Restart a container\n"
       "  enter [user]              Enter a running container\n"
       "  run <cmd> [args]          Run a command in a running container\n"
+      "  run-batch [FILE]          Run many commands with one container entry\n"
+      "                            (FILE or stdin: lines, NUL-separated or a\n"
+      "                            JSON array; framed output per command)\n"
       "  status                    Show container status\n"
       "  uptime                    Show how long the container has been "
       "running\n"
       "  info                      Show detailed container info\n"
       "  pid                       Show the live PID of the container init\n"
+      "  replay [REC|latest] [SPEED]\n"
+      "                            List or play back recorded sessions\n"
+      "  config get [KEY]          Print the saved configuration\n"
+      "  config set KEY=VALUE...   Validate and update the saved configuration\n"
       "  show                      List all running containers\n"
+      "  stats memory              Show RSS/PSS of each container's monitor\n"
+      "                            (--json for machine output)\n"
       "  scan                      Scan for untracked containers\n"
-      "  check                     Check system requirements\n"
+      "  check [--refresh]         Check system requirements (--refresh\n"
+      "                            re-probes instead of using the cache)\n"
+      "  bench net [SECONDS]       Measure NAT throughput and latency with a\n"
+      "                            temporary container (needs -r/-i and\n"
+      "                            --upstream; --json for machine output)\n"
       "  docs                      Show interactive documentation\n"
       "  help                      Show this help message\n"
       "  version                   Show version information\n\n"
@@ -63,8 +77,9 @@ void print_usage(void) {
       "1000-2000:1000-2000/udp\n"
       "  -d, --dns=SERVERS         Set custom DNS servers (comma separated)\n"
       "                            e.g. --dns 1.1.1.1,8.8.8.8\n"
-      "  -I, --disable-ipv6        Disable IPv6 inside the container\n\n"
+      "  -I, --disable-ipv6        Disable IPv6 inside the container\n\n");
 
+  printf(
       C_BOLD "Options (Integration & Hardware):" C_RESET "\n"
       "  -S, --enable-android-storage\n"
       "                            Mount Android internal storage (/sdcard)\n"
@@ -89,6 +104,7 @@ void print_usage(void) {
       C_BOLD "Options (Advanced):" C_RESET "\n"
       "  -f, --foreground          Run in foreground (attach console)\n"
       "  -E, --env=PATH            Load environment variables from file\n"
+      "      --record-sessions     Record enter/console sessions (asciicast)\n"
       "  -B, --bind=SRC:DEST       Bind mount host directory into container\n"
       "                            Supports multiple flags or "
       "comma-separation\n"
@@ -96,6 +112,8 @@ void print_usage(void) {
       "                            e.g. -B /data:/data,/tmp:/tmp\n"
       "      --reset               Reset config to defaults (keeps "
       "name/rootfs)\n"
+      "      --json                Machine-readable output (config get/set,\n"
+      "                            run-batch)\n"
       "      --help                Show this help message\n\n"
 
       C_BOLD "Examples:" C_RESET "\n"
@@ -353,6 +371,9 @@ int main(int argc, char **argv) {
 
   safe_strncpy(cfg.prog_name, argv[0], sizeof(cfg.prog_name));
 
+  /* Runtime half of the ds_dbg() gate; a no-op unless built with DEBUG_LOG */
+  ds_log_debug_init(getenv("DS_DEBUG"));
+
   static struct option long_options[] = {
       {"rootfs", required_argument, 0, 'r'},
       {"rootfs-img", required_argument, 0, 'i'},
@@ -380,6 +401,9 @@ int main(int argc, char **argv) {
       {"cpus", required_argument, 0, 266},
       {"pids-limit", required_argument, 0, 267},
       {"virtualization", no_argument, 0, OPT_VIRTUALIZATION},
+      {"json", no_argument, 0, OPT_JSON},
+      {"record-sessions", no_argument, 0, OPT_RECORD_SESSIONS},
+      {"refresh", no_argument, 0, OPT_REFRESH},
       {"privileged", required_argument, 0, 264},
       {"nat-ip", required_argument, 0, 262},
       {"gpu", no_argument, 0, 263},
@@ -407,6 +431,8 @@ int main(int argc, char **argv) {
   const char *discovered_cmd = NULL;
   char temp_r[PATH_MAX] = {0}, temp_i[PATH_MAX] = {0};
   int reset_config = 0;
+  int json_output = 0;
+  int refresh_caps = 0;
   int cli_net_mode_set = 0;
   enum ds_net_mode cli_net_mode = DS_NET_HOST;
   int opt;
@@ -463,12 +489,14 @@ int main(int argc, char **argv) {
   /*
    * Commands that do not require root access (docs, help, version) or
    * must be run locally to avoid recursive loops (mode) are never proxied.
+   * bench measures from this process, so it stays local as well.
    */
   int is_stateless_cmd =
       (discovered_cmd && (strcmp(discovered_cmd, "docs") == 0 ||
                           strcmp(discovered_cmd, "help") == 0 ||
                           strcmp(discovered_cmd, "version") == 0 ||
-                          strcmp(discovered_cmd, "mode") == 0));
+                          strcmp(discovered_cmd, "mode") == 0 ||
+                          strcmp(discovered_cmd, "bench") == 0));
 
   if (!is_daemon_cmd && !is_stateless_cmd && getenv("DS_NO_PROXY") == NULL) {
     int proxy_ret = ds_client_run(argc - 1, argv + 1);
@@ -502,7 +530,9 @@ int main(int argc, char **argv) {
                           strcmp(discovered_cmd, "info") == 0 ||
                           strcmp(discovered_cmd, "uptime") == 0 ||
                           strcmp(discovered_cmd, "enter") == 0 ||
-                          strcmp(discovered_cmd, "run") == 0));
+                          strcmp(discovered_cmd, "run") == 0 ||
+                          strcmp(discovered_cmd, "run-batch") == 0 ||
+                          strcmp(discovered_cmd, "mux") == 0));
 
   int loaded = 0;
   if (cfg.config_file_specified) {
@@ -942,6 +972,18 @@ int main(int argc, char **argv) {
       cfg.virtualization = 1;
       break;
 
+    case OPT_JSON:
+      json_output = 1;
+      break;
+
+    case OPT_RECORD_SESSIONS:
+      cfg.record_sessions = 1;
+      break;
+
+    case OPT_REFRESH:
+      refresh_caps = 1;
+      break;
+
     case 262: {
       /* --nat-ip: static container IP inside the NAT subnet.
        * Only a basic format check here - subnet + uniqueness validation
@@ -1020,7 +1062,7 @@ int main(int argc, char **argv) {
 
   /* Basic info commands */
   if (strcmp(cmd, "check") == 0) {
-    ret = check_requirements_detailed();
+    ret = check_requirements_detailed(refresh_caps);
     goto cleanup;
   }
   if (strcmp(cmd, "version") == 0) {
@@ -1058,12 +1100,44 @@ int main(int argc, char **argv) {
     goto cleanup;
   }
 
+  if (strcmp(cmd, "stats") == 0) {
+    const char *what = (optind + 1 < argc) ? argv[optind + 1] : NULL;
+    if (!what || strcmp(what, "memory") != 0) {
+      ds_error("Usage: %s stats memory [--json]", cfg.prog_name);
+      ret = 1;
+      goto cleanup;
+    }
+    ret = show_memory_stats(json_output);
+    goto cleanup;
+  }
+
   if (strcmp(cmd, "scan") == 0) {
     scan_containers();
     ret = 0;
     goto cleanup;
   }
 
+  if (strcmp(cmd, "bench") == 0) {
+    const char *what = (optind + 1 < argc) ? argv[optind + 1] : NULL;
+    if (!what || strcmp(what, "net") != 0) {
+      ds_error("Usage: %s -r <rootfs> --upstream <iface> bench net "
+               "[SECONDS] [--json]",
+               cfg.prog_name);
+      ret = 1;
+      goto cleanup;
+    }
+    if (validate_kernel_version() < 0) {
+      ret = 1;
+      goto cleanup;
+    }
+    cfg.net_mode = DS_NET_NAT;
+    enforce_nat_safety(&cfg, argc, argv);
+    ds_cgroup_host_bootstrap(cfg.force_cgroupv1);
+    ret = ds_bench_net(&cfg, (optind + 2 < argc) ? argv[optind + 2] : NULL,
+                       json_output);
+    goto cleanup;
+  }
+
   /* Lifestyle commands */
   if (strcmp(cmd, "start") == 0) {
     if (validate_configuration_cli(&cfg) < 0) {
@@ -1165,6 +1239,12 @@ int main(int argc, char **argv) {
     goto cleanup;
   }
 
+  if (strcmp(cmd, "config") == 0) {
+    ret = ds_config_command(&cfg, argc - (optind + 1), argv + (optind + 1),
+                            json_output);
+    goto cleanup;
+  }
+
   if (strcmp(cmd, "enter") == 0) {
     if (validate_kernel_version() < 0) {
       ret = 1;
@@ -1189,6 +1269,42 @@ int main(int argc, char **argv) {
     goto cleanup;
   }
 
+  if (strcmp(cmd, "run-batch") == 0) {
+    if (validate_kernel_version() < 0) {
+      ret = 1;
+      goto cleanup;
+    }
+    const char *input = (optind + 1 < argc) ? argv[optind + 1] : NULL;
+    ret = run_batch_in_rootfs(&cfg, input, json_output);
+    if (ret < 0)
+      ret = 1;
+    goto cleanup;
+  }
+
+  /* Terminal channels over a daemon connection (REQ_FLAG_MUX), which the
+   * daemon hands over as DS_MUX_FD */
+  if (strcmp(cmd, "mux") == 0) {
+    const char *fd = getenv("DS_MUX_FD");
+    if (!fd) {
+      ds_error("'mux' needs a multiplexed daemon connection");
+      ret = 1;
+      goto cleanup;
+    }
+    if (validate_kernel_version() < 0) {
+      ret = 1;
+      goto cleanup;
+    }
+    ret = mux_rootfs(&cfg, atoi(fd)) < 0 ? 1 : 0;
+    goto cleanup;
+  }
+
+  if (strcmp(cmd, "replay") == 0) {
+    const char *which = (optind + 1 < argc) ? argv[optind + 1] : NULL;
+    const char *speed = (optind + 2 < argc) ? argv[optind + 2] : NULL;
+    ret = ds_replay_command(&cfg, which, speed) < 0 ? 1 : 0;
+    goto cleanup;
+  }
+
   if (strcmp(cmd, "daemon") == 0) {
     if (getuid() != 0) {
       ds_error("Root privileges required for daemon mode");
@@ -746,7 +746,7 @@ int check_volatile_mode(struct ds_config *cfg) {
   if (!cfg->volatile_mode)
     return 0;
 
-  if (grep_file("/proc/filesystems", "overlay") != 1) {
+  if (!ds_hostcap_fs(DS_HOSTCAP_OVERLAY, "overlay")) {
     ds_error("OverlayFS is not supported by your kernel. Volatile mode cannot "
              "be used.");
     return -1;
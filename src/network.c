@@ -65,8 +65,12 @@ static char g_upstream_ifaces[DS_MAX_UPSTREAM_IFACES][IFNAMSIZ];
 static int g_upstream_count = 0;
 static int g_current_gw_table = 0;
 static pthread_mutex_t g_gw_mutex = PTHREAD_MUTEX_INITIALIZER;
-static int g_route_monitor_sock = -1;
-static volatile sig_atomic_t g_stop_monitor = 0;
+static struct ds_ev g_route_nl = {.fd = -1};   /* rtnetlink link/addr events */
+static struct ds_ev g_route_tick = {.fd = -1}; /* heartbeat timerfd */
+static unsigned int g_route_ticks;
+
+#define ROUTE_TICK_MS 1500
+#define ROUTE_REPROBE_TICKS 10 /* full reprobe every 15s once resolved */
 
 /* Returns 1 if ifname exists and is both UP and RUNNING.
  * On Android, the active data interface has IFF_RUNNING set; an interface
@@ -306,17 +310,12 @@ int ds_net_check_ip_collision(const char *ip_str, const char *exclude_name) {
     snprintf(config_path, sizeof(config_path), "%s/%s/container.config",
              containers_dir, ent->d_name);
 
-    struct ds_config other;
-    memset(&other, 0, sizeof(other));
-    other.net_ready_pipe[0] = other.net_ready_pipe[1] = -1;
-    other.net_done_pipe[0] = other.net_done_pipe[1] = -1;
-
-    if (ds_config_load(config_path, &other) == 0) {
+    /* Only static_nat_ip matters here - peek at the cached summary rather
+     * than parsing a full struct ds_config per container. */
+    struct ds_config_summary other;
+    if (ds_config_peek(config_path, &other) == 0) {
       if (other.static_nat_ip[0] && strcmp(other.static_nat_ip, ip_str) == 0)
         collision = 1;
-      free_config_binds(&other);
-      free_config_env_vars(&other);
-      free_config_unknown_lines(&other);
     }
   }
 
@@ -1097,151 +1096,110 @@ static void do_upstream_reprobe(void) {
   ds_nl_close(ctx);
 }
 
-static void *route_monitor_loop(void *arg) {
-  (void)arg;
-
-  /* Build a comma-separated list for the log line */
-  /* DS_MAX_UPSTREAM_IFACES * (IFNAMSIZ + 1 for comma) + NUL */
-  char iface_list[DS_MAX_UPSTREAM_IFACES * (IFNAMSIZ + 1) + 1];
-  memset(iface_list, 0, sizeof(iface_list));
-  for (int i = 0; i < g_upstream_count; i++) {
-    if (i > 0)
-      strncat(iface_list, ",", sizeof(iface_list) - strlen(iface_list) - 1);
-    strncat(iface_list, g_upstream_ifaces[i],
-            sizeof(iface_list) - strlen(iface_list) - 1);
-  }
-  ds_log("[NET] Upstream route monitor started (interfaces: %s)", iface_list);
-
-  int sock = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
-  if (sock < 0) {
-    ds_warn("[NET] Route monitor: failed to open netlink socket: %s",
-            strerror(errno));
-    return NULL;
+/* Enforce IPv4 forwarding in real-time. Since Android kernels do not
+ * broadcast POLLERR/inotify events for /proc/sys/ memory variables,
+ * we must check it periodically. Reading a 1-byte procfs memory flag
+ * takes < 1 microsecond, costing 0% CPU. */
+static void route_assert_ip_forward(void) {
+  if (g_current_gw_table <= 0)
+    return;
+  char val[4] = {0};
+  if (read_file("/proc/sys/net/ipv4/ip_forward", val, sizeof(val)) > 0 &&
+      val[0] == '0') {
+    ds_log("[NET] Route monitor: ip_forward was disabled by Android, "
+           "re-enabling...");
+    write_file("/proc/sys/net/ipv4/ip_forward", "1\n");
   }
+}
 
-  struct sockaddr_nl sa;
-  memset(&sa, 0, sizeof(sa));
-  sa.nl_family = AF_NETLINK;
-  /* RTMGRP_LINK     - interface state changes (IFF_RUNNING, link up/down)
-   * RTMGRP_IPV4_IFADDR - IPv4 address add/remove on upstream interfaces */
-  sa.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR;
+/* 1.5-second heartbeat.  Android flips ip_forward without any event, so
+ * re-asserting it needs the timer; the check is one procfs read.  Upstream
+ * switches arrive over netlink, so once an upstream is resolved the full
+ * reprobe (a netlink round trip) only runs every ROUTE_REPROBE_TICKS as a
+ * safety net for devices with broken notifications.  Until then it runs
+ * on every tick. */
+static void route_on_tick(struct ds_ev *ev, uint32_t events) {
+  (void)events;
+  ds_ev_timer_ack(ev);
+  route_assert_ip_forward();
+  if (g_current_gw_table > 0 && ++g_route_ticks % ROUTE_REPROBE_TICKS != 0)
+    return;
+  ds_dbg(NET, "Route monitor: heartbeat reprobe (table %d)",
+         g_current_gw_table);
+  do_upstream_reprobe();
+}
 
-  if (bind(sock, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
-    ds_warn("[NET] Route monitor: failed to bind netlink socket: %s",
-            strerror(errno));
-    close(sock);
-    return NULL;
+/* 1 if a link/address event names a declared upstream (or wildcard match) */
+static int route_event_is_upstream(int ifindex) {
+  char evname[IFNAMSIZ] = {0};
+  if_indextoname((unsigned int)ifindex, evname);
+  if (!evname[0] || strncmp(evname, "ds-", 3) == 0)
+    return 0;
+  for (int i = 0; i < g_upstream_count; i++) {
+    if (iface_matches_pattern(g_upstream_ifaces[i], evname))
+      return 1;
   }
+  return 0;
+}
 
-  pthread_mutex_lock(&g_gw_mutex);
-  g_route_monitor_sock = sock;
-  pthread_mutex_unlock(&g_gw_mutex);
-
+static void route_on_netlink(struct ds_ev *ev, uint32_t events) {
+  (void)events;
   uint8_t buf[8192];
-  struct pollfd pfd = {.fd = sock, .events = POLLIN};
-
-  while (!g_stop_monitor) {
-    /* Enforce IPv4 forwarding in real-time. Since Android kernels do not
-     * broadcast POLLERR/inotify events for /proc/sys/ memory variables,
-     * we must check it periodically. Reading a 1-byte procfs memory flag
-     * takes < 1 microsecond, costing 0% CPU. */
-    if (is_android() && g_current_gw_table > 0) {
-      char val[4] = {0};
-      if (read_file("/proc/sys/net/ipv4/ip_forward", val, sizeof(val)) > 0 &&
-          val[0] == '0') {
-        ds_log("[NET] Route monitor: ip_forward was disabled by Android, "
-               "re-enabling...");
-        write_file("/proc/sys/net/ipv4/ip_forward", "1\n");
-      }
-    }
 
-    /* 1.5-second heartbeat: aggressively re-asserts ip_forward and covers
-     * devices with broken netlink notifications. */
-    int pr = poll(&pfd, 1, 1500);
-    if (pr < 0) {
-      if (g_stop_monitor)
-        break;
-      if (errno == EINTR)
-        continue;
-      break;
-    }
+  ssize_t len = recv(ev->fd, buf, sizeof(buf), MSG_DONTWAIT);
+  if (len < 0 && (errno == EINTR || errno == EAGAIN))
+    return;
+  if (len < 0 && errno == ENOBUFS) {
+    /* Socket overran and events were lost: re-derive state from scratch */
+    do_upstream_reprobe();
+    return;
+  }
+  if (len <= 0) {
+    ds_warn("[NET] Route monitor: netlink recv: %s",
+            len < 0 ? strerror(errno) : "closed");
+    ds_net_stop_route_monitor();
+    return;
+  }
 
-    if (pr == 0) {
-      do_upstream_reprobe();
-      continue;
-    }
+  route_assert_ip_forward();
 
-    ssize_t len = recv(sock, buf, sizeof(buf), 0);
-    if (len <= 0) {
-      if (g_stop_monitor)
-        break;
-      if (len < 0 && (errno == EINTR || errno == EAGAIN))
-        continue;
-      break;
-    }
+  int should_reprobe = 0;
+  struct nlmsghdr *h = (struct nlmsghdr *)buf;
 
-    int should_reprobe = 0;
-    struct nlmsghdr *h = (struct nlmsghdr *)buf;
-
-    for (; NLMSG_OK(h, (uint32_t)len); h = NLMSG_NEXT(h, len)) {
-      if (h->nlmsg_type == NLMSG_DONE || h->nlmsg_type == NLMSG_ERROR)
-        break;
-
-      if (h->nlmsg_type == RTM_NEWLINK || h->nlmsg_type == RTM_DELLINK) {
-        /* Filter: care about events on declared upstream interfaces or any
-         * interface matching a wildcard pattern (e.g. "*rmnet_data*").
-         * A new rmnet_dataX popping up mid-session triggers a reprobe so
-         * the monitor can adopt the newly-active interface immediately. */
-        struct ifinfomsg *ifi = NLMSG_DATA(h);
-        char evname[IFNAMSIZ] = {0};
-        if_indextoname((unsigned int)ifi->ifi_index, evname);
-        if (evname[0] && strncmp(evname, "ds-", 3) != 0) {
-          for (int i = 0; i < g_upstream_count; i++) {
-            if (iface_matches_pattern(g_upstream_ifaces[i], evname)) {
-              should_reprobe = 1;
-              break;
-            }
-          }
-        }
-      } else if (h->nlmsg_type == RTM_NEWADDR || h->nlmsg_type == RTM_DELADDR) {
-        struct ifaddrmsg *ifa = NLMSG_DATA(h);
-        if (ifa->ifa_family == AF_INET) {
-          char evname[IFNAMSIZ] = {0};
-          if_indextoname((unsigned int)ifa->ifa_index, evname);
-          if (evname[0] && strncmp(evname, "ds-", 3) != 0) {
-            for (int i = 0; i < g_upstream_count; i++) {
-              if (iface_matches_pattern(g_upstream_ifaces[i], evname)) {
-                should_reprobe = 1;
-                break;
-              }
-            }
-          }
-        }
-      }
+  for (; NLMSG_OK(h, (uint32_t)len); h = NLMSG_NEXT(h, len)) {
+    if (h->nlmsg_type == NLMSG_DONE || h->nlmsg_type == NLMSG_ERROR)
+      break;
 
-      if (should_reprobe)
-        break;
+    if (h->nlmsg_type == RTM_NEWLINK || h->nlmsg_type == RTM_DELLINK) {
+      /* Filter: care about events on declared upstream interfaces or any
+       * interface matching a wildcard pattern (e.g. "*rmnet_data*").
+       * A new rmnet_dataX popping up mid-session triggers a reprobe so
+       * the monitor can adopt the newly-active interface immediately. */
+      struct ifinfomsg *ifi = NLMSG_DATA(h);
+      should_reprobe = route_event_is_upstream(ifi->ifi_index);
+    } else if (h->nlmsg_type == RTM_NEWADDR || h->nlmsg_type == RTM_DELADDR) {
+      struct ifaddrmsg *ifa = NLMSG_DATA(h);
+      if (ifa->ifa_family == AF_INET)
+        should_reprobe = route_event_is_upstream((int)ifa->ifa_index);
     }
 
     if (should_reprobe)
-      do_upstream_reprobe();
+      break;
   }
 
-  pthread_mutex_lock(&g_gw_mutex);
-  close(sock);
-  g_route_monitor_sock = -1;
-  pthread_mutex_unlock(&g_gw_mutex);
-
-  ds_log("[NET] Upstream route monitor stopped");
-  return NULL;
+  if (should_reprobe) {
+    ds_dbg(NET, "Route monitor: netlink event type %u on upstream",
+           h->nlmsg_type);
+    do_upstream_reprobe();
+  }
 }
 
 void ds_net_stop_route_monitor(void) {
-  g_stop_monitor = 1;
-  pthread_mutex_lock(&g_gw_mutex);
-  if (g_route_monitor_sock >= 0)
-    shutdown(g_route_monitor_sock, SHUT_RDWR);
-  pthread_mutex_unlock(&g_gw_mutex);
+  if (g_route_nl.fd < 0)
+    return;
+  ds_ev_close(&g_route_tick);
+  ds_ev_close(&g_route_nl);
+  ds_log("[NET] Upstream route monitor stopped");
 }
 
 void ds_net_start_route_monitor(void) {
@@ -1253,17 +1211,52 @@ void ds_net_start_route_monitor(void) {
     return;
   }
 
-  g_stop_monitor = 0;
+  /* A reboot cycle replaces the previous cycle's monitor */
+  ds_net_stop_route_monitor();
+
+  int sock = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                    NETLINK_ROUTE);
+  if (sock < 0) {
+    ds_warn("[NET] Route monitor: failed to open netlink socket: %s",
+            strerror(errno));
+    return;
+  }
+
+  struct sockaddr_nl sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.nl_family = AF_NETLINK;
+  /* RTMGRP_LINK     - interface state changes (IFF_RUNNING, link up/down)
+   * RTMGRP_IPV4_IFADDR - IPv4 address add/remove on upstream interfaces */
+  sa.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR;
 
-  pthread_t tid;
-  pthread_attr_t attr;
-  pthread_attr_init(&attr);
-  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  if (bind(sock, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+    ds_warn("[NET] Route monitor: failed to bind netlink socket: %s",
+            strerror(errno));
+    close(sock);
+    return;
+  }
 
-  if (pthread_create(&tid, &attr, route_monitor_loop, NULL) != 0)
-    ds_warn("[NET] Failed to start route monitor thread: %s", strerror(errno));
+  if (ds_ev_add(&g_route_nl, sock, EPOLLIN, route_on_netlink, NULL) < 0) {
+    ds_warn("[NET] Failed to start route monitor: %s", strerror(errno));
+    close(sock);
+    return;
+  }
+  g_route_ticks = 0;
+  if (ds_ev_timer_add(&g_route_tick, ROUTE_TICK_MS, ROUTE_TICK_MS,
+                      route_on_tick, NULL) < 0)
+    ds_warn("[NET] Route monitor: no heartbeat timer: %s", strerror(errno));
 
-  pthread_attr_destroy(&attr);
+  /* Build a comma-separated list for the log line */
+  /* DS_MAX_UPSTREAM_IFACES * (IFNAMSIZ + 1 for comma) + NUL */
+  char iface_list[DS_MAX_UPSTREAM_IFACES * (IFNAMSIZ + 1) + 1];
+  memset(iface_list, 0, sizeof(iface_list));
+  for (int i = 0; i < g_upstream_count; i++) {
+    if (i > 0)
+      strncat(iface_list, ",", sizeof(iface_list) - strlen(iface_list) - 1);
+    strncat(iface_list, g_upstream_ifaces[i],
+            sizeof(iface_list) - strlen(iface_list) - 1);
+  }
+  ds_log("[NET] Upstream route monitor started (interfaces: %s)", iface_list);
 }
 
 /* ---------------------------------------------------------------------------
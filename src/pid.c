@@ -128,6 +128,25 @@ int resolve_pidfile_from_name(const char *name, char *pidfile, size_t size) {
   return (r > 0 && (size_t)r < size) ? 0 : -1;
 }
 
+/* Pidfile-only liveness probe for scans that know nothing but the name.
+ * Equivalent to is_container_running() on a zeroed config carrying just
+ * container_name, without building a full struct ds_config per entry. */
+int is_container_running_by_name(const char *name, pid_t *pid_out) {
+  char pidfile[PATH_MAX];
+  pid_t pid = 0;
+
+  if (pid_out)
+    *pid_out = 0;
+  if (!name || !name[0] ||
+      resolve_pidfile_from_name(name, pidfile, sizeof(pidfile)) < 0)
+    return 0;
+
+  int ret = read_and_validate_pid(pidfile, &pid);
+  if (pid_out)
+    *pid_out = pid;
+  return ret == 0 && pid > 0;
+}
+
 int is_container_running(struct ds_config *cfg, pid_t *pid_out) {
   if (cfg->pidfile[0] == '\0') {
     if (cfg->container_name[0] == '\0')
@@ -198,26 +217,25 @@ int count_running_containers(char *first_name, size_t size) {
 
   while ((ent = readdir(d)) != NULL) {
     if (is_pid_file(ent->d_name)) {
-      struct ds_config tmp_cfg = {0};
       char clean_name[256];
       get_container_name_from_pidfile(ent->d_name, clean_name,
                                       sizeof(clean_name));
 
-      safe_strncpy(tmp_cfg.container_name, clean_name,
-                   sizeof(tmp_cfg.container_name));
-      resolve_pidfile_from_name(clean_name, tmp_cfg.pidfile,
-                                sizeof(tmp_cfg.pidfile));
-
       pid_t pid;
-      if (is_container_running(&tmp_cfg, &pid)) {
+      if (is_container_running_by_name(clean_name, &pid)) {
         if (count == 0 && first_name && size > 0) {
           safe_strncpy(first_name, clean_name, size);
         }
         count++;
-      } else if (pid == 0 && access(tmp_cfg.pidfile, F_OK) == 0) {
+      } else if (pid == 0) {
         /* Explicit pruning during scan */
-        unlink(tmp_cfg.pidfile);
-        remove_mount_path(tmp_cfg.pidfile);
+        char pidfile[PATH_MAX];
+        if (resolve_pidfile_from_name(clean_name, pidfile, sizeof(pidfile)) ==
+                0 &&
+            access(pidfile, F_OK) == 0) {
+          unlink(pidfile);
+          remove_mount_path(pidfile);
+        }
       }
     }
   }
@@ -364,12 +382,16 @@ int sync_pidfile(const char *src_pidfile, const char *name) {
  * Status reporting
  * ---------------------------------------------------------------------------*/
 
-int show_containers(void) {
-  struct container_info {
-    char name[256];
-    pid_t pid;
-    int running;
-  } *containers = NULL;
+struct container_info {
+  char name[256];
+  pid_t pid;
+  int running;
+};
+
+/* Installed containers (Containers/) plus running ad-hoc ones (Pids/).
+ * Returns the count with *out malloc'd (caller frees), or -1. */
+static int collect_containers(struct container_info **out) {
+  struct container_info *containers = NULL;
 
   int count = 0;
   int cap = 64;
@@ -400,10 +422,8 @@ int show_containers(void) {
       safe_strncpy(containers[count].name, ent->d_name, sizeof(containers[count].name));
 
       /* Check status */
-      struct ds_config tmp_cfg = {0};
-      safe_strncpy(tmp_cfg.container_name, ent->d_name, sizeof(tmp_cfg.container_name));
       pid_t pid = 0;
-      if (is_container_running(&tmp_cfg, &pid)) {
+      if (is_container_running_by_name(ent->d_name, &pid)) {
         containers[count].running = 1;
         containers[count].pid = pid;
       } else {
@@ -434,10 +454,8 @@ int show_containers(void) {
       }
       if (exists) continue;
 
-      struct ds_config tmp_cfg = {0};
-      safe_strncpy(tmp_cfg.container_name, name, sizeof(tmp_cfg.container_name));
       pid_t pid = 0;
-      if (is_container_running(&tmp_cfg, &pid)) {
+      if (is_container_running_by_name(name, &pid)) {
         if (count >= cap) {
           cap *= 2;
           struct container_info *tmp = realloc(containers, (size_t)cap * sizeof(struct container_info));
@@ -453,6 +471,15 @@ int show_containers(void) {
     closedir(d);
   }
 
+  *out = containers;
+  return count;
+}
+
+int show_containers(void) {
+  struct container_info *containers = NULL;
+  int count = collect_containers(&containers);
+  if (count < 0) return -1;
+
   if (count == 0) {
     printf("\n(No containers found)\n\n");
     free(containers);
@@ -502,6 +529,150 @@ int show_containers(void) {
   return 0;
 }
 
+/* ---------------------------------------------------------------------------
+ * Memory report (stats memory)
+ *
+ * A container's supervisor side is the [ds-monitor] process plus the
+ * per-boot intermediate it forks (which keeps the same name); init is the
+ * intermediate's child, so both are found by walking up from the init PID.
+ * ---------------------------------------------------------------------------*/
+
+struct ds_mem_usage {
+  long rss_kb, pss_kb, uss_kb, swap_kb, vsz_kb;
+  int threads;
+};
+
+static pid_t proc_parent(pid_t pid) {
+  char path[64], buf[512];
+  snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+  if (read_file(path, buf, sizeof(buf)) < 0) return -1;
+
+  /* comm may contain spaces and ')' - the state field follows the last ')' */
+  char *p = strrchr(buf, ')');
+  int ppid;
+  if (!p || sscanf(p + 1, " %*c %d", &ppid) != 1) return -1;
+  return ppid;
+}
+
+static int proc_is_monitor(pid_t pid) {
+  char path[64], comm[32];
+  if (pid <= 1) return 0;
+  snprintf(path, sizeof(path), "/proc/%d/comm", pid);
+  if (read_file(path, comm, sizeof(comm)) < 0) return 0;
+  return strcmp(comm, "[ds-monitor]") == 0;
+}
+
+/* smaps_rollup (Linux 4.14+) has the same field names as one smaps block,
+ * so the fallback for older kernels is the same parse summed over every
+ * mapping.  Sets *rollup to which file was used. */
+static int read_mem_usage(pid_t pid, struct ds_mem_usage *mu, int *rollup) {
+  char path[64], line[256];
+  memset(mu, 0, sizeof(*mu));
+
+  snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", pid);
+  FILE *f = fopen(path, "re");
+  *rollup = (f != NULL);
+  if (!f) {
+    snprintf(path, sizeof(path), "/proc/%d/smaps", pid);
+    f = fopen(path, "re");
+    if (!f) return -1;
+  }
+
+  while (fgets(line, sizeof(line), f)) {
+    long v;
+    if (sscanf(line, "Rss: %ld", &v) == 1)
+      mu->rss_kb += v;
+    else if (sscanf(line, "Pss: %ld", &v) == 1)
+      mu->pss_kb += v;
+    else if (sscanf(line, "Private_Clean: %ld", &v) == 1 ||
+             sscanf(line, "Private_Dirty: %ld", &v) == 1)
+      mu->uss_kb += v;
+    else if (sscanf(line, "Swap: %ld", &v) == 1)
+      mu->swap_kb += v;
+  }
+  fclose(f);
+
+  snprintf(path, sizeof(path), "/proc/%d/status", pid);
+  f = fopen(path, "re");
+  if (f) {
+    while (fgets(line, sizeof(line), f)) {
+      if (sscanf(line, "Threads: %d", &mu->threads) == 1) continue;
+      sscanf(line, "VmSize: %ld", &mu->vsz_kb);
+    }
+    fclose(f);
+  }
+  return 0;
+}
+
+int show_memory_stats(int json) {
+  struct container_info *containers = NULL;
+  int count = collect_containers(&containers);
+  if (count < 0) return -1;
+
+  long total_pss = 0;
+  int shown = 0, rollup = 1;
+
+  if (json)
+    printf("{\"containers\":[");
+  else
+    printf("\n%-24s %8s %7s %10s %10s %10s %10s %10s\n", "NAME", "MONITOR",
+           "THREADS", "RSS", "PSS", "USS", "SWAP", "HELPER PSS");
+
+  for (int i = 0; i < count; i++) {
+    if (!containers[i].running) continue;
+
+    pid_t mid = proc_parent(containers[i].pid);
+    pid_t mon = mid > 0 ? proc_parent(mid) : -1;
+    if (!proc_is_monitor(mid) || !proc_is_monitor(mon)) {
+      ds_warn("%s: no monitor found above init (PID %d)", containers[i].name,
+              containers[i].pid);
+      continue;
+    }
+
+    struct ds_mem_usage m, h;
+    int r1, r2;
+    if (read_mem_usage(mon, &m, &r1) < 0) continue;
+    if (read_mem_usage(mid, &h, &r2) < 0) memset(&h, 0, sizeof(h));
+    rollup = rollup && r1;
+    total_pss += m.pss_kb + h.pss_kb;
+
+    if (json) {
+      printf("%s{\"name\":", shown ? "," : "");
+      ds_json_put_str(stdout, containers[i].name, strlen(containers[i].name));
+      printf(",\"init_pid\":%d,\"monitor_pid\":%d,\"helper_pid\":%d,"
+             "\"threads\":%d,\"vsz_kb\":%ld,\"rss_kb\":%ld,\"pss_kb\":%ld,"
+             "\"uss_kb\":%ld,\"swap_kb\":%ld,\"helper_pss_kb\":%ld}",
+             containers[i].pid, mon, mid, m.threads, m.vsz_kb, m.rss_kb,
+             m.pss_kb, m.uss_kb, m.swap_kb, h.pss_kb);
+    } else {
+      char rss[16], pss[16], uss[16], swp[16], hpss[16];
+      ds_format_size(m.rss_kb * 1024, rss, sizeof(rss));
+      ds_format_size(m.pss_kb * 1024, pss, sizeof(pss));
+      ds_format_size(m.uss_kb * 1024, uss, sizeof(uss));
+      ds_format_size(m.swap_kb * 1024, swp, sizeof(swp));
+      ds_format_size(h.pss_kb * 1024, hpss, sizeof(hpss));
+      printf("%-24.24s %8d %7d %10s %10s %10s %10s %10s\n", containers[i].name,
+             mon, m.threads, rss, pss, uss, swp, hpss);
+    }
+    shown++;
+  }
+
+  if (json) {
+    printf("],\"total_pss_kb\":%ld,\"source\":\"%s\"}\n", total_pss,
+           rollup ? "smaps_rollup" : "smaps");
+  } else if (shown == 0) {
+    printf("(No running containers)\n\n");
+  } else {
+    char tot[16];
+    ds_format_size(total_pss * 1024, tot, sizeof(tot));
+    printf("\nTotal PSS (monitors + helpers): %s  [from %s]\n\n", tot,
+           rollup ? "smaps_rollup" : "summed smaps");
+  }
+
+  free(containers);
+  return 0;
+}
+
 int is_container_init(pid_t pid) {
   char path[PATH_MAX];
   snprintf(path, sizeof(path), "/proc/%d/status", pid);
@@ -0,0 +1,519 @@
+/*
+ * Droidspaces v5 - High-performance Container Runtime
+ *
+ * Copyright (C) 2026 ravindu644 <droidcasts@protonmail.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "droidspace.h"
+
+/* ---------------------------------------------------------------------------
+ * Session Recording (asciicast v2)
+ *
+ * Interactive sessions are recorded to
+ * Logs/<name>/sessions/<date>-<time>-<kind>-<pid>.cast in the asciicast v2
+ * format, so the files also play in asciinema.  The relay only appends
+ * (timestamp, type, bytes) to an in-memory queue; a writer thread does the
+ * JSON encoding and the file I/O off the relay's path.
+ * ---------------------------------------------------------------------------*/
+
+#define REC_SUBDIR "sessions"
+#define REC_QUEUE_MAX (4 * 1024 * 1024) /* queued bytes before data is lost */
+#define REC_WAKE_BYTES (64 * 1024)  /* wake the writer early past this */
+#define REC_FLUSH_MS 250            /* otherwise it writes at this cadence */
+
+struct rec_hdr {
+  double t;
+  uint32_t len;
+  char type; /* 'o' output, 'r' resize */
+};
+
+struct ds_recorder {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  char *q; /* pending events: rec_hdr + payload, back to back */
+  size_t q_len, q_cap;
+  size_t lost; /* payload bytes dropped because the queue was full */
+  int stop;
+  FILE *f;
+  struct timespec start;
+  char carry[4]; /* incomplete UTF-8 tail of the last output event */
+  size_t carry_len;
+  char *scratch; /* writer-side encode buffer */
+  size_t scratch_cap;
+};
+
+static void rec_dir(const char *name, char *buf, size_t size) {
+  char safe_name[256];
+  sanitize_container_name(name, safe_name, sizeof(safe_name));
+  snprintf(buf, size, "%.2048s/%.256s/" REC_SUBDIR, get_logs_dir(), safe_name);
+}
+
+static double rec_now(const struct ds_recorder *r) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)(ts.tv_sec - r->start.tv_sec) +
+         (double)(ts.tv_nsec - r->start.tv_nsec) / 1e9;
+}
+
+/* Write one output event.  JSON strings must be valid UTF-8: invalid bytes
+ * become U+FFFD and a sequence split across reads is carried over. */
+static void rec_put_output(struct ds_recorder *r, double t, const char *data,
+                           size_t len) {
+  size_t in_len = r->carry_len + len;
+  size_t need = in_len * 4; /* input + worst-case output (1 byte -> 3) */
+  if (need > r->scratch_cap) {
+    char *tmp = realloc(r->scratch, need);
+    if (!tmp)
+      return;
+    r->scratch = tmp;
+    r->scratch_cap = need;
+  }
+  unsigned char *in = (unsigned char *)r->scratch;
+  char *out = r->scratch + in_len;
+  memcpy(in, r->carry, r->carry_len);
+  memcpy(in + r->carry_len, data, len);
+
+  size_t i = 0, w = 0;
+  while (i < in_len) {
+    int n = ds_utf8_seq(in + i, in + in_len);
+    if (n < 0)
+      break; /* carry the cut-off tail to the next event */
+    if (n == 0) {
+      memcpy(out + w, "\xEF\xBF\xBD", 3);
+      w += 3;
+      i++;
+    } else {
+      memcpy(out + w, in + i, (size_t)n);
+      w += (size_t)n;
+      i += (size_t)n;
+    }
+  }
+  r->carry_len = in_len - i;
+  memcpy(r->carry, in + i, r->carry_len);
+
+  if (w) {
+    fprintf(r->f, "[%.6f, \"o\", ", t);
+    ds_json_put_str(r->f, out, w);
+    fputs("]\n", r->f);
+  }
+}
+
+static void rec_write_batch(struct ds_recorder *r, const char *buf,
+                            size_t len) {
+  size_t off = 0;
+  while (off + sizeof(struct rec_hdr) <= len) {
+    struct rec_hdr h;
+    memcpy(&h, buf + off, sizeof(h));
+    off += sizeof(h);
+    const char *data = buf + off;
+    off += h.len;
+
+    if (h.type == 'o') {
+      rec_put_output(r, h.t, data, h.len);
+    } else {
+      fprintf(r->f, "[%.6f, \"%c\", ", h.t, h.type);
+      ds_json_put_str(r->f, data, h.len);
+      fputs("]\n", r->f);
+    }
+  }
+}
+
+static void *rec_writer(void *arg) {
+  struct ds_recorder *r = arg;
+  char *batch = NULL;
+  size_t batch_cap = 0;
+
+  pthread_mutex_lock(&r->lock);
+  for (;;) {
+    if (!r->stop && r->q_len < REC_WAKE_BYTES) {
+      struct timespec dl;
+      clock_gettime(CLOCK_MONOTONIC, &dl);
+      dl.tv_nsec += REC_FLUSH_MS * 1000000L;
+      if (dl.tv_nsec >= 1000000000L) {
+        dl.tv_sec++;
+        dl.tv_nsec -= 1000000000L;
+      }
+      pthread_cond_timedwait(&r->cond, &r->lock, &dl);
+    }
+
+    /* Swap buffers so the relay can keep appending while this batch is
+     * encoded without the lock held. */
+    char *q = r->q;
+    size_t q_len = r->q_len, q_cap = r->q_cap;
+    size_t lost = r->lost;
+    int stop = r->stop;
+    r->q = batch;
+    r->q_cap = batch_cap;
+    r->q_len = 0;
+    r->lost = 0;
+    pthread_mutex_unlock(&r->lock);
+
+    if (q_len)
+      rec_write_batch(r, q, q_len);
+    if (lost)
+      fprintf(r->f, "[%.6f, \"m\", \"recorder: %zu bytes lost\"]\n",
+              rec_now(r), lost);
+    if (q_len || lost)
+      fflush(r->f);
+    batch = q;
+    batch_cap = q_cap;
+
+    if (stop)
+      break;
+    pthread_mutex_lock(&r->lock);
+  }
+
+  free(batch);
+  return NULL;
+}
+
+static void rec_append(struct ds_recorder *r, char type, const void *data,
+                       size_t len) {
+  struct rec_hdr h = {.t = rec_now(r), .len = (uint32_t)len, .type = type};
+  size_t need = sizeof(h) + len;
+
+  pthread_mutex_lock(&r->lock);
+  if (r->q_len + need > r->q_cap) {
+    size_t cap = r->q_cap ? r->q_cap : REC_WAKE_BYTES;
+    while (cap < r->q_len + need && cap < REC_QUEUE_MAX)
+      cap *= 2;
+    char *nq = (cap >= r->q_len + need) ? realloc(r->q, cap) : NULL;
+    if (!nq) {
+      /* writer is behind (slow storage): keep the relay moving */
+      r->lost += len;
+      pthread_mutex_unlock(&r->lock);
+      return;
+    }
+    r->q = nq;
+    r->q_cap = cap;
+  }
+  memcpy(r->q + r->q_len, &h, sizeof(h));
+  memcpy(r->q + r->q_len + sizeof(h), data, len);
+  r->q_len += need;
+  if (r->q_len >= REC_WAKE_BYTES && r->q_len - need < REC_WAKE_BYTES)
+    pthread_cond_signal(&r->cond);
+  pthread_mutex_unlock(&r->lock);
+}
+
+/* Start recording a session for container name.  kind names the session
+ * source ("enter", "console", "daemon"); size_fd is queried for the initial
+ * terminal size.  Returns NULL (after a warning) if recording can't start. */
+struct ds_recorder *ds_record_open(const char *name, const char *kind,
+                                   int size_fd) {
+  if (!name || !name[0])
+    return NULL;
+
+  char dir[PATH_MAX];
+  rec_dir(name, dir, sizeof(dir));
+  if (mkdir_p(dir, 0700) < 0) {
+    ds_warn("Session recording disabled: cannot create %s: %s", dir,
+            strerror(errno));
+    return NULL;
+  }
+
+  time_t now = time(NULL);
+  struct tm tm;
+  localtime_r(&now, &tm);
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path),
+           "%.4000s/%04d%02d%02d-%02d%02d%02d-%.16s-%d.cast", dir,
+           tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min,
+           tm.tm_sec, kind, (int)getpid());
+
+  int fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    ds_warn("Session recording disabled: cannot create %s: %s", path,
+            strerror(errno));
+    return NULL;
+  }
+
+  struct ds_recorder *r = calloc(1, sizeof(*r));
+  FILE *f = r ? fdopen(fd, "w") : NULL;
+  if (!f) {
+    free(r);
+    close(fd);
+    unlink(path);
+    return NULL;
+  }
+  r->f = f;
+  clock_gettime(CLOCK_MONOTONIC, &r->start);
+
+  struct winsize ws = {.ws_row = 24, .ws_col = 80};
+  if (ioctl(size_fd, TIOCGWINSZ, &ws) < 0 || !ws.ws_row || !ws.ws_col) {
+    ws.ws_row = 24;
+    ws.ws_col = 80;
+  }
+  char title[320];
+  int tlen = snprintf(title, sizeof(title), "%s %s", name, kind);
+  const char *term = getenv("TERM");
+  fprintf(f, "{\"version\": 2, \"width\": %u, \"height\": %u, "
+             "\"timestamp\": %lld, \"title\": ",
+          ws.ws_col, ws.ws_row, (long long)now);
+  ds_json_put_str(f, title, tlen > 0 ? (size_t)tlen : 0);
+  fputs(", \"env\": {\"TERM\": ", f);
+  ds_json_put_str(f, term ? term : "xterm", strlen(term ? term : "xterm"));
+  fputs("}}\n", f);
+  fflush(f);
+
+  pthread_condattr_t ca;
+  pthread_condattr_init(&ca);
+  pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+  pthread_mutex_init(&r->lock, NULL);
+  pthread_cond_init(&r->cond, &ca);
+  pthread_condattr_destroy(&ca);
+
+  if (ds_thread_create(&r->thread, 0, rec_writer, r) < 0) {
+    ds_warn("Session recording disabled: cannot start writer thread");
+    fclose(f);
+    unlink(path);
+    pthread_mutex_destroy(&r->lock);
+    pthread_cond_destroy(&r->cond);
+    free(r);
+    return NULL;
+  }
+  return r;
+}
+
+void ds_record_output(struct ds_recorder *r, const void *data, size_t len) {
+  if (r && len)
+    rec_append(r, 'o', data, len);
+}
+
+void ds_record_resize(struct ds_recorder *r, unsigned cols, unsigned rows) {
+  if (!r || !cols || !rows)
+    return;
+  char buf[32];
+  int n = snprintf(buf, sizeof(buf), "%ux%u", cols, rows);
+  rec_append(r, 'r', buf, (size_t)n);
+}
+
+/* Flush everything still queued and close the recording. */
+void ds_record_close(struct ds_recorder *r) {
+  if (!r)
+    return;
+  pthread_mutex_lock(&r->lock);
+  r->stop = 1;
+  pthread_cond_signal(&r->cond);
+  pthread_mutex_unlock(&r->lock);
+  pthread_join(r->thread, NULL);
+
+  if (r->carry_len) {
+    /* a sequence that never completed */
+    fprintf(r->f, "[%.6f, \"o\", \"\\ufffd\"]\n", rec_now(r));
+  }
+  fclose(r->f);
+  pthread_mutex_destroy(&r->lock);
+  pthread_cond_destroy(&r->cond);
+  free(r->q);
+  free(r->scratch);
+  free(r);
+}
+
+/* ---------------------------------------------------------------------------
+ * Replay
+ * ---------------------------------------------------------------------------*/
+
+/* Pauses longer than this are shortened on playback, like asciinema's
+ * --idle-time-limit. */
+#define REPLAY_IDLE_LIMIT 2.0
+
+static int cast_name_cmp(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Sorted *.cast names in dir (oldest first, the names start with the
+ * date).  Returns the count, or -1 if dir can't be read. */
+static int list_casts(const char *dir, char ***out) {
+  DIR *d = opendir(dir);
+  if (!d)
+    return -1;
+  char **names = NULL;
+  int n = 0, cap = 0;
+  struct dirent *ent;
+  while ((ent = readdir(d)) != NULL) {
+    size_t len = strlen(ent->d_name);
+    if (len < 6 || strcmp(ent->d_name + len - 5, ".cast") != 0)
+      continue;
+    if (n == cap) {
+      cap = cap ? cap * 2 : 16;
+      char **tmp = realloc(names, (size_t)cap * sizeof(*tmp));
+      if (!tmp)
+        break;
+      names = tmp;
+    }
+    names[n] = strdup(ent->d_name);
+    if (names[n])
+      n++;
+  }
+  closedir(d);
+  if (n > 1)
+    qsort(names, (size_t)n, sizeof(*names), cast_name_cmp);
+  *out = names;
+  return n;
+}
+
+static void free_casts(char **names, int n) {
+  for (int i = 0; i < n; i++)
+    free(names[i]);
+  free(names);
+}
+
+static void replay_sleep(double secs) {
+  if (secs <= 0)
+    return;
+  struct timespec ts = {.tv_sec = (time_t)secs,
+                        .tv_nsec = (long)((secs - (double)(time_t)secs) * 1e9)};
+  while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+    ;
+}
+
+static int replay_file(const char *path, double speed) {
+  FILE *f = fopen(path, "re");
+  if (!f) {
+    ds_error("Cannot open recording %s: %s", path, strerror(errno));
+    return -1;
+  }
+
+  char *line = NULL;
+  size_t cap = 0;
+  ssize_t len = getline(&line, &cap, f);
+  if (len <= 0 || !strstr(line, "\"version\": 2")) {
+    ds_error("%s is not an asciicast v2 recording", path);
+    free(line);
+    fclose(f);
+    return -1;
+  }
+
+  unsigned width = 0, height = 0;
+  const char *w = strstr(line, "\"width\":");
+  const char *h = strstr(line, "\"height\":");
+  if (w)
+    width = (unsigned)strtoul(w + 8, NULL, 10);
+  if (h)
+    height = (unsigned)strtoul(h + 9, NULL, 10);
+  struct winsize ws;
+  if (width && height && ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 &&
+      (ws.ws_col < width || ws.ws_row < height))
+    ds_warn("Recording is %ux%u, this terminal is %ux%u: output may wrap",
+            width, height, ws.ws_col, ws.ws_row);
+
+  double prev = 0;
+  int bad = 0;
+  while ((len = getline(&line, &cap, f)) > 0) {
+    char *p = line, *end = line + len;
+    p = ds_json_skip_ws(p, end);
+    if (p >= end || *p != '[') {
+      bad++;
+      continue;
+    }
+    char *num_end;
+    double t = strtod(p + 1, &num_end);
+    p = ds_json_skip_ws(num_end, end);
+    if (p >= end || *p != ',') {
+      bad++;
+      continue;
+    }
+    p = ds_json_skip_ws(p + 1, end);
+    char *type = (p < end && *p == '"') ? ds_json_get_str(&p, end, NULL) : NULL;
+    if (type)
+      p = ds_json_skip_ws(p, end);
+    if (!type || p >= end || *p != ',') {
+      bad++;
+      continue;
+    }
+    p = ds_json_skip_ws(p + 1, end);
+    size_t dlen = 0;
+    char *data =
+        (p < end && *p == '"') ? ds_json_get_str(&p, end, &dlen) : NULL;
+    if (!data) {
+      bad++;
+      continue;
+    }
+
+    if (strcmp(type, "o") != 0)
+      continue; /* resize, marker and input events don't draw anything */
+
+    double gap = t - prev;
+    if (gap > REPLAY_IDLE_LIMIT)
+      gap = REPLAY_IDLE_LIMIT;
+    replay_sleep(gap / speed);
+    prev = t;
+    if (write_all(STDOUT_FILENO, data, dlen) < 0)
+      break;
+  }
+
+  free(line);
+  fclose(f);
+  if (bad)
+    ds_warn("Skipped %d malformed event line(s) in %s", bad, path);
+  return 0;
+}
+
+/* `replay`: without which, list the container's recordings; otherwise
+ * play which (a path, a file name from the list, or "latest"). */
+int ds_replay_command(struct ds_config *cfg, const char *which,
+                      const char *speed_arg) {
+  double speed = 1.0;
+  if (speed_arg) {
+    char *endp;
+    speed = strtod(speed_arg, &endp);
+    if (endp == speed_arg || *endp || !(speed > 0)) {
+      ds_error("Invalid replay speed: %s", speed_arg);
+      return -1;
+    }
+  }
+
+  if (which && strchr(which, '/'))
+    return replay_file(which, speed);
+
+  if (!cfg->container_name[0]) {
+    ds_error("replay needs --name=NAME (or a path to a .cast file)");
+    return -1;
+  }
+
+  char dir[PATH_MAX];
+  rec_dir(cfg->container_name, dir, sizeof(dir));
+  char **names = NULL;
+  int n = list_casts(dir, &names);
+  if (n <= 0) {
+    ds_log("No recorded sessions for '%s'.", cfg->container_name);
+    if (n == 0)
+      free(names);
+    return which ? -1 : 0;
+  }
+
+  int ret = 0;
+  if (!which) {
+    for (int i = 0; i < n; i++) {
+      char path[PATH_MAX];
+      struct stat st;
+      snprintf(path, sizeof(path), "%.3800s/%s", dir, names[i]);
+      if (stat(path, &st) == 0)
+        printf("%-48s %10lld bytes\n", names[i], (long long)st.st_size);
+    }
+  } else {
+    const char *pick = NULL;
+    if (strcmp(which, "latest") == 0) {
+      pick = names[n - 1];
+    } else {
+      size_t wl = strlen(which);
+      for (int i = 0; i < n && !pick; i++)
+        if (strcmp(names[i], which) == 0 ||
+            (strncmp(names[i], which, wl) == 0 &&
+             strcmp(names[i] + wl, ".cast") == 0))
+          pick = names[i];
+    }
+    if (!pick) {
+      ds_error("No recording named '%s' (run 'replay' to list them)", which);
+      ret = -1;
+    } else {
+      char path[PATH_MAX];
+      snprintf(path, sizeof(path), "%.3800s/%s", dir, pick);
+      ret = replay_file(path, speed);
+    }
+  }
+  free_casts(names, n);
+  return ret;
+}
@@ -13,225 +13,332 @@
 #include <sys/prctl.h>
 
 /* ---------------------------------------------------------------------------
- * Android System Call Filtering (Seccomp)
+ * Filter compiler
+ *
+ * All container rules are merged into ONE program so the kernel runs a
+ * single filter per syscall instead of two stacked ones.  After the arch
+ * check and nr load, the program is:
+ *
+ *   - a range guard: syscalls below the lowest or above the highest ruled
+ *     number return ALLOW after one or two compares (read/write/futex/...
+ *     on every supported ABI take this path);
+ *   - a balanced binary search (JGE) over the intervals between ruled
+ *     numbers, so any syscall is classified in O(log n) compares;
+ *   - leaves that return a constant action, or test args[0] against a flag
+ *     mask for clone/unshare.
+ *
+ * Only arch and nr are loaded on the way to every leaf except the
+ * clone/unshare ones, and only JEQ/JGE/JGT/JSET with constants are used.
+ * That is exactly what the kernel's seccomp action cache (5.11+) can
+ * emulate, so every other syscall lands in its constant-ALLOW bitmap and
+ * skips BPF evaluation entirely.  sec_const_allow() mirrors the kernel's
+ * emulator so the property can be checked when SEC debugging is on.
  * ---------------------------------------------------------------------------*/
 
-/**
- * ds_seccomp_apply_minimal()
- *
- * Blocks direct host kernel takeover vectors (module loading, kexec).
- * Applied unconditionally to all kernels and all modes.
- */
-int ds_seccomp_apply_minimal(int hw_access, int privileged_mask) {
-  (void)hw_access;
-  static struct sock_filter filter[64];
-  int curr = 0;
-
-  /* 1. Validate Architecture */
-  filter[curr++] = (struct sock_filter)BPF_STMT(
-      BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch));
 #if defined(__aarch64__)
-  filter[curr++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
-                                                AUDIT_ARCH_AARCH64, 1, 0);
+#define DS_SEC_AUDIT_ARCH AUDIT_ARCH_AARCH64
 #elif defined(__x86_64__)
-  filter[curr++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
-                                                AUDIT_ARCH_X86_64, 1, 0);
+#define DS_SEC_AUDIT_ARCH AUDIT_ARCH_X86_64
 #elif defined(__arm__)
-  filter[curr++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
-                                                AUDIT_ARCH_ARM, 1, 0);
+#define DS_SEC_AUDIT_ARCH AUDIT_ARCH_ARM
 #elif defined(__i386__)
-  filter[curr++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
-                                                AUDIT_ARCH_I386, 1, 0);
+#define DS_SEC_AUDIT_ARCH AUDIT_ARCH_I386
 #endif
-  filter[curr++] =
-      (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS);
+
+#define DS_SEC_MAX_RULES 16
+#define DS_SEC_MAX_INSNS 128 /* well below the 255 reach of a BPF jt/jf */
+
+/* CLONE_NEWNS|CLONE_NEWCGROUP|CLONE_NEWUTS|CLONE_NEWIPC|CLONE_NEWUSER|
+ * CLONE_NEWPID|CLONE_NEWNET */
+#define DS_SEC_NS_MASK 0x7E020000u
+#define DS_SEC_NEWUSER 0x10000000u
+
+struct ds_sec_rule {
+  uint32_t nr;
+  uint32_t action;    /* SECCOMP_RET_* returned when the rule matches */
+  uint32_t arg0_mask; /* 0: unconditional, else match iff args[0] & mask */
+};
+
+struct ds_sec_prog {
+  struct sock_filter insns[DS_SEC_MAX_INSNS];
+  int len;
+  int overflow;
+};
+
+static void sec_emit(struct ds_sec_prog *p, struct sock_filter insn) {
+  if (p->len >= DS_SEC_MAX_INSNS) {
+    p->overflow = 1;
+    return;
+  }
+  p->insns[p->len++] = insn;
+}
+
+/* Add or merge a rule.  Two rules on the same syscall with the same action
+ * combine their flag masks (an unconditional rule absorbs any mask). */
+static void sec_add_rule(struct ds_sec_rule *rules, int *count, uint32_t nr,
+                         uint32_t action, uint32_t arg0_mask) {
+  for (int i = 0; i < *count; i++) {
+    if (rules[i].nr != nr)
+      continue;
+    if (rules[i].action == action) {
+      if (rules[i].arg0_mask && arg0_mask)
+        rules[i].arg0_mask |= arg0_mask;
+      else
+        rules[i].arg0_mask = 0;
+    } else if (!arg0_mask && rules[i].arg0_mask) {
+      /* an unconditional rule wins over a conditional one */
+      rules[i].action = action;
+      rules[i].arg0_mask = 0;
+    }
+    return;
+  }
+  if (*count < DS_SEC_MAX_RULES)
+    rules[(*count)++] = (struct ds_sec_rule){nr, action, arg0_mask};
+}
+
+static int sec_rule_cmp(const void *a, const void *b) {
+  uint32_t x = ((const struct ds_sec_rule *)a)->nr;
+  uint32_t y = ((const struct ds_sec_rule *)b)->nr;
+  return (x > y) - (x < y);
+}
+
+static void sec_emit_leaf(struct ds_sec_prog *p, const struct ds_sec_rule *r) {
+  if (!r) {
+    sec_emit(p, (struct sock_filter)BPF_STMT(BPF_RET | BPF_K,
+                                             SECCOMP_RET_ALLOW));
+    return;
+  }
+  if (!r->arg0_mask) {
+    sec_emit(p, (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, r->action));
+    return;
+  }
+  sec_emit(p, (struct sock_filter)BPF_STMT(
+                  BPF_LD | BPF_W | BPF_ABS,
+                  offsetof(struct seccomp_data, args[0])));
+  sec_emit(p, (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K,
+                                           r->arg0_mask, 0, 1));
+  sec_emit(p, (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, r->action));
+  sec_emit(p, (struct sock_filter)BPF_STMT(BPF_RET | BPF_K,
+                                           SECCOMP_RET_ALLOW));
+}
+
+/*
+ * Interval i covers [lo[i], lo[i+1]) and is either exactly one ruled
+ * syscall (rule[i] != NULL) or a gap between two of them (NULL = ALLOW).
+ * Emit a balanced JGE search over intervals [first, last].  The "false"
+ * branch falls through to the lower half; the true offset is patched once
+ * the lower half's size is known.
+ */
+static void sec_emit_search(struct ds_sec_prog *p, const uint32_t *lo,
+                            const struct ds_sec_rule *const *rule, int first,
+                            int last) {
+  if (first == last) {
+    sec_emit_leaf(p, rule[first]);
+    return;
+  }
+  int mid = first + (last - first + 1) / 2;
+  int at = p->len;
+  sec_emit(p, (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, lo[mid],
+                                           0, 0));
+  sec_emit_search(p, lo, rule, first, mid - 1);
+  int jt = p->len - (at + 1);
+  if (jt > 255)
+    p->overflow = 1;
+  else if (at < DS_SEC_MAX_INSNS)
+    p->insns[at].jt = (uint8_t)jt;
+  sec_emit_search(p, lo, rule, mid, last);
+}
+
+static int sec_compile(struct ds_sec_prog *p, struct ds_sec_rule *rules,
+                       int count) {
+  memset(p, 0, sizeof(*p));
+
+  /* 1. Validate Architecture: KILL on mismatch */
+  sec_emit(p, (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+                                           offsetof(struct seccomp_data, arch)));
+  sec_emit(p, (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+                                           DS_SEC_AUDIT_ARCH, 1, 0));
+  sec_emit(p, (struct sock_filter)BPF_STMT(BPF_RET | BPF_K,
+                                           SECCOMP_RET_KILL_PROCESS));
 
   /* 2. Load syscall number */
-  filter[curr++] = (struct sock_filter)BPF_STMT(
-      BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr));
+  sec_emit(p, (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+                                           offsetof(struct seccomp_data, nr)));
 
 #if defined(__x86_64__)
   /* 3. Block x32 ABI */
-  filter[curr++] =
-      (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, 0x40000000, 0, 1);
-  filter[curr++] =
-      (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS);
+  sec_emit(p, (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K,
+                                           0x40000000, 0, 1));
+  sec_emit(p, (struct sock_filter)BPF_STMT(BPF_RET | BPF_K,
+                                           SECCOMP_RET_KILL_PROCESS));
 #endif
 
-  if (!(privileged_mask & DS_PRIV_NOSEC)) {
-    /* 4. Kernel module loading */
-    filter[curr++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
-                                                  __NR_init_module, 0, 1);
-    filter[curr++] =
-        (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS);
-    filter[curr++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
-                                                  __NR_finit_module, 0, 1);
-    filter[curr++] =
-        (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS);
-    filter[curr++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
-                                                  __NR_delete_module, 0, 1);
-    filter[curr++] =
-        (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS);
-
-    /* 5. kexec */
-    filter[curr++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
-                                                  __NR_kexec_load, 0, 1);
-    filter[curr++] =
-        (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS);
-#ifdef __NR_kexec_file_load
-    filter[curr++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
-                                                  __NR_kexec_file_load, 0, 1);
-    filter[curr++] =
-        (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS);
-#endif
+  if (count == 0) {
+    sec_emit(p, (struct sock_filter)BPF_STMT(BPF_RET | BPF_K,
+                                             SECCOMP_RET_ALLOW));
+    return p->overflow ? -1 : 0;
+  }
 
-#ifdef __NR_clone3
-    /* 6. Block clone3 */
-    filter[curr++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
-                                                  __NR_clone3, 0, 1);
-    filter[curr++] = (struct sock_filter)BPF_STMT(
-        BPF_RET | BPF_K, SECCOMP_RET_ERRNO | (ENOSYS & SECCOMP_RET_DATA));
-#endif
+  qsort(rules, (size_t)count, sizeof(*rules), sec_rule_cmp);
+  uint32_t min_nr = rules[0].nr, max_nr = rules[count - 1].nr;
 
-    /* 7. unshare(CLONE_NEWUSER) */
-    filter[curr++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
-                                                  __NR_unshare, 0, 4);
-    filter[curr++] = (struct sock_filter)BPF_STMT(
-        BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, args[0]));
-    filter[curr++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K,
-                                                  0x10000000, 0, 1);
-    filter[curr++] = (struct sock_filter)BPF_STMT(
-        BPF_RET | BPF_K, SECCOMP_RET_ERRNO | (EPERM & SECCOMP_RET_DATA));
-    filter[curr++] = (struct sock_filter)BPF_STMT(
-        BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr));
-
-    /* 8. clone(CLONE_NEWUSER) */
-    filter[curr++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
-                                                  __NR_clone, 0, 3);
-    filter[curr++] = (struct sock_filter)BPF_STMT(
-        BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, args[0]));
-    filter[curr++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K,
-                                                  0x10000000, 0, 1);
-    filter[curr++] = (struct sock_filter)BPF_STMT(
-        BPF_RET | BPF_K, SECCOMP_RET_ERRNO | (EPERM & SECCOMP_RET_DATA));
+  /* 4. Fast path: outside [min_nr, max_nr] nothing is ruled */
+  sec_emit(p, (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, min_nr,
+                                           1, 0));
+  sec_emit(p, (struct sock_filter)BPF_STMT(BPF_RET | BPF_K,
+                                           SECCOMP_RET_ALLOW));
+  sec_emit(p, (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, max_nr,
+                                           0, 1));
+  sec_emit(p, (struct sock_filter)BPF_STMT(BPF_RET | BPF_K,
+                                           SECCOMP_RET_ALLOW));
+
+  /* 5. Binary search over [min_nr, max_nr] split into rule/gap intervals */
+  uint32_t lo[2 * DS_SEC_MAX_RULES];
+  const struct ds_sec_rule *rule[2 * DS_SEC_MAX_RULES];
+  int n = 0;
+  for (int i = 0; i < count; i++) {
+    lo[n] = rules[i].nr;
+    rule[n++] = &rules[i];
+    if (i + 1 < count && rules[i + 1].nr > rules[i].nr + 1) {
+      lo[n] = rules[i].nr + 1;
+      rule[n++] = NULL;
+    }
   }
+  sec_emit_search(p, lo, rule, 0, n - 1);
 
-  /* Allow everything else */
-  filter[curr++] =
-      (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW);
+  return p->overflow ? -1 : 0;
+}
 
-  struct sock_fprog prog = {
-      .len = (unsigned short)curr,
-      .filter = filter,
-  };
+/* Mirror of the kernel's seccomp_is_const_allow(): true iff the program
+ * returns ALLOW for (arch, nr) without ever looking at the arguments. */
+static int sec_const_allow(const struct ds_sec_prog *p, uint32_t arch,
+                           uint32_t nr) {
+  uint32_t reg = 0;
 
-  if (prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog) < 0) {
-    ds_warn("[SEC] Failed to apply minimal seccomp filter: %s",
-            strerror(errno));
-    return -1;
+  for (int pc = 0; pc < p->len; pc++) {
+    const struct sock_filter *f = &p->insns[pc];
+    int res;
+
+    switch (f->code) {
+    case BPF_LD | BPF_W | BPF_ABS:
+      if (f->k == offsetof(struct seccomp_data, nr))
+        reg = nr;
+      else if (f->k == offsetof(struct seccomp_data, arch))
+        reg = arch;
+      else
+        return 0;
+      continue;
+    case BPF_RET | BPF_K:
+      return f->k == SECCOMP_RET_ALLOW;
+    case BPF_JMP | BPF_JEQ | BPF_K:
+      res = reg == f->k;
+      break;
+    case BPF_JMP | BPF_JGE | BPF_K:
+      res = reg >= f->k;
+      break;
+    case BPF_JMP | BPF_JGT | BPF_K:
+      res = reg > f->k;
+      break;
+    case BPF_JMP | BPF_JSET | BPF_K:
+      res = !!(reg & f->k);
+      break;
+    default:
+      return 0;
+    }
+    pc += res ? f->jt : f->jf;
   }
   return 0;
 }
 
+/* Report how many native syscalls the action cache can bypass and which
+ * ones still run the filter. */
+static void sec_report_cache(const struct ds_sec_prog *p) {
+  char slow[256] = "";
+  size_t off = 0;
+  int allow = 0, total = 512;
+
+  for (int nr = 0; nr < total; nr++) {
+    if (sec_const_allow(p, DS_SEC_AUDIT_ARCH, (uint32_t)nr)) {
+      allow++;
+    } else if (off < sizeof(slow) - 8) {
+      int w = snprintf(slow + off, sizeof(slow) - off, " %d", nr);
+      if (w > 0)
+        off += (size_t)w;
+    }
+  }
+  ds_dbg(SEC, "Filter: %d insns, %d/%d syscalls constant-ALLOW; filtered:%s",
+         p->len, allow, total, slow);
+}
+
+/* ---------------------------------------------------------------------------
+ * Container System Call Filtering (Seccomp)
+ * ---------------------------------------------------------------------------*/
+
 /**
- * android_seccomp_setup()
+ * ds_seccomp_apply()
+ *
+ * Installs the single merged filter for container processes:
  *
- * Applies a seccomp BPF filter for Android compatibility.
+ * 1. Host takeover vectors (KILL): module loading and kexec.  clone3 gets
+ *    ENOSYS (its flags live in user memory, so it can't be inspected) and
+ *    clone/unshare(CLONE_NEWUSER) get EPERM.  Skipped for noseccomp.
+ * 2. Keyring compat (ENOSYS): legacy kernels (< 5.0) only.
+ * 3. Deadlock Shield (EPERM): all namespace flags on unshare/clone when
+ *    block_nested_ns is set (manual override).
  *
- * 1. Keyring compat (ENOSYS): Applied on legacy kernels (< 5.0) to avoid
- *    traversing missing systems.
- * 2. Deadlock Shield (EPERM): Blocks namespace creation (unshare/clone).
- *    Applied ONLY if block_nested_ns is true (manual override).
+ * The arch and x32 checks are applied unconditionally.
  */
-int android_seccomp_setup(int is_systemd, int block_nested_ns) {
-  (void)is_systemd;
-  int major = 0, minor = 0;
-  get_kernel_version(&major, &minor);
-
-  /* ns_mask covers: CLONE_NEWNS|CLONE_NEWCGROUP|CLONE_NEWUTS|CLONE_NEWIPC|
-   *                 CLONE_NEWUSER|CLONE_NEWPID|CLONE_NEWNET */
-  const uint32_t ns_mask = 0x7E020000;
+int ds_seccomp_apply(int privileged_mask, int block_nested_ns) {
+  struct ds_sec_rule rules[DS_SEC_MAX_RULES];
+  int count = 0;
+  const uint32_t kill = SECCOMP_RET_KILL_PROCESS;
+  const uint32_t eperm = SECCOMP_RET_ERRNO | (EPERM & SECCOMP_RET_DATA);
+  const uint32_t enosys = SECCOMP_RET_ERRNO | (ENOSYS & SECCOMP_RET_DATA);
 
-  if (!block_nested_ns && major >= 5) {
-    return 0;
-  }
-
-  /* Define base filter (arch check + load nr) */
-  struct sock_filter filter_base[] = {
-      /* Same wrong-arch fix as ds_seccomp_apply_minimal: KILL on mismatch. */
-      BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch)),
-#if defined(__aarch64__)
-      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, AUDIT_ARCH_AARCH64, 1, 0),
-#elif defined(__x86_64__)
-      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, AUDIT_ARCH_X86_64, 1, 0),
-#elif defined(__arm__)
-      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, AUDIT_ARCH_ARM, 1, 0),
-#elif defined(__i386__)
-      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, AUDIT_ARCH_I386, 1, 0),
+  if (!(privileged_mask & DS_PRIV_NOSEC)) {
+    sec_add_rule(rules, &count, __NR_init_module, kill, 0);
+    sec_add_rule(rules, &count, __NR_finit_module, kill, 0);
+    sec_add_rule(rules, &count, __NR_delete_module, kill, 0);
+    sec_add_rule(rules, &count, __NR_kexec_load, kill, 0);
+#ifdef __NR_kexec_file_load
+    sec_add_rule(rules, &count, __NR_kexec_file_load, kill, 0);
 #endif
-      BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS), /* wrong arch */
-      BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr)),
-  };
+#ifdef __NR_clone3
+    sec_add_rule(rules, &count, __NR_clone3, enosys, 0);
+#endif
+    sec_add_rule(rules, &count, __NR_unshare, eperm, DS_SEC_NEWUSER);
+    sec_add_rule(rules, &count, __NR_clone, eperm, DS_SEC_NEWUSER);
+  }
 
-  struct sock_filter filter_keyring[] = {
-      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_keyctl, 0, 1),
-      BPF_STMT(BPF_RET | BPF_K,
-               SECCOMP_RET_ERRNO | (ENOSYS & SECCOMP_RET_DATA))};
-
-  struct sock_filter filter_ns[] = {
-      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_unshare, 1, 0),
-      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_clone, 0, 3),
-      BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
-               offsetof(struct seccomp_data, args[0])),
-      BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, ns_mask, 0, 1),
-      BPF_STMT(BPF_RET | BPF_K,
-               SECCOMP_RET_ERRNO | (EPERM & SECCOMP_RET_DATA))};
-
-  struct sock_filter filter_allow[] = {
-      BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW)};
-
-  /* Combine filters based on conditions */
-  int filter_len = sizeof(filter_base) / sizeof(struct sock_filter);
+  int major = 0, minor = 0;
+  get_kernel_version(&major, &minor);
   if (major < 5)
-    filter_len += sizeof(filter_keyring) / sizeof(struct sock_filter);
-  if (block_nested_ns)
-    filter_len += sizeof(filter_ns) / sizeof(struct sock_filter);
-  filter_len += sizeof(filter_allow) / sizeof(struct sock_filter);
-
-  struct sock_filter *final_filter =
-      malloc(filter_len * sizeof(struct sock_filter));
-  if (!final_filter)
-    return -1;
-
-  int curr = 0;
-  memcpy(final_filter + curr, filter_base, sizeof(filter_base));
-  curr += sizeof(filter_base) / sizeof(struct sock_filter);
-
-  if (major < 5) {
-    memcpy(final_filter + curr, filter_keyring, sizeof(filter_keyring));
-    curr += sizeof(filter_keyring) / sizeof(struct sock_filter);
-  }
+    sec_add_rule(rules, &count, __NR_keyctl, enosys, 0);
 
   if (block_nested_ns) {
     ds_log(
         "[SEC] --block-nested-namespaces: force blocking namespace syscalls.");
-    memcpy(final_filter + curr, filter_ns, sizeof(filter_ns));
-    curr += sizeof(filter_ns) / sizeof(struct sock_filter);
+    sec_add_rule(rules, &count, __NR_unshare, eperm, DS_SEC_NS_MASK);
+    sec_add_rule(rules, &count, __NR_clone, eperm, DS_SEC_NS_MASK);
   }
 
-  memcpy(final_filter + curr, filter_allow, sizeof(filter_allow));
+  struct ds_sec_prog prog;
+  if (sec_compile(&prog, rules, count) < 0) {
+    ds_warn("[SEC] Seccomp filter too large (%d rules)", count);
+    return -1;
+  }
 
-  struct sock_fprog prog = {
-      .len = (unsigned short)filter_len,
-      .filter = final_filter,
+  if (ds_dbg_enabled(SEC))
+    sec_report_cache(&prog);
+
+  struct sock_fprog fprog = {
+      .len = (unsigned short)prog.len,
+      .filter = prog.insns,
   };
 
-  if (prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog) < 0) {
-    ds_warn("Failed to apply Seccomp filter: %s", strerror(errno));
-    free(final_filter);
+  if (prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &fprog) < 0) {
+    ds_warn("[SEC] Failed to apply seccomp filter: %s", strerror(errno));
     return -1;
   }
-
-  free(final_filter);
   return 0;
 }
@@ -13,12 +13,20 @@
  * ---------------------------------------------------------------------------*/
 
 int ds_terminal_create(struct ds_tty_info *tty) {
-  /* openpty() allocates a master/slave pair.
-   * slave name is returned in tty->name. */
-  if (openpty(&tty->master, &tty->slave, tty->name, NULL, NULL) < 0) {
+  /* openpty() allocates a master/slave pair.  Its name argument has no
+   * length, so the slave name is fetched with the bounded ptsname_r(). */
+  if (openpty(&tty->master, &tty->slave, NULL, NULL, NULL) < 0) {
     ds_error("openpty failed: %s", strerror(errno));
     return -1;
   }
+  int err = ptsname_r(tty->master, tty->name, sizeof(tty->name));
+  if (err != 0) {
+    ds_error("ptsname_r failed: %s", strerror(err));
+    close(tty->master);
+    close(tty->slave);
+    tty->master = tty->slave = -1;
+    return -1;
+  }
 
   /* Set ownership and permissions for the slave TTY */
   if (fchown(tty->slave, 0, 5) < 0) {
@@ -150,30 +158,393 @@ static void handle_sigwinch(int sig) {
   g_sigwinch_received = 1;
 }
 
-static void update_terminal_size(int master_fd) {
+static void update_terminal_size(int master_fd, struct ds_recorder *rec) {
   struct winsize ws;
   if (ioctl(STDIN_FILENO, TIOCGWINSZ, &ws) == 0) {
     ioctl(master_fd, TIOCSWINSZ, &ws);
+    ds_record_resize(rec, ws.ws_col, ws.ws_row);
+  }
+}
+
+/* ---------------------------------------------------------------------------
+ * PTY Relay
+ * ---------------------------------------------------------------------------*/
+
+/* Largest single read from the user's terminal. */
+#define RELAY_IN_CHUNK 4096
+
+/* With DS_PTY_THROTTLE set, a full output ring sheds this much of its
+ * oldest backlog so the newest output reaches the screen first. */
+#define RELAY_DROP_CHUNK (DS_RELAY_RING_SIZE / 4)
+
+/* ...and on exit flushes only this much of whatever is still queued. */
+#define RELAY_TAIL_KEEP 4096
+
+static size_t ring_free(const struct ds_relay_ring *rg) {
+  return sizeof(rg->buf) - rg->len;
+}
+
+/* Queued bytes as at most two iovecs (the data may wrap). */
+static int ring_data_iov(struct ds_relay_ring *rg, struct iovec iov[2]) {
+  size_t first = rg->len;
+  int cnt = 0;
+
+  if (rg->head + first > sizeof(rg->buf))
+    first = sizeof(rg->buf) - rg->head;
+  if (first) {
+    iov[cnt].iov_base = rg->buf + rg->head;
+    iov[cnt++].iov_len = first;
+  }
+  if (rg->len > first) {
+    iov[cnt].iov_base = rg->buf;
+    iov[cnt++].iov_len = rg->len - first;
+  }
+  return cnt;
+}
+
+/* Free space as at most two iovecs. */
+static int ring_space_iov(struct ds_relay_ring *rg, struct iovec iov[2]) {
+  size_t tail = (rg->head + rg->len) % sizeof(rg->buf);
+  size_t space = ring_free(rg);
+  size_t first = space;
+  int cnt = 0;
+
+  if (tail + first > sizeof(rg->buf))
+    first = sizeof(rg->buf) - tail;
+  if (first) {
+    iov[cnt].iov_base = rg->buf + tail;
+    iov[cnt++].iov_len = first;
+  }
+  if (space > first) {
+    iov[cnt].iov_base = rg->buf;
+    iov[cnt++].iov_len = space - first;
+  }
+  return cnt;
+}
+
+static void ring_consume(struct ds_relay_ring *rg, size_t n) {
+  rg->head = (rg->head + n) % sizeof(rg->buf);
+  rg->len -= n;
+  if (rg->len == 0)
+    rg->head = 0;
+}
+
+/* Caller guarantees n <= ring_free(). */
+static void ring_push(struct ds_relay_ring *rg, const char *data, size_t n) {
+  size_t tail = (rg->head + rg->len) % sizeof(rg->buf);
+  size_t first = sizeof(rg->buf) - tail;
+
+  if (first > n)
+    first = n;
+  memcpy(rg->buf + tail, data, first);
+  memcpy(rg->buf, data + first, n - first);
+  rg->len += n;
+}
+
+/* Write out as much of the ring as fd accepts in one writev() per pass.
+ * Returns 0 when drained or the fd would block, -1 on a hard error. */
+static int ring_flush(int fd, struct ds_relay_ring *rg) {
+  while (rg->len > 0) {
+    struct iovec iov[2];
+    int cnt = ring_data_iov(rg, iov);
+    ssize_t n = writev(fd, iov, cnt);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return errno == EAGAIN ? 0 : -1;
+    }
+    ring_consume(rg, (size_t)n);
+  }
+  return 0;
+}
+
+/* readv() straight into the ring's free space, handing what was read to
+ * the session recorder (if any). */
+static ssize_t ring_fill(int fd, struct ds_relay_ring *rg,
+                         struct ds_recorder *rec) {
+  struct iovec iov[2];
+  int cnt = ring_space_iov(rg, iov);
+  ssize_t n = readv(fd, iov, cnt);
+  if (n > 0) {
+    rg->len += (size_t)n;
+    if (rec) {
+      size_t first = (size_t)n < iov[0].iov_len ? (size_t)n : iov[0].iov_len;
+      ds_record_output(rec, iov[0].iov_base, first);
+      if ((size_t)n > first)
+        ds_record_output(rec, iov[1].iov_base, (size_t)n - first);
+    }
+  }
+  return n;
+}
+
+static void relay_arm(struct ds_pty_relay *r, int fd, uint32_t *cur,
+                      uint32_t want) {
+  if (*cur == want)
+    return;
+  struct epoll_event ev = {.events = want, .data.fd = fd};
+  if (epoll_ctl(r->epfd, EPOLL_CTL_MOD, fd, &ev) == 0)
+    *cur = want;
+}
+
+static void relay_forget(struct ds_pty_relay *r, int fd, uint32_t *cur) {
+  epoll_ctl(r->epfd, EPOLL_CTL_DEL, fd, NULL);
+  *cur = 0;
+}
+
+static void relay_note_dropped(struct ds_pty_relay *r) {
+  char note[96];
+  int n = snprintf(note, sizeof(note),
+                   "\r\n\033[0m[droidspaces: %zu bytes of output skipped]\r\n",
+                   r->dropped);
+  if (n > 0 && (size_t)n <= ring_free(&r->to_out))
+    ring_push(&r->to_out, note, (size_t)n);
+  r->dropped = 0;
+}
+
+/* One pass over both directions.  Returns 1 once the relay is finished. */
+static int relay_pump(struct ds_pty_relay *r) {
+  char chunk[RELAY_IN_CHUNK];
+
+  /* User input first, so a keystroke such as Ctrl-C is already on its way
+   * to the container before any pending output is touched. */
+  while (!r->in_done && ring_free(&r->to_master) > 0) {
+    size_t want = ring_free(&r->to_master);
+    if (want > sizeof(chunk))
+      want = sizeof(chunk);
+    ssize_t n = read(r->in_fd, chunk, want);
+    if (n > 0) {
+      size_t keep = (size_t)n;
+      if (r->in_filter)
+        keep = r->in_filter(r->filter_ctx, chunk, keep);
+      ring_push(&r->to_master, chunk, keep);
+      continue;
+    }
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0 && errno == EAGAIN)
+      break;
+    /* EOF, or the terminal went away */
+    r->in_done = 1;
+    if (r->in_pollable)
+      relay_forget(r, r->in_fd, &r->in_ev);
+  }
+  if (ring_flush(r->master_fd, &r->to_master) < 0)
+    return 1;
+  if (r->in_done && r->eof_ends && r->to_master.len == 0)
+    return 1;
+
+  /* Container output, bounded to one ring's worth per pass so input is
+   * looked at again even while the container floods the PTY.  A hung-up
+   * master is no longer watched, so nothing would bring us back for the
+   * rest: keep reading it to EOF, a ring at a time, for as long as the
+   * terminal takes the output, and only then wait on stdout. */
+  for (;;) {
+    size_t budget = sizeof(r->to_out.buf);
+    while (!r->master_done && budget > 0) {
+      if (ring_free(&r->to_out) == 0) {
+        if (!r->throttle)
+          break; /* back-pressure: leave the rest in the PTY */
+        r->dropped += RELAY_DROP_CHUNK;
+        ring_consume(&r->to_out, RELAY_DROP_CHUNK);
+      }
+      ssize_t n = ring_fill(r->master_fd, &r->to_out, r->rec);
+      if (n > 0) {
+        budget = (size_t)n < budget ? budget - (size_t)n : 0;
+        continue;
+      }
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0 && errno == EAGAIN && !r->master_hup)
+        break;
+      /* 0 or EIO: every slave fd is closed and the PTY is drained */
+      r->master_done = 1;
+      relay_forget(r, r->master_fd, &r->master_ev);
+    }
+
+    if (ring_flush(r->out_fd, &r->to_out) < 0) {
+      r->out_error = 1;
+      return 1;
+    }
+    if (r->dropped && r->to_out.len == 0) {
+      relay_note_dropped(r);
+      if (ring_flush(r->out_fd, &r->to_out) < 0) {
+        r->out_error = 1;
+        return 1;
+      }
+    }
+    if (!r->master_hup || r->master_done ||
+        (r->to_out.len > 0 && r->out_pollable))
+      break; /* an armed stdout (below) brings us back */
+  }
+  if (r->master_done && (r->to_out.len == 0 || r->throttle))
+    return 1;
+
+  /* Re-arm: only ask for what can be acted on, so a stalled terminal
+   * throttles the container instead of spinning this loop. */
+  if (!r->in_done && r->in_pollable)
+    relay_arm(r, r->in_fd, &r->in_ev,
+              ring_free(&r->to_master) > 0 ? EPOLLIN : 0);
+  if (!r->master_done && !r->master_hup) {
+    uint32_t want = 0;
+    if (r->throttle || ring_free(&r->to_out) > 0)
+      want |= EPOLLIN;
+    if (r->to_master.len > 0)
+      want |= EPOLLOUT;
+    relay_arm(r, r->master_fd, &r->master_ev, want);
   }
+  if (r->out_pollable)
+    relay_arm(r, r->out_fd, &r->out_ev, r->to_out.len > 0 ? EPOLLOUT : 0);
+  return 0;
+}
+
+static int relay_watch(struct ds_pty_relay *r, int fd, uint32_t events) {
+  struct epoll_event ev = {.events = events, .data.fd = fd};
+  return epoll_ctl(r->epfd, EPOLL_CTL_ADD, fd, &ev);
 }
 
-int ds_terminal_proxy(int master_fd) {
+static void relay_nonblock(int fd, int flags) {
+  if (flags >= 0)
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/* Put back the flags ds_relay_open() found, in reverse order, once */
+static void relay_restore_flags(struct ds_pty_relay *r) {
+  if (r->master_flags >= 0)
+    fcntl(r->master_fd, F_SETFL, r->master_flags);
+  if (r->out_flags >= 0)
+    fcntl(r->out_fd, F_SETFL, r->out_flags);
+  if (r->in_flags >= 0)
+    fcntl(r->in_fd, F_SETFL, r->in_flags);
+  r->in_flags = r->out_flags = r->master_flags = -1;
+}
+
+/* write_all() that waits out EAGAIN: stdout may have been non-blocking
+ * before the relay touched it */
+static int relay_write_tail(int fd, const char *buf, size_t len) {
+  while (len > 0) {
+    ssize_t w = write(fd, buf, len);
+    if (w < 0) {
+      if (errno == EAGAIN) {
+        struct pollfd pfd = {.fd = fd, .events = POLLOUT};
+        if (poll(&pfd, 1, -1) < 0 && errno != EINTR)
+          return -1;
+        continue;
+      }
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    buf += w;
+    len -= (size_t)w;
+  }
+  return 0;
+}
+
+int ds_relay_open(struct ds_pty_relay *r, int epfd, int master_fd) {
+  memset(r, 0, sizeof(*r));
+  r->epfd = epfd;
+  r->in_fd = STDIN_FILENO;
+  r->out_fd = STDOUT_FILENO;
+  r->master_fd = master_fd;
+
+  const char *t = getenv("DS_PTY_THROTTLE");
+  r->throttle = t && t[0] && strcmp(t, "0") != 0;
+
+  /* Every fd is non-blocking: a read or write that would block returns
+   * EAGAIN, which the pump treats as "come back later" (never as EOF).
+   * stdin and stdout usually share one open file description with the
+   * user's shell, so all original flags are read before any is changed
+   * and put back on close. */
+  r->in_flags = fcntl(r->in_fd, F_GETFL);
+  r->out_flags = fcntl(r->out_fd, F_GETFL);
+  r->master_flags = fcntl(master_fd, F_GETFL);
+  relay_nonblock(r->in_fd, r->in_flags);
+  relay_nonblock(r->out_fd, r->out_flags);
+  relay_nonblock(master_fd, r->master_flags);
+
+  if (relay_watch(r, master_fd, EPOLLIN) < 0) {
+    relay_restore_flags(r);
+    return -1;
+  }
+  r->master_ev = EPOLLIN;
+
+  /* Regular files and /dev/null cannot be polled (EPERM).  Such a stdin
+   * counts as already at EOF; such a stdout never blocks anyway. */
+  r->in_pollable = relay_watch(r, r->in_fd, EPOLLIN) == 0;
+  if (r->in_pollable)
+    r->in_ev = EPOLLIN;
+  else
+    r->in_done = 1;
+  r->out_pollable = relay_watch(r, r->out_fd, 0) == 0;
+  return 0;
+}
+
+/* Feed one epoll event to the relay.  Returns 1 once it is finished. */
+int ds_relay_event(struct ds_pty_relay *r, int fd, uint32_t events) {
+  if (fd == r->out_fd && (events & (EPOLLERR | EPOLLHUP))) {
+    r->out_error = 1;
+    return 1;
+  }
+
+  int done = relay_pump(r);
+
+  /* Hangups are reported even on a disarmed fd; stop watching so a full
+   * ring cannot turn them into a busy loop.  A hung-up master is still
+   * read to exhaustion as the output ring drains. */
+  if (!done && (events & (EPOLLERR | EPOLLHUP))) {
+    if (fd == r->in_fd && !r->in_done) {
+      r->in_done = 1;
+      relay_forget(r, r->in_fd, &r->in_ev);
+      if (r->eof_ends)
+        done = 1;
+    } else if (fd == r->master_fd && !r->master_done && !r->master_hup) {
+      r->master_hup = 1;
+      relay_forget(r, r->master_fd, &r->master_ev);
+      done = relay_pump(r);
+    }
+  }
+  return done;
+}
+
+void ds_relay_close(struct ds_pty_relay *r) {
+  relay_restore_flags(r);
+
+  /* Hand the tail of the output to the terminal, blocking again
+   * unless it was non-blocking to begin with.  A
+   * throttled relay keeps only the newest RELAY_TAIL_KEEP bytes (the last
+   * screen, usually) so exit never waits on a slow terminal. */
+  if (r->throttle && r->to_out.len > RELAY_TAIL_KEEP) {
+    size_t skip = r->to_out.len - RELAY_TAIL_KEEP;
+    r->dropped += skip;
+    ring_consume(&r->to_out, skip);
+  }
+  if (!r->out_error && r->to_out.len > 0) {
+    struct iovec iov[2];
+    int cnt = ring_data_iov(&r->to_out, iov);
+    for (int i = 0; i < cnt; i++)
+      if (relay_write_tail(r->out_fd, iov[i].iov_base, iov[i].iov_len) < 0)
+        break;
+  }
+  r->to_out.len = r->to_out.head = 0;
+  if (!r->out_error && r->dropped) {
+    relay_note_dropped(r);
+    if (r->to_out.len > 0)
+      relay_write_tail(r->out_fd, r->to_out.buf, r->to_out.len);
+    r->to_out.len = 0;
+  }
+}
+
+int ds_terminal_proxy(int master_fd, struct ds_recorder *rec) {
   int epfd = epoll_create1(EPOLL_CLOEXEC);
   if (epfd < 0)
     return -1;
 
-  struct epoll_event ev, events[10];
-  char buf[8192];
-
-  /* NOTE: Do NOT set O_NONBLOCK on STDIN or master_fd here.
-   * This is an epoll-driven loop - read() is only called after epoll_wait()
-   * signals readability, so it will never block.  O_NONBLOCK causes read() to
-   * return -1 EAGAIN between events, which the n<=0 EOF check then
-   * misinterprets as a hangup, closes master_fd, and sends EIO to the slave
-   * (bash), killing the session. */
+  /* 128 KiB of rings: keep them off the stack */
+  static struct ds_pty_relay relay;
+  struct epoll_event events[10];
 
   /* Propagate initial window size */
-  update_terminal_size(master_fd);
+  update_terminal_size(master_fd, NULL);
 
   struct sigaction sa;
   sa.sa_handler = handle_sigwinch;
@@ -181,28 +552,21 @@ int ds_terminal_proxy(int master_fd) {
   sa.sa_flags = SA_RESTART;
   sigaction(SIGWINCH, &sa, NULL);
 
-  /* 1. Watch stdin */
-  ev.events = EPOLLIN;
-  ev.data.fd = STDIN_FILENO;
-  if (epoll_ctl(epfd, EPOLL_CTL_ADD, STDIN_FILENO, &ev) < 0) {
-    close(epfd);
-    return -1;
-  }
-
-  /* 2. Watch master PTY */
-  ev.events = EPOLLIN | EPOLLHUP | EPOLLERR;
-  ev.data.fd = master_fd;
-  if (epoll_ctl(epfd, EPOLL_CTL_ADD, master_fd, &ev) < 0) {
+  if (ds_relay_open(&relay, epfd, master_fd) < 0) {
+    ds_relay_close(&relay);
+    sigaction(SIGWINCH, &(struct sigaction){.sa_handler = SIG_DFL}, NULL);
     close(epfd);
     return -1;
   }
+  relay.eof_ends = 1;
+  relay.rec = rec;
 
   int running = 1;
   while (running) {
     int nfds = epoll_wait(epfd, events, 10, -1);
     if (g_sigwinch_received) {
       g_sigwinch_received = 0;
-      update_terminal_size(master_fd);
+      update_terminal_size(master_fd, rec);
     }
 
     if (nfds < 0) {
@@ -211,38 +575,13 @@ int ds_terminal_proxy(int master_fd) {
       break;
     }
 
-    for (int i = 0; i < nfds; i++) {
-      int fd = events[i].data.fd;
-
-      if (fd == STDIN_FILENO) {
-        ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
-        if (n <= 0) {
-          running = 0;
-          break;
-        }
-        if (write_all(master_fd, buf, (size_t)n) < 0) {
-          running = 0;
-          break;
-        }
-      } else if (fd == master_fd) {
-        if (events[i].events & (EPOLLHUP | EPOLLERR)) {
-          running = 0;
-          break;
-        }
-        ssize_t n = read(master_fd, buf, sizeof(buf));
-        if (n > 0) {
-          if (write_all(STDOUT_FILENO, buf, (size_t)n) < 0) {
-            running = 0;
-            break;
-          }
-        } else {
-          running = 0;
-          break;
-        }
-      }
+    for (int i = 0; i < nfds && running; i++) {
+      if (ds_relay_event(&relay, events[i].data.fd, events[i].events))
+        running = 0;
     }
   }
 
+  ds_relay_close(&relay);
   sigaction(SIGWINCH, &(struct sigaction){.sa_handler = SIG_DFL}, NULL);
   close(epfd);
 
@@ -8,6 +8,9 @@
 #include "droidspace.h"
 #include <ctype.h>
 #include <ftw.h>
+#include <malloc.h>
+#include <strings.h>
+#include <sys/mman.h>
 #include <sys/xattr.h>
 #include <time.h>
 
@@ -906,6 +909,187 @@ int run_command_log(char *const argv[]) {
   return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
 }
 
+/* ---------------------------------------------------------------------------
+ * JSON output
+ * ---------------------------------------------------------------------------*/
+
+/* Length of the well-formed UTF-8 sequence at p (RFC 3629: no overlongs,
+ * surrogates or code points past U+10FFFF), 0 if invalid, or -1 if p holds
+ * a valid prefix cut off by end */
+int ds_utf8_seq(const unsigned char *p, const unsigned char *end) {
+  int n;
+  unsigned char lo = 0x80, hi = 0xBF; /* allowed range of the 2nd byte */
+  if (p[0] < 0x80)
+    return 1;
+  if (p[0] >= 0xC2 && p[0] <= 0xDF) {
+    n = 2;
+  } else if (p[0] >= 0xE0 && p[0] <= 0xEF) {
+    n = 3;
+    if (p[0] == 0xE0)
+      lo = 0xA0; /* overlong */
+    else if (p[0] == 0xED)
+      hi = 0x9F; /* UTF-16 surrogates */
+  } else if (p[0] >= 0xF0 && p[0] <= 0xF4) {
+    n = 4;
+    if (p[0] == 0xF0)
+      lo = 0x90; /* overlong */
+    else if (p[0] == 0xF4)
+      hi = 0x8F; /* past U+10FFFF */
+  } else {
+    return 0;
+  }
+  for (int i = 1; i < n; i++) {
+    if (p + i >= end)
+      return -1;
+    if (i == 1 ? (p[1] < lo || p[1] > hi) : (p[i] & 0xC0) != 0x80)
+      return 0;
+  }
+  return n;
+}
+
+/* Write s[0..len) as a quoted JSON string.  Embedded NULs are escaped, and
+ * so is every byte that is not part of valid UTF-8 (as \u00XX), so the
+ * output is always valid JSON whatever a command printed. */
+void ds_json_put_str(FILE *f, const char *s, size_t len) {
+  const unsigned char *p = (const unsigned char *)s, *end = p + len;
+  fputc('"', f);
+  while (p < end) {
+    unsigned char c = *p;
+    int n = ds_utf8_seq(p, end);
+    if (n > 1) {
+      fwrite(p, 1, (size_t)n, f);
+      p += n;
+      continue;
+    }
+    if (n <= 0)
+      fprintf(f, "\\u%04x", c);
+    else if (c == '"' || c == '\\')
+      fprintf(f, "\\%c", c);
+    else if (c == '\n')
+      fputs("\\n", f);
+    else if (c == '\t')
+      fputs("\\t", f);
+    else if (c < 0x20)
+      fprintf(f, "\\u%04x", c);
+    else
+      fputc(c, f);
+    p++;
+  }
+  fputc('"', f);
+}
+
+/* ---------------------------------------------------------------------------
+ * JSON input
+ * ---------------------------------------------------------------------------*/
+
+char *ds_json_skip_ws(char *p, const char *end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+    p++;
+  return p;
+}
+
+static char *json_put_utf8(char *w, unsigned cp) {
+  if (cp < 0x80) {
+    *w++ = (char)cp;
+  } else if (cp < 0x800) {
+    *w++ = (char)(0xC0 | (cp >> 6));
+    *w++ = (char)(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    *w++ = (char)(0xE0 | (cp >> 12));
+    *w++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+    *w++ = (char)(0x80 | (cp & 0x3F));
+  } else {
+    *w++ = (char)(0xF0 | (cp >> 18));
+    *w++ = (char)(0x80 | ((cp >> 12) & 0x3F));
+    *w++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+    *w++ = (char)(0x80 | (cp & 0x3F));
+  }
+  return w;
+}
+
+static int json_hex4(const char *p, const char *end, unsigned *out) {
+  if (end - p < 4)
+    return -1;
+  unsigned v = 0;
+  for (int i = 0; i < 4; i++) {
+    int c = (unsigned char)p[i];
+    v <<= 4;
+    if (c >= '0' && c <= '9')
+      v |= (unsigned)(c - '0');
+    else if (c >= 'a' && c <= 'f')
+      v |= (unsigned)(c - 'a' + 10);
+    else if (c >= 'A' && c <= 'F')
+      v |= (unsigned)(c - 'A' + 10);
+    else
+      return -1;
+  }
+  *out = v;
+  return 0;
+}
+
+/* Decode the JSON string at *pp ('"' included) in place.  Escapes never
+ * expand, so the NUL-terminated result fits where the literal was.  The
+ * decoded length is stored in *len_out when given; it only differs from
+ * strlen() when the string carried a \u0000 escape. */
+char *ds_json_get_str(char **pp, const char *end, size_t *len_out) {
+  char *p = *pp + 1, *start = p, *w = p;
+
+  while (p < end && *p != '"') {
+    if (*p != '\\') {
+      *w++ = *p++;
+      continue;
+    }
+    if (++p >= end)
+      return NULL;
+    char e = *p++;
+    switch (e) {
+    case '"':
+    case '\\':
+    case '/':
+      *w++ = e;
+      break;
+    case 'b':
+      *w++ = '\b';
+      break;
+    case 'f':
+      *w++ = '\f';
+      break;
+    case 'n':
+      *w++ = '\n';
+      break;
+    case 'r':
+      *w++ = '\r';
+      break;
+    case 't':
+      *w++ = '\t';
+      break;
+    case 'u': {
+      unsigned cp, lo;
+      if (json_hex4(p, end, &cp) < 0)
+        return NULL;
+      p += 4;
+      if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' &&
+          p[1] == 'u' && json_hex4(p + 2, end, &lo) == 0 && lo >= 0xDC00 &&
+          lo < 0xE000) {
+        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+        p += 6;
+      }
+      w = json_put_utf8(w, cp);
+      break;
+    }
+    default:
+      return NULL;
+    }
+  }
+  if (p >= end)
+    return NULL;
+  *w = '\0';
+  *pp = p + 1;
+  if (len_out)
+    *len_out = (size_t)(w - start);
+  return start;
+}
+
 /* ---------------------------------------------------------------------------
  * FD Passing (SCM_RIGHTS)
  * ---------------------------------------------------------------------------*/
@@ -956,6 +1140,74 @@ int ds_recv_fd(int sock) {
   return *((int *)CMSG_DATA(cmsg));
 }
 
+/* ---------------------------------------------------------------------------
+ * Monitor footprint (helper threads, boot-only memory)
+ * ---------------------------------------------------------------------------*/
+
+/* Start a helper thread on a DS_THREAD_STACK_SIZE stack.  The monitor runs
+ * its services from the event loop (ds_evloop.c); the only user left is the
+ * session recorder's writer (record.c), whose deepest path (asciicast
+ * encoding into a heap buffer -> stdio) needs well under 64 KiB, against
+ * glibc's default of 8 MiB of address space.  Returns 0, or -1 with errno
+ * set. */
+int ds_thread_create(pthread_t *tid, int detached, void *(*fn)(void *),
+                     void *arg) {
+  pthread_attr_t attr;
+  int rc = pthread_attr_init(&attr);
+  if (rc == 0) {
+    pthread_attr_setstacksize(&attr, DS_THREAD_STACK_SIZE);
+    if (detached)
+      pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    rc = pthread_create(tid, &attr, fn, arg);
+    pthread_attr_destroy(&attr);
+  }
+  if (rc != 0) {
+    errno = rc;
+    return -1;
+  }
+  return 0;
+}
+
+/* Called by the monitor once a boot cycle is up.  Everything below the
+ * caller's frame on the main stack is dead: CLI parsing, config loading
+ * and the start_rootfs() setup frames.  Those pages stay resident (and are
+ * inherited by every intermediate fork) until handed back, so drop them,
+ * sparing DS_STACK_TRIM_SLACK under this frame for the madvise call itself
+ * (dropped pages simply fault back in zeroed if the stack grows again).
+ * Free heap left by config parsing is returned too (glibc only; musl's
+ * allocator unmaps freed spans by itself). */
+void ds_release_boot_memory(void) {
+  uintptr_t lo = 0, hi = 0;
+  char line[256];
+
+  FILE *f = fopen("/proc/self/maps", "re");
+  if (f) {
+    while (fgets(line, sizeof(line), f)) {
+      if (strstr(line, "[stack]")) {
+        unsigned long a, b;
+        if (sscanf(line, "%lx-%lx", &a, &b) == 2) {
+          lo = (uintptr_t)a;
+          hi = (uintptr_t)b;
+        }
+        break;
+      }
+    }
+    fclose(f);
+  }
+
+  uintptr_t sp = (uintptr_t)__builtin_frame_address(0);
+  uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+  if (lo && sp > lo && sp < hi && sp - lo > DS_STACK_TRIM_SLACK) {
+    uintptr_t top = (sp - DS_STACK_TRIM_SLACK) & ~(page - 1);
+    if (top > lo)
+      madvise((void *)lo, top - lo, MADV_DONTNEED);
+  }
+
+#ifdef __GLIBC__
+  malloc_trim(0);
+#endif
+}
+
 /* ---------------------------------------------------------------------------
  * System helpers
  * ---------------------------------------------------------------------------*/
@@ -971,6 +1223,17 @@ int get_kernel_version(int *major, int *minor) {
   return 0;
 }
 
+/* Host boot_id (36 chars): changes on every boot, keys per-boot caches */
+int get_boot_id(char *buf, size_t size) {
+  char tmp[64];
+  if (size < 37 ||
+      read_file("/proc/sys/kernel/random/boot_id", tmp, sizeof(tmp)) < 0 ||
+      strlen(tmp) != 36)
+    return -1;
+  memcpy(buf, tmp, 37);
+  return 0;
+}
+
 void check_kernel_recommendation(void) {
   int major = 0, minor = 0;
   if (get_kernel_version(&major, &minor) < 0)
@@ -1027,8 +1290,67 @@ static void write_to_log_file(const char *name, const char *component,
   fclose(f);
 }
 
+/* Subsystem tags whose non-error lines go to the log file only.  Indexed by
+ * enum ds_log_subsys so DS_DEBUG=<name> parsing can share the table; the
+ * trailing [DEBUG] entry has no subsystem bit of its own. */
+static const struct {
+  const char *tag;
+  size_t len;
+} ds_log_quiet_tags[] = {
+    {"[NET]", 5},  {"[IPT]", 5},    {"[DNS]", 5},  {"[DHCP]", 6},
+    {"[SEC]", 5},  {"[GPU]", 5},    {"[FW]", 4},   {"[CGROUP]", 8},
+    {"[VIRT]", 6}, {"[DAEMON]", 8}, {"[DEBUG]", 7}, {"[HOTPLUG]", 9},
+};
+
+static int log_has_quiet_tag(const char *s) {
+  if (s[0] != '[')
+    return 0;
+  for (size_t i = 0; i < sizeof(ds_log_quiet_tags) / sizeof(ds_log_quiet_tags[0]);
+       i++) {
+    if (strncmp(s, ds_log_quiet_tags[i].tag, ds_log_quiet_tags[i].len) == 0)
+      return 1;
+  }
+  return 0;
+}
+
+/* Parse a DS_DEBUG spec ("net,dns", "all", "0") into ds_log_debug_mask.
+ * Unknown names are ignored so an old binary tolerates newer specs. */
+void ds_log_debug_init(const char *spec) {
+  ds_log_debug_mask = 0;
+  if (!spec || !spec[0])
+    return;
+
+  char buf[256];
+  safe_strncpy(buf, spec, sizeof(buf));
+  char *saveptr;
+  for (char *tok = strtok_r(buf, ", ", &saveptr); tok;
+       tok = strtok_r(NULL, ", ", &saveptr)) {
+    if (strcasecmp(tok, "all") == 0 || strcmp(tok, "1") == 0) {
+      ds_log_debug_mask = (1u << DS_LOG_SUBSYS_COUNT) - 1;
+      continue;
+    }
+    for (int i = 0; i < DS_LOG_SUBSYS_COUNT; i++) {
+      const char *tag = ds_log_quiet_tags[i].tag + 1; /* skip '[' */
+      size_t len = ds_log_quiet_tags[i].len - 2;
+      if (strlen(tok) == len && strncasecmp(tok, tag, len) == 0) {
+        ds_log_debug_mask |= 1u << i;
+        break;
+      }
+    }
+  }
+}
+
 void ds_log_internal(const char *prefix, const char *color, int is_err,
                      const char *fmt, ...) {
+  /* Decide where the line goes before paying for vsnprintf.  Tagged lines
+   * are file-only, so without a container log they are dropped unformatted.
+   * Tags are always literal in fmt, so checking fmt is equivalent to
+   * checking the formatted message. */
+  int to_file = ds_log_container_name[0] != '\0';
+  int to_term = is_err || (!ds_log_silent && !log_has_quiet_tag(fmt));
+  if (!to_file && !to_term)
+    return;
+
   char raw_msg[8192];
   va_list ap;
   va_start(ap, fmt);
@@ -1036,27 +1358,12 @@ void ds_log_internal(const char *prefix, const char *color, int is_err,
   va_end(ap);
 
   /* Always log to file if container name is known */
-  if (ds_log_container_name[0]) {
+  if (to_file)
     write_to_log_file(ds_log_container_name, "main", raw_msg);
-  }
 
-  /* Decide if we should print to terminal */
-  if (ds_log_silent && !is_err)
+  if (!to_term)
     return;
 
-  /* Filter out [DEBUG] and [IPT] prefixes from terminal output */
-  if (!is_err) {
-    if (strncmp(raw_msg, "[DEBUG]", 7) == 0 ||
-        strncmp(raw_msg, "[IPT]", 5) == 0 ||
-        strncmp(raw_msg, "[NET]", 5) == 0 ||
-        strncmp(raw_msg, "[SEC]", 5) == 0 ||
-        strncmp(raw_msg, "[GPU]", 5) == 0 ||
-        strncmp(raw_msg, "[DNS]", 5) == 0 || strncmp(raw_msg, "[FW]", 4) == 0 ||
-        strncmp(raw_msg, "[DHCP]", 6) == 0) {
-      return;
-    }
-  }
-
   FILE *out = is_err ? stderr : stdout;
   fprintf(out,
           "["
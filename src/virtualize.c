@@ -31,18 +31,70 @@ static int write_file_inplace(const char *path, const char *content) {
     return 0;
 }
 
+/* Open a host procfs file, from the injected root when one is set */
+static FILE *vsrc_open(const struct ds_vsource *src, const char *name) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s",
+             (src && src->proc_root) ? src->proc_root : "/proc", name);
+    return fopen(path, "r");
+}
+
+static int vsrc_host_cpus(const struct ds_vsource *src) {
+    if (src && src->host_cpus > 0) return src->host_cpus;
+    int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? n : 1;
+}
+
+/* CPUs the container may see: its CFS quota rounded up, capped at the host */
+static int vcpu_count(const struct ds_vsource *src, struct ds_config *cfg) {
+    int host_cpus = vsrc_host_cpus(src);
+    int cpus = host_cpus;
+    if (cfg->cpu_quota > 0 && cfg->cpu_period > 0) {
+        cpus = (int)((cfg->cpu_quota + cfg->cpu_period - 1) / cfg->cpu_period);
+        if (cpus < 1) cpus = 1;
+        if (cpus > host_cpus) cpus = host_cpus;
+    }
+    return cpus;
+}
+
+/* Memory limit and usage in bytes, from the injected cgroup directory when
+ * one is set (v2 layout) or from the container's live cgroup otherwise */
+static void vsrc_mem(const struct ds_vsource *src, struct ds_config *cfg,
+                     long long *limit, long long *usage) {
+    if (!src || !src->cgroup_dir) {
+        ds_cgroup_get_limits(cfg, limit, NULL, NULL, NULL);
+        ds_cgroup_get_usage(cfg, usage, NULL, NULL);
+        return;
+    }
+
+    char path[PATH_MAX];
+    char buf[256];
+    *limit = -1;
+    *usage = -1;
+    snprintf(path, sizeof(path), "%s/memory.max", src->cgroup_dir);
+    if (read_file(path, buf, sizeof(buf)) > 0)
+        *limit = strncmp(buf, "max", 3) == 0 ? 0 : atoll(buf);
+    snprintf(path, sizeof(path), "%s/memory.current", src->cgroup_dir);
+    if (read_file(path, buf, sizeof(buf)) > 0) *usage = atoll(buf);
+}
+
 /* Helper to read cgroup v2 memory.stat */
-static void get_cgroup_v2_mem_stat(struct ds_config *cfg, long long *anon, long long *file, long long *slab) {
+static void get_cgroup_v2_mem_stat(const struct ds_vsource *src, struct ds_config *cfg,
+                                   long long *anon, long long *file, long long *slab) {
     char path[PATH_MAX * 2];
     char buf[4096];
 
     /* Try common locations for memory.stat - using explicit snprintf calls
      * to avoid -Werror=format-nonliteral. */
-    snprintf(path, sizeof(path), "/sys/fs/cgroup/droidspaces/%s/memory.stat", cfg->container_name);
-    if (access(path, R_OK) != 0)
-        snprintf(path, sizeof(path), "/sys/fs/cgroup/%s/memory.stat", cfg->container_name);
-    if (access(path, R_OK) != 0)
-        snprintf(path, sizeof(path), "/sys/fs/cgroup/memory/droidspaces/%s/memory.stat", cfg->container_name);
+    if (src && src->cgroup_dir) {
+        snprintf(path, sizeof(path), "%s/memory.stat", src->cgroup_dir);
+    } else {
+        snprintf(path, sizeof(path), "/sys/fs/cgroup/droidspaces/%s/memory.stat", cfg->container_name);
+        if (access(path, R_OK) != 0)
+            snprintf(path, sizeof(path), "/sys/fs/cgroup/%s/memory.stat", cfg->container_name);
+        if (access(path, R_OK) != 0)
+            snprintf(path, sizeof(path), "/sys/fs/cgroup/memory/droidspaces/%s/memory.stat", cfg->container_name);
+    }
 
     if (read_file(path, buf, sizeof(buf)) > 0) {
         char *p;
@@ -64,14 +116,14 @@ unsigned long ds_get_pid_ns_inode(pid_t pid) {
 /*
  * Generate virtualized /proc/meminfo
  */
-int ds_virtualize_meminfo(struct ds_config *cfg, char **buf_out, size_t *size_out) {
+int ds_virtualize_meminfo(struct ds_config *cfg, const struct ds_vsource *src,
+                          char **buf_out, size_t *size_out) {
     long long mem_limit = -1, mem_usage = -1;
-    ds_cgroup_get_limits(cfg, &mem_limit, NULL, NULL, NULL);
-    ds_cgroup_get_usage(cfg, &mem_usage, NULL, NULL);
+    vsrc_mem(src, cfg, &mem_limit, &mem_usage);
 
     if (mem_usage < 0) mem_usage = 0;
 
-    FILE *f = fopen("/proc/meminfo", "r");
+    FILE *f = vsrc_open(src, "meminfo");
     if (!f) return -1;
 
     long long host_total = 0;
@@ -85,6 +137,10 @@ int ds_virtualize_meminfo(struct ds_config *cfg, char **buf_out, size_t *size_ou
     if (mem_limit <= 0 && cfg->memory_limit > 0) {
         mem_limit = cfg->memory_limit;
     }
+    /* A limit above physical RAM is no limit at all */
+    if (mem_limit > host_total * 1024 && host_total > 0) {
+        mem_limit = host_total * 1024;
+    }
 
     double ratio = 1.0;
     if (mem_limit > 0 && host_total > 0) {
@@ -92,7 +148,7 @@ int ds_virtualize_meminfo(struct ds_config *cfg, char **buf_out, size_t *size_ou
     }
 
     long long cg_anon = -1, cg_file = -1, cg_slab = -1;
-    get_cgroup_v2_mem_stat(cfg, &cg_anon, &cg_file, &cg_slab);
+    get_cgroup_v2_mem_stat(src, cfg, &cg_anon, &cg_file, &cg_slab);
 
     size_t cap = 16384;
     char *buf = malloc(cap);
@@ -163,16 +219,11 @@ int ds_virtualize_meminfo(struct ds_config *cfg, char **buf_out, size_t *size_ou
 /*
  * Generate virtualized /proc/cpuinfo
  */
-int ds_virtualize_cpuinfo(struct ds_config *cfg, char **buf_out, size_t *size_out) {
-    int host_cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
-    int max_cpus = host_cpus;
-    if (cfg->cpu_quota > 0 && cfg->cpu_period > 0) {
-        max_cpus = (int)((cfg->cpu_quota + cfg->cpu_period - 1) / cfg->cpu_period);
-        if (max_cpus < 1) max_cpus = 1;
-        if (max_cpus > host_cpus) max_cpus = host_cpus;
-    }
+int ds_virtualize_cpuinfo(struct ds_config *cfg, const struct ds_vsource *src,
+                          char **buf_out, size_t *size_out) {
+    int max_cpus = vcpu_count(src, cfg);
 
-    FILE *f = fopen("/proc/cpuinfo", "r");
+    FILE *f = vsrc_open(src, "cpuinfo");
     if (!f) return -1;
 
     size_t cap = 65536;
@@ -187,7 +238,11 @@ int ds_virtualize_cpuinfo(struct ds_config *cfg, char **buf_out, size_t *size_ou
         if (sscanf(line, "processor : %d", &cpu_id) == 1) {
             current_cpu = cpu_id;
         }
-        if (current_cpu >= max_cpus) break;
+        /* Drop hidden CPUs' blocks but keep the SoC-wide lines some kernels
+         * print after the last one (armv7: Hardware, Revision, Serial) */
+        int hidden = current_cpu >= max_cpus;
+        if (line[0] == '\n') current_cpu = -1;
+        if (hidden) continue;
 
         size_t len = strlen(line);
         if (offset + len + 1 >= cap) {
@@ -209,16 +264,11 @@ int ds_virtualize_cpuinfo(struct ds_config *cfg, char **buf_out, size_t *size_ou
 /*
  * Generate virtualized /proc/stat
  */
-int ds_virtualize_stat(struct ds_config *cfg, char **buf_out, size_t *size_out) {
-    int host_cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
-    int max_cpus = host_cpus;
-    if (cfg->cpu_quota > 0 && cfg->cpu_period > 0) {
-        max_cpus = (int)((cfg->cpu_quota + cfg->cpu_period - 1) / cfg->cpu_period);
-        if (max_cpus < 1) max_cpus = 1;
-        if (max_cpus > host_cpus) max_cpus = host_cpus;
-    }
+int ds_virtualize_stat(struct ds_config *cfg, const struct ds_vsource *src,
+                       char **buf_out, size_t *size_out) {
+    int max_cpus = vcpu_count(src, cfg);
 
-    FILE *f = fopen("/proc/stat", "r");
+    FILE *f = vsrc_open(src, "stat");
     if (!f) return -1;
 
     size_t cap = 65536;
@@ -233,7 +283,8 @@ int ds_virtualize_stat(struct ds_config *cfg, char **buf_out, size_t *size_out)
 
     while (fgets(line, sizeof(line), f)) {
         int cpu_id;
-        if (sscanf(line, "cpu%d", &cpu_id) == 1) {
+        /* "cpu%d" alone would also match the aggregate "cpu  <user>" line */
+        if (isdigit((unsigned char)line[3]) && sscanf(line, "cpu%d", &cpu_id) == 1) {
             if (cpu_id < max_cpus) {
                 unsigned long long u = 0, n = 0, s = 0, i = 0, io = 0, ir = 0, si = 0, st = 0, gu = 0, gn = 0;
                 sscanf(line, "cpu%*d %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
@@ -283,7 +334,8 @@ int ds_virtualize_stat(struct ds_config *cfg, char **buf_out, size_t *size_out)
 /*
  * Generate virtualized /proc/uptime
  */
-int ds_virtualize_uptime(struct ds_config *cfg, char **buf_out, size_t *size_out) {
+int ds_virtualize_uptime(struct ds_config *cfg, const struct ds_vsource *src,
+                         char **buf_out, size_t *size_out) {
     struct timespec now;
     clock_gettime(CLOCK_MONOTONIC, &now);
 
@@ -291,7 +343,7 @@ int ds_virtualize_uptime(struct ds_config *cfg, char **buf_out, size_t *size_out
                 (double)(now.tv_nsec - cfg->start_time.tv_nsec) / 1e9;
     if (up < 0) up = 0;
 
-    FILE *f = fopen("/proc/uptime", "r");
+    FILE *f = vsrc_open(src, "uptime");
     if (!f) return -1;
     double host_up, host_idle;
     if (fscanf(f, "%lf %lf", &host_up, &host_idle) != 2) {
@@ -300,12 +352,8 @@ int ds_virtualize_uptime(struct ds_config *cfg, char **buf_out, size_t *size_out
     }
     fclose(f);
 
-    int host_cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
-    int container_cpus = host_cpus;
-    if (cfg->cpu_quota > 0 && cfg->cpu_period > 0) {
-        container_cpus = (int)((cfg->cpu_quota + cfg->cpu_period - 1) / cfg->cpu_period);
-        if (container_cpus < 1) container_cpus = 1;
-    }
+    int host_cpus = vsrc_host_cpus(src);
+    int container_cpus = vcpu_count(src, cfg);
 
     double idle = host_idle * ((double)container_cpus / host_cpus);
     if (idle > up * container_cpus) idle = up * container_cpus;
@@ -320,14 +368,9 @@ int ds_virtualize_uptime(struct ds_config *cfg, char **buf_out, size_t *size_out
 /*
  * Generate virtualized CPU range for sysfs (e.g. 0-3)
  */
-int ds_virtualize_cpu_sysfs(struct ds_config *cfg, char **buf_out, size_t *size_out) {
-    int host_cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
-    int container_cpus = host_cpus;
-    if (cfg->cpu_quota > 0 && cfg->cpu_period > 0) {
-        container_cpus = (int)((cfg->cpu_quota + cfg->cpu_period - 1) / cfg->cpu_period);
-        if (container_cpus < 1) container_cpus = 1;
-        if (container_cpus > host_cpus) container_cpus = host_cpus;
-    }
+int ds_virtualize_cpu_sysfs(struct ds_config *cfg, const struct ds_vsource *src,
+                            char **buf_out, size_t *size_out) {
+    int container_cpus = vcpu_count(src, cfg);
 
     char *buf = malloc(64);
     if (!buf) return -1;
@@ -344,15 +387,12 @@ int ds_virtualize_cpu_sysfs(struct ds_config *cfg, char **buf_out, size_t *size_
 /*
  * Generate virtualized /proc/loadavg
  */
-int ds_virtualize_loadavg(struct ds_config *cfg, char **buf_out, size_t *size_out) {
-    int host_cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
-    int container_cpus = host_cpus;
-    if (cfg->cpu_quota > 0 && cfg->cpu_period > 0) {
-        container_cpus = (int)((cfg->cpu_quota + cfg->cpu_period - 1) / cfg->cpu_period);
-        if (container_cpus < 1) container_cpus = 1;
-    }
+int ds_virtualize_loadavg(struct ds_config *cfg, const struct ds_vsource *src,
+                          char **buf_out, size_t *size_out) {
+    int host_cpus = vsrc_host_cpus(src);
+    int container_cpus = vcpu_count(src, cfg);
 
-    FILE *f = fopen("/proc/loadavg", "r");
+    FILE *f = vsrc_open(src, "loadavg");
     if (!f) return -1;
 
     double l1, l5, l15;
@@ -388,14 +428,14 @@ int ds_virtualize_init(struct ds_config *cfg) {
     }
 
     const char *files[] = {"meminfo", "cpuinfo", "stat", "uptime", "loadavg"};
-    int (*funcs[])(struct ds_config *, char **, size_t *) = {
+    int (*funcs[])(struct ds_config *, const struct ds_vsource *, char **, size_t *) = {
         ds_virtualize_meminfo, ds_virtualize_cpuinfo, ds_virtualize_stat, ds_virtualize_uptime, ds_virtualize_loadavg
     };
 
     for (size_t i = 0; i < ARRAY_SIZE(files); i++) {
         char *vbuf = NULL;
         size_t vsz = 0;
-        if (funcs[i](cfg, &vbuf, &vsz) == 0) {
+        if (funcs[i](cfg, NULL, &vbuf, &vsz) == 0) {
             char path[PATH_MAX * 2];
             snprintf(path, sizeof(path), "%s/%s", vproc_path, files[i]);
             if (write_file(path, vbuf) < 0) {
@@ -422,7 +462,7 @@ int ds_virtualize_init(struct ds_config *cfg) {
         for (size_t i = 0; i < ARRAY_SIZE(cpu_files); i++) {
             char *vbuf = NULL;
             size_t vsz = 0;
-            if (ds_virtualize_cpu_sysfs(cfg, &vbuf, &vsz) == 0) {
+            if (ds_virtualize_cpu_sysfs(cfg, NULL, &vbuf, &vsz) == 0) {
                 char path[PATH_MAX * 2];
                 snprintf(path, sizeof(path), "%s/%s", cpu_sys_base, cpu_files[i]);
                 if (write_file(path, vbuf) == 0) {
@@ -454,12 +494,12 @@ void ds_virtualize_update(struct ds_config *cfg) {
     }
 
     const char *files[] = {"meminfo", "stat", "uptime", "loadavg"};
-    int (*funcs[])(struct ds_config *, char **, size_t *) = {
+    int (*funcs[])(struct ds_config *, const struct ds_vsource *, char **, size_t *) = {
         ds_virtualize_meminfo, ds_virtualize_stat, ds_virtualize_uptime, ds_virtualize_loadavg
     };
 
     for (size_t i = 0; i < ARRAY_SIZE(files); i++) {
-        if (funcs[i](cfg, &vbuf, &vsz) == 0) {
+        if (funcs[i](cfg, NULL, &vbuf, &vsz) == 0) {
             snprintf(path, sizeof(path), "/proc/%d/root/run/droidspaces/vproc/%s", cfg->container_pid, files[i]);
             struct stat st;
             if (stat(path, &st) == 0) {
@@ -10,23 +10,40 @@
 
 #include "droidspace.h"
 
+/*
+ * Where the generators read host state from. NULL (or a zeroed field)
+ * means the live host: /proc, the container's cgroup and sysconf(). Set
+ * by the fixture checker to replay captured device inputs.
+ */
+struct ds_vsource {
+    const char *proc_root;  /* directory holding meminfo, stat, cpuinfo... */
+    const char *cgroup_dir; /* container cgroup v2 directory (memory.*) */
+    int host_cpus;          /* online host CPUs */
+};
+
 /* Generate virtualized /proc/meminfo content */
-int ds_virtualize_meminfo(struct ds_config *cfg, char **buf_out, size_t *size_out);
+int ds_virtualize_meminfo(struct ds_config *cfg, const struct ds_vsource *src,
+                          char **buf_out, size_t *size_out);
 
 /* Generate virtualized /proc/cpuinfo content */
-int ds_virtualize_cpuinfo(struct ds_config *cfg, char **buf_out, size_t *size_out);
+int ds_virtualize_cpuinfo(struct ds_config *cfg, const struct ds_vsource *src,
+                          char **buf_out, size_t *size_out);
 
 /* Generate virtualized /proc/stat content */
-int ds_virtualize_stat(struct ds_config *cfg, char **buf_out, size_t *size_out);
+int ds_virtualize_stat(struct ds_config *cfg, const struct ds_vsource *src,
+                       char **buf_out, size_t *size_out);
 
 /* Generate virtualized /proc/uptime content */
-int ds_virtualize_uptime(struct ds_config *cfg, char **buf_out, size_t *size_out);
+int ds_virtualize_uptime(struct ds_config *cfg, const struct ds_vsource *src,
+                         char **buf_out, size_t *size_out);
 
 /* Generate virtualized /proc/loadavg content */
-int ds_virtualize_loadavg(struct ds_config *cfg, char **buf_out, size_t *size_out);
+int ds_virtualize_loadavg(struct ds_config *cfg, const struct ds_vsource *src,
+                          char **buf_out, size_t *size_out);
 
 /* Generate virtualized CPU range for sysfs (e.g. 0-3) */
-int ds_virtualize_cpu_sysfs(struct ds_config *cfg, char **buf_out, size_t *size_out);
+int ds_virtualize_cpu_sysfs(struct ds_config *cfg, const struct ds_vsource *src,
+                            char **buf_out, size_t *size_out);
 
 /* Initialize virtual proc directory in container rootfs (pre-pivot) */
 int ds_virtualize_init(struct ds_config *cfg);
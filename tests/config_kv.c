@@ -0,0 +1,99 @@
+/*
+ * Droidspaces v5 - `config set` key/value checks
+ *
+ * Feeds ds_config_set_kv() the values `droidspaces config set` can receive,
+ * then saves and reloads the config to make sure every accepted setting
+ * stays on its own line.  A line break in a key or value must be rejected:
+ * "hostname=abc\nprivileged=full" would otherwise save a second, managed
+ * key.
+ *
+ * Exits non-zero when any check fails. Built and run by `make check`.
+ *
+ * Copyright (C) 2026 ravindu644 <droidcasts@protonmail.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "droidspace.h"
+
+/* Provided by main.c in the real binary */
+int ds_log_silent = 1;
+char ds_log_container_name[256] = "";
+
+static int g_failures;
+
+static void kv_fail(const char *what, const char *detail) {
+  printf("FAIL %s: %s\n", what, detail);
+  g_failures++;
+}
+
+static void kv_init(struct ds_config *cfg) {
+  memset(cfg, 0, sizeof(*cfg));
+  cfg->net_ready_pipe[0] = cfg->net_ready_pipe[1] = -1;
+  cfg->net_done_pipe[0] = cfg->net_done_pipe[1] = -1;
+  safe_strncpy(cfg->container_name, "kvtest", sizeof(cfg->container_name));
+}
+
+static void kv_free(struct ds_config *cfg) {
+  free_config_unknown_lines(cfg);
+  free_config_env_vars(cfg);
+  free_config_binds(cfg);
+}
+
+static const struct {
+  const char *key;
+  const char *val;
+  int ok;
+} cases[] = {
+    {"hostname", "abc", 1},
+    {"hostname", "abc\nprivileged=full", 0},
+    {"hostname", "abc\rprivileged=full", 0},
+    {"dns_servers", "1.1.1.1\nselinux_permissive=1", 0},
+    {"app_label", "x\nprivileged=full", 0},
+    {"app\nprivileged", "full", 0},
+    {"app_label", "kept", 1},
+    {NULL, NULL, 0}};
+
+int main(void) {
+  struct ds_config cfg;
+  char errbuf[256];
+
+  kv_init(&cfg);
+  for (int i = 0; cases[i].key; i++) {
+    errbuf[0] = '\0';
+    int ok = ds_config_set_kv(&cfg, cases[i].key, cases[i].val, errbuf,
+                              sizeof(errbuf)) == 0;
+    if (ok != cases[i].ok)
+      kv_fail(cases[i].key, ok ? "accepted a value with a line break"
+                               : errbuf);
+  }
+  if (strcmp(cfg.hostname, "abc") != 0)
+    kv_fail("hostname", "rejected value changed the config");
+
+  /* Whatever was accepted must read back as the same settings */
+  char dir[] = "/tmp/ds-config-kv.XXXXXX";
+  if (!mkdtemp(dir)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s/container.config", dir);
+  if (ds_config_save(path, &cfg) != 0)
+    kv_fail("save", path);
+  kv_free(&cfg);
+
+  kv_init(&cfg);
+  if (ds_config_load(path, &cfg) != 0) {
+    kv_fail("load", path);
+  } else {
+    if (strcmp(cfg.hostname, "abc") != 0)
+      kv_fail("reload", "hostname did not survive the round trip");
+    if (cfg.privileged_mask != 0)
+      kv_fail("reload", "an injected privileged= line was saved");
+  }
+  kv_free(&cfg);
+  unlink(path);
+  rmdir(dir);
+
+  printf("%s: %d failure(s)\n", g_failures ? "FAIL" : "ok", g_failures);
+  return g_failures ? 1 : 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * Droidspaces v5 - JSON string output checks
+ *
+ * ds_json_put_str() writes whatever a command printed (run-batch --json,
+ * session recordings), so binary output must still give valid JSON: each
+ * byte that is not part of well-formed UTF-8 is escaped as \u00XX, while
+ * valid multi-byte sequences pass through untouched.
+ *
+ * Exits non-zero when any check fails. Built and run by `make check`.
+ *
+ * Copyright (C) 2026 ravindu644 <droidcasts@protonmail.com>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "droidspace.h"
+
+/* Provided by main.c in the real binary */
+int ds_log_silent = 1;
+char ds_log_container_name[256] = "";
+
+static const struct {
+  const char *what;
+  const char *in;
+  size_t len;
+  const char *want;
+} cases[] = {
+    {"ascii", "a\"b\\c\n\t", 7, "\"a\\\"b\\\\c\\n\\t\""},
+    {"control", "\x01\x1f", 2, "\"\\u0001\\u001f\""},
+    {"nul", "a\0b", 3, "\"a\\u0000b\""},
+    {"utf8", "\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80", 9,
+     "\"\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\""},
+    {"binary", "\xff\xfe\x80", 3, "\"\\u00ff\\u00fe\\u0080\""},
+    {"overlong", "\xc0\xaf\xe0\x80\xaf", 5,
+     "\"\\u00c0\\u00af\\u00e0\\u0080\\u00af\""},
+    {"surrogate", "\xed\xa0\x80", 3, "\"\\u00ed\\u00a0\\u0080\""},
+    {"past U+10FFFF", "\xf4\x90\x80\x80", 4,
+     "\"\\u00f4\\u0090\\u0080\\u0080\""},
+    {"truncated", "ok\xe2\x82", 4, "\"ok\\u00e2\\u0082\""},
+    {NULL, NULL, 0, NULL}};
+
+int main(void) {
+  int failures = 0;
+  for (int i = 0; cases[i].what; i++) {
+    char *buf = NULL;
+    size_t size = 0;
+    FILE *f = open_memstream(&buf, &size);
+    if (!f) {
+      perror("open_memstream");
+      return 1;
+    }
+    ds_json_put_str(f, cases[i].in, cases[i].len);
+    fclose(f);
+    if (strcmp(buf, cases[i].want) != 0) {
+      printf("FAIL %s: got %s, want %s\n", cases[i].what, buf,
+             cases[i].want);
+      failures++;
+    }
+    free(buf);
+  }
+  printf("%s: %d failure(s)\n", failures ? "FAIL" : "ok", failures);
+  return failures ? 1 : 0;
+}